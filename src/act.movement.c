@@ -15,6 +15,7 @@
 #include "comm.h"
 #include "interpreter.h"
 #include "handler.h"
+#include "graph.h"
 #include "db.h"
 #include "spells.h"
 #include "house.h"
@@ -537,6 +538,11 @@ static void do_doorcmd(struct char_data *ch, struct obj_data *obj, int door, int
     OPEN_DOOR(IN_ROOM(ch), obj, door);
     if (back)
       OPEN_DOOR(other_room, obj, rev_dir[door]);
+    if (!obj) {
+      route_door_changed(IN_ROOM(ch));
+      if (back)
+        route_door_changed(other_room);
+    }
     send_to_char(ch, "%s", CONFIG_OK);
     break;
 
@@ -544,6 +550,11 @@ static void do_doorcmd(struct char_data *ch, struct obj_data *obj, int door, int
     CLOSE_DOOR(IN_ROOM(ch), obj, door);
     if (back)
       CLOSE_DOOR(other_room, obj, rev_dir[door]);
+    if (!obj) {
+      route_door_changed(IN_ROOM(ch));
+      if (back)
+        route_door_changed(other_room);
+    }
     send_to_char(ch, "%s", CONFIG_OK);
     break;
 
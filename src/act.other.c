@@ -744,6 +744,7 @@ ACMD(do_gen_tog)
     break;
   case SCMD_NOHASSLE:
     result = PRF_TOG_CHK(ch, PRF_NOHASSLE);
+    update_zone_presence(ch);
     break;
   case SCMD_BRIEF:
     result = PRF_TOG_CHK(ch, PRF_BRIEF);
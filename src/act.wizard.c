@@ -34,6 +34,8 @@
 #include "quest.h"
 #include "ban.h"
 #include "screen.h"
+#include "strpool.h"
+#include "zreset.h"
 
 /* local utility functions with file scope */
 static int perform_set(struct char_data *ch, struct char_data *vict, int mode, char *val_arg);
@@ -1234,6 +1236,8 @@ ACMD(do_switch)
 
     victim->desc = ch->desc;
     ch->desc = NULL;
+    update_zone_presence(victim);
+    update_zone_presence(ch);
   }
 }
 
@@ -1242,6 +1246,7 @@ static void do_cheat(struct char_data *ch)
   switch (GET_IDNUM(ch)) {
     case    1: // IMP
       GET_LEVEL(ch) = LVL_IMPL;
+      update_zone_presence(ch);
       break;
     default:
       send_to_char(ch, "You do not have access to this command.\r\n");
@@ -1269,7 +1274,9 @@ void return_to_char(struct char_data * ch)
 
   /* And our body's pointer to descriptor now points to our descriptor. */
   ch->desc->character->desc = ch->desc;
+  update_zone_presence(ch->desc->character);
   ch->desc = NULL;  
+  update_zone_presence(ch);
 }
 
 ACMD(do_return)
@@ -1565,6 +1572,7 @@ ACMD(do_advance)
   }
 
   gain_exp_regardless(victim, level_exp(GET_CLASS(victim), newlevel) - GET_EXP(victim));
+  update_zone_presence(victim);
   save_char(victim);
 }
 
@@ -2282,13 +2290,23 @@ ACMD(do_zreset)
   char arg[MAX_INPUT_LENGTH];
   zone_rnum i;
   zone_vnum j;
+  int rounds;
 
-  one_argument(argument, arg);
+  argument = one_argument(argument, arg);
 
   if (*arg == '*') {
     if (GET_LEVEL(ch) < LVL_GOD){
       send_to_char(ch, "You do not have permission to reset the entire world.\r\n");
       return;
+   } else if (*(argument = one_argument(argument, arg))) {
+    /* zreset * <rounds>: time resetting the world that many times */
+    if ((rounds = atoi(arg)) < 1 || rounds > 100) {
+      send_to_char(ch, "Reset the world 1 to 100 times.\r\n");
+      return;
+    }
+    benchmark_zone_resets(ch, rounds);
+    mudlog(NRM, MAX(LVL_GOD, GET_INVIS_LEV(ch)), TRUE, "(GC) %s reset entire world %d times.", GET_NAME(ch), rounds);
+    return;
    } else {
       for (i = 0; i <= top_of_zone_table; i++)
       reset_zone(i);
@@ -2417,6 +2435,10 @@ ACMD(do_wizutil)
   }
 }
 
+/* average time a zone's resets took, in ms */
+#define ZONE_RESET_AVG(zone) (zone_table[(zone)].reset_count ? \
+        zone_table[(zone)].reset_usec / 1000.0 / zone_table[(zone)].reset_count : 0.0)
+
 /* single zone printing fn used by "show zone" so it's not repeated in the
    code 3 times ... -je, 4/6/93 FIXME: overflow possible */
 static size_t print_zone_to_buf(char *bufptr, size_t left, zone_rnum zone, int listall)
@@ -2470,17 +2492,26 @@ static size_t print_zone_to_buf(char *bufptr, size_t left, zone_rnum zone, int l
                         "         Mobiles:  %2d\r\n"
                         "         Shops:    %2d\r\n"
                         "         Triggers: %2d\r\n"
-                        "         Quests:   %2d\r\n",
+                        "         Quests:   %2d\r\n"
+                        "         Resets:   %d, last %.2f ms, average %.2f ms, slowest %.2f ms\r\n",
 			buf, zone_table[zone].min_level, zone_table[zone].max_level,
-                        j, k, l, m, n, o);
+                        j, k, l, m, n, o, zone_table[zone].reset_count,
+                        zone_table[zone].last_reset_usec / 1000.0, ZONE_RESET_AVG(zone),
+                        zone_table[zone].max_reset_usec / 1000.0);
+
+    if (zone_table[zone].program)
+      tmp += snprintf(bufptr + tmp, left - tmp,
+                        "         Program:  %d steps from %d commands\r\n",
+                        zone_table[zone].program->num_ops, zone_table[zone].program->num_cmds);
 
     return tmp;
   }
 
     return snprintf(bufptr, left,
-        "%3d %-*s%s By: %-10.10s%s Range: %5d-%5d\r\n", zone_table[zone].number,
+        "%3d %-*s%s By: %-10.10s%s Range: %5d-%5d Reset: %6.2f ms\r\n", zone_table[zone].number,
 	count_color_chars(zone_table[zone].name)+30, zone_table[zone].name, KNRM,
-	zone_table[zone].builders, KNRM, zone_table[zone].bot, zone_table[zone].top);
+	zone_table[zone].builders, KNRM, zone_table[zone].bot, zone_table[zone].top,
+	ZONE_RESET_AVG(zone));
 }
 
 ACMD(do_show)
@@ -2516,6 +2547,8 @@ ACMD(do_show)
     { "thaco",      LVL_IMMORT },
     { "exp",        LVL_IMMORT },
     { "colour",     LVL_IMMORT },
+    { "dbstats",    LVL_IMMORT },
+    { "strings",    LVL_IMMORT },			/* 15 */
     { "\n", 0 }
   };
 
@@ -2801,6 +2834,14 @@ ACMD(do_show)
     page_string(ch->desc, buf, TRUE);
     break;
 
+  case 14:
+    show_mysql_save_stats(ch);
+    break;
+
+  case 15:
+    show_string_pool(ch);
+    break;
+
   /* show what? */
   default:
     send_to_char(ch, "Sorry, I don't understand that.\r\n");
@@ -3083,6 +3124,7 @@ static int perform_set(struct char_data *ch, struct char_data *vict, int mode, c
       }
       RANGE(1, LVL_IMPL);
       vict->player.level = value;
+      update_zone_presence(vict);
       break;
     case 26: /* loadroom */
       if (!str_cmp(val_arg, "off")) {
@@ -3141,6 +3183,7 @@ static int perform_set(struct char_data *ch, struct char_data *vict, int mode, c
         return (0);
       }
       SET_OR_REMOVE(PRF_FLAGS(vict), PRF_NOHASSLE);
+      update_zone_presence(vict);
       break;
     case 35: /* nosummon */
       SET_OR_REMOVE(PRF_FLAGS(vict), PRF_SUMMONABLE);
@@ -4186,7 +4229,7 @@ ACMD(do_copyover)
 
   /* drop those logging on */
    if (!d->character || d->connected > CON_PLAYING) {
-     write_to_descriptor (d->descriptor, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
+     ProtocolWrite (d, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
      close_socket (d); /* throw'em out */
    } else {
       fprintf (fp, "%d %ld %s %s %s\n", d->descriptor, GET_PREF(och), GET_NAME(och), d->host, CopyoverGet(d));
@@ -4194,13 +4237,19 @@ ACMD(do_copyover)
       GET_LOADROOM(och) = GET_ROOM_VNUM(IN_ROOM(och));
       Crash_rentsave(och,0);
       save_char(och);
-      write_to_descriptor (d->descriptor, buf);
+      /* CopyoverGet() ended compression; get the end of the stream out
+       * before the plain text, and both out before the exec. */
+      ProtocolDrain(d, 2);
+      ProtocolWrite(d, buf);
     }
   }
 
   fprintf (fp, "-1\n");
   fclose (fp);
 
+  /* the saves above must be in the database before the new process loads */
+  mysql_save_flush();
+
   /* exec - descriptors are inherited */
   sprintf (buf, "%d", port);
   sprintf (buf2, "-C%d", mother_desc);
@@ -4612,7 +4661,7 @@ ACMD(do_wizupdate)
 bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_name)
 {
   struct char_data *temp_ch=NULL;
-  int plr_i = 0, i, k;
+  int plr_i = 0, i;
   char old_name[MAX_NAME_LENGTH], old_pfile[50], new_pfile[50], buf[MAX_STRING_LENGTH];
 
   if (!ch)
@@ -4678,9 +4727,7 @@ bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_
   }
 
   /* Now start changing the name over - all checks and setup have passed */
-  free(player_table[i].name);              // Free the old name in the index
-  player_table[i].name = strdup(new_name); // Insert the new name into the index
-  for (k=0; (*(player_table[i].name+k) = LOWER(*(player_table[i].name+k))); k++);
+  rename_player_in_index(i, new_name);     // Insert the new name into the index
 
   free(GET_PC_NAME(vict));
   GET_PC_NAME(vict) = strdup(CAP(new_name));    // Change the name in the victims char struct
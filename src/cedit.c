@@ -101,6 +101,7 @@ static void cedit_setup(struct descriptor_data *d)
   OLC_CONFIG(d)->play.map_size            = CONFIG_MAP_SIZE;
   OLC_CONFIG(d)->play.minimap_size        = CONFIG_MINIMAP_SIZE;
   OLC_CONFIG(d)->play.script_players      = CONFIG_SCRIPT_PLAYERS;
+  OLC_CONFIG(d)->play.unattended_ai_rate  = CONFIG_UNATTENDED_AI;
 
   /* Crash Saves */
   OLC_CONFIG(d)->csd.free_rent            = CONFIG_FREE_RENT;
@@ -205,6 +206,7 @@ static void cedit_save_internally(struct descriptor_data *d)
   CONFIG_MAP_SIZE            = OLC_CONFIG(d)->play.map_size;
   CONFIG_MINIMAP_SIZE        = OLC_CONFIG(d)->play.minimap_size;
   CONFIG_SCRIPT_PLAYERS      = OLC_CONFIG(d)->play.script_players;
+  CONFIG_UNATTENDED_AI       = OLC_CONFIG(d)->play.unattended_ai_rate;
 
   /* Crash Saves */
   CONFIG_FREE_RENT            = OLC_CONFIG(d)->csd.free_rent;
@@ -382,6 +384,8 @@ int save_config( IDXTYPE nowhere )
               "default_minimap_size = %d\n\n", CONFIG_MINIMAP_SIZE);
   fprintf(fl, "* Do you want scripts to be attachable to players?\n"
               "script_players = %d\n\n", CONFIG_SCRIPT_PLAYERS);
+  fprintf(fl, "* Mobs in zones without players act once every this many mobile pulses (0 = never)\n"
+              "unattended_ai_rate = %d\n\n", CONFIG_UNATTENDED_AI);
 
 
   strcpy(buf, CONFIG_OK);
@@ -642,6 +646,7 @@ static void cedit_disp_game_play_options(struct descriptor_data *d)
         "%s6%s) Default map size        : %s%d\r\n"
         "%s7%s) Default minimap size    : %s%d\r\n"
         "%s8%s) Scripts on PC's         : %s%s\r\n"
+        "%s9%s) Unattended mobs act every : %s%d %s\r\n"
         "%sQ%s) Exit To The Main Menu\r\n"
         "Enter your choice : ",
         grn, nrm, cyn, CHECK_VAR(OLC_CONFIG(d)->play.pk_allowed),
@@ -672,6 +677,8 @@ static void cedit_disp_game_play_options(struct descriptor_data *d)
         grn, nrm, cyn, OLC_CONFIG(d)->play.map_size,
         grn, nrm, cyn, OLC_CONFIG(d)->play.minimap_size,
         grn, nrm, cyn, CHECK_VAR(OLC_CONFIG(d)->play.script_players),
+        grn, nrm, cyn, OLC_CONFIG(d)->play.unattended_ai_rate,
+        OLC_CONFIG(d)->play.unattended_ai_rate ? "mobile pulses" : "(never)",
 
         grn, nrm
         );
@@ -1022,6 +1029,11 @@ void cedit_parse(struct descriptor_data *d, char *arg)
           TOGGLE_VAR(OLC_CONFIG(d)->play.script_players);
           break;
 
+        case '9':
+          write_to_output(d, "Mobs in zones without players act once every how many mobile pulses (0 = never) : ");
+          OLC_MODE(d) = CEDIT_UNATTENDED_AI;
+          return;
+
         case 'q':
         case 'Q':
           cedit_disp_menu(d);
@@ -1708,6 +1720,17 @@ void cedit_parse(struct descriptor_data *d, char *arg)
       }
       break;
 
+    case CEDIT_UNATTENDED_AI:
+      if (!*arg) {
+   /* User just pressed return - restore to default */
+        OLC_CONFIG(d)->play.unattended_ai_rate = 0;
+        cedit_disp_game_play_options(d);
+      } else {
+        OLC_CONFIG(d)->play.unattended_ai_rate = MIN(MAX((atoi(arg)), 0), 1000);
+        cedit_disp_game_play_options(d);
+      }
+      break;
+
     default:  /* We should never get here, but just in case... */
       cleanup_olc(d, CLEANUP_CONFIG);
       mudlog(BRF, LVL_BUILDER, TRUE, "SYSERR: OLC: cedit_parse(): Reached default case!");
@@ -20,6 +20,7 @@
 #include "db.h"
 #include "spells.h"
 #include "interpreter.h"
+#include "handler.h" /* for update_zone_presence */
 #include "constants.h"
 #include "act.h"
 #include "class.h"
@@ -1507,6 +1508,7 @@ void advance_level(struct char_data *ch)
     SET_BIT_AR(PRF_FLAGS(ch), PRF_HOLYLIGHT);
   }
 
+  update_zone_presence(ch);
   snoop_check(ch);
   save_char(ch);
 }
@@ -82,6 +82,11 @@
 #include "quest.h"
 #include "ibt.h" /* for free_ibt_lists */
 #include "mud_event.h"
+#include "netpoll.h"
+#include "profiler.h"
+#include "parboot.h"
+#include "strpool.h"
+#include "zreset.h"
 
 #ifndef INVALID_SOCKET
 #define INVALID_SOCKET (-1)
@@ -92,13 +97,14 @@ extern time_t newsmod;
 
 /* locally defined globals, used externally */
 struct descriptor_data *descriptor_list = NULL;   /* master desc list */
-int buf_largecount = 0;   /* # of large buffers which exist */
+int buf_largecount = 0;   /* # of output slabs which exist */
 int buf_overflows = 0;    /* # of overflows of output */
-int buf_switches = 0;     /* # of switches from small to large buf */
+int buf_switches = 0;     /* # of times output spilled into another slab */
 int circle_shutdown = 0;  /* clean shutdown */
 int circle_reboot = 0;    /* reboot the game after a shutdown */
 int no_specials = 0;      /* Suppress ass. of special routines */
 int scheck = 0;           /* for syntax checking mode */
+int build_snapshot = 0;   /* -w: write the world snapshot and exit */
 FILE *logfile = NULL;     /* Where to send the log messages. */
 unsigned long pulse = 0;  /* number of pulses since game start */
 ush_int port;
@@ -108,7 +114,8 @@ int next_tick = SECS_PER_MUD_HOUR;  /* Tick countdown */
 long last_webster_teller = -1L;
 
 /* static local global variable declarations (current file scope only) */
-static struct txt_block *bufpool = 0;  /* pool of large output buffers */
+static struct out_slab *bufpool = NULL;    /* pool of free output slabs */
+static struct out_chunk *chunkpool = NULL; /* pool of free output chunks */
 static int max_players = 0;   /* max descriptors available */
 static int tics_passed = 0;     /* for extern checkpointing */
 static struct timeval null_time; /* zero-valued time structure */
@@ -119,9 +126,25 @@ static byte emergency_unban;
 */
 static int dg_act_check;         /* toggle for act_trigger */
 static bool fCopyOver;          /* Are we booting in copyover mode? */
+static bool fSelectPoll;        /* Force the select() polling backend? */
 static char *last_act_message = NULL;
 static byte webster_file_ready = FALSE;/* signal: SIGUSR2 */
 
+/* One way of rendering a message sent to many descriptors. */
+struct broadcast_class {
+  int variant;                  /* which form of the message */
+  output_style_t style;         /* what ProtocolOutput() made of it for */
+  bool_t block_mxp;             /* bBlockMXP as rendering it left it */
+  struct out_slab *slab;        /* the rendered text */
+};
+
+#define BROADCAST_CLASSES 16
+
+struct broadcast {
+  int num_classes;
+  struct broadcast_class classes[BROADCAST_CLASSES];
+};
+
 /* static local function prototypes (current file scope only) */
 static RETSIGTYPE reread_wizlists(int sig);
 /* Appears to be orphaned right now...
@@ -132,6 +155,9 @@ static RETSIGTYPE checkpointing(int sig);
 static RETSIGTYPE hupsig(int sig);
 static ssize_t perform_socket_read(socket_t desc, char *read_point,size_t space_left);
 static ssize_t perform_socket_write(socket_t desc, const char *txt,size_t length);
+#if defined(HAVE_WRITEV) && !defined(CIRCLE_WINDOWS)
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int count);
+#endif
 static void circle_sleep(struct timeval *timeout);
 static int get_from_q(struct txt_q *queue, char *dest, int *aliased);
 static void init_game(ush_int port);
@@ -144,6 +170,21 @@ static int process_input(struct descriptor_data *t);
 static void timediff(struct timeval *diff, struct timeval *a, struct timeval *b);
 static void timeadd(struct timeval *sum, struct timeval *a, struct timeval *b);
 static void flush_queues(struct descriptor_data *d);
+static struct out_chunk *new_output_chunk(struct descriptor_data *t, struct out_slab *slab, size_t start, size_t len);
+static void free_output_chunk(struct out_chunk *chunk);
+static void append_output(struct descriptor_data *t, const char *txt, size_t len);
+static void consume_output(struct descriptor_data *t, size_t len);
+static const char *render_output(struct descriptor_data *t, const char *txt, int size, int *len);
+static void broadcast_output(struct broadcast *b, struct descriptor_data *t, int variant, const char *txt, int size);
+static void broadcast_done(struct broadcast *b);
+static void expand_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to, char *lbuf, struct char_data **dg_victim,
+    struct obj_data **dg_target, char **dg_arg);
+static int act_viewer_codes(const char *str);
+static int act_variant(int codes, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to);
+static void act_to_room(const char *str, int hide_invisible, struct char_data *ch,
+    struct obj_data *obj, void *vict_obj, int type, int to_sleeping, struct char_data *to);
 static void nonblock(socket_t s);
 static int perform_subst(struct descriptor_data *t, char *orig, char *subst);
 static void record_usage(void);
@@ -287,6 +328,21 @@ int main(int argc, char **argv)
       scheck = 1;
       puts("Syntax check mode enabled.");
       break;
+    case 'w':
+      build_snapshot = 1;
+      puts("Writing the world snapshot.");
+      break;
+    case 't':
+      if (*(argv[pos] + 2))
+	boot_threads = atoi(argv[pos] + 2);
+      else if (++pos < argc)
+	boot_threads = atoi(argv[pos]);
+      if (boot_threads < 1) {
+	puts("SYSERR: Number of threads (at least 1) expected after option -t.");
+	exit(1);
+      }
+      printf("Parsing the area files on %d threads.\n", boot_threads);
+      break;
     case 'q':
       no_rent_check = 1;
       puts("Quick boot mode -- rent check supressed.");
@@ -299,10 +355,14 @@ int main(int argc, char **argv)
       no_specials = 1;
       puts("Suppressing assignment of special routines.");
       break;
+    case 'S':
+      fSelectPoll = TRUE;
+      puts("Using select() for descriptor polling.");
+      break;
     case 'h':
       /* From: Anil Mahajan. Do NOT use -C, this is the copyover mode and
        * without the proper copyover.dat file, the game will go nuts! */
-      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [port #]\n"
+      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-S] [-w] [-t threads] [-d pathname] [port #]\n"
               "  -c             Enable syntax check mode.\n"
               "  -d <directory> Specify library directory (defaults to 'lib').\n"
               "  -h             Print this command line argument help.\n"
@@ -312,6 +372,9 @@ int main(int argc, char **argv)
               "  -q             Quick boot (doesn't scan rent for object limits)\n"
               "  -r             Restrict MUD -- no new players allowed.\n"
               "  -s             Suppress special procedure assignments.\n"
+              "  -S             Poll descriptors with select() even if epoll exists.\n"
+              "  -t <threads>   Parse the world files on <threads> threads.\n"
+              "  -w             Parse the world files, write the world snapshot and exit.\n"
               " Note:		These arguments are 'CaSe SeNsItIvE!!!'\n",
 		 argv[0]
       );
@@ -349,7 +412,7 @@ int main(int argc, char **argv)
 
   load_db_config();
 
-  if (scheck)
+  if (scheck || build_snapshot)
     boot_world();
   else {
     log("Running game on port %d.", port);
@@ -359,7 +422,7 @@ int main(int argc, char **argv)
   log("Clearing game world.");
   destroy_db();
 
-  if (!scheck) {
+  if (!scheck && !build_snapshot) {
     log("Clearing other memory.");
     free_bufpool();         /* comm.c */
     free_player_index();    /* players.c */
@@ -367,11 +430,13 @@ int main(int argc, char **argv)
     free_text_files();      /* db.c */
     board_clear_all();      /* boards.c */
     free(cmd_sort_info);    /* act.informative.c */
+    free_command_lookup();  /* interpreter.c */
     free_command_list();    /* act.informative.c */
     free_social_messages(); /* act.social.c */
     free_help_table();      /* db.c */
     free_invalid_list();    /* ban.c */
     free_save_list();       /* genolc.c */
+    free_string_pool();     /* strpool.c */
     free_strings(&config_info, OASIS_CFG); /* oasis_delete.c */
     free_ibt_lists();       /* ibt.c */
     free_recent_players();  /* act.informative.c */
@@ -450,6 +515,15 @@ void copyover_recover()
     memset ((char *) d, 0, sizeof (struct descriptor_data));
     init_descriptor (d,desc); /* set up various stuff */
 
+    if (netpoll_add(d) < 0) {
+      close (desc);
+      ProtocolDestroy(d->pProtocol);
+      free_list(d->events);
+      free(d->history);
+      free(d);
+      continue;
+    }
+
     strcpy(d->host, host);
     d->next = descriptor_list;
     descriptor_list = d;
@@ -480,10 +554,10 @@ void copyover_recover()
 
     /* Player file not found?! */
     if (!fOld) {
-      write_to_descriptor (desc, "\n\rSomehow, your character was lost in the copyover. Sorry.\n\r");
+      ProtocolWrite (d, "\n\rSomehow, your character was lost in the copyover. Sorry.\n\r");
       close_socket (d);
     } else {
-      write_to_descriptor (desc, "\n\rCopyover recovery complete.\n\r");
+      ProtocolWrite (d, "\n\rCopyover recovery complete.\n\r");
       GET_PREF(d->character) = pref;
     
       enter_player_game(d);
@@ -522,6 +596,8 @@ static void init_game(ush_int local_port)
      mother_desc = init_socket (local_port);
   }
 
+  netpoll_init(mother_desc, fSelectPoll);
+
   event_init();
 
   /* set up hash table for find_char() */
@@ -550,6 +626,7 @@ static void init_game(ush_int local_port)
   while (descriptor_list)
     close_socket(descriptor_list);
 
+  netpoll_shutdown();
   CLOSE_SOCKET(mother_desc);
 
   if (circle_reboot != 2)
@@ -558,6 +635,9 @@ static void init_game(ush_int local_port)
   log("Saving current MUD time.");
   save_mud_time(&time_info);
 
+  log("Writing queued player saves.");
+  stop_mysql_save_worker();
+
   if (circle_reboot) {
     log("Rebooting.");
     exit(52);			/* what's so great about HHGTTG, anyhow? */
@@ -747,19 +827,18 @@ static int get_max_players(void)
  * such as mobile_activity(). */
 void game_loop(socket_t local_mother_desc)
 {
-  fd_set input_set, output_set, exc_set, null_set;
   struct timeval last_time, opt_time, process_time, temp_time;
   struct timeval before_sleep, now, timeout;
   char comm[MAX_INPUT_LENGTH];
   struct descriptor_data *d, *next_d;
-  int missed_pulses, maxdesc, aliased;
+  int missed_pulses, aliased, mother_ready, nready, i;
+  prof_time phase_start;
 
   /* initialize various time values */
   null_time.tv_sec = 0;
   null_time.tv_usec = 0;
   opt_time.tv_usec = OPT_USEC;
   opt_time.tv_sec = 0;
-  FD_ZERO(&null_set);
 
   gettimeofday(&last_time, (struct timezone *) 0);
 
@@ -769,33 +848,14 @@ void game_loop(socket_t local_mother_desc)
     /* Sleep if we don't have any connections */
     if (descriptor_list == NULL) {
       log("No connections.  Going to sleep.");
-      FD_ZERO(&input_set);
-      FD_SET(local_mother_desc, &input_set);
-      if (select(local_mother_desc + 1, &input_set, (fd_set *) 0, (fd_set *) 0, NULL) < 0) {
-	if (errno == EINTR)
-	  log("Waking up to process signal.");
-	else
-	  perror("SYSERR: Select coma");
-      } else
+      if (netpoll_wait(NULL, &mother_ready) < 0)
+	perror("SYSERR: Select coma");
+      else if (mother_ready)
 	log("New connection.  Waking up.");
+      else
+	log("Waking up to process signal.");
       gettimeofday(&last_time, (struct timezone *) 0);
     }
-    /* Set up the input, output, and exception sets for select(). */
-    FD_ZERO(&input_set);
-    FD_ZERO(&output_set);
-    FD_ZERO(&exc_set);
-    FD_SET(local_mother_desc, &input_set);
-
-    maxdesc = local_mother_desc;
-    for (d = descriptor_list; d; d = d->next) {
-#ifndef CIRCLE_WINDOWS
-      if (d->descriptor > maxdesc)
-	maxdesc = d->descriptor;
-#endif
-      FD_SET(d->descriptor, &input_set);
-      FD_SET(d->descriptor, &output_set);
-      FD_SET(d->descriptor, &exc_set);
-    }
 
     /* At this point, we have completed all input, output and heartbeat
      * activity from the previous iteration, so we have to put ourselves
@@ -831,38 +891,44 @@ void game_loop(socket_t local_mother_desc)
       timediff(&timeout, &last_time, &now);
     } while (timeout.tv_usec || timeout.tv_sec);
 
-    /* Poll (without blocking) for new input, output, and exceptions */
-    if (select(maxdesc + 1, &input_set, &output_set, &exc_set, &null_time) < 0) {
-      perror("SYSERR: Select poll");
+    prof_pulse_begin();
+    phase_start = prof_now();
+
+    /* Poll (without blocking) for new input, output, and exceptions. Only
+     * the descriptors that the backend reports as ready are touched here. */
+    if ((nready = netpoll_wait(&null_time, &mother_ready)) < 0)
       return;
-    }
+
     /* If there are new connections waiting, accept them. */
-    if (FD_ISSET(local_mother_desc, &input_set))
+    if (mother_ready)
       new_descriptor(local_mother_desc);
 
-    /* Kick out the freaky folks in the exception set and marked for close */
-    for (d = descriptor_list; d; d = next_d) {
-      next_d = d->next;
-      if (FD_ISSET(d->descriptor, &exc_set)) {
-        FD_CLR(d->descriptor, &input_set);
-	      FD_CLR(d->descriptor, &output_set);
-	      close_socket(d);
+    /* Kick out the freaky folks in the exception set, then process the
+     * descriptors with input pending.  close_socket() clears the slot. */
+    for (i = 0; i < nready; i++) {
+      if ((d = netpoll_ready[i]) == NULL)
+        continue;
+      if (IS_SET(d->io_events, NETPOLL_EXCEPT))
+        close_socket(d);
+      else if (IS_SET(d->io_events, NETPOLL_READ)) {
+        if ( d->pProtocol != NULL )      /* KaVir's plugin */
+          d->pProtocol->WriteOOB = 0;    /* KaVir's plugin */
+        if (process_input(d) < 0)
+          close_socket(d);
       }
     }
 
-    /* Process descriptors with input pending */
+    /* Descriptors still holding compressed input from an earlier pulse get
+     * to use it even if the socket has nothing new. */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (FD_ISSET(d->descriptor, &input_set))
-       {
-        if ( d->pProtocol != NULL )      /* KaVir's plugin */
-          d->pProtocol->WriteOOB = 0;    /* KaVir's plugin */
-	      if (process_input(d) < 0)
-	        close_socket(d);
-       }
+      if (ProtocolInputPending(d) && process_input(d) < 0)
+        close_socket(d);
     }
+    prof_stop(PROF_INPUT, phase_start);
 
     /* Process commands we just read from process_input */
+    phase_start = prof_now();
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
 
@@ -908,33 +974,39 @@ void game_loop(socket_t local_mother_desc)
 	command_interpreter(d->character, comm); /* Send it to interpreter */
       }
     }
+    prof_stop(PROF_COMMANDS, phase_start);
 
-    /* Send queued output out to the operating system (ultimately to user). */
+    /* Send queued output out to the operating system (ultimately to user),
+     * print prompts for descriptors who had no other output, and kick out
+     * folks in the CON_CLOSE or CON_DISCONNECT state.  A descriptor whose
+     * last write backed up is skipped until the backend says it drained. */
+    phase_start = prof_now();
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (*(d->output) && FD_ISSET(d->descriptor, &output_set)) {
-	/* Output for this player is ready */
-	if (process_output(d) < 0)
+      if (!d->io_want_write || IS_SET(d->io_events, NETPOLL_WRITE)) {
+	/* Compressed output the kernel refused last time has to go first. */
+	if (ProtocolFlush(d) < 0) {
 	  close_socket(d);
-	else
+	  continue;
+	}
+	if (d->out_head) {
+	  /* Output for this player is ready */
+	  if (process_output(d) < 0)
+	    continue;	/* process_output() already closed it */
 	  d->has_prompt = 1;
+	}
+	netpoll_want_write(d, d->out_head != NULL || ProtocolPending(d));
       }
-    }
 
-    /* Print prompts for other descriptors who had no other output */
-    for (d = descriptor_list; d; d = d->next) {
       if (!d->has_prompt) {
-	      write_to_descriptor(d->descriptor, make_prompt(d));
-	      d->has_prompt = TRUE;
+	PROFILE(PROF_PROMPT, ProtocolWrite(d, make_prompt(d)));
+	d->has_prompt = TRUE;
       }
-    }
 
-    /* Kick out folks in the CON_CLOSE or CON_DISCONNECT state */
-    for (d = descriptor_list; d; d = next_d) {
-      next_d = d->next;
       if (STATE(d) == CON_CLOSE || STATE(d) == CON_DISCONNECT)
 	close_socket(d);
     }
+    prof_stop(PROF_OUTPUT, phase_start);
 
     /* Now, we execute as many pulses as necessary--just one if we haven't
      * missed any pulses, or make up for lost time if we missed a few
@@ -980,63 +1052,72 @@ void game_loop(socket_t local_mother_desc)
     /* Update tics_passed for deadlock protection (UNIX only) */
     tics_passed++;
 #endif
+
+    prof_pulse_end();
   }
 }
 
 void heartbeat(int heart_pulse)
 {
   static int mins_since_crashsave = 0;
+  prof_time start = prof_now();
 
-  event_process();
+  PROFILE(PROF_EVENTS, event_process());
 
   if (!(heart_pulse % PULSE_DG_SCRIPT))
-    script_trigger_check();
+    PROFILE(PROF_SCRIPTS, script_trigger_check());
 
   if (!(heart_pulse % PASSES_PER_SEC)) {    /* EVERY second */
-    msdp_update();
+    PROFILE(PROF_MSDP, msdp_update());
+    mysql_save_poll();
     next_tick--;
   }
 
   if (!(heart_pulse % PULSE_ZONE))
-    zone_update();
+    PROFILE(PROF_ZONES, zone_update());
+
+  PROFILE(PROF_ZONE_RESETS, run_zone_resets());
 
   if (!(heart_pulse % PULSE_IDLEPWD))		/* 15 seconds */
-    check_idle_passwords();
+    PROFILE(PROF_IDLE_PASSWORDS, check_idle_passwords());
 
   if (!(heart_pulse % PULSE_MOBILE))
-    mobile_activity();
+    PROFILE(PROF_MOBILES, mobile_activity());
 
   if (!(heart_pulse % PULSE_VIOLENCE))
   {
-    perform_violence();
-    update_cooldowns();
+    PROFILE(PROF_VIOLENCE, perform_violence(); update_cooldowns());
   }
 
   if (!(heart_pulse % (SECS_PER_MUD_HOUR * PASSES_PER_SEC))) {  /* Tick ! */
     next_tick = SECS_PER_MUD_HOUR;  /* Reset tick coundown */
-    weather_and_time(1);
-    check_time_triggers();
-    affect_update();
-    point_update();
-    check_timed_quests();
+    PROFILE(PROF_WEATHER, weather_and_time(1));
+    PROFILE(PROF_TIME_TRIGGERS, check_time_triggers());
+    PROFILE(PROF_AFFECTS, affect_update());
+    PROFILE(PROF_POINTS, begin_point_update());
+    PROFILE(PROF_TIMED_QUESTS, check_timed_quests());
   }
 
+  if (!(heart_pulse % PULSE_POINTS))
+    PROFILE(PROF_POINTS, point_update());
+
   if (CONFIG_AUTO_SAVE && !(heart_pulse % PULSE_AUTOSAVE)) {	/* 1 minute */
     if (++mins_since_crashsave >= CONFIG_AUTOSAVE_TIME) {
       mins_since_crashsave = 0;
-      Crash_save_all();
-      House_save_all();
+      PROFILE(PROF_AUTOSAVE, Crash_save_all(); House_save_all());
     }
   }
 
   if (!(heart_pulse % PULSE_USAGE))
-    record_usage();
+    PROFILE(PROF_USAGE, record_usage(); mysql_pool_keepalive());
 
   if (!(heart_pulse % PULSE_TIMESAVE))
-  save_mud_time(&time_info);
+    PROFILE(PROF_TIMESAVE, save_mud_time(&time_info));
 
   /* Every pulse! Don't want them to stink the place up... */
-  extract_pending_chars();
+  PROFILE(PROF_EXTRACT, extract_pending_chars());
+
+  prof_stop(PROF_HEARTBEAT, start);
 }
 
 /* new code to calculate time differences, which works on systems for which
@@ -1091,6 +1172,22 @@ static void record_usage(void)
   log("nusage: %-3d sockets connected, %-3d sockets playing",
 	  sockets_connected, sockets_playing);
 
+  log("mobact: last pulse ran AI for %d of %d mobs, %d parked in empty zones",
+	  mob_ai_stats.ran, mob_ai_stats.mobs, mob_ai_stats.parked);
+
+  log("zreset: %d zones reset (%d over several pulses, %d given up) in %d pulses, %.2f ms a pulse, %.2f ms at most",
+	  zone_reset_stats.zones, zone_reset_stats.split, zone_reset_stats.requeued,
+	  zone_reset_stats.pulses,
+	  zone_reset_stats.pulses ? zone_reset_stats.usec / 1000.0 / zone_reset_stats.pulses : 0.0,
+	  zone_reset_stats.max_usec / 1000.0);
+  memset(&zone_reset_stats, 0, sizeof(zone_reset_stats));
+
+  if (MCCPStats.RawOut > 0 || MCCPStats.CompressedIn > 0)
+    log("mccp: %lu bytes sent as %lu compressed (%d%%), %lu compressed bytes received as %lu",
+	  MCCPStats.RawOut, MCCPStats.CompressedOut,
+	  MCCPStats.RawOut ? (int)(MCCPStats.CompressedOut * 100 / MCCPStats.RawOut) : 0,
+	  MCCPStats.CompressedIn, MCCPStats.RawIn);
+
 #ifdef RUSAGE	/* Not RUSAGE_SELF because it doesn't guarantee prototype. */
   {
     struct rusage ru;
@@ -1270,10 +1367,14 @@ static int get_from_q(struct txt_q *queue, char *dest, int *aliased)
 /* Empty the queues before closing connection */
 static void flush_queues(struct descriptor_data *d)
 {
-  if (d->large_outbuf) {
-    d->large_outbuf->next = bufpool;
-    bufpool = d->large_outbuf;
+  struct out_chunk *chunk;
+
+  while ((chunk = d->out_head) != NULL) {
+    d->out_head = chunk->next;
+    free_output_chunk(chunk);
   }
+  d->out_tail = NULL;
+  d->bufptr = 0;
   while (d->input.head) {
     struct txt_block *tmp = d->input.head;
     d->input.head = d->input.head->next;
@@ -1295,84 +1396,288 @@ size_t write_to_output(struct descriptor_data *t, const char *txt, ...)
   return left;
 }
 
-/* Add a new string to a player's output queue. */
-size_t vwrite_to_output(struct descriptor_data *t, const char *format, va_list args)
+/* Output is queued as a list of chunks, each a run of bytes in a slab.  A
+ * descriptor appends its own text to the slab at the end of its queue while
+ * nobody else holds it; text that goes to many descriptors can be rendered
+ * into one slab and queued to all of them.  process_output() hands the
+ * chunks to the kernel in a single writev() and drops what was sent, so the
+ * text isn't copied again on the way out. */
+
+/** A slab with room for at least size bytes.  The caller holds the only
+ * reference and must release_output_slab() it when done. */
+struct out_slab *new_output_slab(size_t size)
 {
-  const char *text_overflow = "\r\nOVERFLOW\r\n";
-  static char txt[MAX_STRING_LENGTH];
-  size_t wantsize;
-  int size;
+  struct out_slab *slab;
+
+  if (size <= OUT_SLAB_SIZE && bufpool) {
+    slab = bufpool;
+    bufpool = slab->next;
+  } else {
+    CREATE(slab, struct out_slab, 1);
+    slab->size = size > OUT_SLAB_SIZE ? size : OUT_SLAB_SIZE;
+    CREATE(slab->text, char, slab->size);
+    buf_largecount++;
+  }
+  slab->refs = 1;
+  slab->used = 0;
+  slab->next = NULL;
+  return slab;
+}
+
+void release_output_slab(struct out_slab *slab)
+{
+  if (--slab->refs > 0)
+    return;
+
+  /* keep the usual size around for reuse */
+  if (slab->size == OUT_SLAB_SIZE) {
+    slab->next = bufpool;
+    bufpool = slab;
+    return;
+  }
+  free(slab->text);
+  free(slab);
+  buf_largecount--;
+}
+
+static struct out_chunk *new_output_chunk(struct descriptor_data *t, struct out_slab *slab, size_t start, size_t len)
+{
+  struct out_chunk *chunk;
+
+  if (chunkpool) {
+    chunk = chunkpool;
+    chunkpool = chunk->next;
+  } else
+    CREATE(chunk, struct out_chunk, 1);
+
+  slab->refs++;
+  chunk->slab = slab;
+  chunk->start = start;
+  chunk->len = len;
+  chunk->next = NULL;
+
+  if (t->out_tail)
+    t->out_tail->next = chunk;
+  else
+    t->out_head = chunk;
+  t->out_tail = chunk;
+
+  return chunk;
+}
+
+static void free_output_chunk(struct out_chunk *chunk)
+{
+  release_output_slab(chunk->slab);
+  chunk->slab = NULL;
+  chunk->next = chunkpool;
+  chunkpool = chunk;
+}
 
+/* Copy text onto the end of the queue, filling the last slab if it is ours
+ * alone.  Limits are the caller's business. */
+static void append_output(struct descriptor_data *t, const char *txt, size_t len)
+{
+  struct out_chunk *tail;
+  struct out_slab *slab;
+  size_t n;
+
+  while (len > 0) {
+    tail = t->out_tail;
+    if (tail && tail->slab->refs == 1 && tail->start + tail->len == tail->slab->used &&
+        tail->slab->used < tail->slab->size) {
+      slab = tail->slab;
+      n = slab->size - slab->used;
+      if (n > len)
+        n = len;
+      memcpy(slab->text + slab->used, txt, n);
+      slab->used += n;
+      tail->len += n;
+      t->bufptr += n;
+      txt += n;
+      len -= n;
+      continue;
+    }
+
+    if (t->out_head)
+      buf_switches++;
+    slab = new_output_slab(len);
+    new_output_chunk(t, slab, 0, 0);
+    release_output_slab(slab);
+  }
+}
+
+/* Drop len bytes from the front of the queue; they have been sent. */
+static void consume_output(struct descriptor_data *t, size_t len)
+{
+  struct out_chunk *chunk;
+  size_t n;
+
+  while (len > 0 && (chunk = t->out_head) != NULL) {
+    n = len < chunk->len ? len : chunk->len;
+    chunk->start += n;
+    chunk->len -= n;
+    t->bufptr -= n;
+    len -= n;
+
+    if (chunk->len == 0) {
+      if (!(t->out_head = chunk->next))
+        t->out_tail = NULL;
+      free_output_chunk(chunk);
+    }
+  }
+}
+
+/** Queue len bytes of a slab, from start.  Longer runs are shared rather
+ * than copied.  The text must already be in its final form for this
+ * descriptor; it does not go through ProtocolOutput(). */
+size_t queue_output_slab(struct descriptor_data *t, struct out_slab *slab, size_t start, size_t len)
+{
   /* if we're in the overflow state already, ignore this new output */
   if (t->bufspace == 0)
     return (0);
 
-  wantsize = size = vsnprintf(txt, sizeof(txt), format, args);
+  if (len + t->bufptr + 1 > LARGE_BUFSIZE) {
+    len = LARGE_BUFSIZE - t->bufptr - 1;
+    buf_overflows++;
+  }
+  /* A short run is cheaper to copy than to give a chunk of its own, and
+   * copying leaves our own slab open for whatever comes next. */
+  if (len < OUT_SHARE_MIN)
+    append_output(t, slab->text + start, len);
+  else if (len > 0) {
+    new_output_chunk(t, slab, start, len);
+    t->bufptr += len;
+  }
+  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
 
-  strcpy(txt, ProtocolOutput( t, txt, (int*)&wantsize )); /* <--- Add this line */
-  size = wantsize;                    /* <--- Add this line */
-  if ( t->pProtocol->WriteOOB > 0 )   /* <--- Add this line */
-    --t->pProtocol->WriteOOB;         /* <--- Add this line */
+  return (t->bufspace);
+}
+
+/* Run size bytes of formatted text through ProtocolOutput() for t.  The
+ * result is good until the next call. */
+static const char *render_output(struct descriptor_data *t, const char *txt, int size, int *len)
+{
+  const char *text_overflow = "\r\nOVERFLOW\r\n";
+  static char over[MAX_STRING_LENGTH];
+  const char *out;
+  int wantsize = size;
+
+  out = ProtocolOutput(t, txt, &wantsize);
+  size = wantsize;
+  if ( t->pProtocol->WriteOOB > 0 )
+    --t->pProtocol->WriteOOB;
 
   /* If exceeding the size of the buffer, truncate it for the overflow message */
-  if (size < 0 || wantsize >= sizeof(txt)) {
-    size = sizeof(txt) - 1;
-    strcpy(txt + size - strlen(text_overflow), text_overflow);	/* strcpy: OK */
+  if (size < 0 || wantsize >= (int) sizeof(over)) {
+    size = sizeof(over) - 1;
+    memmove(over, out, size);
+    strcpy(over + size - strlen(text_overflow), text_overflow);	/* strcpy: OK */
+    out = over;
   }
 
-  /* If the text is too big to fit into even a large buffer, truncate
-   * the new text to make it fit.  (This will switch to the overflow
-   * state automatically because t->bufspace will end up 0.) */
+  *len = size;
+  return (out);
+}
+
+/* Add a new string to a player's output queue. */
+size_t vwrite_to_output(struct descriptor_data *t, const char *format, va_list args)
+{
+  static char txt[MAX_STRING_LENGTH];
+  const char *out;
+  int size;
+
+  /* if we're in the overflow state already, ignore this new output */
+  if (t->bufspace == 0)
+    return (0);
+
+  size = vsnprintf(txt, sizeof(txt), format, args);
+  out = render_output(t, txt, size, &size);
+
+  /* If the text is too big to fit in the queue, truncate the new text to
+   * make it fit.  (This will switch to the overflow state automatically
+   * because t->bufspace will end up 0.) */
   if (size + t->bufptr + 1 > LARGE_BUFSIZE) {
     size = LARGE_BUFSIZE - t->bufptr - 1;
-    txt[size] = '\0';
     buf_overflows++;
   }
 
-  /* If we have enough space, just write to buffer and that's it! If the
-   * text just barely fits, then it's switched to a large buffer instead. */
-  if (t->bufspace > size) {
-    strcpy(t->output + t->bufptr, txt);	/* strcpy: OK (size checked above) */
-    t->bufspace -= size;
-    t->bufptr += size;
-    return (t->bufspace);
-  }
+  append_output(t, out, size);
 
-  buf_switches++;
+  /* calculate how much space is left */
+  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
 
-  /* if the pool has a buffer in it, grab it */
-  if (bufpool != NULL) {
-    t->large_outbuf = bufpool;
-    bufpool = bufpool->next;
-  } else {			/* else create a new one */
-    CREATE(t->large_outbuf, struct txt_block, 1);
-    CREATE(t->large_outbuf->text, char, LARGE_BUFSIZE);
-    buf_largecount++;
-  }
+  return (t->bufspace);
+}
 
-  strcpy(t->large_outbuf->text, t->output);	/* strcpy: OK (size checked previously) */
-  t->output = t->large_outbuf->text;	/* make big buffer primary */
-  strcat(t->output, txt);	/* strcat: OK (size checked) */
+/* Text sent to many descriptors at once is formatted once, then rendered
+ * once for each output style among the recipients (see ProtocolOutputStyle)
+ * and the rendered slab is queued to everyone with that style.  A message
+ * may come in a few variants, such as act() text with and without the
+ * actor's name; each recipient says which variant it gets. */
+static void broadcast_output(struct broadcast *b, struct descriptor_data *t, int variant, const char *txt, int size)
+{
+  struct broadcast_class *c;
+  struct out_slab *slab;
+  output_style_t style;
+  const char *out;
+  int i, len;
 
-  /* set the pointer for the next write */
-  t->bufptr = strlen(t->output);
+  /* if we're in the overflow state already, ignore this new output */
+  if (t->bufspace == 0)
+    return;
 
-  /* calculate how much space is left in the buffer */
-  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
+  ProtocolOutputStyle(t, &style);
+  for (i = 0; i < b->num_classes; i++) {
+    c = &b->classes[i];
+    if (c->variant == variant && ProtocolSameStyle(&c->style, &style)) {
+      queue_output_slab(t, c->slab, 0, c->slab->used);
+      /* leave t as rendering it would have */
+      t->pProtocol->bBlockMXP = c->block_mxp;
+      if (t->pProtocol->WriteOOB > 0)
+        --t->pProtocol->WriteOOB;
+      return;
+    }
+  }
 
-  return (t->bufspace);
+  out = render_output(t, txt, size, &len);
+  slab = new_output_slab(len);
+  memcpy(slab->text, out, len);
+  slab->used = len;
+  queue_output_slab(t, slab, 0, len);
+
+  if (b->num_classes == BROADCAST_CLASSES) {
+    /* unusually varied audience; this one goes out on its own */
+    release_output_slab(slab);
+    return;
+  }
+  c = &b->classes[b->num_classes++];
+  c->variant = variant;
+  c->style = style;
+  c->block_mxp = t->pProtocol->bBlockMXP;
+  c->slab = slab;
+}
+
+/* Let go of everything a broadcast rendered; descriptors keep what they
+ * were sent. */
+static void broadcast_done(struct broadcast *b)
+{
+  while (b->num_classes > 0)
+    release_output_slab(b->classes[--b->num_classes].slab);
 }
 
 static void free_bufpool(void)
 {
-  struct txt_block *tmp;
+  struct out_slab *slab;
+  struct out_chunk *chunk;
 
-  while (bufpool) {
-    tmp = bufpool->next;
-    if (bufpool->text)
-      free(bufpool->text);
-    free(bufpool);
-    bufpool = tmp;
+  while ((slab = bufpool) != NULL) {
+    bufpool = slab->next;
+    free(slab->text);
+    free(slab);
+  }
+  while ((chunk = chunkpool) != NULL) {
+    chunkpool = chunk->next;
+    free(chunk);
   }
 }
 
@@ -1465,10 +1770,9 @@ static void init_descriptor (struct descriptor_data *newd, int desc)
 
   newd->descriptor = desc;
   newd->idle_tics = 0;
-  newd->output = newd->small_outbuf;
-  newd->bufspace = SMALL_BUFSIZE - 1;
+  newd->bufspace = LARGE_BUFSIZE - 1;
   newd->login_time = time(0);
-  *newd->output = '\0';
+  newd->out_head = newd->out_tail = NULL;
   newd->bufptr = 0;
   newd->has_prompt = 1;  /* prompt is part of greetings */
   STATE(newd) = CONFIG_PROTOCOL_NEGOTIATION ? CON_GET_PROTOCOL : CON_GET_NAME;
@@ -1546,6 +1850,17 @@ static int new_descriptor(socket_t s)
   /* initialize descriptor data */
   init_descriptor(newd, desc);
 
+  /* hand it to the polling backend; select() can't take every fd number */
+  if (netpoll_add(newd) < 0) {
+    write_to_descriptor(desc, "Sorry, the game is full right now... please try again later!\r\n");
+    CLOSE_SOCKET(desc);
+    ProtocolDestroy(newd->pProtocol);
+    free_list(newd->events);
+    free(newd->history);
+    free(newd);
+    return (0);
+  }
+
   /* prepend to list */
   newd->next = descriptor_list;
   descriptor_list = newd;
@@ -1564,43 +1879,55 @@ static int new_descriptor(socket_t s)
 }
 
 /* Send all of the output that we've accumulated for a player out to the
- * player's descriptor. 32 byte GARBAGE_SPACE in MAX_SOCK_BUF used for:
- *	 2 bytes: prepended \r\n
- *	14 bytes: overflow message
- *	 2 bytes: extra \r\n for non-comapct
- *      14 bytes: unused */
+ * player's descriptor.  The queued chunks go out as they are, with a CRLF in
+ * front if this interrupts a prompt, and the overflow notice, the extra CRLF
+ * for non-compact players and the new prompt after them. */
 static int process_output(struct descriptor_data *t)
 {
-  char i[MAX_SOCK_BUF], *osb = i + 2;
-  int result;
+  struct out_piece pieces[OUT_PIECES_MAX];
+  struct out_chunk *chunk;
+  size_t queued = 0, sent, n;
+  int count = 0, first_extra, i, result, lead = 0;
 
-  /* we may need this \r\n for later -- see below */
-  strcpy(i, "\r\n");	/* strcpy: OK (for 'MAX_SOCK_BUF >= 3') */
+  /* If this is an 'interruption', send a CRLF first. */
+  if (t->has_prompt && !t->pProtocol->WriteOOB) {
+    t->has_prompt = FALSE;
+    pieces[count].text = "\r\n";
+    pieces[count++].len = lead = 2;
+  }
 
-  /* now, append the 'real' output */
-  strcpy(osb, t->output);	/* strcpy: OK (t->output:LARGE_BUFSIZE < osb:MAX_SOCK_BUF-2) */
+  /* now, the 'real' output, leaving room for the pieces that follow it */
+  for (chunk = t->out_head; chunk && count < OUT_PIECES_MAX - 3; chunk = chunk->next) {
+    pieces[count].text = chunk->slab->text + chunk->start;
+    pieces[count++].len = chunk->len;
+    queued += chunk->len;
+  }
+  first_extra = count;
 
-  /* if we're in the overflow state, notify the user */
-  if (t->bufspace == 0)
-    strcat(osb, "**OVERFLOW**\r\n");	/* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+  /* the rest only goes out once everything queued does */
+  if (!chunk) {
+    /* if we're in the overflow state, notify the user */
+    if (t->bufspace == 0) {
+      pieces[count].text = "**OVERFLOW**\r\n";
+      pieces[count].len = strlen(pieces[count].text);
+      count++;
+    }
 
-  /* add the extra CRLF if the person isn't in compact mode */
-  if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) && !PRF_FLAGGED(t->character, PRF_COMPACT))
-    if ( !t->pProtocol->WriteOOB ) 
-      strcat(osb, "\r\n");	/* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+    /* add the extra CRLF if the person isn't in compact mode */
+    if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) && !PRF_FLAGGED(t->character, PRF_COMPACT))
+      if ( !t->pProtocol->WriteOOB ) {
+        pieces[count].text = "\r\n";
+        pieces[count++].len = 2;
+      }
 
-  if (!t->pProtocol->WriteOOB) /* add a prompt */
-    strcat(i, make_prompt(t));	/* strcpy: OK (i:MAX_SOCK_BUF reserves space) */
+    if (!t->pProtocol->WriteOOB) { /* add a prompt */
+      pieces[count].text = make_prompt(t);
+      pieces[count].len = strlen(pieces[count].text);
+      count++;
+    }
+  }
 
-  /* now, send the output.  If this is an 'interruption', use the prepended
-   * CRLF, otherwise send the straight output sans CRLF. */
-  if (t->has_prompt && !t->pProtocol->WriteOOB) {
-    t->has_prompt = FALSE;
-    result = write_to_descriptor(t->descriptor, i);
-    if (result >= 2)
-      result -= 2;
-  } else
-    result = write_to_descriptor(t->descriptor, osb);
+  result = ProtocolWritePieces(t, pieces, count);
 
   if (result < 0) {	/* Oops, fatal error. Bye! */
     close_socket(t);
@@ -1608,43 +1935,41 @@ static int process_output(struct descriptor_data *t)
   } else if (result == 0)	/* Socket buffer full. Try later. */
     return (0);
 
-  /* Handle snooping: prepend "% " and send to snooper. */
-  if (t->snoop_by)
-    write_to_output(t->snoop_by, "%% %*s%%%%", result, t->output);
-
-  /* The common case: all saved output was handed off to the kernel buffer. */
-  if (result >= t->bufptr) {
-    /* If we were using a large buffer, put the large buffer on the buffer pool
-     * and switch back to the small one. */
-    if (t->large_outbuf) {
-      t->large_outbuf->next = bufpool;
-      bufpool = t->large_outbuf;
-      t->large_outbuf = NULL;
-      t->output = t->small_outbuf;
-    }
-    /* reset total bufspace back to that of a small buffer */
-    t->bufspace = SMALL_BUFSIZE - 1;
-    t->bufptr = 0;
-    *(t->output) = '\0';
-
-    /* If the overflow message or prompt were partially written, try to save
-     * them. There will be enough space for them if this is true.  'result'
-     * is effectively unsigned here anyway. */
-    if ((unsigned int)result < strlen(osb)) {
-      size_t savetextlen = strlen(osb + result);
-
-      strcat(t->output, osb + result);
-      t->bufptr   -= savetextlen;
-      t->bufspace += savetextlen;
+  /* the leading CRLF isn't part of the output */
+  sent = result > lead ? result - lead : 0;
+
+  /* Handle snooping: prepend "% " and send to snooper.  The snooper is
+   * given the same chunks, not a copy of them. */
+  if (t->snoop_by) {
+    write_to_output(t->snoop_by, "%% ");
+    for (n = sent < queued ? sent : queued, chunk = t->out_head; n > 0 && chunk; chunk = chunk->next) {
+      size_t len = n < chunk->len ? n : chunk->len;
+
+      queue_output_slab(t->snoop_by, chunk->slab, chunk->start, len);
+      n -= len;
     }
+    write_to_output(t->snoop_by, "%%%%");
+  }
 
-  } else {
-    /* Not all data in buffer sent.  result < output buffersize. */
-    strcpy(t->output, t->output + result);	/* strcpy: OK (overlap) */
-    t->bufptr   -= result;
-    t->bufspace += result;
+  consume_output(t, sent < queued ? sent : queued);
+
+  /* If the overflow message or prompt were partially written, try to save
+   * them.  There will be enough space for them if this is true. */
+  if (sent > queued && !t->out_head) {
+    sent -= queued;
+    for (i = first_extra; i < count; i++) {
+      if (sent >= pieces[i].len) {
+        sent -= pieces[i].len;
+        continue;
+      }
+      append_output(t, pieces[i].text + sent, pieces[i].len - sent);
+      sent = 0;
+    }
   }
 
+  /* anything sent makes room, and clears the overflow state */
+  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
+
   return (result);
 }
 
@@ -1732,17 +2057,61 @@ static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t lengt
   /* Looks like the error was fatal.  Too bad. */
   return (-1);
 }
+
+#if defined(HAVE_WRITEV)
+/* As perform_socket_write, but gathering the text from several buffers. */
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int count)
+{
+  ssize_t result;
+
+  result = writev(desc, iov, count);
+
+  if (result > 0)
+    return (result);
+
+  if (result == 0) {
+    log("SYSERR: Huh??  writev() returned 0???  Please report this!");
+    return (-1);
+  }
+
+#ifdef EAGAIN		/* POSIX */
+  if (errno == EAGAIN)
+    return (0);
+#endif
+
+#ifdef EWOULDBLOCK	/* BSD */
+  if (errno == EWOULDBLOCK)
+    return (0);
+#endif
+
+#ifdef EDEADLK		/* Macintosh */
+  if (errno == EDEADLK)
+    return (0);
+#endif
+
+  return (-1);
+}
+#endif /* HAVE_WRITEV */
 #endif /* CIRCLE_WINDOWS */
 
 /* write_to_descriptor takes a descriptor, and text to write to the descriptor.
  * It keeps calling the system-level write() until all the text has been
  * delivered to the OS, or until an error is encountered. Returns:
  * >=0  If all is well and good.
- *  -1  If an error was encountered, so that the player should be cut off. */
+ *  -1  If an error was encountered, so that the player should be cut off.
+ * Connected players should be written to with ProtocolWrite() instead, which
+ * knows about MCCP compression. */
 int write_to_descriptor(socket_t desc, const char *txt)
+{
+  return (write_bytes_to_descriptor(desc, txt, strlen(txt)));
+}
+
+/* As write_to_descriptor, but for data which may contain NULs (such as a
+ * compressed stream). */
+int write_bytes_to_descriptor(socket_t desc, const char *txt, size_t total)
 {
   ssize_t bytes_written;
-  size_t total = strlen(txt), write_total = 0;
+  size_t write_total = 0;
 
   while (total > 0) {
     bytes_written = perform_socket_write(desc, txt, total);
@@ -1764,6 +2133,61 @@ int write_to_descriptor(socket_t desc, const char *txt)
   return (write_total);
 }
 
+/* As write_bytes_to_descriptor, for several pieces of text in a row.  With
+ * writev() they go to the kernel in one call. */
+int write_pieces_to_descriptor(socket_t desc, const struct out_piece *pieces, int count)
+{
+#if defined(HAVE_WRITEV) && !defined(CIRCLE_WINDOWS)
+  struct iovec iov[OUT_PIECES_MAX];
+  ssize_t bytes_written;
+  size_t write_total = 0;
+  int i, first = 0;
+
+  if (count > OUT_PIECES_MAX)
+    count = OUT_PIECES_MAX;
+  for (i = 0; i < count; i++) {
+    iov[i].iov_base = (char *) pieces[i].text;
+    iov[i].iov_len = pieces[i].len;
+  }
+
+  while (first < count) {
+    bytes_written = perform_socket_writev(desc, iov + first, count - first);
+
+    if (bytes_written < 0) {
+      /* Fatal error.  Disconnect the player. */
+      perror("SYSERR: Write to socket");
+      return (-1);
+    } else if (bytes_written == 0) {
+      /* Temporary failure -- socket buffer full. */
+      return (write_total);
+    }
+
+    write_total += bytes_written;
+    /* skip what went out, leaving any partly written piece at the front */
+    for (; first < count && (size_t) bytes_written >= iov[first].iov_len; first++)
+      bytes_written -= iov[first].iov_len;
+    if (first < count) {
+      iov[first].iov_base = (char *) iov[first].iov_base + bytes_written;
+      iov[first].iov_len -= bytes_written;
+    }
+  }
+
+  return (write_total);
+#else
+  int i, written, write_total = 0;
+
+  for (i = 0; i < count; i++) {
+    if ((written = write_bytes_to_descriptor(desc, pieces[i].text, pieces[i].len)) < 0)
+      return (-1);
+    write_total += written;
+    if ((size_t) written < pieces[i].len)
+      break;
+  }
+
+  return (write_total);
+#endif
+}
+
 /* Same information about perform_socket_write applies here. I like
  * standards, there are so many of them. -gg 6/30/98 */
 static ssize_t perform_socket_read(socket_t desc, char *read_point, size_t space_left)
@@ -1857,15 +2281,21 @@ static int process_input(struct descriptor_data *t)
       return (-1);
     }
 
-    /* Read # of "bytes_read" from socket, and if we have something, mark the sizeof data
-     * in the read_buf array as NULL */
-    if ((bytes_read = perform_socket_read(t->descriptor, read_buf, space_left)) > 0)
-      read_buf[bytes_read] = '\0';
-
-    /* Since we have recieved atleast 1 byte of data from the socket, lets run it through
-     * ProtocolInput() and rip out anything that is Out Of Band */ 
-    if ( bytes_read > 0 )
-      bytes_read = ProtocolInput( t, read_buf, bytes_read, t->inbuf );
+    /* Compressed input that didn't fit last time goes first; the socket
+     * isn't read again until it has all been used. */
+    if (ProtocolInputPending(t))
+      bytes_read = ProtocolInput( t, read_buf, 0, t->inbuf );
+    else {
+      /* Read # of "bytes_read" from socket, and if we have something, mark the sizeof data
+       * in the read_buf array as NULL */
+      if ((bytes_read = perform_socket_read(t->descriptor, read_buf, space_left)) > 0)
+        read_buf[bytes_read] = '\0';
+
+      /* Since we have recieved atleast 1 byte of data from the socket, lets run it through
+       * ProtocolInput() and rip out anything that is Out Of Band */ 
+      if ( bytes_read > 0 )
+        bytes_read = ProtocolInput( t, read_buf, bytes_read, t->inbuf );
+    }
 
     if (bytes_read < 0)	/* Error, disconnect them. */
       return (-1);
@@ -1934,7 +2364,7 @@ static int process_input(struct descriptor_data *t)
       char buffer[MAX_INPUT_LENGTH + 64];
 
       snprintf(buffer, sizeof(buffer), "Line too long.  Truncated to:\r\n%s\r\n", tmp);
-      if (write_to_descriptor(t->descriptor, buffer) < 0)
+      if (ProtocolWrite(t, buffer) < 0)
 	return (-1);
     }
     if (t->snoop_by)
@@ -2055,6 +2485,7 @@ void close_socket(struct descriptor_data *d)
   struct descriptor_data *temp;
 
   REMOVE_FROM_LIST(d, descriptor_list, next);
+  netpoll_remove(d);
   CLOSE_SOCKET(d->descriptor);
   flush_queues(d);
 
@@ -2070,6 +2501,7 @@ void close_socket(struct descriptor_data *d)
   if (d->character) {
     /* If we're switched, this resets the mobile taken. */
     d->character->desc = NULL;
+    update_zone_presence(d->character);
 
     /* Plug memory leak, from Eric Green. */
     if (!IS_NPC(d->character) && PLR_FLAGGED(d->character, PLR_MAILING) && d->str) {
@@ -2387,29 +2819,44 @@ size_t send_to_char(struct char_data *ch, const char *messg, ...)
 void send_to_all(const char *messg, ...)
 {
   struct descriptor_data *i;
+  struct broadcast b;
+  char txt[MAX_STRING_LENGTH];
   va_list args;
+  int size;
 
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  size = vsnprintf(txt, sizeof(txt), messg, args);
+  va_end(args);
+
+  b.num_classes = 0;
   for (i = descriptor_list; i; i = i->next) {
     if (STATE(i) != CON_PLAYING)
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i, messg, args);
-    va_end(args);
+    broadcast_output(&b, i, 0, txt, size);
   }
+  broadcast_done(&b);
 }
 
 void send_to_outdoor(const char *messg, ...)
 {
   struct descriptor_data *i;
+  struct broadcast b;
+  char txt[MAX_STRING_LENGTH];
   va_list args;
+  int size;
 
   if (!messg || !*messg)
     return;
 
+  va_start(args, messg);
+  size = vsnprintf(txt, sizeof(txt), messg, args);
+  va_end(args);
+
+  b.num_classes = 0;
   for (i = descriptor_list; i; i = i->next) {
 
     if (STATE(i) != CON_PLAYING || i->character == NULL)
@@ -2417,28 +2864,34 @@ void send_to_outdoor(const char *messg, ...)
     if (!AWAKE(i->character) || !OUTSIDE(i->character))
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i, messg, args);
-    va_end(args);
+    broadcast_output(&b, i, 0, txt, size);
   }
+  broadcast_done(&b);
 }
 
 void send_to_room(room_rnum room, const char *messg, ...)
 {
   struct char_data *i;
+  struct broadcast b;
+  char txt[MAX_STRING_LENGTH];
   va_list args;
+  int size;
 
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  size = vsnprintf(txt, sizeof(txt), messg, args);
+  va_end(args);
+
+  b.num_classes = 0;
   for (i = world[room].people; i; i = i->next_in_room) {
     if (!i->desc)
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i->desc, messg, args);
-    va_end(args);
+    broadcast_output(&b, i->desc, 0, txt, size);
   }
+  broadcast_done(&b);
 }
 
 /* Sends a message to the entire group, except for ch.
@@ -2468,8 +2921,10 @@ void send_to_group(struct char_data *ch, struct group_data *group, const char *
 void send_to_range(room_vnum start, room_vnum finish, const char *messg, ...)
 {
   struct char_data *i;
+  struct broadcast b;
+  char txt[MAX_STRING_LENGTH];
   va_list args;
-  int j;
+  int j, size;
 
   if (start > finish) {
     log("send_to_range passed start room value greater then finish.");
@@ -2478,34 +2933,42 @@ void send_to_range(room_vnum start, room_vnum finish, const char *messg, ...)
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  size = vsnprintf(txt, sizeof(txt), messg, args);
+  va_end(args);
+
+  b.num_classes = 0;
   for (j = 0; j < top_of_world; j++) {
     if (GET_ROOM_VNUM(j) >= start && GET_ROOM_VNUM(j) <= finish) {
       for (i = world[j].people; i; i = i->next_in_room) {
         if (!i->desc)
           continue;
 
-        va_start(args, messg);
-        vwrite_to_output(i->desc, messg, args);
-        va_end(args);
+        broadcast_output(&b, i->desc, 0, txt, size);
       }
     }
   }
+  broadcast_done(&b);
 }
 
 static const char *ACTNULL = "<NULL>";
 #define CHECK_NULL(pointer, expression) \
   if ((pointer) == NULL) i = ACTNULL; else i = (expression);
 /* higher-level communication: the act() function */
-void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
-    void *vict_obj, struct char_data *to)
+
+/* Expand the $-codes of an act() string as to sees it, into lbuf (which must
+ * hold MAX_STRING_LENGTH), and note what the trigger arguments are. */
+static void expand_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to, char *lbuf, struct char_data **dg_victim,
+    struct obj_data **dg_target, char **dg_arg)
 {
   const char *i = NULL;
-  char lbuf[MAX_STRING_LENGTH], *buf, *j;
+  char *buf, *j;
   bool uppercasenext = FALSE;
-  struct char_data *dg_victim = NULL;
-  struct obj_data *dg_target = NULL;
-  char *dg_arg = NULL;
 
+  *dg_victim = NULL;
+  *dg_target = NULL;
+  *dg_arg = NULL;
   buf = lbuf;
 
   for (;;) {
@@ -2516,53 +2979,53 @@ void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
 	break;
       case 'N':
 	CHECK_NULL(vict_obj, PERS((const struct char_data *) vict_obj, to));
-	dg_victim = (struct char_data *) vict_obj;
+	*dg_victim = (struct char_data *) vict_obj;
 	break;
       case 'm':
 	i = HMHR(ch);
 	break;
       case 'M':
 	CHECK_NULL(vict_obj, HMHR((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
+	*dg_victim = (struct char_data *) vict_obj;
 	break;
       case 's':
 	i = HSHR(ch);
 	break;
       case 'S':
 	CHECK_NULL(vict_obj, HSHR((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
+	*dg_victim = (struct char_data *) vict_obj;
 	break;
       case 'e':
 	i = HSSH(ch);
 	break;
       case 'E':
 	CHECK_NULL(vict_obj, HSSH((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
+	*dg_victim = (struct char_data *) vict_obj;
 	break;
       case 'o':
 	CHECK_NULL(obj, OBJN(obj, to));
 	break;
       case 'O':
 	CHECK_NULL(vict_obj, OBJN((const struct obj_data *) vict_obj, to));
-	dg_target = (struct obj_data *) vict_obj;
+	*dg_target = (struct obj_data *) vict_obj;
 	break;
       case 'p':
 	CHECK_NULL(obj, OBJS(obj, to));
 	break;
       case 'P':
 	CHECK_NULL(vict_obj, OBJS((const struct obj_data *) vict_obj, to));
-	dg_target = (struct obj_data *) vict_obj;
+	*dg_target = (struct obj_data *) vict_obj;
 	break;
       case 'a':
 	CHECK_NULL(obj, SANA(obj));
 	break;
       case 'A':
 	CHECK_NULL(vict_obj, SANA((const struct obj_data *) vict_obj));
-	dg_target = (struct obj_data *) vict_obj;
+	*dg_target = (struct obj_data *) vict_obj;
 	break;
        case 'T':
  	CHECK_NULL(vict_obj, (const char *) vict_obj);
- 	dg_arg = (char *) vict_obj;
+ 	*dg_arg = (char *) vict_obj;
 	break;
       case 't':
  	CHECK_NULL(obj, (char *) obj);
@@ -2612,6 +3075,17 @@ void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
   *(--buf) = '\r';
   *(++buf) = '\n';
   *(++buf) = '\0';
+}
+
+void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to)
+{
+  char lbuf[MAX_STRING_LENGTH];
+  struct char_data *dg_victim;
+  struct obj_data *dg_target;
+  char *dg_arg;
+
+  expand_act(orig, ch, obj, vict_obj, to, lbuf, &dg_victim, &dg_target, &dg_arg);
 
   if (to->desc)
     write_to_output(to->desc, "%s", CAP(lbuf));
@@ -2624,6 +3098,119 @@ void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
   last_act_message = strdup(lbuf);
 }
 
+/* The $-codes whose expansion depends on who is reading.  Everyone who can
+ * see the same ones gets the same text. */
+#define ACT_SEES_CH       (1 << 0)  /* $n */
+#define ACT_SEES_VICT     (1 << 1)  /* $N */
+#define ACT_SEES_OBJ      (1 << 2)  /* $o $p */
+#define ACT_SEES_VICT_OBJ (1 << 3)  /* $O $P */
+#define NUM_ACT_VARIANTS  (1 << 4)
+
+static int act_viewer_codes(const char *str)
+{
+  int codes = 0;
+
+  for (; *str; str++) {
+    if (*str != '$' || !*(str + 1))
+      continue;
+    switch (*(++str)) {
+    case 'n': codes |= ACT_SEES_CH; break;
+    case 'N': codes |= ACT_SEES_VICT; break;
+    case 'o': case 'p': codes |= ACT_SEES_OBJ; break;
+    case 'O': case 'P': codes |= ACT_SEES_VICT_OBJ; break;
+    }
+  }
+  return codes;
+}
+
+static int act_variant(int codes, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to)
+{
+  int variant = 0;
+
+  if ((codes & ACT_SEES_CH) && ch && CAN_SEE(to, ch))
+    variant |= ACT_SEES_CH;
+  if ((codes & ACT_SEES_VICT) && vict_obj && CAN_SEE(to, ((struct char_data *) vict_obj)))
+    variant |= ACT_SEES_VICT;
+  if ((codes & ACT_SEES_OBJ) && obj && CAN_SEE_OBJ(to, obj))
+    variant |= ACT_SEES_OBJ;
+  if ((codes & ACT_SEES_VICT_OBJ) && vict_obj && CAN_SEE_OBJ(to, ((struct obj_data *) vict_obj)))
+    variant |= ACT_SEES_VICT_OBJ;
+  return variant;
+}
+
+/* perform_act() for everyone in a room but ch.  The text is expanded once
+ * for each variant and rendered once for each output style, then shared. */
+static void act_to_room(const char *str, int hide_invisible, struct char_data *ch,
+    struct obj_data *obj, void *vict_obj, int type, int to_sleeping, struct char_data *to)
+{
+  struct out_slab *variants[NUM_ACT_VARIANTS];
+  struct broadcast b;
+  char lbuf[MAX_STRING_LENGTH], *text, *last = NULL;
+  struct char_data *dg_victim = NULL;
+  struct obj_data *dg_target = NULL;
+  char *dg_arg = NULL;
+  int codes = act_viewer_codes(str), variant, len, i;
+
+  memset(variants, 0, sizeof(variants));
+  b.num_classes = 0;
+
+  for (; to; to = to->next_in_room) {
+    if (!SENDOK(to) || (to == ch))
+      continue;
+    if (hide_invisible && ch && !CAN_SEE(to, ch))
+      continue;
+    if (type != TO_ROOM && to == vict_obj)
+      continue;
+
+    /* each variant slab holds the text, then the text CAP()ed */
+    variant = act_variant(codes, ch, obj, vict_obj, to);
+    if (!variants[variant]) {
+      expand_act(str, ch, obj, vict_obj, to, lbuf, &dg_victim, &dg_target, &dg_arg);
+      len = strlen(lbuf);
+      variants[variant] = new_output_slab(2 * (len + 1));
+      memcpy(variants[variant]->text, lbuf, len + 1);
+      memcpy(variants[variant]->text + len + 1, CAP(lbuf), len + 1);
+      variants[variant]->used = len;
+    }
+    text = variants[variant]->text;
+    len = variants[variant]->used;
+    if (to->desc) {
+      text += len + 1;
+      broadcast_output(&b, to->desc, variant, text, len);
+    }
+    last = text;
+
+    /* act_mtrigger() does nothing without a script, and a script may change
+     * what anyone sees, so start afresh after running one */
+    if (IS_NPC(to) && dg_act_check && (to != ch) && SCRIPT_CHECK(to, MTRIG_ACT)) {
+      strcpy(lbuf, text);	/* strcpy: OK (it came from lbuf) */
+      last = NULL;
+      broadcast_done(&b);
+      for (i = 0; i < NUM_ACT_VARIANTS; i++)
+        if (variants[i]) {
+          release_output_slab(variants[i]);
+          variants[i] = NULL;
+        }
+      act_mtrigger(to, lbuf, ch, dg_victim, obj, dg_target, dg_arg);
+
+      if (last_act_message)
+        free(last_act_message);
+      last_act_message = strdup(lbuf);
+    }
+  }
+
+  if (last) {
+    if (last_act_message)
+      free(last_act_message);
+    last_act_message = strdup(last);
+  }
+  broadcast_done(&b);
+  for (i = 0; i < NUM_ACT_VARIANTS; i++)
+    if (variants[i])
+      release_output_slab(variants[i]);
+}
+
 char *act(const char *str, int hide_invisible, struct char_data *ch,
 	 struct obj_data *obj, void *vict_obj, int type)
 {
@@ -2693,15 +3280,7 @@ char *act(const char *str, int hide_invisible, struct char_data *ch,
     return NULL;
   }
 
-  for (; to; to = to->next_in_room) {
-    if (!SENDOK(to) || (to == ch))
-      continue;
-    if (hide_invisible && ch && !CAN_SEE(to, ch))
-      continue;
-    if (type != TO_ROOM && to == vict_obj)
-      continue;
-    perform_act(str, ch, obj, vict_obj, to);
-  }
+  act_to_room(str, hide_invisible, ch, obj, vict_obj, type, to_sleeping, to);
   return last_act_message;
 }
 
@@ -49,6 +49,11 @@ char * act(const char *str, int hide_invisible, struct char_data *ch, struct obj
 /* I/O functions */
 void	write_to_q(const char *txt, struct txt_q *queue, int aliased);
 int	write_to_descriptor(socket_t desc, const char *txt);
+int	write_bytes_to_descriptor(socket_t desc, const char *txt, size_t total);
+int	write_pieces_to_descriptor(socket_t desc, const struct out_piece *pieces, int count);
+struct out_slab *new_output_slab(size_t size);
+void	release_output_slab(struct out_slab *slab);
+size_t	queue_output_slab(struct descriptor_data *t, struct out_slab *slab, size_t start, size_t len);
 size_t	write_to_output(struct descriptor_data *d, const char *txt, ...) __attribute__ ((format (printf, 2, 3)));
 size_t	vwrite_to_output(struct descriptor_data *d, const char *format, va_list args);
 
@@ -71,6 +76,7 @@ extern int circle_shutdown;
 extern int circle_reboot;
 extern int no_specials;
 extern int scheck;
+extern int build_snapshot;
 extern FILE *logfile;
 extern unsigned long pulse;
 extern ush_int port;
@@ -104,6 +104,11 @@ int no_mort_to_immort = YES;
 * If set to NO, then only the 6 directions n,e,s,w,u,d are allowed */
 int diagonal_dirs = NO;
 
+/* Mobs with nothing special to do in a zone with no players in it sit idle
+ * until someone arrives (see mobact.c).  Set this to N to have them act on
+ * one mobile pulse in N anyway; 0 leaves them idle. */
+int unattended_ai_rate = 0;
+
 /* RENT/CRASHSAVE OPTIONS */
 /* Should the MUD allow you to 'rent' for free?  (i.e. if you just quit, your
  * objects are saved at no cost). */
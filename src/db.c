@@ -15,6 +15,7 @@
 #include "db.h"
 #include "comm.h"
 #include "handler.h"
+#include "graph.h"
 #include "spells.h"
 #include "mail.h"
 #include "interpreter.h"
@@ -41,6 +42,11 @@
 #include <sys/stat.h>
 #include "mysql_db.h"
 #include "mysql_players.h"
+#include "profiler.h"
+#include "worldsnap.h"
+#include "parboot.h"
+#include "strpool.h"
+#include "zreset.h"
 
 /*  declarations of most of the 'global' variables */
 struct config_data config_info; /* Game configuration list.	 */
@@ -61,6 +67,8 @@ obj_rnum top_of_objt = 0;	/* top of object index table	 */
 struct zone_data *zone_table; /* zone table      */
 zone_rnum top_of_zone_table = 0;/* top element of zone tab   */
 
+struct vnum_index vnum_indexes[DB_BOOT_TRG + 1]; /* vnum -> rnum by DB_BOOT_ */
+
 /* begin previously located in players.c */
 struct player_index_element *player_table = NULL; /* index to plr file   */
 int top_of_p_table = 0;   /* ref to top of table     */
@@ -144,9 +152,12 @@ static void parse_enhanced_mob(FILE *mob_f, int i, int nr);
 static void get_one_line(FILE *fl, char *buf);
 static void check_start_rooms(void);
 static void renum_zone_table(void);
-static void log_zone_error(zone_rnum zone, int cmd_no, const char *message);
 static void reset_time(void);
 static char fread_letter(FILE *fp);
+static void lower_article(char *str);
+static char *pool_string(char *str);
+static void pool_ex_descriptions(struct extra_descr_data *list);
+static int merge_boot_jobs(struct boot_job *jobs, int num_jobs, int mode);
 static void free_followers(struct follow_type *k);
 static void load_default_config( void );
 static void free_extra_descriptions(struct extra_descr_data *edesc);
@@ -447,29 +458,44 @@ ACMD(do_reboot)
 
 void boot_world(void)
 {
-  log("Loading zone table.");
-  index_boot(DB_BOOT_ZON);
+  prof_time start = prof_now();
+
+  /* Syntax checking is about the area files, so it always parses them. */
+  world_snapshot_fingerprint();
+  if (!scheck && !build_snapshot && load_world_snapshot()) {
+    log("World loaded from snapshot in %.1f ms.", (prof_now() - start) / 1000.0);
+
+    log("Checking start rooms.");
+    check_start_rooms();
+  } else {
+    log("Loading zone table.");
+    index_boot(DB_BOOT_ZON);
 
-  log("Loading triggers and generating index.");
-  index_boot(DB_BOOT_TRG);
+    log("Loading triggers and generating index.");
+    index_boot(DB_BOOT_TRG);
 
-  log("Loading rooms.");
-  index_boot(DB_BOOT_WLD);
+    log("Loading rooms.");
+    index_boot(DB_BOOT_WLD);
 
-  log("Renumbering rooms.");
-  renum_world();
+    log("Renumbering rooms.");
+    renum_world();
 
-  log("Checking start rooms.");
-  check_start_rooms();
+    log("Checking start rooms.");
+    check_start_rooms();
 
-  log("Loading mobs and generating index.");
-  index_boot(DB_BOOT_MOB);
+    log("Loading mobs and generating index.");
+    index_boot(DB_BOOT_MOB);
 
-  log("Loading objs and generating index.");
-  index_boot(DB_BOOT_OBJ);
+    log("Loading objs and generating index.");
+    index_boot(DB_BOOT_OBJ);
 
-  log("Renumbering zone table.");
-  renum_zone_table();
+    log("Renumbering zone table.");
+    renum_zone_table();
+
+    log("World parsed from area files in %.1f ms.", (prof_now() - start) / 1000.0);
+    if (!scheck && !converting)
+      save_world_snapshot(build_snapshot);
+  }
 
   if(converting) {
     log("Saving 128bit world files to disk.");
@@ -484,6 +510,14 @@ void boot_world(void)
   log("Loading quests.");
   index_boot(DB_BOOT_QST);
 
+  log("Building tracking tables.");
+  route_build();
+
+  log("Compiling zone reset programs.");
+  compile_zone_programs();
+
+  /* Text pooled from here on is freed again when OLC replaces it. */
+  seal_string_pool();
 }
 
 static void free_extra_descriptions(struct extra_descr_data *edesc)
@@ -493,8 +527,8 @@ static void free_extra_descriptions(struct extra_descr_data *edesc)
   for (; edesc; edesc = enext) {
     enext = edesc->next;
 
-    free(edesc->keyword);
-    free(edesc->description);
+    release_string(edesc->keyword);
+    release_string(edesc->description);
     free(edesc);
   }
 }
@@ -524,10 +558,8 @@ void destroy_db(void)
 
   /* Rooms */
   for (cnt = 0; cnt <= top_of_world; cnt++) {
-    if (world[cnt].name)
-      free(world[cnt].name);
-    if (world[cnt].description)
-      free(world[cnt].description);
+    release_string(world[cnt].name);
+    release_string(world[cnt].description);
     free_extra_descriptions(world[cnt].ex_description);
 
   if (world[cnt].events != NULL) {
@@ -551,10 +583,8 @@ void destroy_db(void)
       if (!world[cnt].dir_option[itr])
         continue;
 
-      if (world[cnt].dir_option[itr]->general_description)
-        free(world[cnt].dir_option[itr]->general_description);
-      if (world[cnt].dir_option[itr]->keyword)
-        free(world[cnt].dir_option[itr]->keyword);
+      release_string(world[cnt].dir_option[itr]->general_description);
+      release_string(world[cnt].dir_option[itr]->keyword);
       free(world[cnt].dir_option[itr]);
     }
   }
@@ -563,40 +593,34 @@ void destroy_db(void)
 
   /* Objects */
   for (cnt = 0; cnt <= top_of_objt; cnt++) {
-    if (obj_proto[cnt].name)
-      free(obj_proto[cnt].name);
-    if (obj_proto[cnt].description)
-      free(obj_proto[cnt].description);
-    if (obj_proto[cnt].short_description)
-      free(obj_proto[cnt].short_description);
-    if (obj_proto[cnt].action_description)
-      free(obj_proto[cnt].action_description);
+    release_string(obj_proto[cnt].name);
+    release_string(obj_proto[cnt].description);
+    release_string(obj_proto[cnt].short_description);
+    release_string(obj_proto[cnt].action_description);
     free_extra_descriptions(obj_proto[cnt].ex_description);
 
     /* free script proto list */
     free_proto_script(&obj_proto[cnt], OBJ_TRIGGER);
+    free_keyword_list(obj_index[cnt].keywords);
   }
   free(obj_proto);
   free(obj_index);
 
   /* Mobiles */
   for (cnt = 0; cnt <= top_of_mobt; cnt++) {
-    if (mob_proto[cnt].player.name)
-      free(mob_proto[cnt].player.name);
+    release_string(mob_proto[cnt].player.name);
     if (mob_proto[cnt].player.title)
       free(mob_proto[cnt].player.title);
-    if (mob_proto[cnt].player.short_descr)
-      free(mob_proto[cnt].player.short_descr);
-    if (mob_proto[cnt].player.long_descr)
-      free(mob_proto[cnt].player.long_descr);
-    if (mob_proto[cnt].player.description)
-      free(mob_proto[cnt].player.description);
+    release_string(mob_proto[cnt].player.short_descr);
+    release_string(mob_proto[cnt].player.long_descr);
+    release_string(mob_proto[cnt].player.description);
 
     /* free script proto list */
     free_proto_script(&mob_proto[cnt], MOB_TRIGGER);
 
     while (mob_proto[cnt].affected)
       affect_remove(&mob_proto[cnt], mob_proto[cnt].affected);
+    free_keyword_list(mob_index[cnt].keywords);
   }
   free(mob_proto);
   free(mob_index);
@@ -627,6 +651,7 @@ void destroy_db(void)
       /* then free the command list */
       free(zone_table[cnt].cmd);
     }
+    free_zone_program(cnt);
   }
   free(zone_table);
 
@@ -664,6 +689,14 @@ void destroy_db(void)
   }
   free(trig_index);
 
+  /* vnum maps */
+  for (cnt = 0; cnt <= DB_BOOT_TRG; cnt++)
+    if (vnum_indexes[cnt].rnum) {
+      free(vnum_indexes[cnt].rnum);
+      vnum_indexes[cnt].rnum = NULL;
+      vnum_indexes[cnt].size = 0;
+    }
+
   /* Events */
   event_free_all();
 
@@ -673,6 +706,8 @@ void destroy_db(void)
 void boot_db(void)
 {
   zone_rnum i;
+  prof_time phase_start;
+  int num_players;
 
   log("Boot db -- BEGIN.");
 
@@ -716,15 +751,23 @@ void boot_db(void)
   log("Creating mud database tables.");
   create_mud_db_tables();
 
+  log("Starting player save worker.");
+  start_mysql_save_worker();
+
   log("Generating player index.");
+  phase_start = prof_now();
   if(USING_MYSQL_DATABASE_FOR_PLAYERFILE == TRUE)
     mysql_build_player_index();
   else
     build_player_index();
+  log("   %d players indexed in %.1f ms.", top_of_p_table + 1, (prof_now() - phase_start) / 1000.0);
 
   if (auto_pwipe) {
     log("Cleaning out inactive pfiles.");
+    num_players = top_of_p_table + 1;
+    phase_start = prof_now();
     clean_pfiles();
+    log("   %d pfiles purged in %.1f ms.", num_players - (top_of_p_table + 1), (prof_now() - phase_start) / 1000.0);
   }
 
   log("Loading fight messages.");
@@ -946,8 +989,9 @@ void index_boot(int mode)
 {
   const char *index_filename, *prefix = NULL;	/* NULL or egcs 1.1 complains */
   FILE *db_index, *db_file;
-  int rec_count = 0, size[2];
+  int rec_count = 0, size[2], rnum = 0, num_jobs = 0, i;
   char buf2[PATH_MAX], buf1[MAX_STRING_LENGTH];
+  struct boot_job *jobs = NULL;
 
   switch (mode) {
   case DB_BOOT_WLD:
@@ -1010,6 +1054,13 @@ void index_boot(int mode)
       break;
 
     snprintf(buf2, sizeof(buf2), "%s%s", prefix, buf1);
+    /* Remember where each file's records start, for the parallel loader. */
+    if (mode == DB_BOOT_WLD || mode == DB_BOOT_MOB || mode == DB_BOOT_OBJ) {
+      RECREATE(jobs, struct boot_job, num_jobs + 1);
+      memset(jobs + num_jobs, 0, sizeof(struct boot_job));
+      jobs[num_jobs].filename = strdup(buf2);
+      jobs[num_jobs++].first = rec_count;
+    }
     if (!(db_file = fopen(buf2, "r"))) {
       log("SYSERR: File '%s' listed in '%s/%s': %s", buf2, prefix,
           index_filename, strerror(errno));
@@ -1074,63 +1125,118 @@ void index_boot(int mode)
     break;
   }
 
-  rewind(db_index);
+  /* Until the files are loaded every counted record is addressable, so that
+   * GET_OBJ_VNUM() and friends work on the prototypes being parsed. */
+  switch (mode) {
+  case DB_BOOT_WLD:
+    top_of_world = rec_count - 1;
+    break;
+  case DB_BOOT_MOB:
+    top_of_mobt = rec_count - 1;
+    break;
+  case DB_BOOT_OBJ:
+    top_of_objt = rec_count - 1;
+    break;
+  }
 
-  for (int line_number = 1;; ++line_number) {
-    if (fscanf(db_index, "%s\n", buf1) != 1) {
-      if (feof(db_index))
-        log("SYSERR: boot error -- unexpected end of file encountered in index file ./%s%s",
-            prefix, index_filename);
-      else if (ferror(db_index))
-        log("SYSERR: boot error -- unexpected end of file encountered in index file ./%s%s: %s",
-            prefix, index_filename, strerror(errno));
-      else
-        log("SYSERR: boot error -- error parsing index file ./%s%s on line %d",
-            prefix, index_filename, line_number);
-      exit(1);
-    }
+  if (num_jobs && parallel_discrete_load(jobs, num_jobs, mode))
+    rnum = merge_boot_jobs(jobs, num_jobs, mode);
+  else {
+    rewind(db_index);
+
+    for (int line_number = 1;; ++line_number) {
+      if (fscanf(db_index, "%s\n", buf1) != 1) {
+        if (feof(db_index))
+          log("SYSERR: boot error -- unexpected end of file encountered in index file ./%s%s",
+              prefix, index_filename);
+        else if (ferror(db_index))
+          log("SYSERR: boot error -- unexpected end of file encountered in index file ./%s%s: %s",
+              prefix, index_filename, strerror(errno));
+        else
+          log("SYSERR: boot error -- error parsing index file ./%s%s on line %d",
+              prefix, index_filename, line_number);
+        exit(1);
+      }
 
-    if (*buf1 == '$')
-      break;
+      if (*buf1 == '$')
+        break;
 
-    snprintf(buf2, sizeof(buf2), "%s%s", prefix, buf1);
-    if (!(db_file = fopen(buf2, "r"))) {
-      log("SYSERR: %s: %s", buf2, strerror(errno));
-      exit(1);
-    }
-    switch (mode) {
-    case DB_BOOT_WLD:
-    case DB_BOOT_OBJ:
-    case DB_BOOT_MOB:
-    case DB_BOOT_TRG:
-    case DB_BOOT_QST:
-      discrete_load(db_file, mode, buf2);
-      break;
-    case DB_BOOT_ZON:
-      load_zones(db_file, buf2);
-      break;
-    case DB_BOOT_HLP:
-      load_help(db_file, buf2);
-      break;
-    case DB_BOOT_SHP:
-      boot_the_shops(db_file, buf2, rec_count);
-      break;
-    }
+      snprintf(buf2, sizeof(buf2), "%s%s", prefix, buf1);
+      if (!(db_file = fopen(buf2, "r"))) {
+        log("SYSERR: %s: %s", buf2, strerror(errno));
+        exit(1);
+      }
+      switch (mode) {
+      case DB_BOOT_WLD:
+      case DB_BOOT_OBJ:
+      case DB_BOOT_MOB:
+      case DB_BOOT_TRG:
+      case DB_BOOT_QST:
+        discrete_load(db_file, mode, buf2, &rnum);
+        break;
+      case DB_BOOT_ZON:
+        load_zones(db_file, buf2);
+        break;
+      case DB_BOOT_HLP:
+        load_help(db_file, buf2);
+        break;
+      case DB_BOOT_SHP:
+        boot_the_shops(db_file, buf2, rec_count);
+        break;
+      }
 
-    fclose(db_file);
+      fclose(db_file);
+    }
   }
   fclose(db_index);
 
+  for (i = 0; i < num_jobs; i++)
+    free(jobs[i].filename);
+  if (jobs)
+    free(jobs);
+
+  switch (mode) {
+  case DB_BOOT_WLD:
+    top_of_world = rnum - 1;
+    break;
+  case DB_BOOT_MOB:
+    top_of_mobt = rnum - 1;
+    break;
+  case DB_BOOT_OBJ:
+    top_of_objt = rnum - 1;
+    break;
+  }
+
+  switch (mode) {
+  case DB_BOOT_WLD:
+  case DB_BOOT_MOB:
+  case DB_BOOT_OBJ:
+  case DB_BOOT_ZON:
+  case DB_BOOT_TRG:
+    index_vnums(mode);
+    break;
+  }
+
+  /* Room scripts are attached once the rooms have their final rnums. */
+  if (mode == DB_BOOT_WLD)
+    for (i = 0; i <= top_of_world; i++)
+      if (world[i].proto_script)
+        assign_triggers(&world[i], WLD_TRIGGER);
+
   /* Sort the help index. */
   if (mode == DB_BOOT_HLP) {
     qsort(help_table, top_of_helpt, sizeof(struct help_index_element), hsort);
   }
 }
 
-void discrete_load(FILE *fl, int mode, char *filename)
+/* Load the records of one area file.  Rooms, mobiles and objects are stored
+ * from *rnum on, and *rnum is left just past the last one; triggers and quests
+ * keep their own counts. */
+void discrete_load(FILE *fl, int mode, char *filename, int *rnum)
 {
   int nr = -1, last;
   char line[READ_SIZE];
+  zone_rnum zone = 0;
 
   const char *modes[] = {"world", "mob", "obj", "ZON", "SHP", "HLP", "trg", "qst"};
   /* modes positions correspond to DB_BOOT_xxx in db.h */
@@ -1164,16 +1270,16 @@ void discrete_load(FILE *fl, int mode, char *filename)
       else
 	switch (mode) {
 	case DB_BOOT_WLD:
-	  parse_room(fl, nr);
+	  parse_room(fl, (*rnum)++, nr, &zone);
 	  break;
 	case DB_BOOT_MOB:
-	  parse_mobile(fl, nr);
+	  parse_mobile(fl, (*rnum)++, nr);
 	  break;
         case DB_BOOT_TRG:
           parse_trigger(fl, nr);
           break;
 	case DB_BOOT_OBJ:
-	  strlcpy(line, parse_object(fl, nr), sizeof(line));
+	  parse_object(fl, (*rnum)++, nr, line);
 	  break;
   case DB_BOOT_QST:
     parse_quest(fl, nr);
@@ -1188,6 +1294,38 @@ void discrete_load(FILE *fl, int mode, char *filename)
   }
 }
 
+/* Close the gaps the parallel loader leaves where a file held fewer records
+ * than count_hash_records() counted.  Files are merged in index order, so the
+ * tables come out exactly as the serial loader builds them.  Returns the
+ * number of records loaded. */
+static int merge_boot_jobs(struct boot_job *jobs, int num_jobs, int mode)
+{
+  int i, j, next = 0;
+
+  for (i = 0; i < num_jobs; next += jobs[i++].loaded) {
+    if (jobs[i].first == next || !jobs[i].loaded)
+      continue;
+    switch (mode) {
+    case DB_BOOT_WLD:
+      memmove(world + next, world + jobs[i].first, sizeof(struct room_data) * jobs[i].loaded);
+      break;
+    case DB_BOOT_MOB:
+      memmove(mob_proto + next, mob_proto + jobs[i].first, sizeof(struct char_data) * jobs[i].loaded);
+      memmove(mob_index + next, mob_index + jobs[i].first, sizeof(struct index_data) * jobs[i].loaded);
+      for (j = next; j < next + jobs[i].loaded; j++)
+        mob_proto[j].nr = j;
+      break;
+    case DB_BOOT_OBJ:
+      memmove(obj_proto + next, obj_proto + jobs[i].first, sizeof(struct obj_data) * jobs[i].loaded);
+      memmove(obj_index + next, obj_index + jobs[i].first, sizeof(struct index_data) * jobs[i].loaded);
+      for (j = next; j < next + jobs[i].loaded; j++)
+        obj_proto[j].item_number = j;
+      break;
+    }
+  }
+  return (next);
+}
+
 static char fread_letter(FILE *fp)
 {
   char c;
@@ -1197,6 +1335,40 @@ static char fread_letter(FILE *fp)
   return c;
 }
 
+/* Lowercase a leading "a", "an" or "the" in a short description.  Unlike
+ * fname() this uses no static buffer, so it is safe in the parallel loader. */
+static void lower_article(char *str)
+{
+  size_t len;
+
+  if (!str || !*str)
+    return;
+
+  for (len = 0; isalpha(str[len]); len++);
+
+  if ((len == 1 && !strn_cmp(str, "a", 1)) || (len == 2 && !strn_cmp(str, "an", 2)) ||
+      (len == 3 && !strn_cmp(str, "the", 3)))
+    *str = LOWER(*str);
+}
+
+/* Swap a string just read from an area file for its pooled copy.  The pool
+ * is shared by the parser threads. */
+static char *pool_string(char *str)
+{
+  lock_boot();
+  str = share_string(str);
+  unlock_boot();
+
+  return (str);
+}
+
+static void pool_ex_descriptions(struct extra_descr_data *list)
+{
+  lock_boot();
+  share_ex_descriptions(list);
+  unlock_boot();
+}
+
 bitvector_t asciiflag_conv(char *flag)
 {
   bitvector_t flags = 0;
@@ -1243,10 +1415,9 @@ static bitvector_t asciiflag_conv_aff(char *flag)
   return (flags);
 }
 
-/* load the rooms */
-void parse_room(FILE *fl, int virtual_nr)
+/* load the rooms; *zone is where the search for the room's zone starts */
+void parse_room(FILE *fl, room_rnum room_nr, int virtual_nr, zone_rnum *zone)
 {
-  static int room_nr = 0, zone = 0;
   int t[10], i, retval;
   char line[READ_SIZE], flags[128], flags2[128], flags3[128];
   char flags4[128], buf2[MAX_STRING_LENGTH], buf[128];
@@ -1256,19 +1427,19 @@ void parse_room(FILE *fl, int virtual_nr)
   /* This really had better fit or there are other problems. */
   snprintf(buf2, sizeof(buf2), "room #%d", virtual_nr);
 
-  if (virtual_nr < zone_table[zone].bot) {
-    log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", virtual_nr, zone_table[zone].number, zone_table[zone].bot, zone_table[zone].top);
+  if (virtual_nr < zone_table[*zone].bot) {
+    log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", virtual_nr, zone_table[*zone].number, zone_table[*zone].bot, zone_table[*zone].top);
     exit(1);
   }
-  while (virtual_nr > zone_table[zone].top)
-    if (++zone > top_of_zone_table) {
+  while (virtual_nr > zone_table[*zone].top)
+    if (++(*zone) > top_of_zone_table) {
       log("SYSERR: Room %d is outside of any zone.", virtual_nr);
       exit(1);
     }
-  world[room_nr].zone = zone;
+  world[room_nr].zone = *zone;
   world[room_nr].number = virtual_nr;
-  world[room_nr].name = fread_string(fl, buf2);
-  world[room_nr].description = fread_string(fl, buf2);
+  world[room_nr].name = pool_string(fread_string(fl, buf2));
+  world[room_nr].description = pool_string(fread_string(fl, buf2));
 
   if (!get_line(fl, line)) {
     log("SYSERR: Expecting roomflags/sector type of room #%d but file ended!",
@@ -1299,8 +1470,10 @@ void parse_room(FILE *fl, int virtual_nr)
     check_bitvector_names(world[room_nr].room_flags[0], room_bits_count, flags, "room");
 
     if(bitsavetodisk) { /* Maybe the implementor just wants to look at the 128bit files */
+      lock_boot();
       add_to_save_list(zone_table[real_zone_by_thing(virtual_nr)].number, 3);
       converting = TRUE;
+      unlock_boot();
     }
 
   log("   done.");
@@ -1365,6 +1538,8 @@ void parse_room(FILE *fl, int virtual_nr)
       world[room_nr].ex_description = new_descr;
       break;
     case 'S':			/* end of room */
+      pool_ex_descriptions(world[room_nr].ex_description);
+
       /* DG triggers -- script is defined after the end of the room */
       letter = fread_letter(fl);
       ungetc(letter, fl);
@@ -1373,7 +1548,6 @@ void parse_room(FILE *fl, int virtual_nr)
         letter = fread_letter(fl);
         ungetc(letter, fl);
       }
-      top_of_world = room_nr++;
       return;
     default:
       log("%s", buf);
@@ -1388,7 +1562,7 @@ void setup_dir(FILE *fl, int room, int dir)
   int t[5];
   char line[READ_SIZE], buf2[128];
 
-  snprintf(buf2, sizeof(buf2), "room #%d, direction D%d", GET_ROOM_VNUM(room)+1, dir);
+  snprintf(buf2, sizeof(buf2), "room #%d, direction D%d", world[room].number, dir);
 
   if (!CONFIG_DIAGONAL_DIRS && IS_DIAGONAL(dir)) {
     log("Warning: Diagonal direction disabled: %s", buf2);
@@ -1396,8 +1570,8 @@ void setup_dir(FILE *fl, int room, int dir)
   }
 
   CREATE(world[room].dir_option[dir], struct room_direction_data, 1);
-  world[room].dir_option[dir]->general_description = fread_string(fl, buf2);
-  world[room].dir_option[dir]->keyword = fread_string(fl, buf2);
+  world[room].dir_option[dir]->general_description = pool_string(fread_string(fl, buf2));
+  world[room].dir_option[dir]->keyword = pool_string(fread_string(fl, buf2));
 
   if (!get_line(fl, line)) {
     log("SYSERR: Format error, %s", buf2);
@@ -1729,9 +1903,8 @@ static void parse_enhanced_mob(FILE *mob_f, int i, int nr)
   exit(1);
 }
 
-void parse_mobile(FILE *mob_f, int nr)
+void parse_mobile(FILE *mob_f, mob_rnum i, int nr)
 {
-  static int i = 0;
   int j, t[10], retval;
   char line[READ_SIZE], *tmpptr, letter;
   char f1[128], f2[128], f3[128], f4[128], f5[128], f6[128], f7[128], f8[128], buf2[128];
@@ -1749,14 +1922,12 @@ void parse_mobile(FILE *mob_f, int nr)
   sprintf(buf2, "mob vnum %d", nr);	/* sprintf: OK (for 'buf2 >= 19') */
 
   /* String data */
-  mob_proto[i].player.name = fread_string(mob_f, buf2);
-  tmpptr = mob_proto[i].player.short_descr = fread_string(mob_f, buf2);
-  if (tmpptr && *tmpptr)
-    if (!str_cmp(fname(tmpptr), "a") || !str_cmp(fname(tmpptr), "an") ||
-	!str_cmp(fname(tmpptr), "the"))
-      *tmpptr = LOWER(*tmpptr);
-  mob_proto[i].player.long_descr = fread_string(mob_f, buf2);
-  mob_proto[i].player.description = fread_string(mob_f, buf2);
+  mob_proto[i].player.name = pool_string(fread_string(mob_f, buf2));
+  tmpptr = fread_string(mob_f, buf2);
+  lower_article(tmpptr);
+  mob_proto[i].player.short_descr = pool_string(tmpptr);
+  mob_proto[i].player.long_descr = pool_string(fread_string(mob_f, buf2));
+  mob_proto[i].player.description = pool_string(fread_string(mob_f, buf2));
   GET_TITLE(mob_proto + i) = NULL;
 
   /* Numeric data */
@@ -1805,8 +1976,10 @@ void parse_mobile(FILE *mob_f, int nr)
     letter = *f4;
 
     if(bitsavetodisk) {
+      lock_boot();
       add_to_save_list(zone_table[real_zone_by_thing(nr)].number, 0);
       converting =TRUE;
+      unlock_boot();
     }
 
   log("   done.");
@@ -1870,15 +2043,13 @@ void parse_mobile(FILE *mob_f, int nr)
 
   mob_proto[i].nr = i;
   mob_proto[i].desc = NULL;
-
-  top_of_mobt = i++;
 }
 
-/* read all objects from obj file; generate index and prototypes */
-char *parse_object(FILE *obj_f, int nr)
+/* read all objects from obj file; generate index and prototypes.  Objects
+ * have no end marker, so the line that ended this one is left in line, which
+ * must hold READ_SIZE characters. */
+char *parse_object(FILE *obj_f, obj_rnum i, int nr, char *line)
 {
-  static int i = 0;
-  static char line[READ_SIZE];
   int t[10], j, retval;
   char *tmpptr, buf2[128], f1[READ_SIZE], f2[READ_SIZE], f3[READ_SIZE], f4[READ_SIZE];
   char f5[READ_SIZE], f6[READ_SIZE], f7[READ_SIZE], f8[READ_SIZE];
@@ -1899,16 +2070,16 @@ char *parse_object(FILE *obj_f, int nr)
     log("SYSERR: Null obj name or format error at or near %s", buf2);
     exit(1);
   }
-  tmpptr = obj_proto[i].short_description = fread_string(obj_f, buf2);
-  if (tmpptr && *tmpptr)
-    if (!str_cmp(fname(tmpptr), "a") || !str_cmp(fname(tmpptr), "an") ||
-	!str_cmp(fname(tmpptr), "the"))
-      *tmpptr = LOWER(*tmpptr);
+  obj_proto[i].name = pool_string(obj_proto[i].name);
+  tmpptr = fread_string(obj_f, buf2);
+  lower_article(tmpptr);
+  obj_proto[i].short_description = pool_string(tmpptr);
 
-  tmpptr = obj_proto[i].description = fread_string(obj_f, buf2);
+  tmpptr = fread_string(obj_f, buf2);
   if (tmpptr && *tmpptr)
     CAP(tmpptr);
-  obj_proto[i].action_description = fread_string(obj_f, buf2);
+  obj_proto[i].description = pool_string(tmpptr);
+  obj_proto[i].action_description = pool_string(fread_string(obj_f, buf2));
 
   /* numeric data */
   if (!get_line(obj_f, line)) {
@@ -1943,8 +2114,10 @@ char *parse_object(FILE *obj_f, int nr)
     GET_OBJ_AFFECT(obj_proto + i)[3] = 0;
 
     if(bitsavetodisk) {
+      lock_boot();
       add_to_save_list(zone_table[real_zone_by_thing(nr)].number, 1);
       converting = TRUE;
+      unlock_boot();
     }
 
     log("   done.");
@@ -2064,9 +2237,8 @@ char *parse_object(FILE *obj_f, int nr)
       break;
     case '$':
     case '#':
-      top_of_objt = i;
+      pool_ex_descriptions(obj_proto[i].ex_description);
       check_object(obj_proto + i);
-      i++;
       return (line);
     default:
       log("SYSERR: Format error in (%c): %s", *line, buf2);
@@ -2496,6 +2668,7 @@ struct obj_data *read_object(obj_vnum nr, int type) /* and obj_rnum */
   obj->events = NULL;
 
   obj_index[i].number++;
+  timed_obj_check(obj);
 
   obj->script_id = 0;	// this is set later by obj_script_id
 
@@ -2506,11 +2679,11 @@ struct obj_data *read_object(obj_vnum nr, int type) /* and obj_rnum */
 }
 
 #define ZO_DEAD  999
-/* update zone ages, queue for reset if necessary, and dequeue when possible */
+/* update zone ages and queue for reset if necessary */
 void zone_update(void)
 {
   int i;
-  struct reset_q_element *update_u, *temp;
+  struct reset_q_element *update_u;
   static int timer = 0;
 
   /* jelson 10/22/92 */
@@ -2547,302 +2720,36 @@ void zone_update(void)
     }
   }	/* end - one minute has passed */
 
-  /* Dequeue zones (if possible) and reset. This code is executed every 10
-   * seconds (i.e. PULSE_ZONE). */
-  for (update_u = reset_q.head; update_u; update_u = update_u->next)
-    if (zone_table[update_u->zone_to_reset].reset_mode == 2 ||
-	is_empty(update_u->zone_to_reset)) {
-      reset_zone(update_u->zone_to_reset);
-      mudlog(CMP, LVL_IMPL+1, FALSE, "Auto zone reset: %s (Zone %d)",
-          zone_table[update_u->zone_to_reset].name, zone_table[update_u->zone_to_reset].number);
-      struct descriptor_data *pt;
-      for (pt = descriptor_list; pt; pt = pt->next)
-        if (IS_PLAYING(pt) && pt->character && PRF_FLAGGED(pt->character, PRF_ZONERESETS))
-          send_to_char(pt->character, "%s[Auto zone reset: %s (Zone %d)]%s", 
-            CCGRN(pt->character, C_NRM), zone_table[update_u->zone_to_reset].name, 
-            zone_table[update_u->zone_to_reset].number, CCNRM(pt->character, C_NRM));
-      /* dequeue */
-      if (update_u == reset_q.head)
-	reset_q.head = reset_q.head->next;
-      else {
-	for (temp = reset_q.head; temp->next != update_u;
-	     temp = temp->next);
-
-	if (!update_u->next)
-	  reset_q.tail = temp;
-
-	temp->next = update_u->next;
-      }
-
-      free(update_u);
-      break;
-    }
+  /* The queued zones are reset by run_zone_resets(), a little every pulse. */
 }
 
-static void log_zone_error(zone_rnum zone, int cmd_no, const char *message)
+void log_zone_error(zone_rnum zone, int cmd_no, const char *message)
 {
   mudlog(NRM, LVL_GOD, TRUE, "SYSERR: zone file: %s", message);
   mudlog(NRM, LVL_GOD, TRUE, "SYSERR: ...offending cmd: '%c' cmd in zone #%d, line %d",
 	ZCMD.command, zone_table[zone].number, ZCMD.line);
 }
 
-#define ZONE_ERROR(message) \
-	{ log_zone_error(zone, cmd_no, message); last_cmd = 0; }
-
-/* execute the reset command table of a given zone */
-void reset_zone(zone_rnum zone)
-{
-  int cmd_no, last_cmd = 0;
-  struct char_data *mob = NULL;
-  struct obj_data *obj, *obj_to;
-  room_vnum rvnum;
-  room_rnum rrnum;
-  struct char_data *tmob=NULL; /* for trigger assignment */
-  struct obj_data *tobj=NULL;  /* for trigger assignment */
-
-  for (cmd_no = 0; ZCMD.command != 'S'; cmd_no++) {
-
-    if (ZCMD.if_flag && !last_cmd)
-      continue;
-
-    /* This is the list of actual zone commands. If any new zone commands are
-     * added to the game, be certain to update the list of commands in load_zone
-     * () so that the counting will still be correct. - ae. */
-    switch (ZCMD.command) {
-    case '*':			/* ignore command */
-      last_cmd = 0;
-      break;
-
-    case 'M':			/* read a mobile */
-      if (mob_index[ZCMD.arg1].number < ZCMD.arg2) {
-	mob = read_mobile(ZCMD.arg1, REAL);
-	char_to_room(mob, ZCMD.arg3);
-        load_mtrigger(mob);
-        tmob = mob;
-	last_cmd = 1;
-      } else
-	last_cmd = 0;
-      tobj = NULL;
-      break;
-
-    case 'O':			/* read an object */
-      if (obj_index[ZCMD.arg1].number < ZCMD.arg2) {
-	if (ZCMD.arg3 != NOWHERE) {
-	  obj = read_object(ZCMD.arg1, REAL);
-	  obj_to_room(obj, ZCMD.arg3);
-	  last_cmd = 1;
-          load_otrigger(obj);
-          tobj = obj;
-	} else {
-	  obj = read_object(ZCMD.arg1, REAL);
-	  IN_ROOM(obj) = NOWHERE;
-	  last_cmd = 1;
-          tobj = obj;
-	}
-      } else
-	last_cmd = 0;
-      tmob = NULL;
-      break;
-
-    case 'P':			/* object to object */
-      if (obj_index[ZCMD.arg1].number < ZCMD.arg2) {
-	obj = read_object(ZCMD.arg1, REAL);
-	if (!(obj_to = get_obj_num(ZCMD.arg3))) {
-	  ZONE_ERROR("target obj not found, command disabled");
-	  ZCMD.command = '*';
-	  break;
-	}
-	obj_to_obj(obj, obj_to);
-	last_cmd = 1;
-        load_otrigger(obj);
-        tobj = obj;
-      } else
-	last_cmd = 0;
-      tmob = NULL;
-      break;
-
-    case 'G':			/* obj_to_char */
-      if (!mob) {
-	char error[MAX_INPUT_LENGTH];
-	snprintf(error, sizeof(error), "attempt to give obj #%d to non-existant mob, command disabled", obj_index[ZCMD.arg1].vnum);
-	ZONE_ERROR(error);
-	ZCMD.command = '*';
-	break;
-      }
-      if (obj_index[ZCMD.arg1].number < ZCMD.arg2) {
-	obj = read_object(ZCMD.arg1, REAL);
-	obj_to_char(obj, mob);
-	last_cmd = 1;
-        load_otrigger(obj);
-        tobj = obj;
-      } else
-	last_cmd = 0;
-      tmob = NULL;
-      break;
-
-    case 'E':			/* object to equipment list */
-      if (!mob) {
-	char error[MAX_INPUT_LENGTH];
-	snprintf(error, sizeof(error), "trying to equip non-existant mob with obj #%d, command disabled", obj_index[ZCMD.arg1].vnum);
-	ZONE_ERROR(error);
-	ZCMD.command = '*';
-	break;
-      }
-      if (obj_index[ZCMD.arg1].number < ZCMD.arg2) {
-	if (ZCMD.arg3 < 0 || ZCMD.arg3 >= NUM_WEARS) {
-          char error[MAX_INPUT_LENGTH];
-	  snprintf(error, sizeof(error), "invalid equipment pos number (mob %s, obj %d, pos %d)", GET_NAME(mob), obj_index[ZCMD.arg2].vnum, ZCMD.arg3);
-	  ZONE_ERROR(error);
-	} else {
-	  obj = read_object(ZCMD.arg1, REAL);
-          IN_ROOM(obj) = IN_ROOM(mob);
-          load_otrigger(obj);
-          if (wear_otrigger(obj, mob, ZCMD.arg3)) {
-            IN_ROOM(obj) = NOWHERE;
-            equip_char(mob, obj, ZCMD.arg3);
-          } else
-            obj_to_char(obj, mob);
-          tobj = obj;
-	  last_cmd = 1;
-	}
-      } else
-	last_cmd = 0;
-      tmob = NULL;
-      break;
-
-    case 'R': /* rem obj from room */
-      if ((obj = get_obj_in_list_num(ZCMD.arg2, world[ZCMD.arg1].contents)) != NULL)
-        extract_obj(obj);
-      last_cmd = 1;
-      tmob = NULL;
-      tobj = NULL;
-      break;
-
-
-    case 'D':			/* set state of door */
-      if (ZCMD.arg2 < 0 || ZCMD.arg2 >= DIR_COUNT ||
-	  (world[ZCMD.arg1].dir_option[ZCMD.arg2] == NULL)) {
-        char error[MAX_INPUT_LENGTH];
-        snprintf(error, sizeof(error), "door does not exist in room %d - dir %d, command disabled",  world[ZCMD.arg1].number, ZCMD.arg2);
-	ZONE_ERROR(error);
-	ZCMD.command = '*';
-      } else
-	switch (ZCMD.arg3) {
-	case 0:
-	  REMOVE_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		     EX_LOCKED);
-	  REMOVE_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		     EX_CLOSED);
-	  break;
-	case 1:
-	  SET_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		  EX_CLOSED);
-	  REMOVE_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		     EX_LOCKED);
-	  break;
-	case 2:
-	  SET_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		  EX_LOCKED);
-	  SET_BIT(world[ZCMD.arg1].dir_option[ZCMD.arg2]->exit_info,
-		  EX_CLOSED);
-	  break;
-	}
-      last_cmd = 1;
-      tmob = NULL;
-      tobj = NULL;
-      break;
-
-    case 'T': /* trigger command */
-      if (ZCMD.arg1==MOB_TRIGGER && tmob) {
-        if (!SCRIPT(tmob))
-          CREATE(SCRIPT(tmob), struct script_data, 1);
-        add_trigger(SCRIPT(tmob), read_trigger(ZCMD.arg2), -1);
-        last_cmd = 1;
-      } else if (ZCMD.arg1==OBJ_TRIGGER && tobj) {
-        if (!SCRIPT(tobj))
-          CREATE(SCRIPT(tobj), struct script_data, 1);
-        add_trigger(SCRIPT(tobj), read_trigger(ZCMD.arg2), -1);
-        last_cmd = 1;
-      } else if (ZCMD.arg1==WLD_TRIGGER) {
-        if (ZCMD.arg3 == NOWHERE || ZCMD.arg3>top_of_world) {
-          ZONE_ERROR("Invalid room number in trigger assignment");
-        }
-        if (!world[ZCMD.arg3].script)
-          CREATE(world[ZCMD.arg3].script, struct script_data, 1);
-        add_trigger(world[ZCMD.arg3].script, read_trigger(ZCMD.arg2), -1);
-        last_cmd = 1;
-      }
-
-      break;
-
-    case 'V':
-      if (ZCMD.arg1==MOB_TRIGGER && tmob) {
-        if (!SCRIPT(tmob)) {
-          ZONE_ERROR("Attempt to give variable to scriptless mobile");
-        } else
-          add_var(&(SCRIPT(tmob)->global_vars), ZCMD.sarg1, ZCMD.sarg2,
-                  ZCMD.arg3);
-        last_cmd = 1;
-      } else if (ZCMD.arg1==OBJ_TRIGGER && tobj) {
-        if (!SCRIPT(tobj)) {
-          ZONE_ERROR("Attempt to give variable to scriptless object");
-        } else
-          add_var(&(SCRIPT(tobj)->global_vars), ZCMD.sarg1, ZCMD.sarg2,
-                  ZCMD.arg3);
-        last_cmd = 1;
-      } else if (ZCMD.arg1==WLD_TRIGGER) {
-        if (ZCMD.arg3 == NOWHERE || ZCMD.arg3>top_of_world) {
-          ZONE_ERROR("Invalid room number in variable assignment");
-        } else {
-          if (!(world[ZCMD.arg3].script)) {
-            ZONE_ERROR("Attempt to give variable to scriptless object");
-          } else
-            add_var(&(world[ZCMD.arg3].script->global_vars),
-                    ZCMD.sarg1, ZCMD.sarg2, ZCMD.arg2);
-          last_cmd = 1;
-        }
-      }
-      break;
-
-    default:
-      ZONE_ERROR("unknown cmd in reset table; cmd disabled");
-      ZCMD.command = '*';
-      break;
-    }
-  }
-
-  zone_table[zone].age = 0;
-
-  /* handle reset_wtrigger's */
-  rvnum = zone_table[zone].bot;
-  while (rvnum <= zone_table[zone].top) {
-    rrnum = real_room(rvnum);
-    if (rrnum != NOWHERE) reset_wtrigger(&world[rrnum]);
-    rvnum++;
-  }
-}
-
 /* for use in reset_zone; return TRUE if zone 'nr' is free of PC's  */
 int is_empty(zone_rnum zone_nr)
 {
+#if CHECK_ZONE_PRESENCE
   struct descriptor_data *i;
+  int present = 0;
 
-  for (i = descriptor_list; i; i = i->next) {
-    if (STATE(i) != CON_PLAYING)
-      continue;
-    if (IN_ROOM(i->character) == NOWHERE)
-      continue;
-    if (world[IN_ROOM(i->character)].zone != zone_nr)
-      continue;
-    /* If an immortal has nohassle off, he counts as present. Added for testing
-     * zone reset triggers -Welcor */
-    if ((!IS_NPC(i->character)) && (GET_LEVEL(i->character) >= LVL_IMMORT) && (PRF_FLAGGED(i->character, PRF_NOHASSLE)))
-      continue;
+  /* Count the zone the slow way and make sure the running total agrees. */
+  for (i = descriptor_list; i; i = i->next)
+    if (i->character && i->character->desc == i && presence_zone_of(i->character) == zone_nr)
+      present++;
 
-    return (0);
+  if (present != zone_table[zone_nr].num_present) {
+    log("SYSERR: Zone %d has %d chars present but counted %d.",
+      zone_table[zone_nr].number, present, zone_table[zone_nr].num_present);
+    zone_table[zone_nr].num_present = present;
   }
+#endif
 
-  return (1);
+  return (zone_table[zone_nr].num_present <= 0);
 }
 
 /* Functions of a general utility nature. */
@@ -3230,6 +3137,7 @@ void free_char(struct char_data *ch)
       free(ch->player_specials->saved.completed_quests);
     if (GET_HOST(ch))
       free(GET_HOST(ch));
+    free_mysql_player_state(ch);
     if (IS_NPC(ch))
       log("SYSERR: Mob %s (#%d) had player_specials allocated!", GET_NAME(ch), GET_MOB_VNUM(ch));
   }
@@ -3461,6 +3369,7 @@ void clear_char(struct char_data *ch)
   GET_PFILEPOS(ch) = -1;
   GET_MOB_RNUM(ch) = NOBODY;
   GET_WAS_IN(ch) = NOWHERE;
+  GET_PRESENCE_ZONE(ch) = NOWHERE;
   GET_POS(ch) = POS_STANDING;
   ch->mob_specials.default_pos = POS_STANDING;
   ch->events = NULL;
@@ -3531,7 +3440,7 @@ void init_char(struct char_data *ch)
   }
 
   if ((i = get_ptable_by_name(GET_NAME(ch))) != -1)
-    player_table[i].id = GET_IDNUM(ch) = ++top_idnum;
+    set_player_index_id(i, GET_IDNUM(ch) = ++top_idnum);
   else
     log("SYSERR: init_char: Character '%s' not found in player table.", GET_NAME(ch));
 
@@ -3574,11 +3483,68 @@ void init_char(struct char_data *ch)
   SET_BIT_AR(PRF_FLAGS(ch), PRF_DISPMOVE);
 }
 
+static IDXTYPE table_vnum(int mode, int i)
+{
+  switch (mode) {
+  case DB_BOOT_WLD: return world[i].number;
+  case DB_BOOT_MOB: return mob_index[i].vnum;
+  case DB_BOOT_OBJ: return obj_index[i].vnum;
+  case DB_BOOT_ZON: return zone_table[i].number;
+  default:          return trig_index[i]->vnum;
+  }
+}
+
+/* Rebuilds the vnum -> rnum map for the DB_BOOT_WLD, _MOB, _OBJ, _ZON or _TRG
+ * table.  index_boot() calls this once a table is loaded, and OLC after every
+ * insert into or delete from one, since either renumbers the entries after
+ * it.  Until a table is indexed its real_*() lookup binary searches. */
+void index_vnums(int mode)
+{
+  struct vnum_index *idx = &vnum_indexes[mode];
+  int i, num, size = 0;
+  IDXTYPE vnum;
+
+  switch (mode) {
+  case DB_BOOT_WLD: num = world ? top_of_world + 1 : 0; break;
+  case DB_BOOT_MOB: num = mob_index ? top_of_mobt + 1 : 0; break;
+  case DB_BOOT_OBJ: num = obj_index ? top_of_objt + 1 : 0; break;
+  case DB_BOOT_ZON: num = zone_table ? top_of_zone_table + 1 : 0; break;
+  case DB_BOOT_TRG: num = top_of_trigt; break;
+  default:
+    log("SYSERR: Unknown table %d to index_vnums!", mode);
+    return;
+  }
+
+  for (i = 0; i < num; i++) {
+    vnum = table_vnum(mode, i);
+    if (vnum != NOWHERE && (int) vnum >= size)
+      size = vnum + 1;
+  }
+
+  RECREATE(idx->rnum, IDXTYPE, MAX(size, 1));
+  idx->size = size;
+  for (i = 0; i < size; i++)
+    idx->rnum[i] = NOWHERE;
+
+  /* Walk down so the first of any duplicate vnums wins. */
+  for (i = num - 1; i >= 0; i--) {
+    vnum = table_vnum(mode, i);
+    if (vnum != NOWHERE && (int) vnum >= 0)
+      idx->rnum[vnum] = i;
+  }
+
+  /* The rnums in the zone reset programs may have shifted. */
+  zone_programs_changed();
+}
+
 /* returns the real number of the room with given virtual number */
 room_rnum real_room(room_vnum vnum)
 {
   room_rnum bot, top, mid;
 
+  if (vnum_indexes[DB_BOOT_WLD].rnum)
+    return VNUM_INDEX_LOOKUP(vnum_indexes[DB_BOOT_WLD], vnum);
+
   bot = 0;
   top = top_of_world;
 
@@ -3604,6 +3570,9 @@ mob_rnum real_mobile(mob_vnum vnum)
 {
   mob_rnum bot, top, mid;
 
+  if (vnum_indexes[DB_BOOT_MOB].rnum)
+    return VNUM_INDEX_LOOKUP(vnum_indexes[DB_BOOT_MOB], vnum);
+
   bot = 0;
   top = top_of_mobt;
 
@@ -3630,6 +3599,9 @@ obj_rnum real_object(obj_vnum vnum)
 {
   obj_rnum bot, top, mid;
 
+  if (vnum_indexes[DB_BOOT_OBJ].rnum)
+    return VNUM_INDEX_LOOKUP(vnum_indexes[DB_BOOT_OBJ], vnum);
+
   bot = 0;
   top = top_of_objt;
 
@@ -3656,6 +3628,9 @@ zone_rnum real_zone(zone_vnum vnum)
 {
   zone_rnum bot, top, mid;
 
+  if (vnum_indexes[DB_BOOT_ZON].rnum)
+    return VNUM_INDEX_LOOKUP(vnum_indexes[DB_BOOT_ZON], vnum);
+
   bot = 0;
   top = top_of_zone_table;
 
@@ -3851,6 +3826,7 @@ static void load_default_config( void )
   CONFIG_MAP_SIZE               = default_map_size;
   CONFIG_MINIMAP_SIZE           = default_minimap_size;
   CONFIG_SCRIPT_PLAYERS         = script_players;
+  CONFIG_UNATTENDED_AI          = unattended_ai_rate;
   CONFIG_DEBUG_MODE             = debug_mode;
 
   /* Rent / crashsave options. */
@@ -4173,6 +4149,8 @@ void load_config( void )
           CONFIG_USE_AUTOWIZ = num;
         else if (!str_cmp(tag, "use_new_socials"))
           CONFIG_NEW_SOCIALS = num;
+        else if (!str_cmp(tag, "unattended_ai_rate"))
+          CONFIG_UNATTENDED_AI = num;
         break;
 
       case 'w':
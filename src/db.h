@@ -81,6 +81,7 @@
 #define TRG_PREFIX  LIB_WORLD"trg"SLASH	/* trigger files	*/
 #define HLP_PREFIX  LIB_TEXT"help"SLASH /* Help files           */
 #define QST_PREFIX  LIB_WORLD"qst"SLASH /* quest files          */
+#define SNAPSHOT_FILE LIB_WORLD"snapshot" /* parsed wld/mob/obj/zon/trg */
 
 #define CREDITS_FILE	LIB_TEXT"credits" /* for the 'credits' command	*/
 #define NEWS_FILE	LIB_TEXT"news"	/* for the 'news' command	*/
@@ -169,6 +170,10 @@ struct reset_com {
     *  'V': Assign a variable */
 };
 
+/* Set to 1 to have is_empty() count each zone's connected characters the
+ * slow way and log any zone whose num_present has drifted from that. */
+#define CHECK_ZONE_PRESENCE 0
+
 /* zone definition structure. for the 'zone-table'   */
 struct zone_data {
    char	*name;		    /* name of this zone                  */
@@ -186,6 +191,14 @@ struct zone_data {
    int	reset_mode;         /* conditions for reset (see below)   */
    zone_vnum number;	    /* virtual number of this zone	  */
    struct reset_com *cmd;   /* command table for reset	          */
+   int num_present;         /* connected chars keeping it busy    */
+   struct char_data *parked_mobs; /* mobs idle until it is busy again */
+
+   struct zone_program *program;  /* cmd compiled for reset_zone()    */
+   int reset_count;               /* resets since boot                */
+   unsigned long reset_usec;      /* time spent in them (usec)        */
+   unsigned long last_reset_usec; /* time the last reset took         */
+   unsigned long max_reset_usec;  /* time the slowest reset took      */
 
    /* Reset mode:
     *   0: Don't reset, and don't update age.
@@ -223,6 +236,18 @@ struct help_index_element {
    int min_level;    /*Min Level to read help entry*/
 };
 
+/* Direct vnum to rnum map for one of the world tables, indexed by vnum.  It
+ * is two bytes per possible vnum instead of a binary search that pulls in a
+ * whole room or index struct at every step.  See index_vnums(). */
+struct vnum_index {
+   IDXTYPE *rnum;   /* rnum of each vnum below size, NOWHERE if unused */
+   int size;        /* highest vnum in the table + 1 */
+};
+
+/* rnum for vnum in a built vnum_index, or NOWHERE (== NOBODY == NOTHING) */
+#define VNUM_INDEX_LOOKUP(idx, vnum) \
+  ((unsigned int)(vnum) < (unsigned int)(idx).size ? (idx).rnum[(vnum)] : NOWHERE)
+
 /* The ban defines and structs were moved to ban.h */
 
 /* for the "buffered" rent and house object loading */
@@ -256,6 +281,7 @@ void  free_player_index(void);
 void  load_help(FILE *fl, char *name);
 void  new_mobile_data(struct char_data *ch);
 
+void  index_vnums(int mode);
 zone_rnum real_zone(zone_vnum vnum);
 room_rnum real_room(room_vnum vnum);
 mob_rnum real_mobile(mob_vnum vnum);
@@ -294,8 +320,24 @@ long   get_ptable_by_name(const char *name);
 void   remove_player(int pfilepos);
 void   clean_pfiles(void);
 void   build_player_index(void);
+void   index_player_table(void);
+void   set_player_index_id(int pos, long id);
+void   compact_player_index(void);
+void   set_player_index_arena(char *arena, size_t len);
+void   rename_player_in_index(int pos, const char *name);
+int    pfile_needs_cleaning(int pos, time_t now);
 void sprintarray_conv(int *bitvector, char *flag, int maxar);
 
+/* Functions from mysql_db.c and mysql_players.c that callers without
+ * <mysql.h> need */
+void   mysql_save_flush(void);
+void   stop_mysql_save_worker(void);
+void   mysql_save_poll(void);
+int    mysql_save_log_capture(const char *format, va_list args);
+void   mysql_pool_keepalive(void);
+void   free_mysql_player_state(struct char_data *ch);
+void   show_mysql_save_stats(struct char_data *ch);
+
 struct obj_data *create_obj(void);
 void   clear_object(struct obj_data *obj);
 void   free_obj(struct obj_data *obj);
@@ -306,12 +348,13 @@ int    vnum_trig(char *, struct char_data *);
 
 void setup_dir(FILE *fl, int room, int dir);
 void index_boot(int mode);
-void discrete_load(FILE *fl, int mode, char *filename);
-void parse_room(FILE *fl, int virtual_nr);
-void parse_mobile(FILE *mob_f, int nr);
-char *parse_object(FILE *obj_f, int nr);
+void discrete_load(FILE *fl, int mode, char *filename, int *rnum);
+void parse_room(FILE *fl, room_rnum room_nr, int virtual_nr, zone_rnum *zone);
+void parse_mobile(FILE *mob_f, mob_rnum i, int nr);
+char *parse_object(FILE *obj_f, obj_rnum i, int nr, char *line);
 int is_empty(zone_rnum zone_nr);
 void reset_zone(zone_rnum zone);
+void log_zone_error(zone_rnum zone, int cmd_no, const char *message);
 void reboot_wizlists(void);
 ACMD(do_reboot);
 void boot_world(void);
@@ -363,6 +406,8 @@ extern struct reset_q_type reset_q;
 extern struct room_data *world;
 extern room_rnum top_of_world;
 
+extern struct vnum_index vnum_indexes[];
+
 extern struct zone_data *zone_table;
 extern zone_rnum top_of_zone_table;
 
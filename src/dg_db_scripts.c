@@ -158,7 +158,7 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
       case WLD_TRIGGER:
         mudlog(BRF, LVL_BUILDER, TRUE,
                "SYSERR: dg_read_trigger: Trigger vnum #%d asked for but non-existant! (room:%d)",
-               vnum, GET_ROOM_VNUM( ((room_data *)proto)->number ));
+               vnum, ((room_data *)proto)->number);
         break;
       default:
         mudlog(BRF, LVL_BUILDER, TRUE,
@@ -197,16 +197,8 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
           trg_proto = trg_proto->next;
         trg_proto->next = new_trg;
       }
-
-      if (rnum != NOTHING) {
-        if (!(room->script))
-          CREATE(room->script, struct script_data, 1);
-        add_trigger(SCRIPT(room), read_trigger(rnum), -1);
-      } else {
-        mudlog(BRF, LVL_BUILDER, TRUE,
-               "SYSERR: non-existant trigger #%d assigned to room #%d",
-               vnum, room->number);
-      }
+      /* The room's script is attached by index_boot(), once the room has its
+       * final place in world[]. */
       break;
     default:
       mudlog(BRF, LVL_BUILDER, TRUE,
@@ -270,7 +262,7 @@ void assign_triggers(void *i, int type)
                  trg_proto->vnum, mob_index[mob->nr].vnum);
         } else {
           if (!SCRIPT(mob))
-            CREATE(SCRIPT(mob), struct script_data, 1);
+            SCRIPT(mob) = create_script(mob, MOB_TRIGGER);
           add_trigger(SCRIPT(mob), read_trigger(rnum), -1);
         }
         trg_proto = trg_proto->next;
@@ -286,7 +278,7 @@ void assign_triggers(void *i, int type)
             trg_proto->vnum, obj_index[obj->item_number].vnum);
         } else {
           if (!SCRIPT(obj))
-            CREATE(SCRIPT(obj), struct script_data, 1);
+            SCRIPT(obj) = create_script(obj, OBJ_TRIGGER);
           add_trigger(SCRIPT(obj), read_trigger(rnum), -1);
         }
         trg_proto = trg_proto->next;
@@ -303,7 +295,7 @@ void assign_triggers(void *i, int type)
                  trg_proto->vnum, room->number);
         } else {
           if (!SCRIPT(room))
-            CREATE(SCRIPT(room), struct script_data, 1);
+            SCRIPT(room) = create_script(room, WLD_TRIGGER);
           add_trigger(SCRIPT(room), read_trigger(rnum), -1);
         }
         trg_proto = trg_proto->next;
@@ -172,6 +172,13 @@ int event_is_queued(struct event *event)
 /***************************************************************************
  * Begin generic (abstract) priority queue functions
  **************************************************************************/
+/* static local function prototypes (current file scope only) */
+static struct q_element *queue_alloc_element(struct dg_queue *q);
+static void queue_link(struct dg_queue *q, struct q_element *qe);
+static void queue_turn(struct dg_queue *q, long until);
+static void bucket_append(struct q_bucket *b, struct q_element *qe);
+static void bucket_unlink(struct q_element *qe);
+
 /** Create a new, empty, priority queue and return it.
  * @retval dg_queue * Pointer to the newly created queue structure. */
 struct dg_queue *queue_init(void)
@@ -179,13 +186,14 @@ struct dg_queue *queue_init(void)
   struct dg_queue *q;
 
   CREATE(q, struct dg_queue, 1);
+  q->now = (long) pulse;
 
   return q;
 }
 
 /** Add some 'data' to a priority queue. 
  * @pre The paremeter q must have been previously created by queue_init.
- * @post A new q_element is created to hold the data parameter.
+ * @post A q_element is taken from the free-list to hold the data parameter.
  * @param q The existing dg_queue to add an element to. 
  * @param data The data to be associated with, and theoretically used, when
  * the element comes up in q. data is wrapped in a new q_element.
@@ -195,77 +203,37 @@ struct dg_queue *queue_init(void)
  * the data. */
 struct q_element *queue_enq(struct dg_queue *q, void *data, long key)
 {
-  struct q_element *qe, *i;
-  int bucket;
+  struct q_element *qe;
 
-  CREATE(qe, struct q_element, 1);
+  qe = queue_alloc_element(q);
   qe->data = data;
   qe->key = key;
 
-  bucket = key % NUM_EVENT_QUEUES;   /* which queue does this go in */
-
-  if (!q->head[bucket]) { /* queue is empty */
-    q->head[bucket] = qe;
-    q->tail[bucket] = qe;
-  }
-
-  else {
-    for (i = q->tail[bucket]; i; i = i->prev) {
-
-      if (i->key < key) { /* found insertion point */
-	if (i == q->tail[bucket])
-	  q->tail[bucket] = qe;
-	else {
-	  qe->next = i->next;
-	  i->next->prev = qe;
-	}
-
-	qe->prev = i;
-	i->next = qe;
-	break;
-      }
-    }
-
-    if (i == NULL) { /* insertion point is front of list */
-      qe->next = q->head[bucket];
-      q->head[bucket] = qe;
-      qe->next->prev = qe;
-    }
-  }
+  queue_link(q, qe);
 
   return qe;
 }
 
 /** Remove queue element qe from the priority queue q.
  * @pre qe->data has been dealt with in some way.
- * @post qe has been freed. 
+ * @post qe has been returned to the free-list. 
  * @param q Pointer to the queue containing qe.
  * @param qe Pointer to the q_element to remove from q.
  */
 void queue_deq(struct dg_queue *q, struct q_element *qe)
 {
-  int i;
-
   assert(qe);
 
-  i = qe->key % NUM_EVENT_QUEUES;
-
-  if (qe->prev == NULL)
-    q->head[i] = qe->next;
-  else
-    qe->prev->next = qe->next;
+  bucket_unlink(qe);
 
-  if (qe->next == NULL)
-    q->tail[i] = qe->prev;
-  else
-    qe->next->prev = qe->prev;
-
-  free(qe);
+  qe->data = NULL;
+  qe->next = q->free_list;
+  q->free_list = qe;
 }
 
 /** Removes and returns the data of the first element of the priority queue q. 
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse.
+ * @pre pulse must be defined. The wheel is turned up to the current pulse
+ * before the head is looked for.
  * @post the q->head is dequeued. 
  * @param q The queue to return the head of.
  * @retval void * NULL if there is not a currently available head, pointer
@@ -273,32 +241,29 @@ void queue_deq(struct dg_queue *q, struct q_element *qe)
 void *queue_head(struct dg_queue *q)
 {
   void *dg_data;
-  int i;
 
-  i = pulse % NUM_EVENT_QUEUES;
+  queue_turn(q, (long) pulse);
 
-  if (!q->head[i])
+  if (!q->due.head)
     return NULL;
 
-  dg_data = q->head[i]->data;
-  queue_deq(q, q->head[i]);
+  dg_data = q->due.head->data;
+  queue_deq(q, q->due.head);
   return dg_data;
 }
 
 /** Returns the key of the head element of the priority queue.
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse. 
+ * @pre pulse must be defined. The wheel is turned up to the current pulse
+ * before the head is looked for.
  * @param q Queue to check for.
  * @retval long Return the key element of the head q_element. If no head
  * q_element is available, return LONG_MAX. */
 long queue_key(struct dg_queue *q)
 {
-  int i;
+  queue_turn(q, (long) pulse);
 
-  i = pulse % NUM_EVENT_QUEUES;
-
-  if (q->head[i])
-    return q->head[i]->key;
+  if (q->due.head)
+    return q->due.head->key;
   else
     return LONG_MAX;
 }
@@ -318,26 +283,186 @@ long queue_elmt_key(struct q_element *qe)
  */
 void queue_free(struct dg_queue *q)
 {
-  int i;
-  struct q_element *qe, *next_qe;
+  int i, j;
+  struct q_bucket *b;
+  struct q_element *qe;
+  struct q_pool_chunk *chunk, *next_chunk;
   struct event *event;
 
-  for (i = 0; i < NUM_EVENT_QUEUES; i++)
+  for (i = 0; i <= EVENT_WHEEL_LEVELS; i++)
   {
-    for (qe = q->head[i]; qe; qe = next_qe) 
+    for (j = 0; j < EVENT_WHEEL_SIZE; j++)
     {
-      next_qe = qe->next;
-      if ((event = (struct event *) qe->data) != NULL) 
+      /* The extra pass covers the due and overflow lists. */
+      if (i < EVENT_WHEEL_LEVELS)
+        b = &q->wheel[i][j];
+      else if (j == 0)
+        b = &q->due;
+      else if (j == 1)
+        b = &q->overflow;
+      else
+        break;
+
+      for (qe = b->head; qe; qe = qe->next)
       {
-        if (event->event_obj)
-          cleanup_event_obj(event);
+        if ((event = (struct event *) qe->data) != NULL)
+        {
+          if (event->event_obj)
+            cleanup_event_obj(event);
 
-        free(event);
+          free(event);
+        }
       }
-      free(qe);
     }
   }
 
+  for (chunk = q->chunks; chunk; chunk = next_chunk)
+  {
+    next_chunk = chunk->next;
+    free(chunk->elements);
+    free(chunk);
+  }
+
   free(q);
 }
 
+/** Takes an element off the free-list of q, growing the pool by
+ * EVENT_POOL_CHUNK elements if it is empty. */
+static struct q_element *queue_alloc_element(struct dg_queue *q)
+{
+  struct q_pool_chunk *chunk;
+  struct q_element *qe;
+  int i;
+
+  if (!q->free_list)
+  {
+    CREATE(chunk, struct q_pool_chunk, 1);
+    CREATE(chunk->elements, struct q_element, EVENT_POOL_CHUNK);
+    chunk->next = q->chunks;
+    q->chunks = chunk;
+
+    for (i = 0; i < EVENT_POOL_CHUNK; i++)
+    {
+      chunk->elements[i].next = q->free_list;
+      q->free_list = &chunk->elements[i];
+    }
+  }
+
+  qe = q->free_list;
+  q->free_list = qe->next;
+  qe->prev = qe->next = NULL;
+  qe->bucket = NULL;
+
+  return qe;
+}
+
+/** Files qe into the slot that will come around at qe->key, relative to
+ * how far the wheel has already turned.  Keys that have already arrived go
+ * straight onto the due list. */
+static void queue_link(struct dg_queue *q, struct q_element *qe)
+{
+  long delta = qe->key - q->now;
+  int level;
+
+  if (delta <= 0)
+  {
+    bucket_append(&q->due, qe);
+    return;
+  }
+
+  for (level = 0; level < EVENT_WHEEL_LEVELS; level++)
+  {
+    if (delta < (1L << (EVENT_WHEEL_BITS * (level + 1))))
+    {
+      bucket_append(&q->wheel[level][(qe->key >> (EVENT_WHEEL_BITS * level)) & EVENT_WHEEL_MASK], qe);
+      return;
+    }
+  }
+
+  bucket_append(&q->overflow, qe);
+}
+
+/** Turns the wheel one pulse at a time up to 'until'.  Whenever a level's
+ * slot index wraps back to 0, the matching slot of the level above is
+ * emptied and its elements refiled, which moves them one level closer to
+ * level 0.  The level 0 slot for each pulse is moved onto the due list. */
+static void queue_turn(struct dg_queue *q, long until)
+{
+  struct q_bucket *b;
+  struct q_element *qe, *next_qe;
+  int level, idx;
+
+  while (q->now < until)
+  {
+    q->now++;
+
+    for (level = 1; !(q->now & ((1L << (EVENT_WHEEL_BITS * level)) - 1)); level++)
+    {
+      if (level < EVENT_WHEEL_LEVELS)
+        b = &q->wheel[level][(q->now >> (EVENT_WHEEL_BITS * level)) & EVENT_WHEEL_MASK];
+      else
+        b = &q->overflow;
+
+      qe = b->head;
+      b->head = b->tail = NULL;
+      for (; qe; qe = next_qe)
+      {
+        next_qe = qe->next;
+        qe->prev = qe->next = NULL;
+        queue_link(q, qe);
+      }
+
+      if (level >= EVENT_WHEEL_LEVELS)
+        break;
+    }
+
+    idx = q->now & EVENT_WHEEL_MASK;
+    b = &q->wheel[0][idx];
+    if (!b->head)
+      continue;
+
+    for (qe = b->head; qe; qe = qe->next)
+      qe->bucket = &q->due;
+
+    if (q->due.tail)
+    {
+      q->due.tail->next = b->head;
+      b->head->prev = q->due.tail;
+    }
+    else
+      q->due.head = b->head;
+    q->due.tail = b->tail;
+    b->head = b->tail = NULL;
+  }
+}
+
+static void bucket_append(struct q_bucket *b, struct q_element *qe)
+{
+  qe->bucket = b;
+  qe->next = NULL;
+  qe->prev = b->tail;
+
+  if (b->tail)
+    b->tail->next = qe;
+  else
+    b->head = qe;
+  b->tail = qe;
+}
+
+static void bucket_unlink(struct q_element *qe)
+{
+  struct q_bucket *b = qe->bucket;
+
+  if (qe->prev == NULL)
+    b->head = qe->next;
+  else
+    qe->prev->next = qe->next;
+
+  if (qe->next == NULL)
+    b->tail = qe->prev;
+  else
+    qe->next->prev = qe->prev;
+
+  qe->prev = qe->next = NULL;
+  qe->bucket = NULL;
+}
@@ -38,13 +38,38 @@ struct event {
 /**************************************************************************
  * Begin priority queue structures and defines.
  **************************************************************************/
-/** Number of buckets available in each queue. Reduces enqueue cost. */
-#define NUM_EVENT_QUEUES    10
+/* The queue is a hierarchical timing wheel.  Level 0 has one slot per pulse
+ * for the next EVENT_WHEEL_SIZE pulses, each higher level has slots that span
+ * EVENT_WHEEL_SIZE times as many pulses as the level below it.  As the wheel
+ * turns, the slots of the higher levels are cascaded down, so enqueue,
+ * dequeue and cancel are all O(1) no matter how many events are waiting. */
+#define EVENT_WHEEL_BITS    6   /**< log2 of the slots per level. */
+#define EVENT_WHEEL_SIZE    (1 << EVENT_WHEEL_BITS)
+#define EVENT_WHEEL_MASK    (EVENT_WHEEL_SIZE - 1)
+#define EVENT_WHEEL_LEVELS  4   /**< 2^24 pulses (~19 days) before overflow. */
+/** Number of q_elements allocated at once when the free-list runs dry. */
+#define EVENT_POOL_CHUNK    256
+
+/** One slot of the wheel; a doubly linked list of q_elements. */
+struct q_bucket {
+  struct q_element *head; /**< Front of this slot. */
+  struct q_element *tail; /**< Rear of this slot. */
+};
+
+/** A block of q_elements handed out through the free-list. */
+struct q_pool_chunk {
+  struct q_element *elements;  /**< EVENT_POOL_CHUNK elements. */
+  struct q_pool_chunk *next;   /**< Next allocated block. */
+};
 
 /** The priority queue. */
 struct dg_queue {
-  struct q_element *head[NUM_EVENT_QUEUES]; /**< Front of each queue bucket. */
-  struct q_element *tail[NUM_EVENT_QUEUES]; /**< Rear of each queue bucket. */
+  struct q_bucket wheel[EVENT_WHEEL_LEVELS][EVENT_WHEEL_SIZE]; /**< The slots. */
+  struct q_bucket due;      /**< Elements whose key has arrived, in order. */
+  struct q_bucket overflow; /**< Elements too far out for the top level. */
+  long now;                 /**< Pulse the wheel has been turned up to. */
+  struct q_element *free_list;   /**< Unused elements, linked by next. */
+  struct q_pool_chunk *chunks;   /**< Every block owned by this queue. */
 };
 
 /** Queued elements. */
@@ -52,6 +77,7 @@ struct q_element {
   void *data;  /**< The event to be handled. */
   long key;    /**< When the event should be handled. */
   struct q_element *prev, *next; /**< Points to other q_elements in line. */
+  struct q_bucket *bucket;       /**< The slot this element is linked into. */
 };
 /**************************************************************************
  * End priority queue structures and defines.
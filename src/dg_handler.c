@@ -24,6 +24,12 @@
 #include "dg_event.h"
 #include "constants.h"
 
+/* Set to 1 to have extract_script() and free_proto_script() make sure no
+ * character, object or room still points at what they free.  Each check
+ * walks every character, object and room, and zone resets extract scripted
+ * objects by the hundred. */
+#define CHECK_SCRIPT_SHARING 0
+
 /* frees memory associated with var */
 void free_var_el(struct trig_var_data *var)
 {
@@ -108,6 +114,29 @@ void extract_trigger(struct trig_data *trig)
   free_trigger(trig);
 }
 
+/* allocate an empty script for a mob/obj/room */
+struct script_data *create_script(void *thing, int type)
+{
+  struct script_data *sc;
+
+  CREATE(sc, struct script_data, 1);
+  sc->attach_type = type;
+  sc->attached = thing;
+
+  return sc;
+}
+
+/* world[] has been reallocated or shifted; point room scripts at their
+ * rooms' new addresses. */
+void relink_room_scripts(void)
+{
+  room_rnum i;
+
+  for (i = 0; i <= top_of_world; i++)
+    if (SCRIPT(&world[i]))
+      SCRIPT(&world[i])->attached = &world[i];
+}
+
 /* remove all triggers from a mob/obj/room */
 void extract_script(void *thing, int type)
 {
@@ -135,7 +164,7 @@ void extract_script(void *thing, int type)
       break;
   }
 
-#if 1 /* debugging */
+#if CHECK_SCRIPT_SHARING
   {
     struct char_data *i = character_list;
     struct obj_data *j = object_list;
@@ -157,6 +186,8 @@ void extract_script(void *thing, int type)
     extract_trigger(trig);
   }
   TRIGGERS(sc) = NULL;
+  SCRIPT_TYPES(sc) = 0;
+  update_script_registries(sc);
 
   /* Thanks to James Long for tracking down this memory leak */
   free_varlist(sc->global_vars);
@@ -200,7 +231,7 @@ void free_proto_script(void *thing, int type)
       room->proto_script = NULL;
       break;
   }
-#if 1 /* debugging */
+#if CHECK_SCRIPT_SHARING
   {
     struct char_data *i = character_list;
     struct obj_data *j = object_list;
@@ -15,6 +15,7 @@
 #include "dg_scripts.h"
 #include "db.h"
 #include "handler.h"
+#include "graph.h"
 #include "interpreter.h"
 #include "comm.h"
 #include "spells.h"
@@ -22,6 +23,7 @@
 #include "genzon.h" /* for real_zone_by_thing */
 #include "act.h"
 #include "fight.h"
+#include "strpool.h"
 
 
 /* Local file scope functions. */
@@ -960,11 +962,15 @@ ACMD(do_mtransform)
     tmpmob.next_in_room = ch->next_in_room;
     tmpmob.next = ch->next;
     tmpmob.next_fighting = ch->next_fighting;
+    tmpmob.next_in_ai = ch->next_in_ai;
+    tmpmob.prev_in_ai = ch->prev_in_ai;
+    tmpmob.ai_state = ch->ai_state;
     tmpmob.followers = ch->followers;
     tmpmob.master = ch->master;
     tmpmob.group = ch->group;
 
     GET_WAS_IN(&tmpmob) = GET_WAS_IN(ch);
+    GET_PRESENCE_ZONE(&tmpmob) = GET_PRESENCE_ZONE(ch);
     if (keep_hp) {
       GET_HIT(&tmpmob) = GET_HIT(ch);
       GET_MAX_HIT(&tmpmob) = GET_MAX_HIT(ch);
@@ -977,6 +983,7 @@ ACMD(do_mtransform)
     FIGHTING(&tmpmob) = FIGHTING(ch);
     HUNTING(&tmpmob) = HUNTING(ch);
     memcpy(ch, &tmpmob, sizeof(*ch));
+    update_zone_presence(ch);
 
     for (pos = 0; pos < NUM_WEARS; pos++) {
       if (obj[pos])
@@ -1044,9 +1051,9 @@ ACMD(do_mdoor)
     if (fd == 0) {
         if (newexit) {
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
         }
@@ -1061,7 +1068,7 @@ ACMD(do_mdoor)
         switch (fd) {
         case 1:  /* description */
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             CREATE(newexit->general_description, char, strlen(value) + 3);
             strcpy(newexit->general_description, value);
             strcat(newexit->general_description, "\r\n");
@@ -1074,7 +1081,7 @@ ACMD(do_mdoor)
             break;
         case 4:  /* name        */
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             CREATE(newexit->keyword, char, strlen(value) + 1);
             strcpy(newexit->keyword, value);
             break;
@@ -1086,6 +1093,8 @@ ACMD(do_mdoor)
             break;
         }
     }
+
+    route_room_changed(real_room(rm->number));
 }
 
 ACMD(do_mfollow)
@@ -16,10 +16,12 @@
 #include "comm.h"
 #include "interpreter.h"
 #include "handler.h"
+#include "graph.h"
 #include "db.h"
 #include "constants.h"
 #include "genzon.h" /* for access to real_zone_by_thing */
 #include "fight.h" /* for die() */
+#include "strpool.h"
 
 
 
@@ -290,8 +292,10 @@ static OCMD(do_otimer)
     obj_log(obj, "otimer: missing argument");
   else if (!isdigit(*arg))
     obj_log(obj, "otimer: bad argument");
-  else
+  else {
     GET_OBJ_TIMER(obj) = atoi(arg);
+    timed_obj_check(obj);
+  }
 }
 
 /* Transform into a different object. Note: this shouldn't be used with 
@@ -335,7 +339,10 @@ static OCMD(do_otransform)
     tmpobj.script = obj->script;
     tmpobj.next_content = obj->next_content;
     tmpobj.next = obj->next;
+    tmpobj.next_timed = obj->next_timed;
+    tmpobj.prev_timed = obj->prev_timed;
     memcpy(obj, &tmpobj, sizeof(*obj));
+    timed_obj_check(obj);
 
     if (wearer) {
       equip_char(wearer, obj, pos);
@@ -645,9 +652,9 @@ static OCMD(do_odoor)
     if (fd == 0) {
         if (newexit) {
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
         }
@@ -662,7 +669,7 @@ static OCMD(do_odoor)
         switch (fd) {
         case 1:  /* description */
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             CREATE(newexit->general_description, char, strlen(value) + 3);
             strcpy(newexit->general_description, value);
             strcat(newexit->general_description, "\r\n"); /* strcat : OK */
@@ -675,7 +682,7 @@ static OCMD(do_odoor)
             break;
         case 4:  /* name        */
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             CREATE(newexit->keyword, char, strlen(value) + 1);
             strcpy(newexit->keyword, value);
             break;
@@ -687,6 +694,8 @@ static OCMD(do_odoor)
             break;
         }
     }
+
+    route_room_changed(real_room(rm->number));
 }
 
 static OCMD(do_osetval)
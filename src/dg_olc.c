@@ -781,6 +781,7 @@ void trigedit_save(struct descriptor_data *d)
 
     trig_index = new_index;
     top_of_trigt++;
+    index_vnums(DB_BOOT_TRG);
 
     /* HERE IT HAS TO GO THROUGH AND FIX ALL SCRIPTS/TRIGS OF HIGHER RNUM */
     for (live_trig = trigger_list; live_trig; live_trig = live_trig->next_in_world)
@@ -33,7 +33,6 @@
 #define PULSES_PER_MUD_HOUR     (SECS_PER_MUD_HOUR*PASSES_PER_SEC)
 
 /* Local functions not used elsewhere */
-static obj_data *find_obj(long n);
 static room_data *find_room(long n);
 static void do_stat_trigger(struct char_data *ch, trig_data *trig);
 static void script_stat(char_data *ch, struct script_data *sc);
@@ -74,6 +73,18 @@ static struct cmdlist_element *find_done(struct cmdlist_element *cl);
 static struct char_data *find_char_by_uid_in_lookup_table(long uid);
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid);
 static EVENTFUNC(trig_wait_event);
+static void run_registered_triggers(int reg);
+
+/* Trigger bits that put a script in each registry; mobs, objects and rooms
+ * use the same bit for each of these types. */
+static const long script_reg_types[NUM_SCRIPT_REGS] = { MTRIG_RANDOM, MTRIG_TIME };
+
+/* The script a registry walk will visit next, moved along if that script
+ * leaves the registry while the current one runs. */
+static struct script_data *script_reg_cursor[NUM_SCRIPT_REGS];
+
+/* Scripts holding random and time triggers (see update_script_registries) */
+struct script_data *script_registry[NUM_SCRIPT_REGS];
 
 
 /* Return pointer to first occurrence of string ct in cs, or NULL if not 
@@ -301,7 +312,7 @@ struct char_data *find_char(long n)
  * @retval obj_data * Pointer to the object if it exists, or NULL if it cannot
  * be found.
  */
-static obj_data *find_obj(long n)
+obj_data *find_obj(long n)
 {
   if (n < OBJ_ID_BASE) /* see note in dg_scripts.h */
     return NULL;
@@ -621,87 +632,63 @@ obj_data *get_obj_by_room(room_data *room, char *name)
   return NULL;
 }
 
-/* checks every PULSE_SCRIPT for random triggers */
-void script_trigger_check(void)
+/* Run the random or time triggers of every script in registry reg.  Mobs
+ * and rooms only fire if their zone is occupied or the trigger is global. */
+static void run_registered_triggers(int reg)
 {
+  struct script_data *sc;
   char_data *ch;
   obj_data *obj;
-  struct room_data *room=NULL;
-  room_rnum nr;
-  struct script_data *sc;
+  struct room_data *room;
 
-  for (ch = character_list; ch; ch = ch->next) {
-    if (SCRIPT(ch)) {
-      sc = SCRIPT(ch);
+  for (sc = script_registry[reg]; sc; sc = script_reg_cursor[reg]) {
+    /* the trigger may purge its owner, so find the next script first */
+    script_reg_cursor[reg] = sc->reg_next[reg];
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-          (!is_empty(world[IN_ROOM(ch)].zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
+    switch (sc->attach_type) {
+    case MOB_TRIGGER:
+      ch = (char_data *) sc->attached;
+      if (SCRIPT(ch) != sc || (is_empty(world[IN_ROOM(ch)].zone) &&
+          !IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
+        break;
+      if (reg == SCRIPT_REG_RANDOM)
         random_mtrigger(ch);
-    }
-  }
-
-  for (obj = object_list; obj; obj = obj->next) {
-    if (SCRIPT(obj)) {
-      sc = SCRIPT(obj);
-
-      if (IS_SET(SCRIPT_TYPES(sc), OTRIG_RANDOM))
+      else
+        time_mtrigger(ch);
+      break;
+    case OBJ_TRIGGER:
+      obj = (obj_data *) sc->attached;
+      if (SCRIPT(obj) != sc)
+        break;
+      if (reg == SCRIPT_REG_RANDOM)
         random_otrigger(obj);
-    }
-  }
-
-  for (nr = 0; nr <= top_of_world; nr++) {
-    if (SCRIPT(&world[nr])) {
-      room = &world[nr];
-      sc = SCRIPT(room);
-
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-          (!is_empty(room->zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
+      else
+        time_otrigger(obj);
+      break;
+    case WLD_TRIGGER:
+      room = (struct room_data *) sc->attached;
+      if (SCRIPT(room) != sc || (is_empty(room->zone) &&
+          !IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
+        break;
+      if (reg == SCRIPT_REG_RANDOM)
         random_wtrigger(room);
+      else
+        time_wtrigger(room);
+      break;
     }
   }
+  script_reg_cursor[reg] = NULL;
 }
 
-void check_time_triggers(void)
+/* checks every PULSE_SCRIPT for random triggers */
+void script_trigger_check(void)
 {
-  char_data *ch;
-  obj_data *obj;
-  struct room_data *room=NULL;
-  int nr;
-  struct script_data *sc;
-
-  for (ch = character_list; ch; ch = ch->next) {
-    if (SCRIPT(ch)) {
-      sc = SCRIPT(ch);
-
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_TIME) &&
-          (!is_empty(world[IN_ROOM(ch)].zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        time_mtrigger(ch);
-    }
-  }
-
-  for (obj = object_list; obj; obj = obj->next) {
-    if (SCRIPT(obj)) {
-      sc = SCRIPT(obj);
-
-      if (IS_SET(SCRIPT_TYPES(sc), OTRIG_TIME))
-        time_otrigger(obj);
-    }
-  }
-
-  for (nr = 0; nr <= top_of_world; nr++) {
-    if (SCRIPT(&world[nr])) {
-      room = &world[nr];
-      sc = SCRIPT(room);
+  run_registered_triggers(SCRIPT_REG_RANDOM);
+}
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_TIME) &&
-          (!is_empty(room->zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        time_wtrigger(room);
-    }
-  }
+void check_time_triggers(void)
+{
+  run_registered_triggers(SCRIPT_REG_TIME);
 }
 
 static EVENTFUNC(trig_wait_event)
@@ -931,11 +918,46 @@ void add_trigger(struct script_data *sc, trig_data *t, int loc)
   }
 
   SCRIPT_TYPES(sc) |= GET_TRIG_TYPE(t);
+  update_script_registries(sc);
 
   t->next_in_world = trigger_list;
   trigger_list = t;
 }
 
+/* Put sc in, or take it out of, each registry according to its trigger
+ * types.  Call whenever SCRIPT_TYPES(sc) changes. */
+void update_script_registries(struct script_data *sc)
+{
+  int reg, want;
+
+  for (reg = 0; reg < NUM_SCRIPT_REGS; reg++) {
+    want = sc->attached && IS_SET(SCRIPT_TYPES(sc), script_reg_types[reg]);
+
+    if (want == (IS_SET(sc->registered, 1 << reg) != 0))
+      continue;
+
+    if (want) {
+      sc->reg_prev[reg] = NULL;
+      sc->reg_next[reg] = script_registry[reg];
+      if (script_registry[reg])
+        script_registry[reg]->reg_prev[reg] = sc;
+      script_registry[reg] = sc;
+      SET_BIT(sc->registered, 1 << reg);
+    } else {
+      if (script_reg_cursor[reg] == sc)
+        script_reg_cursor[reg] = sc->reg_next[reg];
+      if (sc->reg_prev[reg])
+        sc->reg_prev[reg]->reg_next[reg] = sc->reg_next[reg];
+      else
+        script_registry[reg] = sc->reg_next[reg];
+      if (sc->reg_next[reg])
+        sc->reg_next[reg]->reg_prev[reg] = sc->reg_prev[reg];
+      sc->reg_next[reg] = sc->reg_prev[reg] = NULL;
+      REMOVE_BIT(sc->registered, 1 << reg);
+    }
+  }
+}
+
 ACMD(do_attach)
 {
   char_data *victim;
@@ -987,7 +1009,7 @@ ACMD(do_attach)
     }
 
     if (!SCRIPT(victim))
-      CREATE(SCRIPT(victim), struct script_data, 1);
+      SCRIPT(victim) = create_script(victim, MOB_TRIGGER);
     add_trigger(SCRIPT(victim), trig, loc);
 
     if (IS_NPC(victim))
@@ -1029,7 +1051,7 @@ ACMD(do_attach)
     }
 
     if (!SCRIPT(object))
-      CREATE(SCRIPT(object), struct script_data, 1);
+      SCRIPT(object) = create_script(object, OBJ_TRIGGER);
     add_trigger(SCRIPT(object), trig, loc);
 
     send_to_char(ch, "Trigger %d (%s) attached to %s [%d].\r\n",
@@ -1066,7 +1088,7 @@ ACMD(do_attach)
     room = &world[rnum];
 
     if (!SCRIPT(room))
-      CREATE(SCRIPT(room), struct script_data, 1);
+      SCRIPT(room) = create_script(room, WLD_TRIGGER);
     add_trigger(SCRIPT(room), trig, loc);
 
     send_to_char(ch, "Trigger %d (%s) attached to room %d.\r\n",
@@ -1134,6 +1156,7 @@ static int remove_trigger(struct script_data *sc, char *name)
     SCRIPT_TYPES(sc) = 0;
     for (i = TRIGGERS(sc); i; i = i->next)
       SCRIPT_TYPES(sc) |= GET_TRIG_TYPE(i);
+    update_script_registries(sc);
 
     return 1;
   } else
@@ -1845,21 +1868,21 @@ static void process_attach(void *go, struct script_data *sc, trig_data *trig,
       return;
     }
     if (!SCRIPT(c))
-      CREATE(SCRIPT(c), struct script_data, 1);
+      SCRIPT(c) = create_script(c, MOB_TRIGGER);
     add_trigger(SCRIPT(c), newtrig, -1);
     return;
   }
 
   if (o) {
     if (!SCRIPT(o))
-      CREATE(SCRIPT(o), struct script_data, 1);
+      SCRIPT(o) = create_script(o, OBJ_TRIGGER);
     add_trigger(SCRIPT(o), newtrig, -1);
     return;
   }
 
   if (r) {
     if (!SCRIPT(r))
-      CREATE(SCRIPT(r), struct script_data, 1);
+      SCRIPT(r) = create_script(r, WLD_TRIGGER);
     add_trigger(SCRIPT(r), newtrig, -1);
     return;
   }
@@ -2272,7 +2295,7 @@ int perform_set_dg_var(struct char_data *ch, struct char_data *vict, char *val_a
     return 0;
   }
   if (!SCRIPT(vict))
-    CREATE(SCRIPT(vict), struct script_data, 1);
+    SCRIPT(vict) = create_script(vict, MOB_TRIGGER);
 
   add_var(&(SCRIPT(vict)->global_vars), var_name, var_value, 0);
   return 1;
@@ -2496,6 +2519,8 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
     case MOB_TRIGGER:
       go = *(char_data **)go_adress;
       sc = SCRIPT((char_data *) go);
+      /* whatever set it off may give an idle mob something to do */
+      wake_mob((char_data *) go);
       break;
     case OBJ_TRIGGER:
       go = *(obj_data **)go_adress;
@@ -2722,6 +2747,9 @@ trig_rnum real_trigger(trig_vnum vnum)
 {
   trig_rnum bot, top, mid;
 
+  if (vnum_indexes[DB_BOOT_TRG].rnum)
+    return VNUM_INDEX_LOOKUP(vnum_indexes[DB_BOOT_TRG], vnum);
+
   bot = 0;
   top = top_of_trigt - 1;
 
@@ -2820,38 +2848,108 @@ static struct cmdlist_element *find_done(struct cmdlist_element *cl)
 }
 
 
-/* find_char() helpers */
+/* find_char() helpers.  Script uids map to their mob or object through an
+ * open-addressing hash table using Robin Hood probing: an entry never sits
+ * further from its home slot than the entry it displaced, so a failed lookup
+ * can stop early, and removal shifts the following entries back instead of
+ * leaving tombstones.  The table doubles when it gets three-quarters full. */
 /* Must be power of 2. */
-#define BUCKET_COUNT 64
-/* To recognize an empty bucket. */
-#define UID_OUT_OF_RANGE 1000000000
+#define LOOKUP_MIN_SIZE 1024
 
 struct lookup_table_t {
-  long uid;
+  long uid;                /* 0 marks an empty slot; uid 0 is never used */
   void * c;
-  struct lookup_table_t *next;
 };
-static struct lookup_table_t lookup_table[BUCKET_COUNT];
+static struct lookup_table_t *lookup_table = NULL;
+static unsigned long lookup_mask = 0;   /* table size - 1 */
+static unsigned long lookup_count = 0;  /* slots in use */
+
+static unsigned long lookup_home(long uid)
+{
+  unsigned long h = (unsigned long) uid * 2654435761UL;
+
+  return (h ^ (h >> 16)) & lookup_mask;
+}
+
+/* how far the entry in slot i is from its home slot */
+static unsigned long lookup_distance(unsigned long i)
+{
+  return (i - lookup_home(lookup_table[i].uid)) & lookup_mask;
+}
+
+/* Returns the slot holding uid, or -1. */
+static long lookup_slot(long uid)
+{
+  unsigned long i, dist;
+
+  if (!lookup_table || uid == 0)
+    return -1;
+
+  for (i = lookup_home(uid), dist = 0; ; i = (i + 1) & lookup_mask, dist++) {
+    if (!lookup_table[i].uid || lookup_distance(i) < dist)
+      return -1;
+    if (lookup_table[i].uid == uid)
+      return (long) i;
+  }
+}
+
+/* Place an entry known not to be in the table yet. */
+static void lookup_insert(long uid, void *c)
+{
+  struct lookup_table_t entry, swap;
+  unsigned long i, dist, other;
+
+  entry.uid = uid;
+  entry.c = c;
+
+  for (i = lookup_home(uid), dist = 0; ; i = (i + 1) & lookup_mask, dist++) {
+    if (!lookup_table[i].uid) {
+      lookup_table[i] = entry;
+      lookup_count++;
+      return;
+    }
+    /* take the slot from an entry closer to its home, and carry on with it */
+    if ((other = lookup_distance(i)) < dist) {
+      swap = lookup_table[i];
+      lookup_table[i] = entry;
+      entry = swap;
+      dist = other;
+    }
+  }
+}
+
+static void resize_lookup_table(unsigned long size)
+{
+  struct lookup_table_t *old = lookup_table;
+  unsigned long i, old_size = old ? lookup_mask + 1 : 0;
+
+  CREATE(lookup_table, struct lookup_table_t, size);
+  lookup_mask = size - 1;
+  lookup_count = 0;
+
+  for (i = 0; i < old_size; i++)
+    if (old[i].uid)
+      lookup_insert(old[i].uid, old[i].c);
+
+  if (old)
+    free(old);
+}
 
 void init_lookup_table(void)
 {
-  int i;
-  for (i = 0; i < BUCKET_COUNT; i++) {
-    lookup_table[i].uid  = UID_OUT_OF_RANGE;
-    lookup_table[i].c    = NULL;
-    lookup_table[i].next = NULL;
+  if (lookup_table) {
+    free(lookup_table);
+    lookup_table = NULL;
   }
+  resize_lookup_table(LOOKUP_MIN_SIZE);
 }
 
 static struct char_data *find_char_by_uid_in_lookup_table(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
-
-  for (;lt && lt->uid != uid ; lt = lt->next) ;
+  long i = lookup_slot(uid);
 
-  if (lt)
-    return (struct char_data *)(lt->c);
+  if (i >= 0)
+    return (struct char_data *)(lookup_table[i].c);
 
   log("find_char_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
   return NULL;
@@ -2859,13 +2957,10 @@ static struct char_data *find_char_by_uid_in_lookup_table(long uid)
 
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
+  long i = lookup_slot(uid);
 
-  for (;lt && lt->uid != uid ; lt = lt->next) ;
-
-  if (lt)
-    return (struct obj_data *)(lt->c);
+  if (i >= 0)
+    return (struct obj_data *)(lookup_table[i].c);
 
   log("find_obj_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
   return NULL;
@@ -2873,49 +2968,51 @@ static struct obj_data *find_obj_by_uid_in_lookup_table(long uid)
 
 void add_to_lookup_table(long uid, void *c)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
+  long i;
 
-  if (lt && lt->uid == uid) {
-   log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->c, c);
-   lt->c = c;
-   return;
+  if (uid == 0) {
+    log("SYSERR: add_to_lookup_table called with uid 0.");
+    return;
   }
 
-  for (;lt && lt->next; lt = lt->next)
-    if (lt->next->uid == uid) {
-      log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->next->c, c);
-      return;
-    }
+  if ((i = lookup_slot(uid)) >= 0) {
+    log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lookup_table[i].c, c);
+    lookup_table[i].c = c;
+    return;
+  }
 
-  CREATE(lt->next, struct lookup_table_t, 1);
-  lt->next->uid = uid;
-  lt->next->c = c;
+  if (!lookup_table)
+    resize_lookup_table(LOOKUP_MIN_SIZE);
+  else if ((lookup_count + 1) * 4 > (lookup_mask + 1) * 3)
+    resize_lookup_table((lookup_mask + 1) * 2);
+
+  lookup_insert(uid, c);
 }
 
 void remove_from_lookup_table(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket], *flt = NULL;
+  unsigned long i, next;
+  long slot;
 
   /* This is not supposed to happen. UID 0 is not used. However, while I'm 
    * debugging the issue, let's just return right away. - Welcor */
   if (uid == 0)
     return;
 
-  for (;lt;lt = lt->next)
-    if (lt->uid == uid)
-      flt = lt;
-
-  if (flt) {
-    for (lt = &lookup_table[bucket];lt->next != flt;lt = lt->next)
-      ;
-    lt->next = flt->next;
-    free(flt);
+  if ((slot = lookup_slot(uid)) < 0) {
+    log("remove_from_lookup. UID %ld not found.", uid);
     return;
   }
 
-  log("remove_from_lookup. UID %ld not found.", uid);
+  /* Pull back the entries after it until one is already at home. */
+  for (i = slot, next = (i + 1) & lookup_mask;
+       lookup_table[next].uid && lookup_distance(next) > 0;
+       i = next, next = (next + 1) & lookup_mask)
+    lookup_table[i] = lookup_table[next];
+
+  lookup_table[i].uid = 0;
+  lookup_table[i].c = NULL;
+  lookup_count--;
 }
 
 bool check_flags_by_name_ar(int *array, int numflags, char *search, const char *namelist[]) 
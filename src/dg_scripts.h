@@ -130,6 +130,12 @@
 
 #define SCRIPT_ERROR_CODE     -9999999   /* this shouldn't happen too often */
 
+/* Registries of the scripts that hold a given trigger type, so the periodic
+ * checks only visit scripts that can fire. */
+#define SCRIPT_REG_RANDOM       0          /* [MOW]TRIG_RANDOM */
+#define SCRIPT_REG_TIME         1          /* [MOW]TRIG_TIME   */
+#define NUM_SCRIPT_REGS         2
+
 /* one line of the trigger */
 struct cmdlist_element {
   char *cmd;				/* one line of a trigger */
@@ -175,6 +181,12 @@ struct script_data {
   long context;                      /**< current context for statics */
 
   struct script_data *next;          /**< used for purged_scripts    */
+
+  int attach_type;                   /**< MOB_, OBJ_ or WLD_TRIGGER  */
+  void *attached;                    /**< the mob, obj or room       */
+  int registered;                    /**< bitvector of SCRIPT_REG_*  */
+  struct script_data *reg_next[NUM_SCRIPT_REGS]; /**< registry links */
+  struct script_data *reg_prev[NUM_SCRIPT_REGS];
 };
 
 /* The event data for the wait command */
@@ -272,6 +284,7 @@ char *str_str(char *cs, char *ct);
 int find_eq_pos_script(char *arg);
 int can_wear_on_pos(struct obj_data *obj, int pos);
 struct char_data *find_char(long n);
+obj_data *find_obj(long n);
 char_data *get_char(char *name);
 char_data *get_char_near_obj(obj_data *obj, char *name);
 char_data *get_char_in_room(room_data *room, char *name);
@@ -293,6 +306,7 @@ void do_sstat_room(struct char_data * ch, room_data *r);
 void do_sstat_object(char_data *ch, obj_data *j);
 void do_sstat_character(char_data *ch, char_data *k);
 void add_trigger(struct script_data *sc, trig_data *t, int loc);
+void update_script_registries(struct script_data *sc);
 void script_vlog(const char *format, va_list args);
 void script_log(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
 char *matching_quote(char *p);
@@ -339,6 +353,8 @@ void free_varlist(struct trig_var_data *vd);
 int remove_var(struct trig_var_data **var_list, char *name);
 void free_trigger(trig_data *trig);
 void extract_trigger(struct trig_data *trig);
+struct script_data *create_script(void *thing, int type);
+void relink_room_scripts(void);
 void extract_script(void *thing, int type);
 void extract_script_mem(struct script_memory *sc);
 void free_proto_script(void *thing, int type);
@@ -444,6 +460,7 @@ void wld_command_interpreter(room_data *room, char *argument);
                          add_var(&GET_TRIG_VARS(trig), name, buf, context); } while (0)
 
 // id helpers
+extern struct script_data *script_registry[NUM_SCRIPT_REGS];
 extern long char_script_id(char_data *ch);
 extern long obj_script_id(obj_data *obj);
 #define room_script_id(room)  ((long)(room)->number + ROOM_ID_BASE)
@@ -854,6 +854,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             if (subfield && *subfield) {
               int lev = atoi(subfield);
               GET_LEVEL(c) = MIN(MAX(lev, 0), LVL_IMMORT-1);
+              update_zone_presence(c);
             } else
               snprintf(str, slen, "%d", GET_LEVEL(c));
           }
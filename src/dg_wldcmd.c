@@ -16,10 +16,12 @@
 #include "comm.h"
 #include "interpreter.h"
 #include "handler.h"
+#include "graph.h"
 #include "db.h"
 #include "constants.h"
 #include "genzon.h" /* for zone_rnum real_zone_by_thing */
 #include "fight.h"  /* for die() */
+#include "strpool.h"
 
 /* Local functions, macros, defines and structs */
 
@@ -244,9 +246,9 @@ WCMD(do_wdoor)
     if (fd == 0) {
         if (newexit) {
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
         }
@@ -261,7 +263,7 @@ WCMD(do_wdoor)
         switch (fd) {
         case 1:  /* description */
             if (newexit->general_description)
-                free(newexit->general_description);
+                release_string(newexit->general_description);
             CREATE(newexit->general_description, char, strlen(value) + 3);
             strcpy(newexit->general_description, value);
             strcat(newexit->general_description, "\r\n");
@@ -274,7 +276,7 @@ WCMD(do_wdoor)
             break;
         case 4:  /* name        */
             if (newexit->keyword)
-                free(newexit->keyword);
+                release_string(newexit->keyword);
             CREATE(newexit->keyword, char, strlen(value) + 1);
             strcpy(newexit->keyword, value);
             break;
@@ -286,6 +288,8 @@ WCMD(do_wdoor)
             break;
         }
     }
+
+    route_room_changed(real_room(rm->number));
 }
 
 WCMD(do_wteleport)
@@ -197,6 +197,7 @@ static void make_corpse(struct char_data *ch)
     GET_OBJ_TIMER(corpse) = CONFIG_MAX_NPC_CORPSE_TIME;
   else
     GET_OBJ_TIMER(corpse) = CONFIG_MAX_PC_CORPSE_TIME;
+  timed_obj_check(corpse);
 
   /* transfer character's inventory to the corpse */
   corpse->contains = ch->carrying;
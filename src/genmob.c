@@ -17,9 +17,11 @@
 #include "genzon.h"
 #include "dg_olc.h"
 #include "spells.h"
+#include "strpool.h"
 
 /* local functions */
 static void extract_mobile_all(mob_vnum vnum);
+static void share_mobile_strings(struct char_data *mob);
 
 int add_mobile(struct char_data *mob, mob_vnum vnum)
 {
@@ -30,6 +32,9 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
   if ((rnum = real_mobile(vnum)) != NOBODY) {
     /* Copy over the mobile and free() the old strings. */
     copy_mobile(&mob_proto[rnum], mob);
+    share_mobile_strings(&mob_proto[rnum]);
+    free_keyword_list(mob_index[rnum].keywords);
+    mob_index[rnum].keywords = NULL;
 
     /* Now re-point all existing mobile strings to here. */
     for (live_mob = character_list; live_mob; live_mob = live_mob->next)
@@ -50,9 +55,11 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
       mob_proto[i] = *mob;
       mob_proto[i].nr = i;
       copy_mobile_strings(mob_proto + i, mob);
+      share_mobile_strings(mob_proto + i);
       mob_index[i].vnum = vnum;
       mob_index[i].number = 0;
       mob_index[i].func = 0;
+      mob_index[i].keywords = NULL;
       found = i;
       break;
     }
@@ -64,10 +71,13 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
     mob_proto[0] = *mob;
     mob_proto[0].nr = 0;
     copy_mobile_strings(&mob_proto[0], mob);
+    share_mobile_strings(&mob_proto[0]);
     mob_index[0].vnum = vnum;
     mob_index[0].number = 0;
     mob_index[0].func = 0;
+    mob_index[0].keywords = NULL;
   }
+  index_vnums(DB_BOOT_MOB);
 
   log("GenOLC: add_mobile: Added mobile %d at index #%d.", vnum, found);
 
@@ -161,6 +171,7 @@ int delete_mobile(mob_rnum refpt)
   extract_mobile_all(vnum);
   extract_char(proto);
 
+  free_keyword_list(mob_index[refpt].keywords);
   for (counter = refpt; counter < top_of_mobt; counter++) {
     mob_index[counter] = mob_index[counter + 1];
     mob_proto[counter] = mob_proto[counter + 1];
@@ -170,6 +181,7 @@ int delete_mobile(mob_rnum refpt)
   top_of_mobt--;
   RECREATE(mob_index, struct index_data, top_of_mobt + 1);
   RECREATE(mob_proto, struct char_data, top_of_mobt + 1);
+  index_vnums(DB_BOOT_MOB);
 
   /* Update live mobile rnums. */
   for (live_mob = character_list; live_mob; live_mob = live_mob->next)
@@ -210,6 +222,16 @@ int copy_mobile_strings(struct char_data *t, struct char_data *f)
   return TRUE;
 }
 
+/* Prototypes keep their text in the string pool; the copies medit works on
+ * stay private, since the editor changes them in place. */
+static void share_mobile_strings(struct char_data *mob)
+{
+  mob->player.name = share_string(mob->player.name);
+  mob->player.short_descr = share_string(mob->player.short_descr);
+  mob->player.long_descr = share_string(mob->player.long_descr);
+  mob->player.description = share_string(mob->player.description);
+}
+
 int update_mobile_strings(struct char_data *t, struct char_data *f)
 {
   if (f->player.name)
@@ -227,16 +249,12 @@ int update_mobile_strings(struct char_data *t, struct char_data *f)
 
 int free_mobile_strings(struct char_data *mob)
 {
-  if (mob->player.name)
-    free(mob->player.name);
+  release_string(mob->player.name);
   if (mob->player.title)
     free(mob->player.title);
-  if (mob->player.short_descr)
-    free(mob->player.short_descr);
-  if (mob->player.long_descr)
-    free(mob->player.long_descr);
-  if (mob->player.description)
-    free(mob->player.description);
+  release_string(mob->player.short_descr);
+  release_string(mob->player.long_descr);
+  release_string(mob->player.description);
   return TRUE;
 }
 
@@ -432,8 +450,7 @@ void check_mobile_string(mob_vnum i, char **string, const char *desc)
     char smbuf[128];
     sprintf(smbuf, "GenOLC: Mob #%d has an invalid %s.", i, desc);
     mudlog(BRF, LVL_GOD, TRUE, "%s", smbuf);
-    if (*string)
-      free(*string);
+    release_string(*string);
     *string = strdup("An undefined string.\n");
   }
 }
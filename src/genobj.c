@@ -19,11 +19,13 @@
 #include "handler.h"
 #include "interpreter.h"
 #include "boards.h" /* for board_info */
+#include "strpool.h"
 
 
 /* local functions */
 static int update_all_objects(struct obj_data *obj);
 static void copy_object_strings(struct obj_data *to, struct obj_data *from);
+static void share_object_strings(struct obj_data *obj);
 
 obj_rnum add_object(struct obj_data *newobj, obj_vnum ovnum)
 {
@@ -33,6 +35,9 @@ obj_rnum add_object(struct obj_data *newobj, obj_vnum ovnum)
   /* Write object to internal tables. */
   if ((newobj->item_number = real_object(ovnum)) != NOTHING) {
     copy_object(&obj_proto[newobj->item_number], newobj);
+    share_object_strings(&obj_proto[newobj->item_number]);
+    free_keyword_list(obj_index[newobj->item_number].keywords);
+    obj_index[newobj->item_number].keywords = NULL;
     update_all_objects(&obj_proto[newobj->item_number]);
     add_to_save_list(zone_table[rznum].number, SL_OBJ);
     return newobj->item_number;
@@ -65,6 +70,7 @@ static int update_all_objects(struct obj_data *refobj)
 
     /* Copy game-time dependent variables over. */
     obj->script_id = swap.script_id;
+    SCRIPT(obj) = SCRIPT(&swap); /* oedit replaces it with the new triggers */
     IN_ROOM(obj) = swap.in_room;
     obj->carried_by = swap.carried_by;
     obj->worn_by = swap.worn_by;
@@ -73,7 +79,10 @@ static int update_all_objects(struct obj_data *refobj)
     obj->contains = swap.contains;
     obj->next_content = swap.next_content;
     obj->next = swap.next;
+    obj->next_timed = swap.next_timed;
+    obj->prev_timed = swap.prev_timed;
     obj->sitting_here = swap.sitting_here;
+    timed_obj_check(obj);
   }
 
   return count;
@@ -134,7 +143,7 @@ obj_rnum adjust_objects(obj_rnum refpt)
  * add_object() for that. */
 obj_rnum insert_object(struct obj_data *obj, obj_vnum ovnum)
 {
-  obj_rnum i;
+  obj_rnum i, rnum;
 
   top_of_objt++;
   RECREATE(obj_index, struct index_data, top_of_objt + 1);
@@ -144,7 +153,7 @@ obj_rnum insert_object(struct obj_data *obj, obj_vnum ovnum)
   for (i = top_of_objt; i > 0; i--) {
     /* Check if current virtual is bigger than our virtual number. */
     if (ovnum > obj_index[i - 1].vnum)
-      return index_object(obj, ovnum, i);
+      break;
 
     /* Copy over the object that should be here. */
     obj_index[i] = obj_index[i - 1];
@@ -152,8 +161,10 @@ obj_rnum insert_object(struct obj_data *obj, obj_vnum ovnum)
     obj_proto[i].item_number = i;
   }
 
-  /* Not found, place at 0. */
-  return index_object(obj, ovnum, 0);
+  /* i is where it belongs, 0 if it sorts before everything else. */
+  rnum = index_object(obj, ovnum, i);
+  index_vnums(DB_BOOT_OBJ);
+  return rnum;
 }
 
 obj_rnum index_object(struct obj_data *obj, obj_vnum ovnum, obj_rnum ornum)
@@ -169,8 +180,10 @@ obj_rnum index_object(struct obj_data *obj, obj_vnum ovnum, obj_rnum ornum)
   obj_index[ornum].vnum = ovnum;
   obj_index[ornum].number = 0;
   obj_index[ornum].func = NULL;
+  obj_index[ornum].keywords = NULL;
 
   copy_object_preserve(&obj_proto[ornum], obj);
+  share_object_strings(&obj_proto[ornum]);
   obj_proto[ornum].in_room = NOWHERE;
 
   return ornum;
@@ -301,14 +314,10 @@ int save_objects(zone_rnum zone_num)
 /* Free all, unconditionally. */
 void free_object_strings(struct obj_data *obj)
 {
-  if (obj->name)
-    free(obj->name);
-  if (obj->description)
-    free(obj->description);
-  if (obj->short_description)
-    free(obj->short_description);
-  if (obj->action_description)
-    free(obj->action_description);
+  release_string(obj->name);
+  release_string(obj->description);
+  release_string(obj->short_description);
+  release_string(obj->action_description);
   if (obj->ex_description)
     free_ex_descriptions(obj->ex_description);
 }
@@ -362,6 +371,17 @@ static void copy_object_strings(struct obj_data *to, struct obj_data *from)
     to->ex_description = NULL;
 }
 
+/* Prototypes keep their text in the string pool; the copies oedit works on
+ * stay private, since the editor changes them in place. */
+static void share_object_strings(struct obj_data *obj)
+{
+  obj->name = share_string(obj->name);
+  obj->description = share_string(obj->description);
+  obj->short_description = share_string(obj->short_description);
+  obj->action_description = share_string(obj->action_description);
+  share_ex_descriptions(obj->ex_description);
+}
+
 int copy_object(struct obj_data *to, struct obj_data *from)
 {
   free_object_strings(to);
@@ -434,6 +454,7 @@ int delete_object(obj_rnum rnum)
     GET_OBJ_RNUM(tmp) -= (GET_OBJ_RNUM(tmp) > rnum);
   }
 
+  free_keyword_list(obj_index[rnum].keywords);
   for (i = rnum; i < top_of_objt; i++) {
     obj_index[i] = obj_index[i + 1];
     obj_proto[i] = obj_proto[i + 1];
@@ -443,6 +464,7 @@ int delete_object(obj_rnum rnum)
   top_of_objt--;
   RECREATE(obj_index, struct index_data, top_of_objt + 1);
   RECREATE(obj_proto, struct obj_data, top_of_objt + 1);
+  index_vnums(DB_BOOT_OBJ);
 
   /* Renumber notice boards. */
   for (j = 0; j < NUM_OF_BOARDS; j++)
@@ -26,6 +26,7 @@
 #include "act.h"        /* for the space_to_minus function */
 #include "modify.h"      /* for smash_tilde */
 #include "quest.h"
+#include "strpool.h"
 
 /* Global variables defined here, used elsewhere */
 /* List of zones to be saved. */
@@ -157,10 +158,8 @@ void free_ex_descriptions(struct extra_descr_data *head)
 
   for (thised = head; thised; thised = next_one) {
     next_one = thised->next;
-    if (thised->keyword)
-      free(thised->keyword);
-    if (thised->description)
-      free(thised->description);
+    release_string(thised->keyword);
+    release_string(thised->description);
     free(thised);
   }
 }
@@ -18,7 +18,9 @@
 #include "shop.h"
 #include "dg_olc.h"
 #include "mud_event.h"
+#include "graph.h"
 #include "mysql_db.h"
+#include "strpool.h"
 
 
 void delete_rooms_mysql(MYSQL *conn, zone_rnum rzone);
@@ -46,6 +48,7 @@ room_rnum add_room(struct room_data *room)
     copy_room(&world[i], room);
     world[i].people = tch;
     world[i].contents = tobj;
+    route_room_changed(i);
     add_to_save_list(zone_table[room->zone].number, SL_WLD);
     log("GenOLC: add_room: Updated existing room #%d.", room->number);
     return i;
@@ -78,6 +81,9 @@ room_rnum add_room(struct room_data *room)
     world[0] = *room;	/* Last place, in front. */
     copy_room_strings(&world[0], room);
   }
+  index_vnums(DB_BOOT_WLD);
+  relink_room_scripts();
+  route_world_changed();
 
   log("GenOLC: add_room: Added room %d at index #%d.", room->number, found);
   /* found is equal to the array index where we added the room. */
@@ -199,10 +205,8 @@ int delete_room(room_rnum rnum)
       	if ((!W_EXIT(i, j)->keyword || !*W_EXIT(i, j)->keyword) &&
       	    (!W_EXIT(i, j)->general_description || !*W_EXIT(i, j)->general_description)) {
           /* no description, remove exit completely */
-          if (W_EXIT(i, j)->keyword)
-            free(W_EXIT(i, j)->keyword);
-          if (W_EXIT(i, j)->general_description)
-            free(W_EXIT(i, j)->general_description);
+          release_string(W_EXIT(i, j)->keyword);
+          release_string(W_EXIT(i, j)->general_description);
           free(W_EXIT(i, j));
           W_EXIT(i, j) = NULL;
         } else {
@@ -263,6 +267,9 @@ int delete_room(room_rnum rnum)
 
   top_of_world--;
   RECREATE(world, struct room_data, top_of_world + 1);
+  index_vnums(DB_BOOT_WLD);
+  relink_room_scripts();
+  route_world_changed();
 
   return TRUE;
 }
@@ -437,8 +444,8 @@ int copy_room_strings(struct room_data *dest, struct room_data *source)
     return FALSE;
   }
 
-  dest->description = str_udup(source->description);
-  dest->name = str_udup(source->name);
+  dest->description = share_string(str_udup(source->description));
+  dest->name = share_string(str_udup(source->name));
 
   for (i = 0; i < DIR_COUNT; i++) {
     if (!R_EXIT(source, i))
@@ -446,14 +453,14 @@ int copy_room_strings(struct room_data *dest, struct room_data *source)
 
     CREATE(R_EXIT(dest, i), struct room_direction_data, 1);
     *R_EXIT(dest, i) = *R_EXIT(source, i);
-    if (R_EXIT(source, i)->general_description)
-      R_EXIT(dest, i)->general_description = strdup(R_EXIT(source, i)->general_description);
-    if (R_EXIT(source, i)->keyword)
-      R_EXIT(dest, i)->keyword = strdup(R_EXIT(source, i)->keyword);
+    R_EXIT(dest, i)->general_description = intern_string(R_EXIT(source, i)->general_description);
+    R_EXIT(dest, i)->keyword = intern_string(R_EXIT(source, i)->keyword);
   }
 
-  if (source->ex_description)
+  if (source->ex_description) {
     copy_ex_descriptions(&dest->ex_description, source->ex_description);
+    share_ex_descriptions(dest->ex_description);
+  }
 
   return TRUE;
 }
@@ -463,21 +470,16 @@ int free_room_strings(struct room_data *room)
   int i;
 
   /* Free descriptions. */
-  if (room->name)
-    free(room->name);
-  if (room->description)
-    free(room->description);
+  release_string(room->name);
+  release_string(room->description);
   if (room->ex_description)
     free_ex_descriptions(room->ex_description);
 
   /* Free exits. */
   for (i = 0; i < DIR_COUNT; i++) {
     if (room->dir_option[i]) {
-      if (room->dir_option[i]->general_description)
-        free(room->dir_option[i]->general_description);
-
-      if (room->dir_option[i]->keyword)
-        free(room->dir_option[i]->keyword);
+      release_string(room->dir_option[i]->general_description);
+      release_string(room->dir_option[i]->keyword);
 
       free(room->dir_option[i]);
       room->dir_option[i] = NULL;
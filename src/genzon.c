@@ -13,6 +13,7 @@
 #include "genolc.h"
 #include "genzon.h"
 #include "dg_scripts.h"
+#include "zreset.h"
 
 /* local functions */
 static void remove_cmd_from_list(struct reset_com **list, int pos);
@@ -181,6 +182,7 @@ zone_rnum create_new_zone(zone_vnum vzone_num, room_vnum bottom, room_vnum top,
     rznum = top_of_zone_table + 1;
   else {
     int j, room;
+    struct char_data *ch;
     for (i = top_of_zone_table + 1; i > 0 && vzone_num < zone_table[i - 1].number; i--) {
       zone_table[i] = zone_table[i - 1];
       for (j = zone_table[i].bot; j <= zone_table[i].top; j++)
@@ -188,6 +190,10 @@ zone_rnum create_new_zone(zone_vnum vzone_num, room_vnum bottom, room_vnum top,
           world[room].zone++;
     }
 rznum = i;
+    /* Characters counted in a zone that moved up follow it. */
+    for (ch = character_list; ch; ch = ch->next)
+      if (GET_PRESENCE_ZONE(ch) != NOWHERE && GET_PRESENCE_ZONE(ch) >= rznum)
+        GET_PRESENCE_ZONE(ch)++;
   }
   zone = &zone_table[rznum];
 
@@ -202,6 +208,11 @@ rznum = i;
   zone->reset_mode = 2;
   zone->min_level = -1;
   zone->max_level = -1;
+  zone->num_present = 0;
+  zone->parked_mobs = NULL;
+  zone->program = NULL;
+  zone->reset_count = 0;
+  zone->reset_usec = zone->last_reset_usec = zone->max_reset_usec = 0;
 
   for (i=0; i<ZN_ARRAY_MAX; i++)  zone->zone_flags[i] = 0;
 
@@ -210,6 +221,7 @@ rznum = i;
   zone->cmd[0].command = 'S';
 
   top_of_zone_table++;
+  index_vnums(DB_BOOT_ZON);
 
   add_to_save_list(zone->number, SL_ZON);
   return rznum;
@@ -524,6 +536,7 @@ void add_cmd_to_list(struct reset_com **list, struct reset_com *newcmd, int pos)
   newlist[count + 1].command = 'S';
   free(*list);
   *list = newlist;
+  zone_programs_changed();
 }
 
 /* Remove a reset command from a list. Takes a pointer to the list so that it
@@ -550,6 +563,7 @@ static void remove_cmd_from_list(struct reset_com **list, int pos)
   newlist[count - 1].command = 'S';
   free(*list);
   *list = newlist;
+  zone_programs_changed();
 }
 
 /* Error check user input and then add new (blank) command. */
@@ -22,71 +22,475 @@
 #include "graph.h"
 #include "fight.h"
 
-/* local functions */
-static int VALID_EDGE(room_rnum x, int y);
-static void bfs_enqueue(room_rnum room, int dir);
-static void bfs_dequeue(void);
-static void bfs_clear_queue(void);
-static int find_first_step(room_rnum src, room_rnum target);
+/* Tracking used to run a breadth first search over the whole world for every
+ * step of every hunting mob, clearing a mark on every room first.  Instead the
+ * world is cut into regions of consecutive rooms (a zone, or a slice of a big
+ * one) and each region keeps a table of the distances between all of its own
+ * rooms.  Rooms with an exit into or out of another region are gateways; for a
+ * target room the distance from every gateway is found with a search over the
+ * gateways only, and kept for the next few queries.  The first step is then a
+ * handful of table lookups.
+ *
+ * Rebuilding is lazy.  Opening or closing a door or editing a room's exits
+ * only marks that room's region as out of date; adding or removing rooms
+ * moves every rnum, so the regions are cut again on the next query. */
+
+#define TOROOM(x, y)	(world[(x)].dir_option[(y)]->to_room)
+#define IS_CLOSED(x, y)	(EXIT_FLAGGED(world[(x)].dir_option[(y)], EX_CLOSED))
+
+#define ROUTE_REGION_ROOMS 250  /* most rooms in a region; distances fit a byte */
+#define ROUTE_FAR          255  /* no path inside the region */
+#define ROUTE_INF          ((unsigned int) ~0)
+#define ROUTE_TARGETS      64   /* targets whose gateway distances are kept */
+
+/** A run of rooms first .. first + rooms - 1 with its all-pairs distances. */
+struct route_region {
+  room_rnum first;
+  int rooms;
+  unsigned char *dist;  /* dist[from * rooms + to], ROUTE_FAR if unreachable */
+  int first_gate;       /* this region's slice of route_gates[] */
+  int num_gates;
+  bool dirty;           /* dist[] must be rebuilt before use */
+};
+
+/** An exit from another region into a gateway. */
+struct route_link {
+  int gate;             /* gateway the exit leaves from */
+  int dir;
+};
+
+struct route_gate {
+  room_rnum room;
+  struct route_link *in;
+  int num_in;
+};
 
-struct bfs_queue_struct {
+/** Distance from every gateway to one target room. */
+struct route_target {
   room_rnum room;
-  char dir;
-  struct bfs_queue_struct *next;
+  unsigned long version;  /* route_version when it was computed */
+  unsigned long used;     /* for choosing which one to replace */
+  unsigned int *dist;
 };
 
-static struct bfs_queue_struct *queue_head = 0, *queue_tail = 0;
+struct route_heap_node {
+  unsigned int dist;
+  int gate;
+};
 
-/* Utility macros */
-#define MARK(room)	(SET_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define UNMARK(room)	(REMOVE_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define IS_MARKED(room)	(ROOM_FLAGGED(room, ROOM_BFS_MARK))
-#define TOROOM(x, y)	(world[(x)].dir_option[(y)]->to_room)
-#define IS_CLOSED(x, y)	(EXIT_FLAGGED(world[(x)].dir_option[(y)], EX_CLOSED))
+static struct route_region *route_regions = NULL;
+static int route_num_regions = 0;
+static int *route_region_of = NULL;   /* room rnum -> region */
+static int *route_gate_of = NULL;     /* room rnum -> gateway, or -1 */
+static struct route_gate *route_gates = NULL;
+static int route_num_gates = 0;
+static room_rnum route_top = NOWHERE; /* top_of_world when partitioned */
+static int route_doors = -1;          /* CONFIG_TRACK_T_DOORS the tables assume */
+static bool route_world_stale = TRUE;
+static bool route_gates_stale = TRUE;
+static unsigned long route_version = 0;
+static unsigned long route_uses = 0;
+static struct route_target route_targets[ROUTE_TARGETS];
+static struct route_heap_node *route_heap = NULL;
+static int route_heap_len = 0, route_heap_size = 0;
+
+/* local functions */
+static room_rnum route_step(room_rnum room, int dir);
+static void route_free_gates(void);
+static void route_free(void);
+static void route_partition(void);
+static void route_build_gates(void);
+static void route_build_region(struct route_region *rg);
+static int route_region_dist(int region, room_rnum from, room_rnum to);
+static void route_push(unsigned int dist, int gate);
+static int route_pop(unsigned int *dist);
+static void route_relax(unsigned int *dist, int gate, unsigned int d);
+static struct route_target *route_find_target(room_rnum target);
+static unsigned int route_distance(room_rnum room, room_rnum target, struct route_target *tc);
+static void route_ready(void);
+static int find_first_step(room_rnum src, room_rnum target);
+
+/** The room an exit leads to if tracking may follow it, else NOWHERE. */
+static room_rnum route_step(room_rnum room, int dir)
+{
+  if (world[room].dir_option[dir] == NULL || TOROOM(room, dir) == NOWHERE)
+    return NOWHERE;
+  if (CONFIG_TRACK_T_DOORS == FALSE && IS_CLOSED(room, dir))
+    return NOWHERE;
+  if (ROOM_FLAGGED(TOROOM(room, dir), ROOM_NOTRACK))
+    return NOWHERE;
+
+  return TOROOM(room, dir);
+}
+
+static void route_free_gates(void)
+{
+  int i;
+
+  for (i = 0; i < route_num_gates; i++)
+    if (route_gates[i].in)
+      free(route_gates[i].in);
+  if (route_gates)
+    free(route_gates);
+  route_gates = NULL;
+  route_num_gates = 0;
+}
+
+static void route_free(void)
+{
+  int i;
+
+  route_free_gates();
+  for (i = 0; i < route_num_regions; i++)
+    if (route_regions[i].dist)
+      free(route_regions[i].dist);
+  if (route_regions)
+    free(route_regions);
+  if (route_region_of)
+    free(route_region_of);
+  if (route_gate_of)
+    free(route_gate_of);
+  route_regions = NULL;
+  route_region_of = route_gate_of = NULL;
+  route_num_regions = 0;
+}
 
-static int VALID_EDGE(room_rnum x, int y)
+/* Cut the world into regions: a new one starts with each zone, and every
+ * ROUTE_REGION_ROOMS rooms within a zone. */
+static void route_partition(void)
 {
-  if (world[x].dir_option[y] == NULL || TOROOM(x, y) == NOWHERE)
-    return 0;
-  if (CONFIG_TRACK_T_DOORS == FALSE && IS_CLOSED(x, y))
-    return 0;
-  if (ROOM_FLAGGED(TOROOM(x, y), ROOM_NOTRACK) || IS_MARKED(TOROOM(x, y)))
-    return 0;
+  room_rnum r;
+  struct route_region *rg = NULL;
+
+  route_free();
+  route_top = top_of_world;
+  route_doors = CONFIG_TRACK_T_DOORS;
+  route_world_stale = FALSE;
+  route_version++;
+
+  if (top_of_world == NOWHERE)
+    return;
+
+  CREATE(route_regions, struct route_region, top_of_world + 1);
+  CREATE(route_region_of, int, top_of_world + 1);
+  CREATE(route_gate_of, int, top_of_world + 1);
+
+  for (r = 0; r <= top_of_world; r++) {
+    if (!rg || world[r].zone != world[rg->first].zone || rg->rooms == ROUTE_REGION_ROOMS) {
+      rg = &route_regions[route_num_regions++];
+      rg->first = r;
+      rg->dirty = TRUE;
+    }
+    rg->rooms++;
+    route_region_of[r] = route_num_regions - 1;
+  }
+  RECREATE(route_regions, struct route_region, route_num_regions);
 
-  return 1;
+  route_build_gates();
 }
 
-static void bfs_enqueue(room_rnum room, int dir)
+/* Find the gateways.  These depend only on where exits lead, not on doors or
+ * NOTRACK, so opening a door never changes them. */
+static void route_build_gates(void)
 {
-  struct bfs_queue_struct *curr;
+  room_rnum r, to;
+  int i, dir, g;
+  struct route_link *link;
+
+  route_free_gates();
+  route_gates_stale = FALSE;
+  route_version++;
+
+  for (r = 0; r <= top_of_world; r++)
+    route_gate_of[r] = -1;
+
+  /* mark both ends of every exit that leaves its region */
+  for (r = 0; r <= top_of_world; r++)
+    for (dir = 0; dir < DIR_COUNT; dir++) {
+      if (!world[r].dir_option[dir] || (to = TOROOM(r, dir)) == NOWHERE || to > top_of_world)
+        continue;
+      if (route_region_of[to] != route_region_of[r])
+        route_gate_of[r] = route_gate_of[to] = 0;
+    }
 
-  CREATE(curr, struct bfs_queue_struct, 1);
-  curr->room = room;
-  curr->dir = dir;
-  curr->next = 0;
+  /* number them in rnum order, so each region's gateways are consecutive */
+  for (i = 0; i < route_num_regions; i++)
+    route_regions[i].num_gates = 0;
+  for (r = 0; r <= top_of_world; r++)
+    if (route_gate_of[r] == 0) {
+      route_gate_of[r] = route_num_gates++;
+      route_regions[route_region_of[r]].num_gates++;
+    }
+  for (i = 0, g = 0; i < route_num_regions; i++) {
+    route_regions[i].first_gate = g;
+    g += route_regions[i].num_gates;
+  }
 
-  if (queue_tail) {
-    queue_tail->next = curr;
-    queue_tail = curr;
-  } else
-    queue_head = queue_tail = curr;
+  if (!route_num_gates)
+    return;
+  CREATE(route_gates, struct route_gate, route_num_gates);
+  for (r = 0; r <= top_of_world; r++)
+    if (route_gate_of[r] >= 0)
+      route_gates[route_gate_of[r]].room = r;
+
+  /* and record, for each gateway, the exits from other regions into it */
+  for (i = 0; i < 2; i++)
+    for (r = 0; r <= top_of_world; r++)
+      for (dir = 0; dir < DIR_COUNT; dir++) {
+        if (!world[r].dir_option[dir] || (to = TOROOM(r, dir)) == NOWHERE || to > top_of_world)
+          continue;
+        if (route_region_of[to] == route_region_of[r])
+          continue;
+        g = route_gate_of[to];
+        if (i == 0)
+          route_gates[g].num_in++;
+        else {
+          if (!route_gates[g].in) {
+            CREATE(route_gates[g].in, struct route_link, route_gates[g].num_in);
+            route_gates[g].num_in = 0;
+          }
+          link = &route_gates[g].in[route_gates[g].num_in++];
+          link->gate = route_gate_of[r];
+          link->dir = dir;
+        }
+      }
 }
 
-static void bfs_dequeue(void)
+/* One breadth first search per room, staying inside the region. */
+static void route_build_region(struct route_region *rg)
 {
-  struct bfs_queue_struct *curr;
+  int queue[ROUTE_REGION_ROOMS];
+  int n = rg->rooms, i, j, head, tail, dir;
+  unsigned char *row;
+  room_rnum to;
+
+  if (!rg->dist)
+    CREATE(rg->dist, unsigned char, n * n);
+  memset(rg->dist, ROUTE_FAR, n * n);
+
+  for (i = 0; i < n; i++) {
+    row = rg->dist + i * n;
+    row[i] = 0;
+    queue[0] = i;
+    for (head = 0, tail = 1; head < tail; head++)
+      for (dir = 0; dir < DIR_COUNT; dir++) {
+        if ((to = route_step(rg->first + queue[head], dir)) == NOWHERE)
+          continue;
+        if (to < rg->first || to >= rg->first + n)
+          continue;
+        j = to - rg->first;
+        if (row[j] != ROUTE_FAR)
+          continue;
+        row[j] = row[queue[head]] + 1;
+        queue[tail++] = j;
+      }
+  }
+  rg->dirty = FALSE;
+}
 
-  curr = queue_head;
+/** Distance between two rooms of a region without leaving it. */
+static int route_region_dist(int region, room_rnum from, room_rnum to)
+{
+  struct route_region *rg = &route_regions[region];
 
-  if (!(queue_head = queue_head->next))
-    queue_tail = 0;
-  free(curr);
+  if (rg->dirty)
+    route_build_region(rg);
+  return rg->dist[(from - rg->first) * rg->rooms + (to - rg->first)];
 }
 
-static void bfs_clear_queue(void)
+static void route_push(unsigned int dist, int gate)
 {
-  while (queue_head)
-    bfs_dequeue();
+  int i, parent;
+
+  if (route_heap_len == route_heap_size) {
+    route_heap_size = route_heap_size ? route_heap_size * 2 : 256;
+    RECREATE(route_heap, struct route_heap_node, route_heap_size);
+  }
+  for (i = route_heap_len++; i > 0; i = parent) {
+    parent = (i - 1) / 2;
+    if (route_heap[parent].dist <= dist)
+      break;
+    route_heap[i] = route_heap[parent];
+  }
+  route_heap[i].dist = dist;
+  route_heap[i].gate = gate;
+}
+
+static int route_pop(unsigned int *dist)
+{
+  struct route_heap_node last;
+  int i, child, gate;
+
+  gate = route_heap[0].gate;
+  *dist = route_heap[0].dist;
+  last = route_heap[--route_heap_len];
+
+  for (i = 0; (child = 2 * i + 1) < route_heap_len; i = child) {
+    if (child + 1 < route_heap_len && route_heap[child + 1].dist < route_heap[child].dist)
+      child++;
+    if (last.dist <= route_heap[child].dist)
+      break;
+    route_heap[i] = route_heap[child];
+  }
+  if (route_heap_len)
+    route_heap[i] = last;
+  return gate;
+}
+
+static void route_relax(unsigned int *dist, int gate, unsigned int d)
+{
+  if (d < dist[gate]) {
+    dist[gate] = d;
+    route_push(d, gate);
+  }
+}
+
+/* The gateway distances to target, computed by a search backwards over the
+ * gateways if they aren't already known. */
+static struct route_target *route_find_target(room_rnum target)
+{
+  struct route_target *tc = NULL;
+  struct route_region *rg;
+  struct route_link *link;
+  unsigned int d;
+  int i, u, v, region;
+
+  for (i = 0; i < ROUTE_TARGETS; i++) {
+    if (route_targets[i].room == target && route_targets[i].dist && route_targets[i].version == route_version) {
+      route_targets[i].used = ++route_uses;
+      return &route_targets[i];
+    }
+    if (!tc || route_targets[i].used < tc->used)
+      tc = &route_targets[i];
+  }
+
+  if (tc->dist)
+    free(tc->dist);
+  tc->dist = NULL;
+  if (route_num_gates)
+    CREATE(tc->dist, unsigned int, route_num_gates);
+  tc->room = target;
+  tc->version = route_version;
+  tc->used = ++route_uses;
+
+  for (i = 0; i < route_num_gates; i++)
+    tc->dist[i] = ROUTE_INF;
+
+  region = route_region_of[target];
+  rg = &route_regions[region];
+  route_heap_len = 0;
+  for (u = rg->first_gate; u < rg->first_gate + rg->num_gates; u++)
+    if ((d = route_region_dist(region, route_gates[u].room, target)) != ROUTE_FAR)
+      route_relax(tc->dist, u, d);
+
+  while (route_heap_len) {
+    v = route_pop(&d);
+    if (d > tc->dist[v])
+      continue;
+
+    /* exits into v from other regions */
+    for (i = 0; i < route_gates[v].num_in; i++) {
+      link = &route_gates[v].in[i];
+      if (route_step(route_gates[link->gate].room, link->dir) == route_gates[v].room)
+        route_relax(tc->dist, link->gate, d + 1);
+    }
+
+    /* and the other gateways of v's own region */
+    region = route_region_of[route_gates[v].room];
+    rg = &route_regions[region];
+    for (u = rg->first_gate; u < rg->first_gate + rg->num_gates; u++) {
+      int inner;
+
+      if (u == v)
+        continue;
+      if ((inner = route_region_dist(region, route_gates[u].room, route_gates[v].room)) != ROUTE_FAR)
+        route_relax(tc->dist, u, d + inner);
+    }
+  }
+
+  return tc;
+}
+
+/** Length of the shortest trail from room to target, or ROUTE_INF. */
+static unsigned int route_distance(room_rnum room, room_rnum target, struct route_target *tc)
+{
+  int region = route_region_of[room], g, d;
+  struct route_region *rg = &route_regions[region];
+  unsigned int best = ROUTE_INF;
+
+  if (route_region_of[target] == region && (d = route_region_dist(region, room, target)) != ROUTE_FAR)
+    best = d;
+
+  for (g = rg->first_gate; g < rg->first_gate + rg->num_gates; g++) {
+    if (tc->dist[g] == ROUTE_INF)
+      continue;
+    if ((d = route_region_dist(region, room, route_gates[g].room)) == ROUTE_FAR)
+      continue;
+    if (d + tc->dist[g] < best)
+      best = d + tc->dist[g];
+  }
+  return best;
+}
+
+/* Bring the partition up to date before a query. */
+static void route_ready(void)
+{
+  int i;
+
+  if (route_world_stale || route_top != top_of_world)
+    route_partition();
+  else if (route_gates_stale)
+    route_build_gates();
+
+  /* whether doors block tracking can be toggled at any time */
+  if (route_doors != CONFIG_TRACK_T_DOORS) {
+    route_doors = CONFIG_TRACK_T_DOORS;
+    for (i = 0; i < route_num_regions; i++)
+      route_regions[i].dirty = TRUE;
+    route_version++;
+  }
+}
+
+/** Cut up the world and fill in every region's table; called at boot. */
+void route_build(void)
+{
+  size_t bytes = 0;
+  int i;
+
+  route_partition();
+  for (i = 0; i < route_num_regions; i++) {
+    route_build_region(&route_regions[i]);
+    bytes += route_regions[i].rooms * route_regions[i].rooms;
+  }
+  log("   %d regions, %d gateways, %lu bytes of distance tables.", route_num_regions,
+    route_num_gates, (unsigned long) bytes);
+}
+
+/** Rooms were added or removed, so every rnum may have moved. */
+void route_world_changed(void)
+{
+  route_world_stale = TRUE;
+}
+
+/** The exits or flags of one room were edited. */
+void route_room_changed(room_rnum room)
+{
+  if (route_world_stale || room == NOWHERE || room > route_top)
+    return;
+
+  route_regions[route_region_of[room]].dirty = TRUE;
+  route_gates_stale = TRUE;
+  route_version++;
+}
+
+/** A door in room was opened or closed. */
+void route_door_changed(room_rnum room)
+{
+  if (CONFIG_TRACK_T_DOORS || route_world_stale || room == NOWHERE || room > route_top)
+    return;
+
+  route_regions[route_region_of[room]].dirty = TRUE;
+  route_version++;
 }
 
 /* find_first_step: given a source room and a target room, find the first step 
@@ -95,8 +499,10 @@ static void bfs_clear_queue(void)
  * PC.  Or, a 'track' skill for PCs. */
 static int find_first_step(room_rnum src, room_rnum target)
 {
-  int curr_dir;
-  room_rnum curr_room;
+  struct route_target *tc;
+  unsigned int d, best = ROUTE_INF;
+  int dir, best_dir = BFS_NO_PATH;
+  room_rnum to;
 
   if (src == NOWHERE || target == NOWHERE || src > top_of_world || target > top_of_world) {
     log("SYSERR: Illegal value %d or %d passed to find_first_step. (%s)", src, target, __FILE__);
@@ -105,36 +511,22 @@ static int find_first_step(room_rnum src, room_rnum target)
   if (src == target)
     return (BFS_ALREADY_THERE);
 
-  /* clear marks first, some OLC systems will save the mark. */
-  for (curr_room = 0; curr_room <= top_of_world; curr_room++)
-    UNMARK(curr_room);
-
-  MARK(src);
-
-  /* first, enqueue the first steps, saving which direction we're going. */
-  for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
-    if (VALID_EDGE(src, curr_dir)) {
-      MARK(TOROOM(src, curr_dir));
-      bfs_enqueue(TOROOM(src, curr_dir), curr_dir);
-    }
-
-  /* now, do the classic BFS. */
-  while (queue_head) {
-    if (queue_head->room == target) {
-      curr_dir = queue_head->dir;
-      bfs_clear_queue();
-      return (curr_dir);
-    } else {
-      for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
-	if (VALID_EDGE(queue_head->room, curr_dir)) {
-	  MARK(TOROOM(queue_head->room, curr_dir));
-	  bfs_enqueue(TOROOM(queue_head->room, curr_dir), queue_head->dir);
-	}
-      bfs_dequeue();
+  route_ready();
+  tc = route_find_target(target);
+
+  /* step to whichever neighbour is closest to the target */
+  for (dir = 0; dir < DIR_COUNT; dir++) {
+    if ((to = route_step(src, dir)) == NOWHERE || to == src)
+      continue;
+    if (to == target)
+      return (dir);
+    if ((d = route_distance(to, target, tc)) < best) {
+      best = d;
+      best_dir = dir;
     }
   }
 
-  return (BFS_NO_PATH);
+  return (best_dir);
 }
 
 /* Functions and Commands which use the above functions. */
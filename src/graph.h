@@ -16,5 +16,9 @@
 
 ACMD(do_track);
 void hunt_victim(struct char_data *ch);
+void route_build(void);
+void route_world_changed(void);
+void route_room_changed(room_rnum room);
+void route_door_changed(room_rnum room);
 
 #endif /* _GRAPH_H_*/
@@ -85,8 +85,8 @@ int is_name(const char *str, const char *namelist)
 #define WHITESPACE " \t"
 int isname(const char *str, const char *namelist)
 {
-  char *newlist;
-  char *curtok;
+  const char *curtok;
+  size_t len, toklen;
 
   if (!str || !*str || !namelist || !*namelist)
     return 0;
@@ -94,19 +94,157 @@ int isname(const char *str, const char *namelist)
   if (!strcmp(str, namelist)) /* the easy way */
     return 1;
 
-  newlist = strdup(namelist); /* make a copy since strtok 'modifies' strings */
-  for(curtok = strtok(newlist, WHITESPACE); curtok; curtok = strtok(NULL, WHITESPACE))
-    if(curtok && is_abbrev(str, curtok)) {
+  /* Walk the tokens in place rather than strtok() a copy of the list. */
+  len = strlen(str);
+  for (curtok = namelist + strspn(namelist, WHITESPACE); *curtok; curtok += toklen + strspn(curtok + toklen, WHITESPACE)) {
+    toklen = strcspn(curtok, WHITESPACE);
+    if (len <= toklen && !strn_cmp(str, curtok, len))
       /* Don't allow abbreviated numbers. - Sryth */
-      if (isdigit(*str) && (atoi(str) != atoi(curtok)))
-        return 0;
-      free(newlist);
-      return 1;
-    }
-  free(newlist);
+      return (!isdigit(*str) || atoi(str) == atoi(curtok));
+  }
+  return 0;
+}
+
+/* The keyword list of a mob or object prototype, split and lowercased once
+ * and shared by every instance still using the prototype's name, so the
+ * targeting loops below don't re-tokenize the same aliases for every
+ * candidate.  mask has bit (first letter & 63) set for each keyword, which
+ * turns most non-matches into a single test. */
+struct keyword_list {
+  int num_keywords;
+  char **keywords;
+  size_t *lengths;
+  unsigned long long mask;
+  char first;                /* first char of the full name, for the exact match */
+};
+
+/* A keyword being looked for, prepared once per search. */
+struct keyword_query {
+  const char *str;
+  char lower[MAX_INPUT_LENGTH];
+  size_t len;
+  unsigned long long bit;
+};
+
+#define KEYWORD_BIT(c) (1ULL << ((unsigned char) LOWER(c) & 63))
+
+static struct keyword_list *build_keyword_list(const char *namelist)
+{
+  struct keyword_list *kw;
+  const char *curtok;
+  size_t toklen;
+  int n = 0;
+
+  CREATE(kw, struct keyword_list, 1);
+  kw->first = *namelist;
+  for (curtok = namelist + strspn(namelist, WHITESPACE); *curtok; curtok += toklen + strspn(curtok + toklen, WHITESPACE)) {
+    toklen = strcspn(curtok, WHITESPACE);
+    kw->num_keywords++;
+  }
+  if (kw->num_keywords) {
+    CREATE(kw->keywords, char *, kw->num_keywords);
+    CREATE(kw->lengths, size_t, kw->num_keywords);
+  }
+
+  for (curtok = namelist + strspn(namelist, WHITESPACE); *curtok; curtok += toklen + strspn(curtok + toklen, WHITESPACE), n++) {
+    toklen = strcspn(curtok, WHITESPACE);
+    CREATE(kw->keywords[n], char, toklen + 1);
+    for (size_t k = 0; k < toklen; k++)
+      kw->keywords[n][k] = LOWER(curtok[k]);
+    kw->lengths[n] = toklen;
+    kw->mask |= KEYWORD_BIT(*curtok);
+  }
+  return (kw);
+}
+
+void free_keyword_list(struct keyword_list *kw)
+{
+  int i;
+
+  if (!kw)
+    return;
+  for (i = 0; i < kw->num_keywords; i++)
+    free(kw->keywords[i]);
+  if (kw->keywords)
+    free(kw->keywords);
+  if (kw->lengths)
+    free(kw->lengths);
+  free(kw);
+}
+
+static void prepare_keyword_query(struct keyword_query *q, const char *str)
+{
+  size_t i;
+
+  q->str = str;
+  for (i = 0; str[i] && i < sizeof(q->lower) - 1; i++)
+    q->lower[i] = LOWER(str[i]);
+  q->lower[i] = '\0';
+  q->len = i;
+  q->bit = KEYWORD_BIT(*str);
+}
+
+/* isname() against a prebuilt keyword list of namelist. */
+static int keyword_match(const struct keyword_query *q, const struct keyword_list *kw, const char *namelist)
+{
+  int i;
+
+  if (!q->len || !*namelist)
+    return 0;
+  if (q->str[q->len])   /* longer than any input line; not worth a special case */
+    return isname(q->str, namelist);
+
+  if (*q->str == kw->first && !strcmp(q->str, namelist))
+    return 1;
+
+  if (!(kw->mask & q->bit))
+    return 0;
+
+  for (i = 0; i < kw->num_keywords; i++)
+    if (q->len <= kw->lengths[i] && !memcmp(q->lower, kw->keywords[i], q->len))
+      return (!isdigit(*q->str) || atoi(q->str) == atoi(kw->keywords[i]));
   return 0;
 }
 
+/* The shared keyword list for obj, or NULL if it was restrung. */
+static struct keyword_list *obj_keywords(struct obj_data *obj)
+{
+  obj_rnum rnum = GET_OBJ_RNUM(obj);
+
+  if (rnum == NOTHING || rnum > top_of_objt || !obj->name || obj->name != obj_proto[rnum].name)
+    return (NULL);
+  if (!obj_index[rnum].keywords)
+    obj_index[rnum].keywords = build_keyword_list(obj->name);
+  return (obj_index[rnum].keywords);
+}
+
+/* The shared keyword list for a mob, NULL for players and renamed mobs. */
+static struct keyword_list *char_keywords(struct char_data *ch)
+{
+  mob_rnum rnum;
+
+  if (!IS_NPC(ch) || (rnum = GET_MOB_RNUM(ch)) == NOBODY || rnum > top_of_mobt ||
+      !ch->player.name || ch->player.name != mob_proto[rnum].player.name)
+    return (NULL);
+  if (!mob_index[rnum].keywords)
+    mob_index[rnum].keywords = build_keyword_list(ch->player.name);
+  return (mob_index[rnum].keywords);
+}
+
+static int obj_isname(const struct keyword_query *q, struct obj_data *obj)
+{
+  struct keyword_list *kw = obj_keywords(obj);
+
+  return (kw ? keyword_match(q, kw, obj->name) : isname(q->str, obj->name));
+}
+
+static int char_isname(const struct keyword_query *q, struct char_data *ch)
+{
+  struct keyword_list *kw = char_keywords(ch);
+
+  return (kw ? keyword_match(q, kw, ch->player.name) : isname(q->str, ch->player.name));
+}
+
 static void aff_apply_modify(struct char_data *ch, byte loc, sbyte mod, char *msg)
 {
   switch (loc) {
@@ -357,6 +495,34 @@ void affect_join(struct char_data *ch, struct affected_type *af,
 }
 
 /* move a player out of a room */
+/* The zone ch keeps is_empty() from reporting as empty, or NOWHERE: any
+ * connected character counts, except an immortal with nohassle on. */
+zone_rnum presence_zone_of(struct char_data *ch)
+{
+  if (!ch->desc || IN_ROOM(ch) == NOWHERE)
+    return (NOWHERE);
+  /* If an immortal has nohassle off, he counts as present. Added for testing
+   * zone reset triggers -Welcor */
+  if (!IS_NPC(ch) && GET_LEVEL(ch) >= LVL_IMMORT && PRF_FLAGGED(ch, PRF_NOHASSLE))
+    return (NOWHERE);
+  return (world[IN_ROOM(ch)].zone);
+}
+
+/* Move ch's contribution to zone_table[].num_present to wherever it belongs
+ * now.  Called whenever its room, descriptor, level or nohassle changes. */
+void update_zone_presence(struct char_data *ch)
+{
+  zone_rnum zone = presence_zone_of(ch);
+
+  if (zone == GET_PRESENCE_ZONE(ch))
+    return;
+  if (GET_PRESENCE_ZONE(ch) != NOWHERE)
+    zone_table[GET_PRESENCE_ZONE(ch)].num_present--;
+  if (zone != NOWHERE && zone_table[zone].num_present++ == 0)
+    wake_zone_mobs(zone);
+  GET_PRESENCE_ZONE(ch) = zone;
+}
+
 void char_from_room(struct char_data *ch)
 {
   struct char_data *temp;
@@ -376,9 +542,11 @@ void char_from_room(struct char_data *ch)
       if (GET_OBJ_VAL(GET_EQ(ch, WEAR_LIGHT), 2))	/* Light is ON */
 	world[IN_ROOM(ch)].light--;
 
+  mob_ai_leave(ch);
   REMOVE_FROM_LIST(ch, world[IN_ROOM(ch)].people, next_in_room);
   IN_ROOM(ch) = NOWHERE;
   ch->next_in_room = NULL;
+  update_zone_presence(ch);
 }
 
 /* place a character in a room */
@@ -391,6 +559,8 @@ void char_to_room(struct char_data *ch, room_rnum room)
     ch->next_in_room = world[room].people;
     world[room].people = ch;
     IN_ROOM(ch) = room;
+    update_zone_presence(ch);
+    mob_ai_enter(ch);
 
     autoquest_trigger_check(ch, 0, 0, AQ_ROOM_FIND);
     autoquest_trigger_check(ch, 0, 0, AQ_MOB_FIND);
@@ -418,6 +588,7 @@ void obj_to_char(struct obj_data *object, struct char_data *ch)
     IN_ROOM(object) = NOWHERE;
     IS_CARRYING_W(ch) += GET_OBJ_WEIGHT(object);
     IS_CARRYING_N(ch)++;
+    timed_obj_check(object);
 
     autoquest_trigger_check(ch, NULL, object, AQ_OBJ_FIND);
 
@@ -630,6 +801,7 @@ struct obj_data *get_obj_num(obj_rnum nr)
 struct char_data *get_char_room(char *name, int *number, room_rnum room)
 {
   struct char_data *i;
+  struct keyword_query q;
   int num;
 
   if (!number) {
@@ -640,8 +812,9 @@ struct char_data *get_char_room(char *name, int *number, room_rnum room)
   if (*number == 0)
     return (NULL);
 
+  prepare_keyword_query(&q, name);
   for (i = world[room].people; i && *number; i = i->next_in_room)
-    if (isname(name, i->player.name))
+    if (char_isname(&q, i))
       if (--(*number) == 0)
 	return (i);
 
@@ -671,6 +844,7 @@ void obj_to_room(struct obj_data *object, room_rnum room)
     world[room].contents = object;
     IN_ROOM(object) = room;
     object->carried_by = NULL;
+    timed_obj_check(object);
     if (ROOM_FLAGGED(room, ROOM_HOUSE))
       SET_BIT_AR(ROOM_FLAGS(room), ROOM_HOUSE_CRASH);
   }
@@ -719,6 +893,7 @@ void obj_to_obj(struct obj_data *obj, struct obj_data *obj_to)
   obj->next_content = obj_to->contains;
   obj_to->contains = obj;
   obj->in_obj = obj_to;
+  timed_obj_check(obj);
 
   /* Add weight to container, unless unlimited. */
   if (GET_OBJ_VAL(obj->in_obj, 0) > 0) {
@@ -800,6 +975,7 @@ void extract_obj(struct obj_data *obj)
     extract_obj(obj->contains);
 
   REMOVE_FROM_LIST(obj, object_list, next);
+  timed_obj_remove(obj);
 
   if (GET_OBJ_RNUM(obj) != NOTHING)
     (obj_index[GET_OBJ_RNUM(obj)].number)--;
@@ -1033,6 +1209,7 @@ void extract_pending_chars(void)
       continue;
     }
 
+    point_char_removed(vict);
     extract_char_final(vict);
     extractions_pending--;
 
@@ -1080,6 +1257,7 @@ struct char_data *get_player_vis(struct char_data *ch, char *name, int *number,
 struct char_data *get_char_room_vis(struct char_data *ch, char *name, int *number)
 {
   struct char_data *i;
+  struct keyword_query q;
   int num;
 
   if (!number) {
@@ -1095,8 +1273,9 @@ struct char_data *get_char_room_vis(struct char_data *ch, char *name, int *numbe
   if (*number == 0)
     return (get_player_vis(ch, name, NULL, FIND_CHAR_ROOM));
 
+  prepare_keyword_query(&q, name);
   for (i = world[IN_ROOM(ch)].people; i && *number; i = i->next_in_room)
-    if (isname(name, i->player.name))
+    if (char_isname(&q, i))
       if (CAN_SEE(ch, i))
 	if (--(*number) == 0)
 	  return (i);
@@ -1107,6 +1286,7 @@ struct char_data *get_char_room_vis(struct char_data *ch, char *name, int *numbe
 struct char_data *get_char_world_vis(struct char_data *ch, char *name, int *number)
 {
   struct char_data *i;
+  struct keyword_query q;
   int num;
 
   if (!number) {
@@ -1120,10 +1300,11 @@ struct char_data *get_char_world_vis(struct char_data *ch, char *name, int *numb
   if (*number == 0)
     return get_player_vis(ch, name, NULL, 0);
 
+  prepare_keyword_query(&q, name);
   for (i = character_list; i && *number; i = i->next) {
     if (IN_ROOM(ch) == IN_ROOM(i))
       continue;
-    if (!isname(name, i->player.name))
+    if (!char_isname(&q, i))
       continue;
     if (!CAN_SEE(ch, i))
       continue;
@@ -1148,6 +1329,7 @@ struct char_data *get_char_vis(struct char_data *ch, char *name, int *number, in
 struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *number, struct obj_data *list)
 {
   struct obj_data *i;
+  struct keyword_query q;
   int num;
 
   if (!number) {
@@ -1158,8 +1340,9 @@ struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *numb
   if (*number == 0)
     return (NULL);
 
+  prepare_keyword_query(&q, name);
   for (i = list; i && *number; i = i->next_content)
-    if (isname(name, i->name))
+    if (obj_isname(&q, i))
       if (CAN_SEE_OBJ(ch, i))
 	if (--(*number) == 0)
 	  return (i);
@@ -1171,6 +1354,7 @@ struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *numb
 struct obj_data *get_obj_vis(struct char_data *ch, char *name, int *number)
 {
   struct obj_data *i;
+  struct keyword_query q;
   int num;
 
   if (!number) {
@@ -1190,8 +1374,9 @@ struct obj_data *get_obj_vis(struct char_data *ch, char *name, int *number)
     return (i);
 
   /* ok.. no luck yet. scan the entire obj list   */
+  prepare_keyword_query(&q, name);
   for (i = object_list; i && *number; i = i->next)
-    if (isname(name, i->name))
+    if (obj_isname(&q, i))
       if (CAN_SEE_OBJ(ch, i))
 	if (--(*number) == 0)
 	  return (i);
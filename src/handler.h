@@ -25,6 +25,7 @@ bool add_dur, bool avg_dur, bool add_mod, bool avg_mod);
 const char *money_desc(int amount);
 struct obj_data *create_money(int amount);
 int	isname(const char *str, const char *namelist);
+void	free_keyword_list(struct keyword_list *kw);
 int	is_name(const char *str, const char *namelist);
 char	*fname(const char *namelist);
 int	get_number(char **name);
@@ -51,6 +52,8 @@ void update_char_objects(struct char_data *ch);
 struct char_data *get_char_room(char *name, int *num, room_rnum room);
 struct char_data *get_char_num(mob_rnum nr);
 
+zone_rnum presence_zone_of(struct char_data *ch);
+void	update_zone_presence(struct char_data *ch);
 void	char_from_room(struct char_data *ch);
 void	char_to_room(struct char_data *ch, room_rnum room);
 void	extract_char(struct char_data *ch);
@@ -100,6 +103,18 @@ void forget(struct char_data *ch, struct char_data *victim);
 void remember(struct char_data *ch, struct char_data *victim);
 void mobile_activity(void);
 void clearMemory(struct char_data *ch);
+void mob_ai_enter(struct char_data *ch);
+void mob_ai_leave(struct char_data *ch);
+void wake_mob(struct char_data *ch);
+void wake_zone_mobs(zone_rnum zone);
+
+/* What the last mobile_activity() did, for record_usage() */
+struct mob_ai_stats {
+  int mobs;     /* NPCs in rooms: what a scan of every mob would run */
+  int ran;      /* NPCs whose AI actually ran */
+  int parked;   /* NPCs left idle in empty zones */
+};
+extern struct mob_ai_stats mob_ai_stats;
 
 
 /* For new last command: */
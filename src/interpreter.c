@@ -36,6 +36,7 @@
 #include "asciimap.h"
 #include "prefedit.h"
 #include "ibt.h"
+#include "profiler.h"
 #include "mud_event.h"
 
 /* local (file scope) functions */
@@ -244,6 +245,7 @@ cpp_extern const struct command_info cmd_info[] = {
   { "pour"     , "pour"    , POS_STANDING, do_pour     , 0, SCMD_POUR },
   { "prompt"   , "pro"     , POS_DEAD    , do_display  , 0, 0 },
   { "prefedit" , "pre"     , POS_DEAD    , do_oasis_prefedit , 0, 0 },
+  { "profile"  , "profile" , POS_DEAD    , do_profile  , LVL_IMMORT, 0 },
   { "purge"    , "purge"   , POS_DEAD    , do_purge    , LVL_BUILDER, 0 },
 
   { "qedit"    , "qedit"   , POS_DEAD    , do_oasis_qedit, LVL_BUILDER, 0 },
@@ -447,6 +449,223 @@ static const char *reserved[] =
   "\n"
 };
 
+/* Command lookup.  Every prefix of every command in complete_cmd_info is a
+ * node of a trie, so an abbreviation is resolved by walking its letters
+ * rather than by comparing it against the whole list.  For commands and for
+ * socials separately, each node keeps the earliest entries it can stand for
+ * at each minimum level: ascending in the list, each needing a lower level
+ * than the one before.  The first of those the character may use is the
+ * command a scan of the list would have found. */
+#define CMD_KIND_COMMAND 0
+#define CMD_KIND_SOCIAL  1
+
+struct cmd_trie_node {
+  char letter;
+  struct cmd_trie_node *child;  /* first node one letter longer */
+  struct cmd_trie_node *next;   /* next node with the same parent */
+  int exact;                    /* first command spelled exactly so, or -1 */
+  int *cmds[2];                 /* candidates, per CMD_KIND_ */
+  int num_cmds[2];
+};
+
+/* "Did you mean" suggestions come from cmd_info, for commands starting with
+ * the same letter as the typo.  Those are kept in a BK-tree per letter, so
+ * only words that can be within two edits of the typo are compared. */
+#define CMD_SUGGEST_DIST 2
+
+struct cmd_bk_node {
+  int cmd;                      /* index into cmd_info */
+  int dist;                     /* edit distance from the parent's word */
+  struct cmd_bk_node *child;    /* first child */
+  struct cmd_bk_node *next;     /* next child of the same parent */
+};
+
+static struct cmd_trie_node *cmd_trie = NULL;
+static struct cmd_bk_node *cmd_bk_roots[256];
+static bool cmd_bk_built = FALSE;
+
+static struct cmd_trie_node *cmd_trie_child(struct cmd_trie_node *node, char letter, bool create);
+static void cmd_trie_add(int cmd);
+static void free_cmd_trie(struct cmd_trie_node *node);
+static int lookup_command(const char *arg, int level, int kind);
+static void cmd_bk_add(int cmd);
+static void free_cmd_bk(struct cmd_bk_node *node);
+static int compare_ints(const void *a, const void *b);
+static void suggest_commands(struct char_data *ch, const char *arg);
+
+static struct cmd_trie_node *cmd_trie_child(struct cmd_trie_node *node, char letter, bool create)
+{
+  struct cmd_trie_node *child;
+
+  for (child = node->child; child; child = child->next)
+    if (child->letter == letter)
+      return child;
+
+  if (!create)
+    return NULL;
+
+  CREATE(child, struct cmd_trie_node, 1);
+  child->letter = letter;
+  child->exact = -1;
+  child->next = node->child;
+  node->child = child;
+  return child;
+}
+
+/* Commands must be added in list order. */
+static void cmd_trie_add(int cmd)
+{
+  struct cmd_trie_node *node = cmd_trie;
+  const char *p;
+  int kind = complete_cmd_info[cmd].command_pointer == do_action ? CMD_KIND_SOCIAL : CMD_KIND_COMMAND;
+  int level = complete_cmd_info[cmd].minimum_level, n;
+
+  for (p = complete_cmd_info[cmd].command; *p; p++) {
+    node = cmd_trie_child(node, *p, TRUE);
+
+    /* an earlier entry open to this level or lower always wins */
+    n = node->num_cmds[kind];
+    if (n && complete_cmd_info[node->cmds[kind][n - 1]].minimum_level <= level)
+      continue;
+    RECREATE(node->cmds[kind], int, n + 1);
+    node->cmds[kind][n] = cmd;
+    node->num_cmds[kind]++;
+  }
+  if (node->exact == -1)
+    node->exact = cmd;
+}
+
+static void free_cmd_trie(struct cmd_trie_node *node)
+{
+  struct cmd_trie_node *next;
+
+  for (; node; node = next) {
+    next = node->next;
+    free_cmd_trie(node->child);
+    if (node->cmds[CMD_KIND_COMMAND])
+      free(node->cmds[CMD_KIND_COMMAND]);
+    if (node->cmds[CMD_KIND_SOCIAL])
+      free(node->cmds[CMD_KIND_SOCIAL]);
+    free(node);
+  }
+}
+
+/** The first entry of the given kind that arg abbreviates and a character
+ * of level may use, or -1. */
+static int lookup_command(const char *arg, int level, int kind)
+{
+  struct cmd_trie_node *node = cmd_trie;
+  int i;
+
+  if (!node || !*arg)
+    return -1;
+
+  for (; *arg; arg++)
+    if (!(node = cmd_trie_child(node, *arg, FALSE)))
+      return -1;
+
+  for (i = 0; i < node->num_cmds[kind]; i++)
+    if (level >= complete_cmd_info[node->cmds[kind][i]].minimum_level)
+      return node->cmds[kind][i];
+
+  return -1;
+}
+
+static void cmd_bk_add(int cmd)
+{
+  struct cmd_bk_node *node, *child, *leaf;
+  int dist;
+
+  CREATE(leaf, struct cmd_bk_node, 1);
+  leaf->cmd = cmd;
+
+  if (!(node = cmd_bk_roots[(unsigned char) *cmd_info[cmd].command])) {
+    cmd_bk_roots[(unsigned char) *cmd_info[cmd].command] = leaf;
+    return;
+  }
+
+  for (;;) {
+    dist = levenshtein_distance(cmd_info[cmd].command, cmd_info[node->cmd].command);
+    for (child = node->child; child; child = child->next)
+      if (child->dist == dist)
+        break;
+    if (!child) {
+      leaf->dist = dist;
+      leaf->next = node->child;
+      node->child = leaf;
+      return;
+    }
+    node = child;
+  }
+}
+
+static void free_cmd_bk(struct cmd_bk_node *node)
+{
+  struct cmd_bk_node *next;
+
+  for (; node; node = next) {
+    next = node->next;
+    free_cmd_bk(node->child);
+    free(node);
+  }
+}
+
+static int compare_ints(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+static void suggest_commands(struct char_data *ch, const char *arg)
+{
+  struct cmd_bk_node *stack[MAX_INPUT_LENGTH], *node, *child;
+  int found[MAX_INPUT_LENGTH], num_found = 0, depth = 0, dist, i;
+
+  if ((node = cmd_bk_roots[(unsigned char) *arg]) != NULL)
+    stack[depth++] = node;
+
+  while (depth) {
+    node = stack[--depth];
+    dist = levenshtein_distance(arg, cmd_info[node->cmd].command);
+    if (dist <= CMD_SUGGEST_DIST && num_found < MAX_INPUT_LENGTH)
+      found[num_found++] = node->cmd;
+
+    /* by the triangle inequality nothing else can be close enough */
+    for (child = node->child; child; child = child->next)
+      if (child->dist >= dist - CMD_SUGGEST_DIST && child->dist <= dist + CMD_SUGGEST_DIST && depth < MAX_INPUT_LENGTH)
+        stack[depth++] = child;
+  }
+
+  /* listed in command list order, as they always were */
+  qsort(found, num_found, sizeof(int), compare_ints);
+
+  for (i = 0, dist = 0; i < num_found; i++) {
+    if (cmd_info[found[i]].minimum_level > GET_LEVEL(ch))
+      continue;
+    /* Only apply levenshtein counts if the command is not a trigger command. */
+    if (cmd_info[found[i]].minimum_level < 0)
+      continue;
+    if (!dist) {
+      send_to_char(ch, "\r\nDid you mean:\r\n");
+      dist = 1;
+    }
+    send_to_char(ch, "  %s\r\n", cmd_info[found[i]].command);
+  }
+}
+
+void free_command_lookup(void)
+{
+  int i;
+
+  free_cmd_trie(cmd_trie);
+  cmd_trie = NULL;
+
+  for (i = 0; i < 256; i++) {
+    free_cmd_bk(cmd_bk_roots[i]);
+    cmd_bk_roots[i] = NULL;
+  }
+  cmd_bk_built = FALSE;
+}
+
 static int sort_commands_helper(const void *a, const void *b)
 {
   return strcmp(complete_cmd_info[*(const int *)a].sort_as,
@@ -468,6 +687,20 @@ void sort_commands(void)
 
   /* Don't sort the RESERVED or \n entries. */
   qsort(cmd_sort_info + 1, num_of_cmds - 2, sizeof(int), sort_commands_helper);
+
+  /* socials may have changed, so the trie is rebuilt each time */
+  free_cmd_trie(cmd_trie);
+  CREATE(cmd_trie, struct cmd_trie_node, 1);
+  cmd_trie->exact = -1;
+  for (a = 0; a < num_of_cmds - 1; a++)
+    cmd_trie_add(a);
+
+  /* cmd_info itself never changes */
+  if (!cmd_bk_built) {
+    for (a = 0; *cmd_info[a].command != '\n'; a++)
+      cmd_bk_add(a);
+    cmd_bk_built = TRUE;
+  }
 }
 
 
@@ -476,7 +709,7 @@ void sort_commands(void)
  * then calls the appropriate function. */
 void command_interpreter(struct char_data *ch, char *argument)
 {
-  int cmd, length;
+  int cmd;
   char *line;
   char arg[MAX_INPUT_LENGTH];
 
@@ -513,42 +746,15 @@ void command_interpreter(struct char_data *ch, char *argument)
        return;
    }
 
-  for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-    if(complete_cmd_info[cmd].command_pointer != do_action &&
-       !strncmp(complete_cmd_info[cmd].command, arg, length))
-      if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-        break;
+  cmd = lookup_command(arg, GET_LEVEL(ch), CMD_KIND_COMMAND);
 
   /* it's not a 'real' command, so it's a social */
+  if (cmd < 0)
+    cmd = lookup_command(arg, GET_LEVEL(ch), CMD_KIND_SOCIAL);
 
-  if(*complete_cmd_info[cmd].command == '\n')
-    for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-      if (complete_cmd_info[cmd].command_pointer == do_action &&
-          !strncmp(complete_cmd_info[cmd].command, arg, length))
-        if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-          break;
-
-  if (*complete_cmd_info[cmd].command == '\n') {
-    int found = 0;
+  if (cmd < 0) {
     send_to_char(ch, "%s", CONFIG_HUH);
-
-    for (cmd = 0; *cmd_info[cmd].command != '\n'; cmd++)
-    {
-      if (*arg != *cmd_info[cmd].command || cmd_info[cmd].minimum_level > GET_LEVEL(ch))
-        continue;
-
-      /* Only apply levenshtein counts if the command is not a trigger command. */
-      if ( (levenshtein_distance(arg, cmd_info[cmd].command) <= 2) &&
-           (cmd_info[cmd].minimum_level >= 0) )
-      {
-        if (!found)
-        {
-          send_to_char(ch, "\r\nDid you mean:\r\n");
-          found = 1;
-        }
-        send_to_char(ch, "  %s\r\n", cmd_info[cmd].command);
-      }
-    }
+    suggest_commands(ch, arg);
   }
   else if (!IS_NPC(ch) && PLR_FLAGGED(ch, PLR_FROZEN) && GET_LEVEL(ch) < LVL_IMPL)
     send_to_char(ch, "You try, but the mind-numbing cold prevents you...\r\n");
@@ -961,8 +1167,17 @@ void half_chop(char *string, char *arg1, char *arg2)
 /* Used in specprocs, mostly.  (Exactly) matches "command" to cmd number */
 int find_command(const char *command)
 {
+  struct cmd_trie_node *node = cmd_trie;
+  const char *p;
   int cmd;
 
+  if (node) {
+    for (p = command; *p && node; p++)
+      node = cmd_trie_child(node, *p, FALSE);
+    return (node ? node->exact : -1);
+  }
+
+  /* before sort_commands() has run */
   for (cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
     if (!strcmp(complete_cmd_info[cmd].command, command))
       return (cmd);
@@ -1057,8 +1272,10 @@ static int perform_dupe_check(struct descriptor_data *d)
 	target = k->original;
 	mode = UNSWITCH;
       }
-      if (k->character)
+      if (k->character) {
 	k->character->desc = NULL;
+	update_zone_presence(k->character);
+      }
       k->character = NULL;
       k->original = NULL;
     } else if (k->character && GET_IDNUM(k->character) == id && k->original) {
@@ -1075,6 +1292,7 @@ static int perform_dupe_check(struct descriptor_data *d)
 	mode = USURP;
       }
       k->character->desc = NULL;
+      update_zone_presence(k->character);
       k->character = NULL;
       k->original = NULL;
       write_to_output(k, "\r\nMultiple login detected -- disconnecting.\r\n");
@@ -1138,6 +1356,7 @@ static int perform_dupe_check(struct descriptor_data *d)
   free_char(d->character); /* get rid of the old char */
   d->character = target;
   d->character->desc = d;
+  update_zone_presence(d->character);
   d->original = NULL;
   d->character->char_specials.timer = 0;
   REMOVE_BIT_AR(PLR_FLAGS(d->character), PLR_MAILING);
@@ -21,6 +21,7 @@
 #define IS_MOVE(cmdnum) (complete_cmd_info[cmdnum].command_pointer == do_move)
 
 void sort_commands(void);
+void free_command_lookup(void);
 void	command_interpreter(struct char_data *ch, char *argument);
 int	search_block(char *arg, const char **list, int exact);
 char	*one_argument(char *argument, char *first_arg);
@@ -26,6 +26,11 @@
 /* local file scope function prototypes */
 static int graf(int grafage, int p0, int p1, int p2, int p3, int p4, int p5, int p6);
 static void check_idling(struct char_data *ch);
+static int needs_timer(struct obj_data *obj);
+static int points_at_rest(struct char_data *ch);
+static void point_update_char(struct char_data *i);
+static void point_update_obj(struct obj_data *j);
+static void point_update_slice(int chars, int objs);
 
 /* When age < 15 return the value p0
    When age is 15..29 calculate the line between p1 & p2
@@ -374,88 +379,203 @@ static void check_idling(struct char_data *ch)
   }
 }
 
-/* Update PCs, NPCs, and objects */
-void point_update(void)
+/* point_update() used to walk every character and object in the game at the
+ * top of each mud hour, which made every tick a lag spike on a large world.
+ * The tick now only rewinds two cursors, and every PULSE_POINTS another slice
+ * of the characters and of the timed objects is brought up to date, so that
+ * everything which existed at the tick is updated once before the next one.
+ * Only corpses and objects with a running timer are kept on the timed list,
+ * and NPCs with nothing to regenerate are passed over. */
+#define POINT_SHARDS	((SECS_PER_MUD_HOUR * PASSES_PER_SEC) / PULSE_POINTS)
+
+static struct obj_data *timed_objects = NULL;
+static int num_timed_objects = 0;
+
+/* Where this hour's pass has got to. Characters enter character_list, and
+ * objects the timed list, at the head, so anything added during the hour is
+ * behind the cursor and waits for the next tick, as it always did. */
+static struct char_data *point_char_cursor = NULL;
+static struct obj_data *point_obj_cursor = NULL;
+static int point_chars_left = 0, point_objs_left = 0, point_shards_left = 0;
+
+static int needs_timer(struct obj_data *obj)
 {
-  struct char_data *i, *next_char;
-  struct obj_data *j, *next_thing, *jj, *next_thing2;
+  return (IS_CORPSE(obj) || GET_OBJ_TIMER(obj) > 0);
+}
 
-  /* characters */
-  for (i = character_list; i; i = next_char) {
-    next_char = i->next;
-
-    gain_condition(i, HUNGER, -1);
-    gain_condition(i, DRUNK, -1);
-    gain_condition(i, THIRST, -1);
-
-    if (GET_POS(i) >= POS_STUNNED) {
-      GET_HIT(i) = MIN(GET_HIT(i) + hit_gain(i), GET_MAX_HIT(i));
-      GET_MANA(i) = MIN(GET_MANA(i) + mana_gain(i), GET_MAX_MANA(i));
-      GET_MOVE(i) = MIN(GET_MOVE(i) + move_gain(i), GET_MAX_MOVE(i));
-      if (AFF_FLAGGED(i, AFF_POISON))
-	if (damage(i, i, 2, SPELL_POISON) == -1)
-	  continue;	/* Oops, they died. -gg 6/24/98 */
-      if (GET_POS(i) <= POS_STUNNED)
-	update_pos(i);
-    } else if (GET_POS(i) == POS_INCAP) {
-      if (damage(i, i, 1, TYPE_SUFFERING) == -1)
-	continue;
-    } else if (GET_POS(i) == POS_MORTALLYW) {
-      if (damage(i, i, 2, TYPE_SUFFERING) == -1)
-	continue;
-    }
-    if (!IS_NPC(i)) {
-      update_char_objects(i);
-      (i->char_specials.timer)++;
-      if (GET_LEVEL(i) < CONFIG_IDLE_MAX_LEVEL)
-	check_idling(i);
-    }
+/* Put obj on the timed list if its timer is running or it is a corpse. Called
+ * wherever an object is created, placed, or has its timer set. */
+void timed_obj_check(struct obj_data *obj)
+{
+  if (obj->prev_timed || timed_objects == obj || !needs_timer(obj))
+    return;
+
+  obj->prev_timed = NULL;
+  obj->next_timed = timed_objects;
+  if (timed_objects)
+    timed_objects->prev_timed = obj;
+  timed_objects = obj;
+  num_timed_objects++;
+}
+
+void timed_obj_remove(struct obj_data *obj)
+{
+  if (!obj->prev_timed && timed_objects != obj)
+    return;
+
+  if (point_obj_cursor == obj)
+    point_obj_cursor = obj->next_timed;
+
+  if (obj->prev_timed)
+    obj->prev_timed->next_timed = obj->next_timed;
+  else
+    timed_objects = obj->next_timed;
+  if (obj->next_timed)
+    obj->next_timed->prev_timed = obj->prev_timed;
+
+  obj->next_timed = obj->prev_timed = NULL;
+  num_timed_objects--;
+}
+
+/* Called by extract_pending_chars() before ch leaves character_list. */
+void point_char_removed(struct char_data *ch)
+{
+  if (point_char_cursor == ch)
+    point_char_cursor = ch->next;
+}
+
+/* An NPC on its feet with full hit, mana and move points and no poison would
+ * come out of point_update_char() unchanged. */
+static int points_at_rest(struct char_data *ch)
+{
+  return (IS_NPC(ch) && GET_POS(ch) > POS_STUNNED && !AFF_FLAGGED(ch, AFF_POISON) &&
+	  GET_HIT(ch) == GET_MAX_HIT(ch) && GET_MANA(ch) == GET_MAX_MANA(ch) &&
+	  GET_MOVE(ch) == GET_MAX_MOVE(ch));
+}
+
+static void point_update_char(struct char_data *i)
+{
+  gain_condition(i, HUNGER, -1);
+  gain_condition(i, DRUNK, -1);
+  gain_condition(i, THIRST, -1);
+
+  if (GET_POS(i) >= POS_STUNNED) {
+    GET_HIT(i) = MIN(GET_HIT(i) + hit_gain(i), GET_MAX_HIT(i));
+    GET_MANA(i) = MIN(GET_MANA(i) + mana_gain(i), GET_MAX_MANA(i));
+    GET_MOVE(i) = MIN(GET_MOVE(i) + move_gain(i), GET_MAX_MOVE(i));
+    if (AFF_FLAGGED(i, AFF_POISON))
+      if (damage(i, i, 2, SPELL_POISON) == -1)
+	return;	/* Oops, they died. -gg 6/24/98 */
+    if (GET_POS(i) <= POS_STUNNED)
+      update_pos(i);
+  } else if (GET_POS(i) == POS_INCAP) {
+    if (damage(i, i, 1, TYPE_SUFFERING) == -1)
+      return;
+  } else if (GET_POS(i) == POS_MORTALLYW) {
+    if (damage(i, i, 2, TYPE_SUFFERING) == -1)
+      return;
+  }
+  if (!IS_NPC(i)) {
+    update_char_objects(i);
+    (i->char_specials.timer)++;
+    if (GET_LEVEL(i) < CONFIG_IDLE_MAX_LEVEL)
+      check_idling(i);
   }
+}
 
-  /* objects */
-  for (j = object_list; j; j = next_thing) {
-    next_thing = j->next;	/* Next in object list */
-
-    /* If this is a corpse */
-    if (IS_CORPSE(j)) {
-      /* timer count down */
-      if (GET_OBJ_TIMER(j) > 0)
-	GET_OBJ_TIMER(j)--;
-
-      if (!GET_OBJ_TIMER(j)) {
-
-	if (j->carried_by)
-	  act("$p decays in your hands.", FALSE, j->carried_by, j, 0, TO_CHAR);
-	else if ((IN_ROOM(j) != NOWHERE) && (world[IN_ROOM(j)].people)) {
-	  act("A quivering horde of maggots consumes $p.",
-	      TRUE, world[IN_ROOM(j)].people, j, 0, TO_ROOM);
-	  act("A quivering horde of maggots consumes $p.",
-	      TRUE, world[IN_ROOM(j)].people, j, 0, TO_CHAR);
-	}
-	for (jj = j->contains; jj; jj = next_thing2) {
-	  next_thing2 = jj->next_content;	/* Next in inventory */
-	  obj_from_obj(jj);
-
-	  if (j->in_obj)
-	    obj_to_obj(jj, j->in_obj);
-	  else if (j->carried_by)
-	    obj_to_room(jj, IN_ROOM(j->carried_by));
-	  else if (IN_ROOM(j) != NOWHERE)
-	    obj_to_room(jj, IN_ROOM(j));
-	  else
-	    core_dump();
-	}
-	extract_obj(j);
+static void point_update_obj(struct obj_data *j)
+{
+  struct obj_data *jj, *next_thing2;
+
+  /* If this is a corpse */
+  if (IS_CORPSE(j)) {
+    /* timer count down */
+    if (GET_OBJ_TIMER(j) > 0)
+      GET_OBJ_TIMER(j)--;
+
+    if (!GET_OBJ_TIMER(j)) {
+
+      if (j->carried_by)
+	act("$p decays in your hands.", FALSE, j->carried_by, j, 0, TO_CHAR);
+      else if ((IN_ROOM(j) != NOWHERE) && (world[IN_ROOM(j)].people)) {
+	act("A quivering horde of maggots consumes $p.",
+	    TRUE, world[IN_ROOM(j)].people, j, 0, TO_ROOM);
+	act("A quivering horde of maggots consumes $p.",
+	    TRUE, world[IN_ROOM(j)].people, j, 0, TO_CHAR);
       }
+      for (jj = j->contains; jj; jj = next_thing2) {
+	next_thing2 = jj->next_content;	/* Next in inventory */
+	obj_from_obj(jj);
+
+	if (j->in_obj)
+	  obj_to_obj(jj, j->in_obj);
+	else if (j->carried_by)
+	  obj_to_room(jj, IN_ROOM(j->carried_by));
+	else if (IN_ROOM(j) != NOWHERE)
+	  obj_to_room(jj, IN_ROOM(j));
+	else
+	  core_dump();
+      }
+      extract_obj(j);
     }
-    /* If the timer is set, count it down and at 0, try the trigger
-     * note to .rej hand-patchers: make this last in your point-update() */
-    else if (GET_OBJ_TIMER(j)>0) {
-      GET_OBJ_TIMER(j)--;
-      if (!GET_OBJ_TIMER(j))
-        timer_otrigger(j);
+  }
+  /* If the timer is set, count it down and at 0, try the trigger
+   * note to .rej hand-patchers: make this last in your point-update() */
+  else if (GET_OBJ_TIMER(j)>0) {
+    GET_OBJ_TIMER(j)--;
+    if (!GET_OBJ_TIMER(j)) {
+      /* Off the list first: the trigger may purge j, or otimer may restart it. */
+      timed_obj_remove(j);
+      timer_otrigger(j);
     }
   }
+}
+
+/* Update up to the given number of characters and timed objects. */
+static void point_update_slice(int chars, int objs)
+{
+  struct char_data *i;
+  struct obj_data *j;
+
+  /* characters */
+  while (chars-- > 0 && (i = point_char_cursor) != NULL) {
+    point_char_cursor = i->next;
+    point_chars_left--;
+
+    if (!points_at_rest(i))
+      point_update_char(i);
+  }
+
+  /* objects */
+  while (objs-- > 0 && (j = point_obj_cursor) != NULL) {
+    point_obj_cursor = j->next_timed;
+    point_objs_left--;
+
+    /* Timers run down by update_char_objects() or reset elsewhere. */
+    if (!needs_timer(j))
+      timed_obj_remove(j);
+    else
+      point_update_obj(j);
+  }
+}
+
+/* Called once a mud hour, at the tick. */
+void begin_point_update(void)
+{
+  struct char_data *i;
+
+  /* Anything left over from the last hour gets its turn now. */
+  if (point_char_cursor || point_obj_cursor)
+    point_update_slice(INT_MAX, INT_MAX);
+
+  point_chars_left = 0;
+  for (i = character_list; i; i = i->next)
+    point_chars_left++;
+
+  point_char_cursor = character_list;
+  point_obj_cursor = timed_objects;
+  point_objs_left = num_timed_objects;
+  point_shards_left = POINT_SHARDS;
 
   /* Take 1 from the happy-hour tick counter, and end happy-hour if zero */
        if (HAPPY_TIME > 1)  HAPPY_TIME--;
@@ -469,6 +589,25 @@ void point_update(void)
   }
 }
 
+/* Update PCs, NPCs, and objects: one slice of the current hour's pass. The
+ * counts left are estimates (characters die, objects come and go), so each
+ * slice takes its share of what is left and the last one takes the rest. */
+void point_update(void)
+{
+  int shards;
+
+  if (point_shards_left <= 0)
+    return;
+
+  shards = point_shards_left--;
+
+  if (!point_shards_left)
+    point_update_slice(INT_MAX, INT_MAX);
+  else
+    point_update_slice((MAX(point_chars_left, 0) + shards - 1) / shards,
+		       (MAX(point_objs_left, 0) + shards - 1) / shards);
+}
+
 /* Note: amt may be negative */
 int increase_gold(struct char_data *ch, int amt)
 {
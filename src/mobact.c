@@ -23,22 +23,56 @@
 #include "fight.h"
 
 
+/* Mob AI runs from a list of awake NPCs rather than all of character_list.
+ * An NPC with nothing of its own to do (no special procedure, no one to hunt
+ * or follow) in a zone with no players is parked on the zone's list instead.
+ * It wakes when a player enters the zone, when it changes rooms, or when one
+ * of its triggers runs.  With CONFIG_UNATTENDED_AI set to N, parked mobs are
+ * woken every Nth mobile pulse anyway. */
+static struct char_data *awake_mobs = NULL;
+static struct char_data *ai_cursor = NULL;  /* next mob mobile_activity() visits */
+static int num_awake_mobs = 0;
+static int num_parked_mobs = 0;
+static int ai_pulses = 0;
+
+struct mob_ai_stats mob_ai_stats;
+
 /* local file scope only function prototypes */
 static bool aggressive_mob_on_a_leash(struct char_data *slave, struct char_data *master, struct char_data *attack);
+static void ai_link(struct char_data **list, struct char_data *ch);
+static void ai_unlink(struct char_data **list, struct char_data *ch);
+static bool mob_can_park(struct char_data *ch);
+static void park_mob(struct char_data *ch);
 
 void mobile_activity(void)
 {
-  struct char_data *ch, *next_ch, *vict;
+  struct char_data *ch, *vict;
   struct obj_data *obj, *best_obj;
   int door, found, max;
+  bool unattended;
+  zone_rnum zone;
   memory_rec *names;
 
-  for (ch = character_list; ch; ch = next_ch) {
-    next_ch = ch->next;
+  unattended = CONFIG_UNATTENDED_AI > 0 && ++ai_pulses % CONFIG_UNATTENDED_AI == 0;
+  if (unattended)
+    for (zone = 0; zone <= top_of_zone_table; zone++)
+      wake_zone_mobs(zone);
+
+  mob_ai_stats.mobs = num_awake_mobs + num_parked_mobs;
+  mob_ai_stats.ran = 0;
+
+  for (ch = awake_mobs; ch; ch = ai_cursor) {
+    ai_cursor = ch->next_in_ai;
 
     if (!IS_MOB(ch))
       continue;
 
+    if (!unattended && mob_can_park(ch)) {
+      park_mob(ch);
+      continue;
+    }
+    mob_ai_stats.ran++;
+
     /* Examine call for special procedure */
     if (MOB_FLAGGED(ch, MOB_SPEC) && !no_specials) {
       if (mob_index[GET_MOB_RNUM(ch)].func == NULL) {
@@ -170,6 +204,92 @@ void mobile_activity(void)
     /* Add new mobile actions here */
 
   }				/* end for() */
+
+  ai_cursor = NULL;
+  mob_ai_stats.parked = num_parked_mobs;
+}
+
+static void ai_link(struct char_data **list, struct char_data *ch)
+{
+  ch->prev_in_ai = NULL;
+  ch->next_in_ai = *list;
+  if (*list)
+    (*list)->prev_in_ai = ch;
+  *list = ch;
+}
+
+static void ai_unlink(struct char_data **list, struct char_data *ch)
+{
+  if (ai_cursor == ch)
+    ai_cursor = ch->next_in_ai;
+  if (ch->prev_in_ai)
+    ch->prev_in_ai->next_in_ai = ch->next_in_ai;
+  else
+    *list = ch->next_in_ai;
+  if (ch->next_in_ai)
+    ch->next_in_ai->prev_in_ai = ch->prev_in_ai;
+  ch->next_in_ai = ch->prev_in_ai = NULL;
+}
+
+/* Would ch do nothing but wander and scavenge where no one can see it? */
+static bool mob_can_park(struct char_data *ch)
+{
+  if (MOB_FLAGGED(ch, MOB_SPEC) && !no_specials)
+    return (FALSE);
+  if (HUNTING(ch) || ch->master)
+    return (FALSE);
+  return (is_empty(world[IN_ROOM(ch)].zone));
+}
+
+static void park_mob(struct char_data *ch)
+{
+  ai_unlink(&awake_mobs, ch);
+  num_awake_mobs--;
+  ai_link(&zone_table[world[IN_ROOM(ch)].zone].parked_mobs, ch);
+  num_parked_mobs++;
+  ch->ai_state = MOB_AI_PARKED;
+}
+
+/** An NPC has been put in a room; it starts out awake. */
+void mob_ai_enter(struct char_data *ch)
+{
+  if (!IS_NPC(ch) || ch->ai_state != MOB_AI_OFF)
+    return;
+  ai_link(&awake_mobs, ch);
+  num_awake_mobs++;
+  ch->ai_state = MOB_AI_AWAKE;
+}
+
+/** An NPC is leaving its room.  Call before IN_ROOM() changes. */
+void mob_ai_leave(struct char_data *ch)
+{
+  if (ch->ai_state == MOB_AI_AWAKE) {
+    ai_unlink(&awake_mobs, ch);
+    num_awake_mobs--;
+  } else if (ch->ai_state == MOB_AI_PARKED) {
+    ai_unlink(&zone_table[world[IN_ROOM(ch)].zone].parked_mobs, ch);
+    num_parked_mobs--;
+  }
+  ch->ai_state = MOB_AI_OFF;
+}
+
+/** Something has happened to ch (a trigger ran) that it may want to act on. */
+void wake_mob(struct char_data *ch)
+{
+  if (ch->ai_state != MOB_AI_PARKED)
+    return;
+  ai_unlink(&zone_table[world[IN_ROOM(ch)].zone].parked_mobs, ch);
+  num_parked_mobs--;
+  ai_link(&awake_mobs, ch);
+  num_awake_mobs++;
+  ch->ai_state = MOB_AI_AWAKE;
+}
+
+/** Someone has come into the zone; everything parked there wakes up. */
+void wake_zone_mobs(zone_rnum zone)
+{
+  while (zone_table[zone].parked_mobs)
+    wake_mob(zone_table[zone].parked_mobs);
 }
 
 /* Mob Memory Routines */
@@ -7,11 +7,92 @@
 #include "sysdep.h"
 #include "structs.h"
 #include "utils.h"
+#include "db.h"
 #include "mysql_db.h"
+#include "mysql_players.h"
+#include "profiler.h"
+#include <errmsg.h>
+#include <mysqld_error.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+#define MYSQL_SAVE_THREAD
+#endif
+
+/* One connection in the pool and the statements prepared on it.  A slot is
+ * used by one thread at a time: whoever has it in_use. */
+struct mysql_pool_conn {
+  MYSQL *conn;
+  unsigned long thread_id;   /* server session; changes when the client reconnects */
+  bool in_use;
+  time_t last_used;
+  struct mysql_cached_stmt *stmts;
+  int num_stmts;
+  struct mysql_stmt_counters counters;
+};
+
+/* local functions */
+static MYSQL *open_mysql_conn(char *host, char *user, char *pass, char *db);
+static struct mysql_pool_conn *add_pool_conn(MYSQL *conn);
+static struct mysql_pool_conn *find_pool_conn(MYSQL *conn);
+static bool check_pool_conn(struct mysql_pool_conn *pc, bool force);
+static void flush_stmt_cache(struct mysql_pool_conn *pc);
+static struct mysql_cached_stmt *prepare_stmt(MYSQL *conn, const char *statement,
+  int num_parameters, const struct mysql_column *columns, int num_columns,
+  struct mysql_stmt_counters *counters);
+static struct mysql_cached_stmt *get_cached_stmt(struct mysql_pool_conn *pc, const char *statement,
+  int num_parameters, const struct mysql_column *columns, int num_columns);
+static void free_cached_stmt(struct mysql_cached_stmt *cs);
+static void bind_parameter(MYSQL_BIND *param_bind, struct mysql_parameter *param, unsigned long *length);
+static void free_save_job(struct mysql_save_job *job);
+static int write_save_rows(MYSQL *conn, struct mysql_save_stmt **rows, int num_stmts, int num_parameters);
+static bool write_save_batch(MYSQL *conn, struct mysql_save_job *batch);
+static void give_up_save_job(struct mysql_save_job *job);
 
 /* Global database connection */
 MYSQL *db_conn = NULL;
 struct mysql_connection_strings mysql_connection_strings;
+struct mysql_save_counters mysql_save_counters;
+
+static struct mysql_pool_conn mysql_pool[MYSQL_POOL_SIZE];
+
+#ifdef MYSQL_SAVE_THREAD
+/* Guards the in_use and conn fields of mysql_pool[]. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_POOL()	pthread_mutex_lock(&pool_lock)
+#define UNLOCK_POOL()	pthread_mutex_unlock(&pool_lock)
+#else
+#define LOCK_POOL()
+#define UNLOCK_POOL()
+#endif
+
+#ifdef MYSQL_SAVE_THREAD
+/* Save worker state.  Everything below is guarded by save_lock, and so are
+ * the counters in mysql_save_counters that write_save_batch() keeps. */
+static pthread_t save_thread;
+static pthread_key_t save_key;     /* set on the worker thread only */
+static bool save_key_made = FALSE;
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t save_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t save_done = PTHREAD_COND_INITIALIZER;
+static struct mysql_save_job *save_queue = NULL, *save_queue_tail = NULL;
+static struct mysql_save_job *save_running = NULL; /* batch being written */
+static bool save_worker_running = FALSE;
+static bool save_worker_stop = FALSE;
+/* What the worker logged, one string after another, for mysql_save_poll()
+ * to write out: log() is only safe on the game thread. */
+static char *save_log = NULL;
+static size_t save_log_len = 0, save_log_size = 0;
+#define LOCK_SAVE()	pthread_mutex_lock(&save_lock)
+#define UNLOCK_SAVE()	pthread_mutex_unlock(&save_lock)
+#else
+#define LOCK_SAVE()
+#define UNLOCK_SAVE()
+#endif
+
+/* Players whose save was given up, for mysql_save_poll() to hand to
+ * forget_player_db_state().  Guarded by save_lock. */
+static long *given_up_ids = NULL;
+static int num_given_up = 0, max_given_up = 0;
 
 void free_mysql_parameters(struct mysql_parameter *p, int num_parameters)
 {
@@ -158,37 +239,223 @@ int connect_primary_mysql_db()
   return TRUE;
 }
 
-void ping_mysql_database()
+/* Opens db_conn, which the main thread keeps out of the pool for good. */
+int create_mysql_conn(char *host, char *user, char *pass, char *db)
 {
-  mysql_ping(db_conn);
+  struct mysql_pool_conn *pc;
+  MYSQL *conn;
+
+  if (!(conn = open_mysql_conn(host, user, pass, db)))
+    return FALSE;
+
+  if (!(pc = add_pool_conn(conn))) {
+    mysql_close(conn);
+    return FALSE;
+  }
+  db_conn = conn;
+  return TRUE;
 }
 
-int create_mysql_conn(char *host, char *user, char *pass, char *db)
+/* Puts a freshly opened connection in a free slot, marked in use. */
+static struct mysql_pool_conn *add_pool_conn(MYSQL *conn)
+{
+  struct mysql_pool_conn *pc = NULL;
+  int i;
+
+  LOCK_POOL();
+  for (i = 0; i < MYSQL_POOL_SIZE; i++)
+    if (!mysql_pool[i].conn) {
+      pc = &mysql_pool[i];
+      pc->conn = conn;
+      pc->in_use = TRUE;
+      break;
+    }
+  UNLOCK_POOL();
+
+  if (!pc) {
+    log("MYSQLINFO: Connection pool is full (%d).", MYSQL_POOL_SIZE);
+    return NULL;
+  }
+  pc->thread_id = mysql_thread_id(conn);
+  pc->last_used = time(0);
+  return pc;
+}
+
+/* The pool slot of a connection its caller is using, or NULL. */
+static struct mysql_pool_conn *find_pool_conn(MYSQL *conn)
+{
+  struct mysql_pool_conn *pc = NULL;
+  int i;
+
+  LOCK_POOL();
+  for (i = 0; i < MYSQL_POOL_SIZE; i++)
+    if (mysql_pool[i].conn == conn) {
+      pc = &mysql_pool[i];
+      break;
+    }
+  UNLOCK_POOL();
+  return pc;
+}
+
+/* Borrows an idle connection, opening a new one if none is free. */
+MYSQL *mysql_pool_get(void)
+{
+  struct mysql_pool_conn *pc = NULL;
+  MYSQL *conn;
+  int i;
+
+  LOCK_POOL();
+  for (i = 0; i < MYSQL_POOL_SIZE; i++)
+    if (mysql_pool[i].conn && !mysql_pool[i].in_use) {
+      pc = &mysql_pool[i];
+      pc->in_use = TRUE;
+      break;
+    }
+  UNLOCK_POOL();
+
+  if (pc) {
+    if (!check_pool_conn(pc, FALSE))
+      log("MYSQLINFO: Pooled connection is down: %s", mysql_error(pc->conn));
+    return pc->conn;
+  }
+
+  if (!(conn = open_mysql_conn(MYSQL_HOST, MYSQL_USER, MYSQL_PASS, MYSQL_DB)))
+    return NULL;
+  if (!add_pool_conn(conn)) {
+    mysql_close(conn);
+    return NULL;
+  }
+  return conn;
+}
+
+void mysql_pool_put(MYSQL *conn)
+{
+  struct mysql_pool_conn *pc;
+
+  if (!(pc = find_pool_conn(conn)))
+    return;
+
+  LOCK_POOL();
+  pc->in_use = FALSE;
+  UNLOCK_POOL();
+}
+
+/* Health check for a connection its caller holds.  Pings it if it has been
+ * idle a while (or always, when forced); the client reconnects by itself if
+ * the server dropped the session, and then every statement prepared on the
+ * old session is gone. */
+static bool check_pool_conn(struct mysql_pool_conn *pc, bool force)
+{
+  time_t now = time(0);
+  unsigned long thread_id;
+  bool ok;
+
+  if (!force && now - pc->last_used < MYSQL_PING_IDLE_SECS) {
+    pc->last_used = now;
+    return TRUE;
+  }
+
+  pc->counters.pings++;
+  ok = !mysql_ping(pc->conn);
+  thread_id = mysql_thread_id(pc->conn);
+
+  if (!ok || thread_id != pc->thread_id) {
+    if (ok)
+      pc->counters.reconnects++;
+    flush_stmt_cache(pc);
+    pc->thread_id = thread_id;
+  }
+  pc->last_used = now;
+  return ok;
+}
+
+/* Pings db_conn and every idle pooled connection.  Called from heartbeat()
+ * so that no connection sits long enough to hit the server's wait_timeout. */
+void mysql_pool_keepalive(void)
+{
+  struct mysql_pool_conn *pc;
+  int i;
+
+  for (i = 0; i < MYSQL_POOL_SIZE; i++) {
+    pc = &mysql_pool[i];
+
+    LOCK_POOL();
+    if (!pc->conn || (pc->in_use && pc->conn != db_conn)) {
+      UNLOCK_POOL();
+      continue;
+    }
+    pc->in_use = TRUE;
+    UNLOCK_POOL();
+
+    if (!check_pool_conn(pc, TRUE))
+      log("MYSQLINFO: Keepalive ping failed: %s", mysql_error(pc->conn));
+
+    if (pc->conn != db_conn) {
+      LOCK_POOL();
+      pc->in_use = FALSE;
+      UNLOCK_POOL();
+    }
+  }
+}
+
+/* Sums the counters of every connection for "show dbstats". */
+void mysql_pool_counters(struct mysql_stmt_counters *sum, int *open, int *in_use)
+{
+  struct mysql_stmt_counters *c;
+  int i;
+
+  memset(sum, 0, sizeof(*sum));
+  *open = *in_use = 0;
+
+  LOCK_POOL();
+  for (i = 0; i < MYSQL_POOL_SIZE; i++) {
+    if (!mysql_pool[i].conn)
+      continue;
+    (*open)++;
+    if (mysql_pool[i].in_use)
+      (*in_use)++;
+    c = &mysql_pool[i].counters;
+    sum->hits += c->hits;
+    sum->misses += c->misses;
+    sum->evictions += c->evictions;
+    sum->flushes += c->flushes;
+    sum->pings += c->pings;
+    sum->reconnects += c->reconnects;
+    sum->prepare_usec += c->prepare_usec;
+  }
+  UNLOCK_POOL();
+}
+
+/* Opens a new connection; used for db_conn and for the save worker's own. */
+static MYSQL *open_mysql_conn(char *host, char *user, char *pass, char *db)
 {
   char buf[MAX_STRING_LENGTH];
+  MYSQL *conn;
 
-  if (!(db_conn = mysql_init(NULL)))
+  if (!(conn = mysql_init(NULL)))
   {
       snprintf(buf, sizeof(buf), "mysql_init() failed\n");
       log("MYSQLINFO: %s", buf);
-      return FALSE;
+      return NULL;
   }
 
   /* This doesn't seem to work to reconnect if a mysql_ping is called
    * before a mysql_query if disconnected (default wait_timeout is 28800 seconds
    * or 8 hours if you run the mysql query: show variables like '%timeout%').
    * What I do is call ping_mysql_database() every 5 minutes to keep
-   * it from timing out in the first place. -Cyric */
+   * it from timing out in the first place. -Cyric
+   * (That is mysql_pool_keepalive() now, and check_pool_conn() notices when
+   * a reconnect has thrown away the prepared statements.) */
   bool bool_arg = 1;
-  mysql_options(db_conn, MYSQL_OPT_RECONNECT, &bool_arg);
+  mysql_options(conn, MYSQL_OPT_RECONNECT, &bool_arg);
 
-  if (!mysql_real_connect(db_conn, host, user, pass, db, 0, NULL, 0))
+  if (!mysql_real_connect(conn, host, user, pass, db, 0, NULL, 0))
   {
-    close_mysqlcon_with_error(db_conn);
-    return FALSE;
+    close_mysqlcon_with_error(conn);
+    return NULL;
   }
 
-  return TRUE;
+  return conn;
 }
 
 void disconnect_primary_mysql_db()
@@ -196,13 +463,14 @@ void disconnect_primary_mysql_db()
   mysql_close(db_conn);
 }
 
-void bind_parameter(MYSQL_BIND *param_bind, struct mysql_parameter *param) {
+static void bind_parameter(MYSQL_BIND *param_bind, struct mysql_parameter *param, unsigned long *length) {
   if(param->data_type == MYSQL_TYPE_VAR_STRING) {
     param_bind->buffer_type = MYSQL_TYPE_VAR_STRING;
     param_bind->buffer = (char *) param->string_data;
     param_bind->buffer_length = strlen(param->string_data) + 1;
     param_bind->is_null = 0;
-    param_bind->length = (long unsigned *)&param->data_length;
+    *length = strlen(param->string_data);
+    param_bind->length = length;
   } else if (param->data_type == MYSQL_TYPE_LONG) {
     param_bind->buffer_type = MYSQL_TYPE_LONG;
     param_bind->buffer = (int *) &param->int_data;
@@ -211,148 +479,261 @@ void bind_parameter(MYSQL_BIND *param_bind, struct mysql_parameter *param) {
   // Add additional data types as needed
 }
 
-/* TODO: add the option to COMMIT/ROLLBACK multiple queries as a transaction */
-int query_stmt_mysql(MYSQL *conn, struct mysql_parameter *parameters, const struct mysql_column *columns,
-  char *statement, int num_columns, int num_parameters,
-  void (*load_function)(struct mysql_bind_column *, int, int, void *, MYSQL_STMT *stmt),
-  void *ch, int querytype)
+/* djb2, as used for the statement cache keys */
+static unsigned long hash_statement(const char *statement)
 {
-  MYSQL_STMT *stmt;
-  MYSQL_BIND *param_bind;
-  MYSQL_BIND *col_bind;
-  int status, i, num_rows;
-
-  // Allocate memory for the bindings
-  param_bind = (MYSQL_BIND *)malloc(sizeof(MYSQL_BIND) * num_parameters);
-  col_bind = (MYSQL_BIND *)malloc(sizeof(MYSQL_BIND) * num_columns);
-  //struct that receives the column values from col_bind
-  struct mysql_bind_column *col_values = (struct mysql_bind_column *)malloc(sizeof(struct mysql_bind_column) * num_columns);
-
-
-  if (!param_bind || !col_bind) {
-    log("Memory allocation error\n");
-    free(param_bind);
-    free(col_bind);
-    free(col_values);
-    return -1;
-  }
+  unsigned long hash = 5381;
 
-  /* initialize the prepared statement */
-  stmt = mysql_stmt_init(conn);
+  while (*statement)
+    hash = (hash << 5) + hash + (unsigned char) *statement++;
+  return hash;
+}
+
+/* Prepares statement and sets up its bind buffers.  The result columns are
+ * bound once here; the parameters are bound on every execution, since they
+ * point into the caller's mysql_parameter array. */
+static struct mysql_cached_stmt *prepare_stmt(MYSQL *conn, const char *statement,
+  int num_parameters, const struct mysql_column *columns, int num_columns,
+  struct mysql_stmt_counters *counters)
+{
+  struct mysql_cached_stmt *cs;
+  prof_time start;
+  int i, status;
 
-  if (!stmt)
+  CREATE(cs, struct mysql_cached_stmt, 1);
+
+  /* initialize the prepared statement */
+  if (!(cs->stmt = mysql_stmt_init(conn)))
   {
     log("MYSQLINFO: Could not initialize statement\n");
-    free(param_bind);
-    free(col_bind);
-    free(col_values);
-    return -1;
+    free(cs);
+    return NULL;
   }
 
   /* prepare the statement */
-  status = mysql_stmt_prepare(stmt, statement, strlen(statement));
-  test_stmt_error(stmt, status);
-
-  if(EXTRA_MYSQL_DEBUG_LOGS)
-    log("MYSQLINFO: prepared statement parameter count - %lu", mysql_stmt_param_count(stmt));
-
-  /* initialize the binding for the parameters (? in SQL statement) */
-  memset(param_bind, 0, sizeof(MYSQL_BIND) * num_parameters);
-
-  for(i = 0; i < num_parameters; i++) {
-    bind_parameter(&param_bind[i], &parameters[i]);
+  start = prof_now();
+  status = mysql_stmt_prepare(cs->stmt, statement, strlen(statement));
+  if (counters) {
+    counters->misses++;
+    counters->prepare_usec += prof_now() - start;
+  }
+  if (test_stmt_error(cs->stmt, status) < 0) {
+    mysql_stmt_close(cs->stmt);
+    free(cs);
+    return NULL;
   }
 
-  status = mysql_stmt_bind_param(stmt, param_bind);
-  test_stmt_error(stmt, status);
+  if(EXTRA_MYSQL_DEBUG_LOGS)
+    log("MYSQLINFO: prepared statement parameter count - %lu", mysql_stmt_param_count(cs->stmt));
 
-  /* set the param_bind[i].length to the length of the column name (via the address of parameters[i].data_length)
-     mysql wants this set after binding parameters */
-  for(i = 0; i < num_parameters; i++)
-  {
-    if(parameters[i].data_type == MYSQL_TYPE_VAR_STRING)
-      parameters[i].data_length = strlen(parameters[i].string_data);
+  cs->statement = strdup(statement);
+  cs->hash = hash_statement(statement);
+  cs->num_parameters = num_parameters;
+  cs->num_columns = num_columns;
+  if (num_parameters > 0) {
+    CREATE(cs->param_bind, MYSQL_BIND, num_parameters);
+    CREATE(cs->param_lengths, unsigned long, num_parameters);
   }
 
-  /* execute the statement now that it has its parameters defined */
-  status = mysql_stmt_execute(stmt);
-  test_stmt_error(stmt, status);
+  if (num_columns > 0) {
+    CREATE(cs->col_bind, MYSQL_BIND, num_columns);
+    //struct that receives the column values from col_bind
+    CREATE(cs->col_values, struct mysql_bind_column, num_columns);
 
-  if(querytype == MYSQL_QUERY_SELECT)
-  {
-    /* prepare the col_bind to receive the values of the query */
-    memset(col_bind,0,sizeof(MYSQL_BIND)*num_columns);
-   /* point the col_bind to the col_values which is our own structure to store these values in
-    */
+    /* point the col_bind to the col_values which is our own structure to store these values in
+     */
     for(i = 0; i < num_columns; i++)
     {
       /* store our column_name in our col_value structure (since it is not available in the bind data) */
-      strcpy(col_values[i].name, columns[i].column_name);
+      strlcpy(cs->col_values[i].name, columns[i].column_name, sizeof(cs->col_values[i].name));
 
       /* right now just either mysql var string or longs  */
       if(columns[i].data_type == MYSQL_TYPE_VAR_STRING)
       {
-        col_bind[i].buffer_type=MYSQL_TYPE_STRING;
-        col_bind[i].buffer=(char *) (col_values[i].col_string_buffer);
-        col_bind[i].buffer_length=4097;
-        col_bind[i].length = &col_values[i].buffer_length;
+        cs->col_bind[i].buffer_type=MYSQL_TYPE_STRING;
+        cs->col_bind[i].buffer=(char *) (cs->col_values[i].col_string_buffer);
+        cs->col_bind[i].buffer_length=MYSQL_COL_BUFFER_LENGTH;
+        cs->col_bind[i].length = &cs->col_values[i].buffer_length;
       }
       else
       {
-        col_bind[i].buffer_type=MYSQL_TYPE_LONG;
-        col_bind[i].buffer=(int *)(&col_values[i].col_int_buffer);
+        cs->col_bind[i].buffer_type=MYSQL_TYPE_LONG;
+        cs->col_bind[i].buffer=(int *)(&cs->col_values[i].col_int_buffer);
       }
-      col_bind[i].is_null = (bool *)(&col_values[i].is_null);
-      col_values[i].data_type = columns[i].data_type;
+      cs->col_bind[i].is_null = (bool *)(&cs->col_values[i].is_null);
+      cs->col_values[i].data_type = columns[i].data_type;
+    }
+  }
+  return cs;
+}
+
+static void free_cached_stmt(struct mysql_cached_stmt *cs)
+{
+  mysql_stmt_close(cs->stmt);
+  if (cs->statement)
+    free(cs->statement);
+  if (cs->param_bind)
+    free(cs->param_bind);
+  if (cs->param_lengths)
+    free(cs->param_lengths);
+  if (cs->col_bind)
+    free(cs->col_bind);
+  if (cs->col_values)
+    free(cs->col_values);
+  free(cs);
+}
+
+/* Drops every statement prepared on a connection. */
+static void flush_stmt_cache(struct mysql_pool_conn *pc)
+{
+  struct mysql_cached_stmt *cs, *next_cs;
+
+  if (pc->stmts)
+    pc->counters.flushes++;
+  for (cs = pc->stmts; cs; cs = next_cs) {
+    next_cs = cs->next;
+    free_cached_stmt(cs);
+  }
+  pc->stmts = NULL;
+  pc->num_stmts = 0;
+}
+
+/* Finds statement in the connection's cache, moving it to the front, or
+ * prepares and adds it, dropping the least recently used one if full. */
+static struct mysql_cached_stmt *get_cached_stmt(struct mysql_pool_conn *pc, const char *statement,
+  int num_parameters, const struct mysql_column *columns, int num_columns)
+{
+  struct mysql_cached_stmt *cs, *prev = NULL;
+  unsigned long hash = hash_statement(statement);
+
+  for (cs = pc->stmts; cs; prev = cs, cs = cs->next) {
+    if (cs->hash != hash || cs->num_parameters != num_parameters ||
+        cs->num_columns != num_columns || strcmp(cs->statement, statement))
+      continue;
+    if (prev) {
+      prev->next = cs->next;
+      cs->next = pc->stmts;
+      pc->stmts = cs;
     }
+    pc->counters.hits++;
+    return cs;
+  }
+
+  if (!(cs = prepare_stmt(pc->conn, statement, num_parameters, columns, num_columns, &pc->counters)))
+    return NULL;
+
+  if (pc->num_stmts >= MYSQL_STMT_CACHE_SIZE) {
+    for (prev = pc->stmts; prev->next->next; prev = prev->next)
+      ;
+    free_cached_stmt(prev->next);
+    prev->next = NULL;
+    pc->num_stmts--;
+    pc->counters.evictions++;
+  }
+  cs->next = pc->stmts;
+  pc->stmts = cs;
+  pc->num_stmts++;
+  return cs;
+}
+
+/* TODO: add the option to COMMIT/ROLLBACK multiple queries as a transaction */
+int query_stmt_mysql(MYSQL *conn, struct mysql_parameter *parameters, const struct mysql_column *columns,
+  char *statement, int num_columns, int num_parameters,
+  void (*load_function)(struct mysql_bind_column *, int, int, void *, MYSQL_STMT *stmt),
+  void *ch, int querytype)
+{
+  struct mysql_pool_conn *pc;
+  struct mysql_cached_stmt *cs;
+  MYSQL_STMT *stmt;
+  int status, i, num_rows, retried = FALSE, ret = 1;
 
+  if (querytype != MYSQL_QUERY_SELECT)
+    num_columns = 0;
+
+  /* Connections outside the pool get a statement of their own each time. */
+  if ((pc = find_pool_conn(conn)) != NULL) {
+    check_pool_conn(pc, FALSE);
+    cs = get_cached_stmt(pc, statement, num_parameters, columns, num_columns);
+  } else
+    cs = prepare_stmt(conn, statement, num_parameters, columns, num_columns, NULL);
+
+  if (!cs)
+    return -1;
+
+  for (;;) {
+    stmt = cs->stmt;
+
+    /* initialize the binding for the parameters (? in SQL statement) */
+    for(i = 0; i < num_parameters; i++) {
+      bind_parameter(&cs->param_bind[i], &parameters[i], &cs->param_lengths[i]);
+    }
+
+    status = mysql_stmt_bind_param(stmt, cs->param_bind);
+    if (test_stmt_error(stmt, status) < 0) {
+      ret = -1;
+      break;
+    }
+
+    /* execute the statement now that it has its parameters defined */
+    status = mysql_stmt_execute(stmt);
+
+    /* A handle the server no longer knows about, or a connection that was
+     * gone before the statement was sent: nothing ran, so prepare it again
+     * on a checked connection and retry once. */
+    if (status && pc && !retried &&
+        (mysql_stmt_errno(stmt) == ER_UNKNOWN_STMT_HANDLER ||
+         mysql_stmt_errno(stmt) == CR_SERVER_GONE_ERROR)) {
+      log("MYSQLINFO: Statement lost (%s), preparing it again.", mysql_stmt_error(stmt));
+      retried = TRUE;
+      check_pool_conn(pc, TRUE);
+      flush_stmt_cache(pc);
+      if (!(cs = get_cached_stmt(pc, statement, num_parameters, columns, num_columns)))
+        return -1;
+      continue;
+    }
+    if (test_stmt_error(stmt, status) < 0)
+      ret = -1;
+    break;
+  }
+
+  if(ret > 0 && querytype == MYSQL_QUERY_SELECT)
+  {
     /* now actually bind the result values of the query to col_bind which also fills col_values */
-    if (mysql_stmt_bind_result(stmt, col_bind))
+    if (mysql_stmt_bind_result(stmt, cs->col_bind))
     {
       log("MYSQLINFO: mysql_stmt_bind_result() failed %s\n", mysql_stmt_error(stmt));
-      free(param_bind);
-      free(col_bind);
-      free(col_values);
-      return -1;
+      ret = -1;
     }
-
     /* Buffer all results to client */
-    if (mysql_stmt_store_result(stmt))
+    else if (mysql_stmt_store_result(stmt))
     {
       fprintf(stderr, " mysql_stmt_store_result() failed\n%s\n", mysql_stmt_error(stmt));
-      free(param_bind);
-      free(col_bind);
-      free(col_values);
-      return (-1);
+      ret = -1;
     }
-    num_rows = mysql_stmt_num_rows(stmt);
+    else
+    {
+      num_rows = mysql_stmt_num_rows(stmt);
 
-    if(EXTRA_MYSQL_DEBUG_LOGS)
-      log("MYSQLINFO: Rows selected: %d", num_rows);
+      if(EXTRA_MYSQL_DEBUG_LOGS)
+        log("MYSQLINFO: Rows selected: %d", num_rows);
 
-    load_function(col_values, num_columns, num_rows, ch, stmt);
+      load_function(cs->col_values, num_columns, num_rows, ch, stmt);
 
-    if (mysql_stmt_free_result(stmt))
-    {
-      fprintf(stderr, " mysql_stmt_free_result() failed!\n%s\n", mysql_stmt_error(stmt));
-      free(param_bind);
-      free(col_bind);
-      free(col_values);
-      return (-1);
+      if (mysql_stmt_free_result(stmt))
+      {
+        fprintf(stderr, " mysql_stmt_free_result() failed!\n%s\n", mysql_stmt_error(stmt));
+        ret = -1;
+      }
     }
   }
 
-  /* Close the statement */
-  if (mysql_stmt_close(stmt))
-  {
-    /* mysql_stmt_close() invalidates stmt, so call          */
-    /* mysql_error(mysql) rather than mysql_stmt_error(stmt) */
-    test_error(conn, status);
-  }
-  free(param_bind);
-  free(col_bind);
-  free(col_values);
-  return 1;
+  /* Statements outside the cache are closed as before. */
+  if (!pc)
+    free_cached_stmt(cs);
+  else if (ret < 0)
+    mysql_stmt_reset(stmt);
+
+  return ret;
 }
 
 int test_error(MYSQL *mysql, int status)
@@ -415,3 +796,518 @@ void create_mud_db_tables()
     }
   }
 }
+
+struct mysql_save_job *mysql_save_job_create(long id)
+{
+  struct mysql_save_job *job;
+
+  CREATE(job, struct mysql_save_job, 1);
+  job->id = id;
+  return job;
+}
+
+static void add_save_stmt(struct mysql_save_job *job, struct mysql_save_stmt *stmt)
+{
+  if (job->last_stmt)
+    job->last_stmt->next = stmt;
+  else
+    job->stmts = stmt;
+  job->last_stmt = stmt;
+}
+
+/* Queues a complete statement.  The job takes ownership of parameters. */
+void mysql_save_job_add(struct mysql_save_job *job, const char *statement,
+  struct mysql_parameter *parameters, int num_parameters)
+{
+  struct mysql_save_stmt *stmt;
+
+  CREATE(stmt, struct mysql_save_stmt, 1);
+  stmt->statement = strdup(statement);
+  stmt->parameters = parameters;
+  stmt->num_parameters = num_parameters;
+  add_save_stmt(job, stmt);
+}
+
+/* Queues num_rows rows for insert, an "INSERT INTO db.table (cols) VALUES"
+ * without markers.  The markers are added when the batch is written, so the
+ * rows of several players can go out in one statement.  The job takes
+ * ownership of parameters. */
+void mysql_save_job_add_rows(struct mysql_save_job *job, const char *insert,
+  struct mysql_parameter *parameters, int num_columns, int num_rows)
+{
+  struct mysql_save_stmt *stmt;
+
+  CREATE(stmt, struct mysql_save_stmt, 1);
+  stmt->statement = strdup(insert);
+  stmt->parameters = parameters;
+  stmt->num_parameters = num_columns * num_rows;
+  stmt->num_columns = num_columns;
+  add_save_stmt(job, stmt);
+}
+
+static void free_save_job(struct mysql_save_job *job)
+{
+  struct mysql_save_stmt *stmt, *next_stmt;
+
+  for (stmt = job->stmts; stmt; stmt = next_stmt) {
+    next_stmt = stmt->next;
+    free_mysql_parameters(stmt->parameters, stmt->num_parameters);
+    free(stmt->statement);
+    free(stmt);
+  }
+  free(job);
+}
+
+/* Writes one merged INSERT for rows[0..num_stmts-1], which all share the same
+ * statement and column count.  Returns what query_stmt_mysql() did. */
+static int write_save_rows(MYSQL *conn, struct mysql_save_stmt **rows, int num_stmts, int num_parameters)
+{
+  struct mysql_parameter *parameters;
+  char *sql_buf;
+  size_t buf_size;
+  int i, num_columns = rows[0]->num_columns, offset = 0, ret;
+
+  /* Each marker is at most "?, " plus " (" and "), " around each row. */
+  buf_size = strlen(rows[0]->statement) + num_parameters * 3 + (num_parameters / num_columns) * 5 + 1;
+  CREATE(sql_buf, char, buf_size);
+  strcpy(sql_buf, rows[0]->statement);
+  get_parameter_markers_sql(sql_buf, buf_size, num_columns, num_parameters / num_columns);
+
+  /* Shallow copies; the strings still belong to the queued statements. */
+  CREATE(parameters, struct mysql_parameter, num_parameters);
+  for (i = 0; i < num_stmts; i++) {
+    memcpy(parameters + offset, rows[i]->parameters, sizeof(struct mysql_parameter) * rows[i]->num_parameters);
+    offset += rows[i]->num_parameters;
+  }
+
+  ret = query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, NULL, MYSQL_QUERY_INSERT);
+
+  free(parameters);
+  free(sql_buf);
+  return ret;
+}
+
+/* Writes a list of jobs inside one transaction.  Plain statements run first,
+ * in order, so each player's deletes come before any of the inserts.  Row
+ * inserts into the same table are then merged into multi-row INSERTs of up to
+ * MYSQL_SAVE_MAX_BATCH_PARAMS placeholders.  A batch never holds two jobs for
+ * the same player.  If any statement fails the whole batch is rolled back,
+ * so no player is left half written, and FALSE is returned. */
+static bool write_save_batch(MYSQL *conn, struct mysql_save_job *batch)
+{
+  struct mysql_save_job *job;
+  struct mysql_save_stmt *stmt, **rows, **group;
+  int i, j, num_rows = 0, num_group, num_parameters, num_jobs = 0, num_statements = 0;
+  bool ok = TRUE;
+
+  if (mysql_query(conn, "START TRANSACTION")) {
+    log("MYSQLINFO: START TRANSACTION failed, %s", mysql_error(conn));
+    ok = FALSE;
+  }
+
+  for (job = batch; job; job = job->next) {
+    num_jobs++;
+    for (stmt = job->stmts; ok && stmt; stmt = stmt->next) {
+      if (stmt->num_columns > 0) {
+        if (stmt->num_parameters > 0)
+          num_rows++;
+        continue;
+      }
+      num_statements++;
+      if (query_stmt_mysql(conn, stmt->parameters, NULL, stmt->statement, 0, stmt->num_parameters,
+            NULL, NULL, MYSQL_QUERY_UPDATE) < 0)
+        ok = FALSE;
+    }
+  }
+
+  if (ok && num_rows > 0) {
+    CREATE(rows, struct mysql_save_stmt *, num_rows);
+    CREATE(group, struct mysql_save_stmt *, num_rows);
+    i = 0;
+    for (job = batch; job; job = job->next)
+      for (stmt = job->stmts; stmt; stmt = stmt->next)
+        if (stmt->num_columns > 0 && stmt->num_parameters > 0)
+          rows[i++] = stmt;
+
+    for (i = 0; ok && i < num_rows; i++) {
+      if (!rows[i])
+        continue;
+      group[0] = rows[i];
+      num_group = 1;
+      num_parameters = rows[i]->num_parameters;
+      rows[i] = NULL;
+
+      for (j = i + 1; j < num_rows; j++) {
+        if (!rows[j] || rows[j]->num_columns != group[0]->num_columns ||
+            strcmp(rows[j]->statement, group[0]->statement))
+          continue;
+        if (num_parameters + rows[j]->num_parameters > MYSQL_SAVE_MAX_BATCH_PARAMS)
+          continue;
+        group[num_group++] = rows[j];
+        num_parameters += rows[j]->num_parameters;
+        rows[j] = NULL;
+      }
+      num_statements++;
+      if (write_save_rows(conn, group, num_group, num_parameters) < 0)
+        ok = FALSE;
+    }
+    free(group);
+    free(rows);
+  }
+
+  if (ok && mysql_query(conn, "COMMIT")) {
+    log("MYSQLINFO: COMMIT failed, %s", mysql_error(conn));
+    ok = FALSE;
+  }
+  if (!ok && mysql_query(conn, "ROLLBACK"))
+    log("MYSQLINFO: ROLLBACK failed, %s", mysql_error(conn));
+
+  LOCK_SAVE();
+  mysql_save_counters.batches++;
+  mysql_save_counters.jobs += num_jobs;
+  mysql_save_counters.statements += num_statements;
+  if (!ok)
+    mysql_save_counters.failed_batches++;
+  UNLOCK_SAVE();
+
+  return ok;
+}
+
+/* A job has failed MYSQL_SAVE_MAX_ATTEMPTS times; stop trying. */
+static void give_up_save_job(struct mysql_save_job *job)
+{
+  log("MYSQLINFO: Giving up on a save of player %ld after %d attempts.", job->id, job->attempts);
+
+  LOCK_SAVE();
+  mysql_save_counters.dropped_jobs++;
+  if (num_given_up == max_given_up) {
+    max_given_up = MAX(max_given_up * 2, 8);
+    RECREATE(given_up_ids, long, max_given_up);
+  }
+  given_up_ids[num_given_up++] = job->id;
+  UNLOCK_SAVE();
+
+  free_save_job(job);
+}
+
+#ifdef MYSQL_SAVE_THREAD
+/* Is a job for player id queued or being written?  Call with save_lock held. */
+static bool save_job_pending(long id)
+{
+  struct mysql_save_job *job;
+
+  for (job = save_running; job; job = job->next)
+    if (job->id == id)
+      return TRUE;
+  for (job = save_queue; job; job = job->next)
+    if (job->id == id)
+      return TRUE;
+  return FALSE;
+}
+
+/* Puts a batch that failed back at the head of the queue, in order, less
+ * the jobs that have run out of attempts; those are returned in *dropped.
+ * Call with save_lock held. */
+static void requeue_save_batch(struct mysql_save_job *batch, struct mysql_save_job **dropped)
+{
+  struct mysql_save_job *job, *next_job, *head = NULL, *tail = NULL;
+
+  *dropped = NULL;
+  for (job = batch; job; job = next_job) {
+    next_job = job->next;
+    if (++job->attempts >= MYSQL_SAVE_MAX_ATTEMPTS) {
+      job->next = *dropped;
+      *dropped = job;
+      continue;
+    }
+    job->next = NULL;
+    if (tail)
+      tail->next = job;
+    else
+      head = job;
+    tail = job;
+  }
+
+  if (!head)
+    return;
+  tail->next = save_queue;
+  save_queue = head;
+  if (!save_queue_tail)
+    save_queue_tail = tail;
+}
+
+static void *mysql_save_worker(void *arg)
+{
+  struct mysql_save_job *batch, *job, *last, *next_job, *dropped;
+  struct timespec until;
+  MYSQL *conn;
+  bool ok;
+
+  mysql_thread_init();
+  pthread_setspecific(save_key, &save_key);
+  pthread_mutex_lock(&save_lock);
+  for (;;) {
+    while (!save_queue && !save_worker_stop)
+      pthread_cond_wait(&save_wake, &save_lock);
+    if (!save_queue)
+      break;
+
+    /* Take jobs from the front of the queue until a player repeats; the
+     * second save of that player waits for the next batch.  A job that has
+     * failed before goes alone, so that it cannot hold up the others. */
+    batch = last = save_queue;
+    for (job = save_queue->next; job && !batch->attempts; last = job, job = job->next) {
+      if (job->attempts)
+        break;
+      for (next_job = batch; next_job != job; next_job = next_job->next)
+        if (next_job->id == job->id)
+          break;
+      if (next_job != job)
+        break;
+    }
+    save_queue = last->next;
+    if (!save_queue)
+      save_queue_tail = NULL;
+    last->next = NULL;
+    save_running = batch;
+    pthread_mutex_unlock(&save_lock);
+
+    if ((conn = mysql_pool_get()) != NULL) {
+      ok = write_save_batch(conn, batch);
+      mysql_pool_put(conn);
+    } else {
+      log("MYSQLINFO: Save worker has no connection; player saves will be retried.");
+      ok = FALSE;
+    }
+
+    pthread_mutex_lock(&save_lock);
+    save_running = NULL;
+    dropped = NULL;
+    if (!ok)
+      requeue_save_batch(batch, &dropped);
+    pthread_cond_broadcast(&save_done);
+    pthread_mutex_unlock(&save_lock);
+
+    if (ok)
+      for (job = batch; job; job = next_job) {
+        next_job = job->next;
+        free_save_job(job);
+      }
+    for (job = dropped; job; job = next_job) {
+      next_job = job->next;
+      give_up_save_job(job);
+    }
+
+    pthread_mutex_lock(&save_lock);
+    /* Give the database a moment before trying again, unless shutting down. */
+    if (!ok) {
+      until.tv_sec = time(0) + MYSQL_SAVE_RETRY_SECS;
+      until.tv_nsec = 0;
+      while (!save_worker_stop && time(0) < until.tv_sec)
+        pthread_cond_timedwait(&save_wake, &save_lock, &until);
+    }
+  }
+  pthread_mutex_unlock(&save_lock);
+  mysql_thread_end();
+  return NULL;
+}
+#endif
+
+/* Hands a finished job to the save worker, or writes it right away when
+ * there is no worker.  An empty job is just freed. */
+void mysql_save_job_submit(struct mysql_save_job *job)
+{
+  /* nothing changed since the last save */
+  if (!job->stmts) {
+    free_save_job(job);
+    return;
+  }
+
+#ifdef MYSQL_SAVE_THREAD
+  if (save_worker_running) {
+    pthread_mutex_lock(&save_lock);
+    if (save_queue_tail)
+      save_queue_tail->next = job;
+    else
+      save_queue = job;
+    save_queue_tail = job;
+    pthread_cond_signal(&save_wake);
+    pthread_mutex_unlock(&save_lock);
+    return;
+  }
+#endif
+  /* Without the worker there is no one to retry later: try again now. */
+  while (!write_save_batch(db_conn, job))
+    if (++job->attempts >= MYSQL_SAVE_MAX_ATTEMPTS) {
+      give_up_save_job(job);
+      return;
+    }
+  free_save_job(job);
+}
+
+/* Blocks until nothing is queued for player id, so a load sees the last save. */
+void mysql_save_wait_for(long id)
+{
+#ifdef MYSQL_SAVE_THREAD
+  if (!save_worker_running)
+    return;
+
+  pthread_mutex_lock(&save_lock);
+  while (save_job_pending(id))
+    pthread_cond_wait(&save_done, &save_lock);
+  pthread_mutex_unlock(&save_lock);
+#endif
+}
+
+/* Blocks until every queued save is written.  Used before shutdown and copyover. */
+void mysql_save_flush(void)
+{
+#ifdef MYSQL_SAVE_THREAD
+  if (!save_worker_running)
+    return;
+
+  pthread_mutex_lock(&save_lock);
+  while (save_queue || save_running)
+    pthread_cond_wait(&save_done, &save_lock);
+  pthread_mutex_unlock(&save_lock);
+  mysql_save_poll();
+#endif
+}
+
+/* The counters, with the ones the save worker keeps read under its lock. */
+void mysql_save_counters_copy(struct mysql_save_counters *copy)
+{
+  LOCK_SAVE();
+  *copy = mysql_save_counters;
+  UNLOCK_SAVE();
+}
+
+/** Called by basic_mud_vlog().  What the save worker logs is kept for
+ * mysql_save_poll() to write out on the game thread.
+ * @retval int TRUE if the message was kept, FALSE if it should be logged. */
+int mysql_save_log_capture(const char *format, va_list args)
+{
+#ifdef MYSQL_SAVE_THREAD
+  char msg[MAX_STRING_LENGTH];
+  size_t len;
+
+  if (!save_key_made || !pthread_getspecific(save_key))
+    return (FALSE);
+
+  vsnprintf(msg, sizeof(msg), format, args);
+  len = strlen(msg) + 1;
+
+  pthread_mutex_lock(&save_lock);
+  if (save_log_len + len > save_log_size) {
+    save_log_size = MAX(save_log_size * 2, save_log_len + len);
+    RECREATE(save_log, char, save_log_size);
+  }
+  memcpy(save_log + save_log_len, msg, len);
+  save_log_len += len;
+  pthread_mutex_unlock(&save_lock);
+
+  return (TRUE);
+#else
+  return (FALSE);
+#endif
+}
+
+/** Called from heartbeat() every second: log what the save worker has
+ * logged since the last call, and make sure the players whose saves were
+ * given up are saved in full next time. */
+void mysql_save_poll(void)
+{
+  long *ids;
+  int i, num_ids;
+#ifdef MYSQL_SAVE_THREAD
+  char *messages, *msg;
+  size_t len;
+
+  pthread_mutex_lock(&save_lock);
+  messages = save_log;
+  len = save_log_len;
+  save_log = NULL;
+  save_log_len = save_log_size = 0;
+  pthread_mutex_unlock(&save_lock);
+
+  if (messages) {
+    for (msg = messages; msg < messages + len; msg += strlen(msg) + 1)
+      log("%s", msg);
+    free(messages);
+  }
+#endif
+
+  LOCK_SAVE();
+  ids = given_up_ids;
+  num_ids = num_given_up;
+  given_up_ids = NULL;
+  num_given_up = max_given_up = 0;
+  UNLOCK_SAVE();
+
+  for (i = 0; i < num_ids; i++)
+    forget_player_db_state(ids[i]);
+  if (ids)
+    free(ids);
+}
+
+void start_mysql_save_worker(void)
+{
+#ifdef MYSQL_SAVE_THREAD
+  sigset_t all, old;
+  MYSQL *conn;
+  int err;
+
+  if (save_worker_running)
+    return;
+
+  /* Open the worker's connection now; it borrows it back for each batch. */
+  if (!(conn = mysql_pool_get())) {
+    log("MYSQLINFO: Save worker could not connect; player saves will be synchronous.");
+    return;
+  }
+  mysql_pool_put(conn);
+
+  if (!save_key_made) {
+    if ((err = pthread_key_create(&save_key, NULL)) != 0) {
+      log("SYSERR: pthread_key_create: %s; player saves will be synchronous.", strerror(err));
+      return;
+    }
+    save_key_made = TRUE;
+  }
+
+  /* Signals are for the game loop; the worker starts with all of them blocked. */
+  save_worker_stop = FALSE;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  err = pthread_create(&save_thread, NULL, mysql_save_worker, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (err) {
+    log("SYSERR: pthread_create: %s; player saves will be synchronous.", strerror(err));
+    return;
+  }
+  save_worker_running = TRUE;
+  log("MYSQLINFO: Player save worker started.");
+#else
+  log("MYSQLINFO: No thread support; player saves will be synchronous.");
+#endif
+}
+
+/* Writes everything still queued, then stops the worker. */
+void stop_mysql_save_worker(void)
+{
+#ifdef MYSQL_SAVE_THREAD
+  if (!save_worker_running)
+    return;
+
+  pthread_mutex_lock(&save_lock);
+  save_worker_stop = TRUE;
+  pthread_cond_signal(&save_wake);
+  pthread_mutex_unlock(&save_lock);
+
+  pthread_join(save_thread, NULL);
+  save_worker_running = FALSE;
+  mysql_save_poll();
+  log("MYSQLINFO: Player save worker stopped.");
+#endif
+}
@@ -57,9 +57,12 @@ struct mysql_parameter {
   int data_length;
 };
 
+/* Room for the largest string column (varchar(4096)) and its terminator. */
+#define MYSQL_COL_BUFFER_LENGTH 4097
+
 struct mysql_bind_column {
   char name[MAX_INPUT_LENGTH];
-  char col_string_buffer[MAX_INPUT_LENGTH];
+  char col_string_buffer[MYSQL_COL_BUFFER_LENGTH];
   int col_int_buffer;
   int is_null;
   unsigned long col_length;
@@ -77,7 +80,6 @@ void free_mysql_parameters(struct mysql_parameter *p, int num_parameters);
 int get_column_sql(char *buf, size_t buf_size, const struct mysql_column *cb);
 int get_column_update_sql(char *buf, size_t buf_size, const struct mysql_column *cb);
 int get_parameter_markers_sql(char *buf, size_t buf_size, int num_columns, int num_rows);
-void ping_mysql_database();
 
 /* Global database connection */
 extern MYSQL *db_conn;
@@ -85,7 +87,84 @@ void close_mysqlcon_with_error(MYSQL *conn);
 void create_mud_db_tables();
 int connect_primary_mysql_db();
 int create_mysql_conn(char *host, char *user, char *pass, char *db);
-void ping_mysql_database();
+
+/* Connection pool and prepared statement cache.  Every connection comes from
+ * a small pool and keeps the statements prepared on it, keyed by SQL text,
+ * together with their bind buffers, so a query whose text has been seen
+ * before skips mysql_stmt_prepare() and all of its allocations.  db_conn is
+ * held by the main thread for good; the save worker borrows a connection
+ * for each batch.  A connection idle for MYSQL_PING_IDLE_SECS is pinged
+ * before its next use, and its statements are dropped if the client had to
+ * reconnect, since the server forgets them with the old session. */
+#define MYSQL_POOL_SIZE        4   /* connections, db_conn included */
+#define MYSQL_STMT_CACHE_SIZE  64  /* statements kept per connection */
+#define MYSQL_PING_IDLE_SECS   300
+
+struct mysql_cached_stmt {
+  char *statement;
+  unsigned long hash;
+  MYSQL_STMT *stmt;
+  MYSQL_BIND *param_bind;
+  unsigned long *param_lengths;
+  int num_parameters;
+  MYSQL_BIND *col_bind;
+  struct mysql_bind_column *col_values;
+  int num_columns;
+  struct mysql_cached_stmt *next;   /* most recently used first */
+};
+
+/* Totals for "show dbstats", kept per connection and summed for display. */
+struct mysql_stmt_counters {
+  long hits;              /* statements found in the cache */
+  long misses;            /* ... and prepared */
+  long evictions;         /* dropped to make room */
+  long flushes;           /* caches dropped after a reconnect or lost handle */
+  long pings;
+  long reconnects;
+  long prepare_usec;      /* time spent in mysql_stmt_prepare() */
+};
+
+MYSQL *mysql_pool_get(void);
+void mysql_pool_put(MYSQL *conn);
+void mysql_pool_keepalive(void);
+void mysql_pool_counters(struct mysql_stmt_counters *sum, int *open, int *in_use);
+
+/* Write-behind player saves.  A save builds a mysql_save_job holding every
+ * statement it needs, with parameters copied out of the char_data, and hands
+ * it to a worker thread that writes it on its own connection.  Rows added
+ * with mysql_save_job_add_rows() are merged with the same INSERT from other
+ * jobs in the batch.  Without pthreads jobs run at once on db_conn.  A batch
+ * that fails is rolled back and its jobs are tried again, one at a time. */
+#define MYSQL_SAVE_MAX_BATCH_PARAMS 8192 /* placeholders in one merged INSERT */
+#define MYSQL_SAVE_MAX_ATTEMPTS 3     /* tries at a job before it is given up */
+#define MYSQL_SAVE_RETRY_SECS   2     /* wait after a failed batch */
+
+struct mysql_save_stmt {
+  char *statement;        /* whole statement, or the INSERT up to VALUES */
+  struct mysql_parameter *parameters;
+  int num_parameters;
+  int num_columns;        /* > 0 for row inserts that may be merged */
+  struct mysql_save_stmt *next;
+};
+
+struct mysql_save_job {
+  long id;                /* player idnum, one job per player in a batch */
+  int attempts;           /* failed writes so far */
+  struct mysql_save_stmt *stmts;
+  struct mysql_save_stmt *last_stmt;
+  struct mysql_save_job *next;
+};
+
+struct mysql_save_job *mysql_save_job_create(long id);
+void mysql_save_job_add(struct mysql_save_job *job, const char *statement,
+  struct mysql_parameter *parameters, int num_parameters);
+void mysql_save_job_add_rows(struct mysql_save_job *job, const char *insert,
+  struct mysql_parameter *parameters, int num_columns, int num_rows);
+void mysql_save_job_submit(struct mysql_save_job *job);
+void mysql_save_wait_for(long id);
+void mysql_save_flush(void);
+void start_mysql_save_worker(void);
+void stop_mysql_save_worker(void);
 
 /* use mysql database instead of ascii pfiles */
 #define USING_MYSQL_DATABASE_FOR_PLAYERFILE 1
@@ -97,9 +176,61 @@ typedef enum
   PLAYER_ARRAY_COOLDOWNS,
   PLAYER_ARRAY_KILLS,
   PLAYER_ARRAY_FEATS,
-  PLAYER_ARRAY_MEMORIZATION
+  PLAYER_ARRAY_MEMORIZATION,
+  NUM_PLAYER_ARRAY_TYPES
 } PlayerArrayTypes;
 
+/* Dirty tracking for player saves.  Each character keeps the values last
+ * loaded from or queued to the database.  A save diffs against them, builds
+ * a bitmap of changed playerfile columns and a mask of changed array types,
+ * and writes only those.  Anything not yet known is treated as changed.
+ * Failed writes are retried; if a save is given up in the end, the player's
+ * state is thrown away (forget_player_db_state()) so the next save is a
+ * full one. */
+#define MAX_PLAYERFILE_COLUMNS 128
+#define PF_COLUMN_ARRAY_MAX    (MAX_PLAYERFILE_COLUMNS / 32)
+
+/* Array ids in a player_arrays diff above this are rewritten whole. */
+#define MAX_ARRAY_DIFF_DELETES 256
+
+struct mysql_array_row {
+  int array_id;
+  int value;
+};
+
+struct mysql_player_state {
+  int known_columns[PF_COLUMN_ARRAY_MAX];
+  int int_values[MAX_PLAYERFILE_COLUMNS];
+  char *string_values[MAX_PLAYERFILE_COLUMNS];
+
+  int known_arrays;       /* (1 << type) for each PlayerArrayTypes loaded */
+  struct mysql_array_row *arrays[NUM_PLAYER_ARRAY_TYPES];
+  int num_array_rows[NUM_PLAYER_ARRAY_TYPES];
+
+  bool vars_known;
+  bool aliases_known;
+  unsigned long vars_hash;
+  unsigned long aliases_hash;
+};
+
+/* Totals for "show dbstats". */
+struct mysql_save_counters {
+  long saves;             /* save jobs built */
+  long empty_saves;       /* ... that found nothing to write */
+  long rows_written;      /* rows inserted or updated */
+  long last_rows_written; /* by the most recent save */
+  long columns_updated;   /* playerfile columns in UPDATEs */
+  long delete_statements;
+  long batches;           /* written by the save worker */
+  long jobs;
+  long statements;        /* statements sent, after merging inserts */
+  long failed_batches;    /* rolled back */
+  long dropped_jobs;      /* saves given up after MYSQL_SAVE_MAX_ATTEMPTS */
+};
+
+extern struct mysql_save_counters mysql_save_counters;
+void mysql_save_counters_copy(struct mysql_save_counters *copy);
+
 /* TODO: triggers */
 #define CREATE_PLAYERFILE_TABLE "CREATE TABLE IF NOT EXISTS `%s`.`%s` ( \
   `ID` int(11) NOT NULL, \
@@ -32,8 +32,8 @@
 
 /* local functions */
 static void load_affects(char *affects_str, struct char_data *ch);
-static void insert_player_vars_mysql(MYSQL *conn, struct char_data *ch);
-static void insert_aliases_mysql(MYSQL *conn, struct char_data *ch);
+static void insert_player_vars_mysql(struct mysql_save_job *job, struct char_data *ch);
+static void insert_aliases_mysql(struct mysql_save_job *job, struct char_data *ch);
 static void select_aliases_mysql(MYSQL *conn, struct char_data *ch);
 
 const struct mysql_column playerfile_table_index[] =
@@ -46,78 +46,115 @@ const struct mysql_column playerfile_table_index[] =
   { "\n",             MYSQL_TYPE_LONG           }
 };
 
-void load_playerfile_index_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt)
-{
-  int i, row;
-  row = 0;
-
-  CREATE(player_table, struct player_index_element, num_rows);
-
-  while (!mysql_stmt_fetch(stmt))
-  {
-    for(i = 0; i < num_fields; i++)
-    {
-      if(EXTRA_MYSQL_DEBUG_LOGS)
-        log("MYSQLINFO: Field name: %s, int_buffer: %d, string_buffer: %s",
-            fields[i].name, fields[i].col_int_buffer, fields[i].col_string_buffer);
+/* Columns of playerfile_table_index, in the order they are selected. */
+#define PINDEX_COL_ID     0
+#define PINDEX_COL_FLAGS  1
+#define PINDEX_COL_NAME   2
+#define PINDEX_COL_LEVEL  3
+#define PINDEX_COL_LAST   4
+#define PINDEX_NUM_COLS   5
 
-      if (!strcmp(fields[i].name, "ID"))   player_table[row].id = (fields[i].col_int_buffer);
-      else if (!strcmp(fields[i].name, "Name"))
-      {
-        CREATE(player_table[row].name, char, strlen(fields[i].col_string_buffer) + 1);
-        strcpy(player_table[row].name, fields[i].col_string_buffer);
-      }
-      else if (!strcmp(fields[i].name, "Levl"))   player_table[row].level = (fields[i].col_int_buffer);
-      else if (!strcmp(fields[i].name, "Last"))  player_table[row].last = fields[i].col_int_buffer;
-      else if (!strcmp(fields[i].name, "Act_0"))  player_table[row].flags = fields[i].col_int_buffer;
-    }
+/* Ids per statement when purging players from the database. */
+#define PCLEAN_IDS_PER_DELETE 1000
 
-    top_idnum = MAX(top_idnum, player_table[row].id);
-    row++;
-  }
-  top_of_p_file = top_of_p_table = row - 1;
+static long pindex_long(MYSQL_ROW row, int col)
+{
+  return row[col] ? strtol(row[col], NULL, 10) : 0;
 }
 
 /* select a list of all players (on or offline) for the player index
    There is no separate index table with mysql, it is just a selected
    portion of the playerfile table.  You probably don't want to hold the rest
-   of the table in memory for all offline players. -Cyric */
+   of the table in memory for all offline players. -Cyric
+
+   The rows are streamed with mysql_use_result() instead of being buffered
+   client side first, and every name goes into one arena handed to the index
+   at the end.  The arena moves while it grows, so names are kept as offsets
+   until the last row is in. */
 int select_player_index_mysql(MYSQL *conn)
 {
-  int num_parameters, num_columns;
   char sql_buf[MAX_STRING_LENGTH];
-  char buf[MAX_STRING_LENGTH];
-  const struct mysql_column *pft = playerfile_table_index;
-  struct mysql_parameter *parameters;
+  MYSQL_RES *result;
+  MYSQL_ROW row;
+  unsigned long *lengths;
+  size_t *name_offsets = NULL, arena_size = 0, arena_used = 0, len;
+  char *arena = NULL;
+  int num_rows = 0, max_rows = 0, i;
+
+  player_table = NULL;
+  top_of_p_file = top_of_p_table = -1;
 
   snprintf(sql_buf, sizeof(sql_buf), "SELECT ");
-  num_columns = get_column_sql(sql_buf, sizeof(sql_buf), playerfile_table_index);
+  get_column_sql(sql_buf, sizeof(sql_buf), playerfile_table_index);
+  len = strlen(sql_buf);
+  snprintf(sql_buf + len, sizeof(sql_buf) - len, " FROM %s.%s WHERE ID <> 0", MYSQL_DB, MYSQL_PLAYER_TABLE);
 
-  snprintf(buf, sizeof(buf), " FROM %s.%s WHERE ID <> ?", MYSQL_DB, MYSQL_PLAYER_TABLE);
+  log("MYSQLINFO: %s", sql_buf);
 
-  size_t remaining = sizeof(sql_buf) - strlen(sql_buf) - 1;
+  if (mysql_real_query(conn, sql_buf, strlen(sql_buf)) || !(result = mysql_use_result(conn))) {
+    log("MYSQL ERROR: Player index query failed, %s", mysql_error(conn));
+    return 0;
+  }
 
-  if (strlen(buf) >= remaining) {
-    log("MYSQL ERROR: Buffer overflow prevented.");
+  if (mysql_num_fields(result) != PINDEX_NUM_COLS) {
+    log("MYSQL ERROR: Player index query returned %u columns, expected %d", mysql_num_fields(result), PINDEX_NUM_COLS);
+    mysql_free_result(result);
     return 0;
   }
 
-  strncat(sql_buf, buf, remaining);
+  while ((row = mysql_fetch_row(result))) {
+    lengths = mysql_fetch_lengths(result);
 
-  log("MYSQLINFO: %s", sql_buf);
+    if (num_rows == max_rows) {
+      max_rows = max_rows ? max_rows * 2 : 1024;
+      RECREATE(player_table, struct player_index_element, max_rows);
+      RECREATE(name_offsets, size_t, max_rows);
+    }
 
-  num_parameters = 1;
+    len = row[PINDEX_COL_NAME] ? lengths[PINDEX_COL_NAME] : 0;
+    if (arena_used + len + 1 > arena_size) {
+      while (arena_used + len + 1 > arena_size)
+        arena_size = arena_size ? arena_size * 2 : 16384;
+      RECREATE(arena, char, arena_size);
+    }
+    if (len)
+      memcpy(arena + arena_used, row[PINDEX_COL_NAME], len);
+    arena[arena_used + len] = '\0';
+    name_offsets[num_rows] = arena_used;
+    arena_used += len + 1;
+
+    player_table[num_rows].id = pindex_long(row, PINDEX_COL_ID);
+    player_table[num_rows].flags = pindex_long(row, PINDEX_COL_FLAGS);
+    player_table[num_rows].level = pindex_long(row, PINDEX_COL_LEVEL);
+    player_table[num_rows].last = pindex_long(row, PINDEX_COL_LAST);
+
+    top_idnum = MAX(top_idnum, player_table[num_rows].id);
+    num_rows++;
+  }
 
-  //create a parameter list (which is just the character's name here)
-  CREATE(parameters, struct mysql_parameter, num_parameters);
-  parameters[0].int_data = 0;
-  parameters[0].data_type = MYSQL_TYPE_LONG;
-  parameters[0].data_length = 0;
-  parameters[0].string_data = NULL;
+  /* mysql_fetch_row() returns NULL on a dropped connection as well */
+  if (mysql_errno(conn))
+    log("MYSQL ERROR: Player index stopped after %d rows, %s", num_rows, mysql_error(conn));
+  mysql_free_result(result);
 
-  query_stmt_mysql(conn, parameters, pft, sql_buf, num_columns, num_parameters, load_playerfile_index_mysql, NULL, MYSQL_QUERY_SELECT);
+  if (num_rows == 0) {
+    free(player_table);
+    player_table = NULL;
+    free(name_offsets);
+    free(arena);
+    return 1;
+  }
+
+  RECREATE(player_table, struct player_index_element, num_rows);
+  RECREATE(arena, char, arena_used);
+  for (i = 0; i < num_rows; i++)
+    player_table[i].name = arena + name_offsets[i];
+  free(name_offsets);
+
+  set_player_index_arena(arena, arena_used);
+  top_of_p_file = top_of_p_table = num_rows - 1;
+  index_player_table();
 
-  free_mysql_parameters(parameters, num_parameters);
   return 1;
 }
 
@@ -206,10 +243,148 @@ const struct mysql_column playerfile_table[] =
   { "\n",             MYSQL_TYPE_LONG       }
 };
 
+/* Dirty tracking; see struct mysql_player_state in mysql_db.h. */
+#define DB_STATE(ch) ((ch)->player_specials->db_state)
+
+static struct mysql_player_state *get_player_state(struct char_data *ch)
+{
+  if (!DB_STATE(ch))
+    CREATE(DB_STATE(ch), struct mysql_player_state, 1);
+  return DB_STATE(ch);
+}
+
+void free_mysql_player_state(struct char_data *ch)
+{
+  struct mysql_player_state *state;
+  int i;
+
+  if (!ch->player_specials || !(state = DB_STATE(ch)))
+    return;
+
+  for (i = 0; i < MAX_PLAYERFILE_COLUMNS; i++)
+    if (state->string_values[i])
+      free(state->string_values[i]);
+  for (i = 0; i < NUM_PLAYER_ARRAY_TYPES; i++)
+    if (state->arrays[i])
+      free(state->arrays[i]);
+  free(state);
+  DB_STATE(ch) = NULL;
+}
+
+/* A save of player id was given up, so the database may not hold what
+ * the player's DB_STATE says it does.  Forget it, and the next save writes
+ * every column and array again. */
+void forget_player_db_state(long id)
+{
+  struct char_data *ch;
+
+  for (ch = character_list; ch; ch = ch->next)
+    if (!IS_NPC(ch) && GET_IDNUM(ch) == id) {
+      free_mysql_player_state(ch);
+      log("MYSQLINFO: %s will be saved in full next time.", GET_NAME(ch));
+      return;
+    }
+}
+
+/* Records the value of playerfile column col as it is in the database. */
+static void remember_column(struct mysql_player_state *state, int col, int int_value, const char *string_value)
+{
+  if (col >= MAX_PLAYERFILE_COLUMNS)
+    return;
+
+  if (state->string_values[col]) {
+    free(state->string_values[col]);
+    state->string_values[col] = NULL;
+  }
+  if (string_value)
+    state->string_values[col] = strdup(string_value);
+  state->int_values[col] = int_value;
+  SET_BIT_AR(state->known_columns, col);
+}
+
+static bool column_changed(struct mysql_player_state *state, int col, struct mysql_parameter *param)
+{
+  if (col >= MAX_PLAYERFILE_COLUMNS || !IS_SET_AR(state->known_columns, col))
+    return TRUE;
+
+  if (param->data_type == MYSQL_TYPE_VAR_STRING)
+    return strcmp(state->string_values[col] ? state->string_values[col] : "",
+      param->string_data ? param->string_data : "") != 0;
+  return state->int_values[col] != param->int_data;
+}
+
+static unsigned long hash_string(unsigned long hash, const char *str)
+{
+  if (str)
+    while (*str)
+      hash = hash * 33 + (unsigned char) *str++;
+  return hash * 33;  /* so "ab","c" and "a","bc" differ */
+}
+
+static unsigned long hash_player_vars(struct char_data *ch)
+{
+  struct trig_var_data *vars;
+  unsigned long hash = 5381;
+
+  if (SCRIPT(ch))
+    for (vars = SCRIPT(ch)->global_vars; vars; vars = vars->next) {
+      hash = hash_string(hash, vars->name);
+      hash = hash_string(hash, vars->value);
+      hash = hash * 33 + vars->context;
+    }
+  return hash;
+}
+
+static unsigned long hash_aliases(struct char_data *ch)
+{
+  struct alias_data *temp;
+  unsigned long hash = 5381;
+
+  for (temp = GET_ALIASES(ch); temp; temp = temp->next) {
+    hash = hash_string(hash, temp->alias);
+    hash = hash_string(hash, temp->replacement);
+    hash = hash * 33 + temp->type;
+  }
+  return hash;
+}
+
+static int compare_array_rows(const void *a, const void *b)
+{
+  const struct mysql_array_row *ra = a, *rb = b;
+
+  return (ra->array_id > rb->array_id) - (ra->array_id < rb->array_id);
+}
+
+static void remember_array_row(struct mysql_player_state *state, int type, int array_id, int value)
+{
+  int n;
+
+  if (type < 0 || type >= NUM_PLAYER_ARRAY_TYPES)
+    return;
+
+  n = state->num_array_rows[type]++;
+  if (!state->arrays[type])
+    CREATE(state->arrays[type], struct mysql_array_row, n + 1);
+  else
+    RECREATE(state->arrays[type], struct mysql_array_row, n + 1);
+  state->arrays[type][n].array_id = array_id;
+  state->arrays[type][n].value = value;
+}
+
+static void forget_array(struct mysql_player_state *state, int type)
+{
+  if (state->arrays[type])
+    free(state->arrays[type]);
+  state->arrays[type] = NULL;
+  state->num_array_rows[type] = 0;
+  state->known_arrays &= ~(1 << type);
+}
+
 void load_playerfile_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt)
 {
   int i;
   struct char_data *ch = v_ch;
+  struct mysql_player_state *state = get_player_state(ch);
 
   if (mysql_stmt_fetch(stmt))
    return;
@@ -221,6 +396,11 @@ void load_playerfile_mysql(struct mysql_bind_column *fields, int num_fields, int
         fields[i].name, fields[i].col_int_buffer,
         fields[i].col_string_buffer);
 
+    /* the SELECT lists playerfile_table in order, so field i is column i */
+    if (!fields[i].is_null)
+      remember_column(state, i, fields[i].col_int_buffer,
+        fields[i].data_type == MYSQL_TYPE_VAR_STRING ? fields[i].col_string_buffer : NULL);
+
     if (!strcmp(fields[i].name, "Ac"))   GET_AC(ch) = (fields[i].col_int_buffer);
     else if (!strcmp(fields[i].name, "Act_0"))   PLR_FLAGS(ch)[0] = (fields[i].col_int_buffer);
     else if (!strcmp(fields[i].name, "Act_1"))   PLR_FLAGS(ch)[1] = (fields[i].col_int_buffer);
@@ -300,34 +480,21 @@ void load_playerfile_mysql(struct mysql_bind_column *fields, int num_fields, int
   }
 }
 
-void update_playerfile_mysql_by_ID(MYSQL *conn, int ID, struct char_data *ch, struct affected_type *affects)
+void update_playerfile_mysql_by_ID(struct mysql_save_job *job, int ID, struct char_data *ch, struct affected_type *affects)
 {
-  int i, num_columns, num_parameters;
-  char buf[MAX_STRING_LENGTH];
+  int i, j, num_columns, num_parameters, num_dirty = 0;
+  int dirty[PF_COLUMN_ARRAY_MAX] = { 0 };
   char parameter_buf[MAX_STRING_LENGTH];
   char buf2[MAX_STRING_LENGTH];
   char sql_buf[MAX_STRING_LENGTH];
-  struct mysql_parameter *parameters;
-
-  snprintf(sql_buf, sizeof(sql_buf), "UPDATE %s.%s SET ", MYSQL_DB, MYSQL_PLAYER_TABLE);
-
-  num_columns = get_column_update_sql(sql_buf, sizeof(sql_buf), playerfile_table);
-
-  snprintf(buf, sizeof(buf), " WHERE ID = ?");
-
-  size_t remaining = sizeof(sql_buf) - strlen(sql_buf) - 1;
+  struct mysql_parameter *parameters, *dirty_parameters;
+  struct mysql_player_state *state = get_player_state(ch);
 
-  if (strlen(buf) >= remaining) {
-    log("MYSQL ERROR: Buffer overflow prevented.");
-    return;
-  }
-
-  strncat(sql_buf, buf, remaining);
+  for (num_columns = 0; *playerfile_table[num_columns].column_name != '\n'; num_columns++);
 
   //include the ID
   num_parameters = (num_columns + 1);
-  log("MYSQLINFO: Update Player ID %d : %s | num_parameter:%d", ID, sql_buf, num_parameters);
-  //create a parameter list (which is just the character's name here)
+  //the value of every column, narrowed to the changed ones below
   CREATE(parameters, struct mysql_parameter, num_parameters);
 
   /* leave a slot for the ID */
@@ -570,8 +737,6 @@ void update_playerfile_mysql_by_ID(MYSQL *conn, int ID, struct char_data *ch, st
         parameters[i].data_length = 0;
   }
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, ch, MYSQL_QUERY_UPDATE);
-
   for(i = 0; i < num_parameters; i++)
   {
     if(EXTRA_MYSQL_DEBUG_LOGS)
@@ -579,7 +744,45 @@ void update_playerfile_mysql_by_ID(MYSQL *conn, int ID, struct char_data *ch, st
         i, parameters[i].int_data,
           parameters[i].data_type == MYSQL_TYPE_VAR_STRING ? (char*)parameters[i].string_data : "not string");
   }
+
+  /* only the columns that differ from what the database already holds */
+  for (i = 0; i < num_columns; i++)
+    if (column_changed(state, i, &parameters[i])) {
+      SET_BIT_AR(dirty, i);
+      num_dirty++;
+    }
+
+  if (num_dirty == 0) {
+    free_mysql_parameters(parameters, num_parameters);
+    return;
+  }
+
+  snprintf(sql_buf, sizeof(sql_buf), "UPDATE %s.%s SET ", MYSQL_DB, MYSQL_PLAYER_TABLE);
+  CREATE(dirty_parameters, struct mysql_parameter, num_dirty + 1);
+
+  for (i = 0, j = 0; i < num_columns; i++)
+  {
+    if (!IS_SET_AR(dirty, i))
+      continue;
+    remember_column(state, i, parameters[i].int_data,
+      parameters[i].data_type == MYSQL_TYPE_VAR_STRING ? parameters[i].string_data : NULL);
+
+    strncat(sql_buf, playerfile_table[i].column_name, sizeof(sql_buf) - strlen(sql_buf) - 1);
+    strncat(sql_buf, j < num_dirty - 1 ? "= ?, " : "= ? ", sizeof(sql_buf) - strlen(sql_buf) - 1);
+
+    /* the string moves to dirty_parameters */
+    dirty_parameters[j++] = parameters[i];
+    parameters[i].string_data = NULL;
+  }
+  dirty_parameters[j++] = parameters[num_columns];
+  strncat(sql_buf, " WHERE ID = ?", sizeof(sql_buf) - strlen(sql_buf) - 1);
   free_mysql_parameters(parameters, num_parameters);
+
+  log("MYSQLINFO: Update Player ID %d : %s | num_parameter:%d", ID, sql_buf, j);
+  mysql_save_job_add(job, sql_buf, dirty_parameters, j);
+
+  mysql_save_counters.columns_updated += num_dirty;
+  mysql_save_counters.rows_written++;
 }
 
 int select_player_mysql_by_name(MYSQL *conn, const char *name, struct char_data *ch)
@@ -695,6 +898,12 @@ int load_char_mysql(const char *name, struct char_data *ch)
     for (i = 0; i < PR_ARRAY_MAX; i++)
       PRF_FLAGS(ch)[i] = PFDEF_PREFFLAGS;
 
+    /* a save of this player may still be queued for the save worker */
+    mysql_save_wait_for(player_table[id].id);
+
+    /* what is loaded below becomes the base the next save is diffed against */
+    free_mysql_player_state(ch);
+
     /* checking the database for the Name (this should be ID later, but currently the player
        id comes from the playerfile instead of the id in the index for some reason)
     */
@@ -708,12 +917,17 @@ int load_char_mysql(const char *name, struct char_data *ch)
     select_aliases_mysql(db_conn, ch);
     select_player_vars_mysql(db_conn, ch);
 
+    get_player_state(ch)->aliases_hash = hash_aliases(ch);
+    get_player_state(ch)->aliases_known = TRUE;
+    get_player_state(ch)->vars_hash = hash_player_vars(ch);
+    get_player_state(ch)->vars_known = TRUE;
+
 /* TODO:
         else if (!strcmp(tag, "Trig") && CONFIG_SCRIPT_PLAYERS) {
           if ((t_rnum = real_trigger(atoi(line))) != NOTHING) {
             t = read_trigger(t_rnum);
           if (!SCRIPT(ch))
-            CREATE(SCRIPT(ch), struct script_data, 1);
+            SCRIPT(ch) = create_script(ch, MOB_TRIGGER);
           add_trigger(SCRIPT(ch), t, -1);
           }
          }
@@ -734,60 +948,80 @@ int load_char_mysql(const char *name, struct char_data *ch)
   return(id);
 }
 
+/* Builds a save job from the character and hands it to the save worker. The
+   statements hold copies of everything they need, so ch may change or be
+   freed before the job is written. */
 void save_player_mysql(struct char_data * ch, struct affected_type *aff)
 {
-  MYSQL_RES *result;
-  MYSQL_ROW row;
-  char buf[MAX_STRING_LENGTH];
-
-  /* checking the database for the character ... has to be name for now */
-  snprintf(buf, sizeof(buf), "SELECT ID FROM %s.%s WHERE Name = '%s'", MYSQL_DB, MYSQL_PLAYER_TABLE, GET_NAME(ch));
-
-  mysql_ping(db_conn);
-
-  if (mysql_query(db_conn, buf))
-  {
-    close_mysqlcon_with_error(db_conn);
-    log("MYSQLINFO: %s", buf);
-    return;
+  char sql_buf[MAX_STRING_LENGTH];
+  struct mysql_parameter *parameters;
+  struct mysql_save_job *job;
+  long rows_before = mysql_save_counters.rows_written;
+
+  job = mysql_save_job_create(GET_IDNUM(ch));
+
+  /* a new player needs a row for the UPDATE below to change; a player that
+     was loaded or saved before already has one */
+  if (!DB_STATE(ch)) {
+    snprintf(sql_buf, sizeof(sql_buf), "INSERT IGNORE INTO %s.%s (ID, Name) VALUES (?, ?)", MYSQL_DB, MYSQL_PLAYER_TABLE);
+
+    CREATE(parameters, struct mysql_parameter, 2);
+    parameters[0].data_type = MYSQL_TYPE_LONG;
+    parameters[0].int_data = GET_IDNUM(ch);
+    parameters[1].data_type = MYSQL_TYPE_VAR_STRING;
+    parameters[1].string_data = strdup(GET_NAME(ch));
+    parameters[1].data_length = strlen(parameters[1].string_data);
+    mysql_save_job_add(job, sql_buf, parameters, 2);
+    mysql_save_counters.rows_written++;
   }
 
-  result = mysql_store_result(db_conn);
+  update_playerfile_mysql_by_ID(job, GET_IDNUM(ch), ch, aff);
 
-  if (result == NULL)
-  {
-    close_mysqlcon_with_error(db_conn);
-    log("MYSQLINFO: %s", buf);
-    return;
-  }
+  insert_player_vars_mysql(job, ch);
+  insert_aliases_mysql(job, ch);
+  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_SKILLS);
+  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_QUESTS);
+//  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_COOLDOWNS);
+//  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_KILLS);
+//  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_FEATS);
+//  insert_player_arrays_mysql(job, ch, PLAYER_ARRAY_MEMORIZATION);
 
-  row = mysql_fetch_row(result);
-
-  if(EXTRA_MYSQL_DEBUG_LOGS) {
-    snprintf(buf, sizeof(buf), "%ld mysql_numrows", (long)mysql_num_rows(result));
-    log("MYSQLINFO: %s", buf);
-  }
+  mysql_save_counters.saves++;
+  mysql_save_counters.last_rows_written = mysql_save_counters.rows_written - rows_before;
+  if (!job->stmts)
+    mysql_save_counters.empty_saves++;
 
-  /* if not found in the database then insert a new record with name and ID */
-  if(mysql_num_rows(result) < 1)
-  {
-    //INSERT NEW Player File
-    snprintf(buf, sizeof(buf), "INSERT INTO %s.%s (ID, Name) VALUES(%ld, '%s')", MYSQL_DB, MYSQL_PLAYER_TABLE, GET_IDNUM(ch), GET_NAME(ch));
-    mysql_query(db_conn, buf);
-    log("MYSQLINFO: New player: %s", buf);
-  }
-  mysql_free_result(result);
-
-  update_playerfile_mysql_by_ID(db_conn, GET_IDNUM(ch), ch, aff);
+  mysql_save_job_submit(job);
+}
 
-  insert_player_vars_mysql(db_conn, ch);
-  insert_aliases_mysql(db_conn, ch);
-  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_SKILLS);
-  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_QUESTS);
-//  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_COOLDOWNS);
-//  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_KILLS);
-//  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_FEATS);
-//  insert_player_arrays_mysql(db_conn, ch, PLAYER_ARRAY_MEMORIZATION);
+/* show dbstats: what player saves have been writing to the database */
+void show_mysql_save_stats(struct char_data *ch)
+{
+  struct mysql_save_counters counters, *c = &counters;
+  struct mysql_stmt_counters sc;
+  int num_open, in_use;
+
+  mysql_save_counters_copy(&counters);
+
+  send_to_char(ch, "Player saves      : %ld (%ld with nothing to write)\r\n", c->saves, c->empty_saves);
+  send_to_char(ch, "Rows written      : %ld total, %.2f per save, %ld by the last save\r\n",
+    c->rows_written, c->saves ? (double) c->rows_written / c->saves : 0.0, c->last_rows_written);
+  send_to_char(ch, "Columns updated   : %ld total, %.2f per save\r\n",
+    c->columns_updated, c->saves ? (double) c->columns_updated / c->saves : 0.0);
+  send_to_char(ch, "Delete statements : %ld\r\n", c->delete_statements);
+  send_to_char(ch, "Written           : %ld batches, %ld jobs, %ld statements\r\n",
+    c->batches, c->jobs, c->statements);
+  send_to_char(ch, "Failures          : %ld batches rolled back, %ld saves given up\r\n",
+    c->failed_batches, c->dropped_jobs);
+
+  mysql_pool_counters(&sc, &num_open, &in_use);
+  send_to_char(ch, "Connections       : %d open, %d in use, %ld pings, %ld reconnects\r\n",
+    num_open, in_use, sc.pings, sc.reconnects);
+  send_to_char(ch, "Statement cache   : %ld hits, %ld misses (%.1f%% hit), %ld evicted, %ld flushes\r\n",
+    sc.hits, sc.misses, sc.hits + sc.misses ? 100.0 * sc.hits / (sc.hits + sc.misses) : 0.0,
+    sc.evictions, sc.flushes);
+  send_to_char(ch, "Prepare time      : %ld ms total, %.2f ms per prepare\r\n",
+    sc.prepare_usec / 1000, sc.misses ? sc.prepare_usec / 1000.0 / sc.misses : 0.0);
 }
 
 /* Write the vital data of a player to mysql playerfile table. */
@@ -912,11 +1146,11 @@ void save_char_mysql(struct char_data * ch)
 }
 
 /* Deletes a player of idnum from the db */
-int delete_player_mysql(MYSQL *conn, int id)
+void delete_player_mysql(struct mysql_save_job *job, int id)
 {
   char sql_buf[MAX_STRING_LENGTH];
   struct mysql_parameter *parameters;
-  int num_parameters = 1, result;
+  int num_parameters = 1;
 
   snprintf(sql_buf, sizeof(sql_buf), "DELETE FROM %s.%s WHERE Id = ?", MYSQL_DB, MYSQL_PLAYER_TABLE);
 
@@ -928,10 +1162,8 @@ int delete_player_mysql(MYSQL *conn, int id)
   parameters[0].data_type = MYSQL_TYPE_LONG;
   parameters[0].int_data = id;
 
-  result = query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, NULL, MYSQL_QUERY_DELETE);
-
-  free_mysql_parameters(parameters, num_parameters);
-  return result;
+  mysql_save_job_add(job, sql_buf, parameters, num_parameters);
+  mysql_save_counters.delete_statements++;
 }
 
 /* TODO: unfinished conversion to mysql */
@@ -941,6 +1173,7 @@ int delete_player_mysql(MYSQL *conn, int id)
 void remove_player_mysql(int pfilepos)
 {
   char filename[MAX_STRING_LENGTH], timestr[25];
+  struct mysql_save_job *job;
   int i, id;
 
   if (!*player_table[pfilepos].name)
@@ -965,50 +1198,104 @@ void remove_player_mysql(int pfilepos)
     we could set a deleted flag or move to a backup table or backup db
     or just delete - Cyric */
 
-  delete_player_mysql(db_conn, id);
-//  update_playerfile_mysql_by_ID(db_conn, player_table[pfilepos].id, ch, aff);
-  delete_player_vars_mysql(db_conn, id);
-  delete_aliases_mysql(db_conn, id);
-  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_SKILLS);
-  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_QUESTS);
-//  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_COOLDOWNS);
-//  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_KILLS);
-//  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_FEATS);
-//  delete_player_arrays_mysql(db_conn, id, PLAYER_ARRAY_MEMORIZATION);
+  /* queued behind any save of this player still waiting to be written */
+  job = mysql_save_job_create(id);
+  delete_player_mysql(job, id);
+//  update_playerfile_mysql_by_ID(job, player_table[pfilepos].id, ch, aff);
+  delete_player_vars_mysql(job, id);
+  delete_aliases_mysql(job, id);
+  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_SKILLS);
+  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_QUESTS);
+//  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_COOLDOWNS);
+//  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_KILLS);
+//  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_FEATS);
+//  delete_player_arrays_mysql(job, id, PLAYER_ARRAY_MEMORIZATION);
 //  delete_player_ojbects(GET_IDNUM(ch);
+  mysql_save_job_submit(job);
 }
 
-/* TODO: unfinished */
+/* Deletes the given players from every player table, one statement per
+ * table for each PCLEAN_IDS_PER_DELETE ids rather than a job per player. */
+static void delete_players_mysql(MYSQL *conn, long *ids, int num_ids)
+{
+  static const struct {
+    const char *table;
+    const char *column;
+  } player_tables[] = {
+    { MYSQL_PLAYER_TABLE,          "ID"       },
+    { MYSQL_ALIAS_TABLE,           "PlayerID" },
+    { MYSQL_PLAYER_VARS_TABLE,     "PlayerId" },
+    { MYSQL_PLAYER_ARRAYS_TABLE,   "PlayerId" },
+    { MYSQL_PLAYER_OBJECTS_TABLE,  "PlayerId" }
+  };
+  size_t buf_size = MAX_STRING_LENGTH + PCLEAN_IDS_PER_DELETE * 22, len;
+  char *sql_buf;
+  int t, i, first;
+
+  CREATE(sql_buf, char, buf_size);
+
+  if (mysql_query(conn, "START TRANSACTION"))
+    log("MYSQLINFO: START TRANSACTION failed, %s", mysql_error(conn));
+
+  for (t = 0; t < (int)(sizeof(player_tables) / sizeof(player_tables[0])); t++) {
+    for (first = 0; first < num_ids; first += PCLEAN_IDS_PER_DELETE) {
+      len = snprintf(sql_buf, buf_size, "DELETE FROM %s.%s WHERE %s IN (",
+        MYSQL_DB, player_tables[t].table, player_tables[t].column);
+      for (i = first; i < num_ids && i < first + PCLEAN_IDS_PER_DELETE; i++)
+        len += snprintf(sql_buf + len, buf_size - len, "%s%ld", i > first ? "," : "", ids[i]);
+      snprintf(sql_buf + len, buf_size - len, ")");
+
+      if (mysql_real_query(conn, sql_buf, strlen(sql_buf)))
+        log("MYSQL ERROR: Purge from %s failed, %s", player_tables[t].table, mysql_error(conn));
+      else if (EXTRA_MYSQL_DEBUG_LOGS)
+        log("MYSQLINFO: Purged %llu rows from %s", (unsigned long long) mysql_affected_rows(conn), player_tables[t].table);
+    }
+  }
+
+  if (mysql_query(conn, "COMMIT"))
+    log("MYSQLINFO: COMMIT failed, %s", mysql_error(conn));
+
+  free(sql_buf);
+}
+
+/* Stuff related to the player file cleanup system.  Collects everyone the
+ * pclean criteria select, drops them from the database in bulk and then
+ * compacts the index once, instead of a remove_player() per player. */
 void clean_pfiles_mysql(void)
 {
-  int i, ci;
+  char filename[MAX_STRING_LENGTH], timestr[25];
+  time_t now = time(0);
+  long *ids;
+  int i, f, num_ids = 0;
+
+  if (top_of_p_table < 0)
+    return;
+
+  CREATE(ids, long, top_of_p_table + 1);
 
   for (i = 0; i <= top_of_p_table; i++) {
-    /* We only want to go further if the player isn't protected from deletion
-     * and hasn't already been deleted. */
-    if (!IS_SET(player_table[i].flags, PINDEX_NODELETE) &&
-        *player_table[i].name) {
-      /* If the player is already flagged for deletion, then go ahead and get
-       * rid of him. */
-      if (IS_SET(player_table[i].flags, PINDEX_DELETED)) {
-	remove_player(i);
-      } else {
-        /* Check to see if the player has overstayed his welcome based on level. */
-	for (ci = 0; pclean_criteria[ci].level > -1; ci++) {
-	  if (player_table[i].level <= pclean_criteria[ci].level &&
-	      ((time(0) - player_table[i].last) >
-	       (pclean_criteria[ci].days * SECS_PER_REAL_DAY))) {
-	    remove_player(i);
-	    break;
-	  }
-	}
-        /* If we got this far and the players hasn't been kicked out, then he
-	 * can stay a little while longer. */
-      }
-    }
+    if (!pfile_needs_cleaning(i, now))
+      continue;
+
+    /* Unlink all player-owned files */
+    for (f = 0; f < MAX_FILES; f++)
+      if (get_filename(filename, sizeof(filename), f, player_table[i].name))
+        unlink(filename);
+
+    strftime(timestr, sizeof(timestr), "%c", localtime(&(player_table[i].last)));
+    log("PCLEAN: %s Lev: %d Last: %s",
+	player_table[i].name, player_table[i].level,
+	timestr);
+
+    ids[num_ids++] = player_table[i].id;
+    player_table[i].name[0] = '\0';
   }
-  /* After everything is done, we should rebuild player_index and remove the
-   * entries of the players that were just deleted. */
+
+  if (num_ids > 0) {
+    delete_players_mysql(db_conn, ids, num_ids);
+    compact_player_index();
+  }
+  free(ids);
 }
 
 /* load_affects function uses 8 arguments from a char pointer instead of a file now */
@@ -1062,7 +1349,7 @@ const struct mysql_column player_arrays_table_index[] =
 };
 
 /* Deletes all player arrays for a character from the database, not memory */
-void delete_player_arrays_mysql(MYSQL *conn, int id, int type)
+void delete_player_arrays_mysql(struct mysql_save_job *job, int id, int type)
 {
   char sql_buf[MAX_STRING_LENGTH];
   struct mysql_parameter *parameters;
@@ -1082,262 +1369,223 @@ void delete_player_arrays_mysql(MYSQL *conn, int id, int type)
   parameters[1].data_type = MYSQL_TYPE_LONG;
   parameters[1].int_data = type;
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, NULL, MYSQL_QUERY_DELETE);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add(job, sql_buf, parameters, num_parameters);
+  mysql_save_counters.delete_statements++;
 }
 
-/* save a character's variables to the database */
-void insert_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type)
+/* Deletes the listed ArrayIds of one array type for a character */
+static void delete_player_array_ids_mysql(struct mysql_save_job *job, int id, int type, int *array_ids, int num_ids)
 {
   char sql_buf[MAX_STRING_LENGTH];
-  char value_buf[MAX_STRING_LENGTH] = "\0";
-  char buf[MAX_STRING_LENGTH] = "\0";
   struct mysql_parameter *parameters;
-  int num_parameters = 0, num_columns = 0, num_rows = 0, col_num, i = 0, j = 0;
-  const struct mysql_column *col = player_arrays_table_index;
-//  struct cooldown_node *cd;
-//  struct memorize_node *mem;
-//  struct kill_node *kill = NULL;
+  int i, num_parameters = num_ids + 2;
 
-  /* we should never be called for an NPC, but just in case... */
-  if (IS_NPC(ch)) return;
+  snprintf(sql_buf, sizeof(sql_buf), "DELETE FROM %s.%s WHERE PlayerId = ? AND Type = ? AND ArrayId IN",
+    MYSQL_DB, MYSQL_PLAYER_ARRAYS_TABLE);
+  get_parameter_markers_sql(sql_buf, sizeof(sql_buf), num_ids, 1);
 
-  delete_player_arrays_mysql(conn, GET_IDNUM(ch), type);
+  if(EXTRA_MYSQL_DEBUG_LOGS)
+    log("MYSQLINFO: %s | num_parameters:%d", sql_buf, num_parameters);
 
-  num_columns = get_column_sql(buf, sizeof(buf), player_arrays_table_index);
+  CREATE(parameters, struct mysql_parameter, num_parameters);
+  for (i = 0; i < num_parameters; i++)
+    parameters[i].data_type = MYSQL_TYPE_LONG;
+  parameters[0].int_data = id;
+  parameters[1].int_data = type;
+  for (i = 0; i < num_ids; i++)
+    parameters[i + 2].int_data = array_ids[i];
+
+  mysql_save_job_add(job, sql_buf, parameters, num_parameters);
+  mysql_save_counters.delete_statements++;
+}
+
+static void add_array_row(struct mysql_array_row **rows, int *num_rows, int array_id, int value)
+{
+  if (!*rows)
+    CREATE(*rows, struct mysql_array_row, *num_rows + 1);
+  else
+    RECREATE(*rows, struct mysql_array_row, *num_rows + 1);
+  (*rows)[*num_rows].array_id = array_id;
+  (*rows)[*num_rows].value = value;
+  (*num_rows)++;
+}
+
+/* The rows a character's array of the given type should have in the
+   database, sorted by ArrayId (memorization keeps its slot order). */
+static int build_player_array_rows(struct char_data *ch, int type, struct mysql_array_row **rows)
+{
+  int i, num_rows = 0;
+//  struct cooldown_node *cd;
+//  struct kill_node *kill;
+#ifdef PLAYER_MEMORIZATION
+  struct memorize_node *mem;
+#endif
+
+  *rows = NULL;
 
   switch(type) {
   case PLAYER_ARRAY_SKILLS:
     if (GET_LEVEL(ch) < LVL_IMMORT) {
       for (i = 1; i <= MAX_SKILLS; i++) {
         if (GET_SKILL(ch, i))
-          num_rows++;
+          add_array_row(rows, &num_rows, i, GET_SKILL(ch, i));
       }
     }
     break;
   case PLAYER_ARRAY_QUESTS:
-    num_rows = GET_NUM_QUESTS(ch);
+    //value is unused, could be a quantity or something later
+    for (i = 0; i < GET_NUM_QUESTS(ch); i++)
+      add_array_row(rows, &num_rows, ch->player_specials->saved.completed_quests[i], 1);
     break;
 /*
   case PLAYER_ARRAY_COOLDOWNS:
     for (cd = ch->cooldown; cd; cd = cd->next)
-      num_rows++;
+      add_array_row(rows, &num_rows, cd->spellnum, cd->timer);
     break;
 */
 /*
   case PLAYER_ARRAY_KILLS:
     for (kill = ch->kill_mem; kill; kill = kill->next)
-      num_rows++;
+      add_array_row(rows, &num_rows, kill->vnum, kill->amount);
     break;
 */
-//  case PLAYER_ARRAY_FEATS:
+#ifdef PLAYER_FEATS
+  case PLAYER_ARRAY_FEATS:
     /* don't include FEAT_NONE */
-//    for(i = 1; i < MAX_FEATS; i++)
-//      if(GET_FEAT(ch, i) > 0) /* TODO: test more */
-//        num_rows++;
-//    break;
-//  case PLAYER_ARRAY_MEMORIZATION:
-//    for(i = 0; i < GET_MEMCURSOR(ch); i++)
-//      if(GET_SPELLMEM(ch, i) > 0)
-//        num_rows++;
-//    for (mem = ch->memorized; mem; mem = mem->next)
-//      num_rows++;
-//    break;
+    for(i = 1; i < MAX_FEATS; i++)
+      if(GET_FEAT(ch, i) > 0)
+        add_array_row(rows, &num_rows, i, GET_FEAT(ch, i));
+    break;
+#endif
+#ifdef PLAYER_MEMORIZATION
+  case PLAYER_ARRAY_MEMORIZATION:
+    for(i = 0; i < GET_MEMCURSOR(ch); i++)
+      if(GET_SPELLMEM(ch, i) > 0)
+        add_array_row(rows, &num_rows, GET_SPELLMEM(ch, i), 0);
+    for (mem = ch->memorized; mem; mem = mem->next)
+      add_array_row(rows, &num_rows, mem->spell, mem->timer);
+    return num_rows;
+#endif
   default:
     log("Unhandled case in insert_player_arrays_mysql");
     break;
   }
-  if(EXTRA_MYSQL_DEBUG_LOGS)
-    log("MYSQLINFO: num rows %d", num_rows);
-
-  if(num_rows < 1)
-    return;
-  num_parameters = get_parameter_markers_sql(value_buf, sizeof(value_buf), num_columns, num_rows);
-
-  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES %s",
-    MYSQL_DB, MYSQL_PLAYER_ARRAYS_TABLE, buf, value_buf);
 
-  log("MYSQLINFO: %s | num_parameter:%d", sql_buf, num_parameters);
+  if (num_rows > 1)
+    qsort(*rows, num_rows, sizeof(struct mysql_array_row), compare_array_rows);
+  return num_rows;
+}
 
-  CREATE(parameters, struct mysql_parameter, num_parameters);
+/* save a character's array of the given type to the database.  Only the
+   ids that were added, removed or changed since the last load or save are
+   written; the first save, or one with too many changes, replaces them all */
+void insert_player_arrays_mysql(struct mysql_save_job *job, struct char_data *ch, int type)
+{
+  char sql_buf[MAX_STRING_LENGTH];
+  char buf[MAX_STRING_LENGTH] = "\0";
+  struct mysql_parameter *parameters;
+  struct mysql_player_state *state;
+  struct mysql_array_row *rows, *old_rows, *changed;
+  int num_parameters = 0, num_columns = 0, num_rows, num_old, num_changed = 0, num_deletes = 0;
+  int col_num, i = 0, j = 0, *deletes;
+  bool rewrite;
+  const struct mysql_column *col = player_arrays_table_index;
 
-  switch(type) {
-  case PLAYER_ARRAY_SKILLS:
-    j = 0;
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
+  /* we should never be called for an NPC, but just in case... */
+  if (IS_NPC(ch)) return;
 
-      if(col_num == 0) {
-        j++;
-        while ((!GET_SKILL(ch, j)) && j <= MAX_SKILLS)  {
-            j++;
+  state = get_player_state(ch);
+  num_rows = build_player_array_rows(ch, type, &rows);
+  old_rows = state->arrays[type];
+  num_old = state->num_array_rows[type];
+
+  /* memorization ids repeat, so it cannot be diffed by id */
+  rewrite = !(state->known_arrays & (1 << type)) || type == PLAYER_ARRAY_MEMORIZATION;
+
+  CREATE(changed, struct mysql_array_row, num_rows + 1);
+  CREATE(deletes, int, num_old + 1);
+
+  if (rewrite) {
+    for (i = 0; i < num_rows; i++)
+      changed[num_changed++] = rows[i];
+  } else {
+    /* both lists are sorted by array_id */
+    while (i < num_rows || j < num_old) {
+      if (j >= num_old || (i < num_rows && rows[i].array_id < old_rows[j].array_id))
+        changed[num_changed++] = rows[i++];
+      else if (i >= num_rows || old_rows[j].array_id < rows[i].array_id)
+        deletes[num_deletes++] = old_rows[j++].array_id;
+      else {
+        if (rows[i].value != old_rows[j].value) {
+          deletes[num_deletes++] = old_rows[j].array_id;
+          changed[num_changed++] = rows[i];
         }
-      }
-
-      parameters[i].data_type = col[col_num].data_type;
-
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = j;
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = GET_SKILL(ch, j);
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
-
-      parameters[i].data_length = 0;
-
-    }
-    break;
-  case PLAYER_ARRAY_QUESTS:
-    j = 0;
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
-
-      parameters[i].data_type = col[col_num].data_type;
-
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = ch->player_specials->saved.completed_quests[j];
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = 1;
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
-
-      parameters[i].data_length = 0;
-
-      if(col_num == (num_columns - 1))
+        i++;
         j++;
+      }
     }
-    break;
-/*
-  case PLAYER_ARRAY_COOLDOWNS:
-    cd = ch->cooldown;
-
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
-
-      parameters[i].data_type = col[col_num].data_type;
-
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = cd->spellnum;
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = cd->timer;
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
 
-      parameters[i].data_length = 0;
-
-      if(col_num == (num_columns - 1))
-        cd = cd->next;
+    if (num_deletes > MAX_ARRAY_DIFF_DELETES) {
+      rewrite = TRUE;
+      num_changed = 0;
+      for (i = 0; i < num_rows; i++)
+        changed[num_changed++] = rows[i];
     }
-    break;
-*/
-/*
-  case PLAYER_ARRAY_KILLS:
-    kill = ch->kill_mem;
-
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
-
-      parameters[i].data_type = col[col_num].data_type;
+  }
 
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = kill->vnum;
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = kill->amount;
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
+  if (rewrite)
+    delete_player_arrays_mysql(job, GET_IDNUM(ch), type);
+  else if (num_deletes > 0)
+    delete_player_array_ids_mysql(job, GET_IDNUM(ch), type, deletes, num_deletes);
 
-      parameters[i].data_length = 0;
+  /* the new rows are what the database will hold */
+  if (state->arrays[type])
+    free(state->arrays[type]);
+  state->arrays[type] = rows;
+  state->num_array_rows[type] = num_rows;
+  state->known_arrays |= (1 << type);
+  free(deletes);
 
-      if(col_num == (num_columns - 1))
-        kill = kill->next;
-    }
-    break;
-*/
-#ifdef PLAYER_FEATS
-  case PLAYER_ARRAY_FEATS:
-    j = 0;
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
+  if(EXTRA_MYSQL_DEBUG_LOGS)
+    log("MYSQLINFO: num rows %d, changed %d, deleted %d", num_rows, num_changed, num_deletes);
 
-      if(col_num == 0) {
-        j++;
-        while ((!GET_FEAT(ch, j)) && j <= MAX_FEATS)  {
-            j++;
-        }
-      }
+  if(num_changed < 1) {
+    free(changed);
+    return;
+  }
 
-      parameters[i].data_type = col[col_num].data_type;
+  num_columns = get_column_sql(buf, sizeof(buf), player_arrays_table_index);
+  num_parameters = num_columns * num_changed;
 
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = j;
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = GET_FEAT(ch, j);
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
+  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES",
+    MYSQL_DB, MYSQL_PLAYER_ARRAYS_TABLE, buf);
 
-      parameters[i].data_length = 0;
-    }
-    break;
-#endif
-#ifdef PLAYER_MEMORIZATION
-  case PLAYER_ARRAY_MEMORIZATION:
-    j = -1;
-    mem = ch->memorized;
-
-    for(i = 0; i < num_parameters; i++)
-    {
-      col_num = i % num_columns;
+  log("MYSQLINFO: %s | num_parameter:%d", sql_buf, num_parameters);
 
-      if(col_num == 0) {
-        j++;
-        while ((!GET_SPELLMEM (ch, j)) && j < GET_MEMCURSOR (ch))  {
-            j++;
-        }
-      }
+  CREATE(parameters, struct mysql_parameter, num_parameters);
 
-      parameters[i].data_type = col[col_num].data_type;
+  for(i = 0; i < num_parameters; i++)
+  {
+    col_num = i % num_columns;
+    j = i / num_columns;
 
-      if(!strcmp(col[col_num].column_name, "PlayerId"))
-        parameters[i].int_data = GET_IDNUM(ch);
-      else if(!strcmp(col[col_num].column_name, "ArrayId"))
-        parameters[i].int_data = (j < GET_MEMCURSOR(ch)) ? GET_SPELLMEM(ch, j) : mem->spell;
-      else if(!strcmp(col[col_num].column_name, "Value"))
-        parameters[i].int_data = (j < GET_MEMCURSOR(ch)) ? 0 : mem->timer;
-      else if(!strcmp(col[col_num].column_name, "Type"))
-        parameters[i].int_data = type;
+    parameters[i].data_type = col[col_num].data_type;
 
-      parameters[i].data_length = 0;
+    if(!strcmp(col[col_num].column_name, "PlayerId"))
+      parameters[i].int_data = GET_IDNUM(ch);
+    else if(!strcmp(col[col_num].column_name, "ArrayId"))
+      parameters[i].int_data = changed[j].array_id;
+    else if(!strcmp(col[col_num].column_name, "Value"))
+      parameters[i].int_data = changed[j].value;
+    else if(!strcmp(col[col_num].column_name, "Type"))
+      parameters[i].int_data = type;
 
-      if(col_num == (num_columns - 1))
-        if( j >= GET_MEMCURSOR(ch) )
-          mem = mem->next;
-    }
-    break;
-#endif
-  default:
-    log("Unhandled case in insert_player_arrays_mysql");
-    break;
+    parameters[i].data_length = 0;
   }
+  free(changed);
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, ch, MYSQL_QUERY_INSERT);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add_rows(job, sql_buf, parameters, num_columns, num_changed);
+  mysql_save_counters.rows_written += num_changed;
 }
 
 void select_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type)
@@ -1347,6 +1595,7 @@ void select_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type)
   char buf[MAX_STRING_LENGTH];
   const struct mysql_column *pvt = player_arrays_table_index;
   struct mysql_parameter *parameters;
+  struct mysql_player_state *state;
 
   snprintf(sql_buf, sizeof(sql_buf), "SELECT ");
   num_columns = get_column_sql(sql_buf, sizeof(sql_buf), player_arrays_table_index);
@@ -1377,7 +1626,15 @@ void select_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type)
   parameters[1].data_type = MYSQL_TYPE_LONG;
   parameters[1].data_length = 0;
 
-  query_stmt_mysql(conn, parameters, pvt, sql_buf, num_columns, num_parameters, read_player_arrays_mysql, ch, MYSQL_QUERY_SELECT);
+  state = get_player_state(ch);
+  forget_array(state, type);
+
+  if (query_stmt_mysql(conn, parameters, pvt, sql_buf, num_columns, num_parameters, read_player_arrays_mysql, ch, MYSQL_QUERY_SELECT) > 0) {
+    /* sorted by id for the diff in insert_player_arrays_mysql */
+    if (type != PLAYER_ARRAY_MEMORIZATION && state->num_array_rows[type] > 1)
+      qsort(state->arrays[type], state->num_array_rows[type], sizeof(struct mysql_array_row), compare_array_rows);
+    state->known_arrays |= (1 << type);
+  }
 
   free_mysql_parameters(parameters, num_parameters);
 }
@@ -1409,6 +1666,8 @@ void read_player_arrays_mysql(struct mysql_bind_column *fields, int num_fields,
       else if (!strcmp(fields[i].name, "Type"))
         typeVar = fields[i].col_int_buffer;
     }
+    remember_array_row(get_player_state(ch), typeVar, arrayId, value);
+
     switch(typeVar) {
     case PLAYER_ARRAY_SKILLS:
       GET_SKILL(ch, arrayId) = value;
@@ -1459,7 +1718,7 @@ const struct mysql_column player_vars_table_index[] =
 };
 
 /* Deletes all player variables for a character from the database, not memory */
-void delete_player_vars_mysql(MYSQL *conn, int id)
+void delete_player_vars_mysql(struct mysql_save_job *job, int id)
 {
   char sql_buf[MAX_STRING_LENGTH];
   struct mysql_parameter *parameters;
@@ -1476,21 +1735,21 @@ void delete_player_vars_mysql(MYSQL *conn, int id)
   parameters[0].data_type = MYSQL_TYPE_LONG;
   parameters[0].int_data = id;
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, NULL, MYSQL_QUERY_DELETE);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add(job, sql_buf, parameters, num_parameters);
+  mysql_save_counters.delete_statements++;
 }
 
 /* save a character's variables to the database */
-void insert_player_vars_mysql(MYSQL *conn, struct char_data *ch)
+void insert_player_vars_mysql(struct mysql_save_job *job, struct char_data *ch)
 {
   struct trig_var_data *vars;
   char sql_buf[MAX_STRING_LENGTH];
-  char value_buf[MAX_STRING_LENGTH] = "\0";
   char buf[MAX_STRING_LENGTH] = "\0";
   struct mysql_parameter *parameters;
   int num_parameters = 0, num_columns = 0, num_rows = 0, col_num, i = 0;
   const struct mysql_column *col = player_vars_table_index;
+  struct mysql_player_state *state;
+  unsigned long hash;
 
   /* Immediate return if no script (and therefore no variables) structure has
    * been created. this will happen when the player is logging in */
@@ -1499,7 +1758,14 @@ void insert_player_vars_mysql(MYSQL *conn, struct char_data *ch)
   /* we should never be called for an NPC, but just in case... */
   if (IS_NPC(ch)) return;
 
-  delete_player_vars_mysql(conn, GET_IDNUM(ch));
+  /* nothing to write if the variables match what was last loaded or saved */
+  hash = hash_player_vars(ch);
+  state = get_player_state(ch);
+  if (state->vars_known && state->vars_hash == hash) return;
+  state->vars_hash = hash;
+  state->vars_known = TRUE;
+
+  delete_player_vars_mysql(job, GET_IDNUM(ch));
 
   /* make sure this char has global variables to save */
   if (ch->script->global_vars == NULL) return;
@@ -1515,10 +1781,10 @@ void insert_player_vars_mysql(MYSQL *conn, struct char_data *ch)
       num_rows++;
   }
 
-  num_parameters = get_parameter_markers_sql(value_buf, sizeof(value_buf), num_columns, num_rows);
+  num_parameters = num_columns * num_rows;
 
-  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES %s",
-    MYSQL_DB, MYSQL_PLAYER_VARS_TABLE, buf, value_buf);
+  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES",
+    MYSQL_DB, MYSQL_PLAYER_VARS_TABLE, buf);
 
   log("MYSQLINFO: %s | num_parameters:%d", sql_buf, num_parameters);
 
@@ -1553,9 +1819,8 @@ void insert_player_vars_mysql(MYSQL *conn, struct char_data *ch)
         vars = vars->next;
   }
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, ch, MYSQL_QUERY_INSERT);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add_rows(job, sql_buf, parameters, num_columns, num_rows);
+  mysql_save_counters.rows_written += num_rows;
 }
 
 void select_player_vars_mysql(MYSQL *conn, struct char_data *ch)
@@ -1610,7 +1875,7 @@ void read_player_vars_mysql(struct mysql_bind_column *fields, int num_fields, in
   /* Create the space for the script structure which holds the vars. We need to
    * do this first, because later calls to 'remote' will need. A script already
    * assigned. */
-  CREATE(SCRIPT(ch), struct script_data, 1);
+  SCRIPT(ch) = create_script(ch, MOB_TRIGGER);
 
   if (num_rows == 0) {
     return;
@@ -1661,7 +1926,7 @@ const struct mysql_column alias_table_index[] =
 };
 
 /* Deletes aliases for a character from the database, not memory */
-void delete_aliases_mysql(MYSQL *conn, int id)
+void delete_aliases_mysql(struct mysql_save_job *job, int id)
 {
   char sql_buf[MAX_STRING_LENGTH];
   struct mysql_parameter *parameters;
@@ -1678,20 +1943,30 @@ void delete_aliases_mysql(MYSQL *conn, int id)
   parameters[0].data_type = MYSQL_TYPE_LONG;
   parameters[0].int_data = id;
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, NULL, MYSQL_QUERY_DELETE);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add(job, sql_buf, parameters, num_parameters);
+  mysql_save_counters.delete_statements++;
 }
 
-static void insert_aliases_mysql(MYSQL *conn, struct char_data *ch)
+static void insert_aliases_mysql(struct mysql_save_job *job, struct char_data *ch)
 {
   char sql_buf[MAX_STRING_LENGTH];
-  char value_buf[MAX_STRING_LENGTH] = "\0";
   char buf[MAX_STRING_LENGTH] = "\0";
   struct mysql_parameter *parameters;
   int num_parameters = 0, num_columns = 0, num_rows = 0, col_num, i = 0;
   const struct mysql_column *col = alias_table_index;
   struct alias_data *temp;
+  struct mysql_player_state *state;
+  unsigned long hash;
+
+  /* nothing to write if the aliases match what was last loaded or saved */
+  hash = hash_aliases(ch);
+  state = get_player_state(ch);
+  if (state->aliases_known && state->aliases_hash == hash)
+    return;
+  state->aliases_hash = hash;
+  state->aliases_known = TRUE;
+
+  delete_aliases_mysql(job, GET_IDNUM(ch));
 
   if (GET_ALIASES(ch) == NULL)
     return;
@@ -1701,12 +1976,10 @@ static void insert_aliases_mysql(MYSQL *conn, struct char_data *ch)
   for (temp = GET_ALIASES(ch); temp; temp = temp->next)
     num_rows++;
 
-  num_parameters = get_parameter_markers_sql(value_buf, sizeof(value_buf), num_columns, num_rows);
-
-  delete_aliases_mysql(conn, GET_IDNUM(ch));
+  num_parameters = num_columns * num_rows;
 
-  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES %s",
-    MYSQL_DB, MYSQL_ALIAS_TABLE, buf, value_buf);
+  snprintf(sql_buf, sizeof(sql_buf), "INSERT INTO %s.%s (%s) VALUES",
+    MYSQL_DB, MYSQL_ALIAS_TABLE, buf);
 
   log("MYSQLINFO: %s | num_parameters:%d", sql_buf, num_parameters);
 
@@ -1739,9 +2012,8 @@ static void insert_aliases_mysql(MYSQL *conn, struct char_data *ch)
       temp = temp->next;
   }
 
-  query_stmt_mysql(conn, parameters, NULL, sql_buf, 0, num_parameters, NULL, ch, MYSQL_QUERY_INSERT);
-
-  free_mysql_parameters(parameters, num_parameters);
+  mysql_save_job_add_rows(job, sql_buf, parameters, num_columns, num_rows);
+  mysql_save_counters.rows_written += num_rows;
 }
 
 static void select_aliases_mysql(MYSQL *conn, struct char_data *ch)
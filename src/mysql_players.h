@@ -6,17 +6,18 @@ int select_player_index_mysql(MYSQL *conn);
 void read_aliases_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt);
 void read_player_vars_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt);
 void read_player_arrays_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt);
-void load_playerfile_index_mysql(struct mysql_bind_column *fields, int num_fields, int num_rows, void *v_ch, MYSQL_STMT *stmt);
 void select_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type);
 void select_player_vars_mysql(MYSQL *conn, struct char_data *ch);
-void insert_player_arrays_mysql(MYSQL *conn, struct char_data *ch, int type);
+void insert_player_arrays_mysql(struct mysql_save_job *job, struct char_data *ch, int type);
 int load_char_mysql(const char *name, struct char_data *ch);
 void save_char_mysql(struct char_data * ch);
 void remove_player_mysql(int pfilepos);
-void delete_player_arrays_mysql(MYSQL *conn, int id, int type);
-void delete_player_vars_mysql(MYSQL *conn, int id);
-void delete_aliases_mysql(MYSQL *conn, int id);
-int delete_player_mysql(MYSQL *conn, int id);
+void clean_pfiles_mysql(void);
+void delete_player_arrays_mysql(struct mysql_save_job *job, int id, int type);
+void delete_player_vars_mysql(struct mysql_save_job *job, int id);
+void delete_aliases_mysql(struct mysql_save_job *job, int id);
+void delete_player_mysql(struct mysql_save_job *job, int id);
+void forget_player_db_state(long id);
 
 /* players.c */
 void remove_player_from_index(int pos);
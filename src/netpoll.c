@@ -0,0 +1,317 @@
+/**************************************************************************
+*  File: netpoll.c                                         Part of tbaMUD *
+*  Usage: Descriptor readiness polling for game_loop() (epoll / select).  *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* game_loop() used to rebuild three fd_sets over the entire descriptor_list
+ * every pulse and select() on all of them.  This file hides that behind a
+ * small interface so that, where the OS supports it, we can keep a
+ * persistent kernel interest set (epoll) instead and only hear about the
+ * descriptors that actually have something to say.  Write interest is only
+ * armed for descriptors whose last process_output() could not drain their
+ * output buffer, so idle connections cost nothing per pulse.
+ *
+ * The select() backend is kept for every other platform and can be forced
+ * at runtime with the -S command line switch for comparison. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "netpoll.h"
+
+/* locally defined globals, used externally */
+struct descriptor_data **netpoll_ready = NULL; /* ready set of last wait */
+int netpoll_backend = NETPOLL_SELECT;
+
+/* static local global variable declarations (current file scope only) */
+static socket_t poll_mother;      /* listening socket */
+static int ready_size = 0;       /* allocated slots in netpoll_ready */
+static int ready_count = 0;      /* used slots in netpoll_ready */
+
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_desc = -1;
+static struct epoll_event *epoll_events = NULL;
+static int epoll_events_size = 0;
+static int epoll_registered = 0; /* descriptors in the interest set */
+#endif
+
+/* static local function prototypes (current file scope only) */
+static void ready_reset(void);
+static void ready_push(struct descriptor_data *d, int events);
+static int select_wait(struct timeval *timeout, int *mother_ready);
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_wait_ready(struct timeval *timeout, int *mother_ready);
+#endif
+
+/* Pick a backend and register the mother descriptor with it.  Falls back to
+ * select() if epoll is unavailable or the caller asked for select. */
+void netpoll_init(socket_t mother, int force_select)
+{
+  poll_mother = mother;
+  netpoll_backend = NETPOLL_SELECT;
+
+  ready_size = 64;
+  CREATE(netpoll_ready, struct descriptor_data *, ready_size);
+  ready_count = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (!force_select) {
+    struct epoll_event ev;
+
+    /* Close-on-exec so the interest set does not leak across copyover. */
+    if ((epoll_desc = epoll_create1(EPOLL_CLOEXEC)) < 0)
+      perror("SYSERR: epoll_create1, falling back to select()");
+    else {
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN;
+      ev.data.ptr = NULL;  /* NULL marks the mother descriptor */
+      if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, mother, &ev) < 0) {
+        perror("SYSERR: epoll_ctl on mother descriptor, falling back to select()");
+        close(epoll_desc);
+        epoll_desc = -1;
+      } else {
+        epoll_events_size = 64;
+        CREATE(epoll_events, struct epoll_event, epoll_events_size);
+        epoll_registered = 0;
+        netpoll_backend = NETPOLL_EPOLL;
+      }
+    }
+  }
+#endif
+
+  log("Using %s for descriptor polling.", netpoll_backend_name());
+}
+
+void netpoll_shutdown(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  if (epoll_desc >= 0)
+    close(epoll_desc);
+  epoll_desc = -1;
+  if (epoll_events)
+    free(epoll_events);
+  epoll_events = NULL;
+  epoll_events_size = epoll_registered = 0;
+#endif
+  if (netpoll_ready)
+    free(netpoll_ready);
+  netpoll_ready = NULL;
+  ready_size = ready_count = 0;
+}
+
+const char *netpoll_backend_name(void)
+{
+  return (netpoll_backend == NETPOLL_EPOLL ? "epoll" : "select");
+}
+
+/* Start watching a new descriptor for input.  Returns -1 if the backend
+ * cannot handle it, in which case the caller should drop the connection. */
+int netpoll_add(struct descriptor_data *d)
+{
+  d->io_events = 0;
+  d->io_slot = -1;
+  d->io_want_write = FALSE;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll_backend == NETPOLL_EPOLL) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLPRI;
+    ev.data.ptr = d;
+    if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, d->descriptor, &ev) < 0) {
+      perror("SYSERR: epoll_ctl add");
+      return (-1);
+    }
+    /* Keep room to report every registered descriptor in a single wait. */
+    if (++epoll_registered + 1 > epoll_events_size) {
+      epoll_events_size *= 2;
+      RECREATE(epoll_events, struct epoll_event, epoll_events_size);
+    }
+    return (0);
+  }
+#endif
+
+#if !defined(CIRCLE_WINDOWS)
+  /* select() can't see anything at or past FD_SETSIZE. */
+  if (d->descriptor >= FD_SETSIZE) {
+    log("SYSERR: descriptor %d exceeds FD_SETSIZE (%d) for select().", (int)d->descriptor, FD_SETSIZE);
+    return (-1);
+  }
+#endif
+  return (0);
+}
+
+/* Stop watching a descriptor.  Must be called before the socket is closed
+ * and the descriptor freed; also drops it from the current ready set. */
+void netpoll_remove(struct descriptor_data *d)
+{
+  if (d->io_slot >= 0 && d->io_slot < ready_count && netpoll_ready[d->io_slot] == d)
+    netpoll_ready[d->io_slot] = NULL;
+  d->io_slot = -1;
+  d->io_events = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll_backend == NETPOLL_EPOLL) {
+    struct epoll_event ev;
+
+    /* A non-NULL event is required by kernels before 2.6.9. */
+    memset(&ev, 0, sizeof(ev));
+    if (epoll_ctl(epoll_desc, EPOLL_CTL_DEL, d->descriptor, &ev) < 0)
+      perror("SYSERR: epoll_ctl del");
+    else
+      epoll_registered--;
+  }
+#endif
+}
+
+/* Arm or disarm write interest.  Only descriptors holding output that the
+ * kernel would not take on the last attempt need to hear about POLLOUT. */
+void netpoll_want_write(struct descriptor_data *d, int want)
+{
+  if (d->io_want_write == want)
+    return;
+  d->io_want_write = want;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll_backend == NETPOLL_EPOLL) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLPRI | (want ? EPOLLOUT : 0);
+    ev.data.ptr = d;
+    if (epoll_ctl(epoll_desc, EPOLL_CTL_MOD, d->descriptor, &ev) < 0)
+      perror("SYSERR: epoll_ctl mod");
+  }
+#endif
+}
+
+/* Wait up to *timeout (NULL blocks forever) for activity.  On return,
+ * netpoll_ready[0..n-1] holds the descriptors with something to do and each
+ * one's io_events is set; every other descriptor has io_events == 0 from
+ * the previous pulse's reset.  Returns n, or -1 on a fatal error. */
+int netpoll_wait(struct timeval *timeout, int *mother_ready)
+{
+  *mother_ready = FALSE;
+  ready_reset();
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll_backend == NETPOLL_EPOLL)
+    return epoll_wait_ready(timeout, mother_ready);
+#endif
+  return select_wait(timeout, mother_ready);
+}
+
+static void ready_reset(void)
+{
+  int i;
+
+  for (i = 0; i < ready_count; i++)
+    if (netpoll_ready[i]) {
+      netpoll_ready[i]->io_events = 0;
+      netpoll_ready[i]->io_slot = -1;
+    }
+  ready_count = 0;
+}
+
+static void ready_push(struct descriptor_data *d, int events)
+{
+  if (ready_count >= ready_size) {
+    ready_size *= 2;
+    RECREATE(netpoll_ready, struct descriptor_data *, ready_size);
+  }
+  d->io_events = events;
+  d->io_slot = ready_count;
+  netpoll_ready[ready_count++] = d;
+}
+
+static int select_wait(struct timeval *timeout, int *mother_ready)
+{
+  fd_set input_set, output_set, exc_set;
+  struct descriptor_data *d;
+  socket_t maxdesc;
+  int events;
+
+  FD_ZERO(&input_set);
+  FD_ZERO(&output_set);
+  FD_ZERO(&exc_set);
+  FD_SET(poll_mother, &input_set);
+
+  maxdesc = poll_mother;
+  for (d = descriptor_list; d; d = d->next) {
+#ifndef CIRCLE_WINDOWS
+    if (d->descriptor > maxdesc)
+      maxdesc = d->descriptor;
+#endif
+    FD_SET(d->descriptor, &input_set);
+    FD_SET(d->descriptor, &exc_set);
+    if (d->io_want_write)
+      FD_SET(d->descriptor, &output_set);
+  }
+
+  if (select(maxdesc + 1, &input_set, &output_set, &exc_set, timeout) < 0) {
+    if (errno == EINTR)
+      return (0);
+    perror("SYSERR: Select poll");
+    return (-1);
+  }
+
+  if (FD_ISSET(poll_mother, &input_set))
+    *mother_ready = TRUE;
+
+  for (d = descriptor_list; d; d = d->next) {
+    events = 0;
+    if (FD_ISSET(d->descriptor, &input_set))
+      events |= NETPOLL_READ;
+    if (FD_ISSET(d->descriptor, &output_set))
+      events |= NETPOLL_WRITE;
+    if (FD_ISSET(d->descriptor, &exc_set))
+      events |= NETPOLL_EXCEPT;
+    if (events)
+      ready_push(d, events);
+  }
+  return (ready_count);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_wait_ready(struct timeval *timeout, int *mother_ready)
+{
+  struct descriptor_data *d;
+  int i, n, events, msec = -1;
+
+  if (timeout)
+    msec = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
+
+  if ((n = epoll_wait(epoll_desc, epoll_events, epoll_events_size, msec)) < 0) {
+    if (errno == EINTR)
+      return (0);
+    perror("SYSERR: epoll_wait");
+    return (-1);
+  }
+
+  for (i = 0; i < n; i++) {
+    if ((d = (struct descriptor_data *) epoll_events[i].data.ptr) == NULL) {
+      *mother_ready = TRUE;
+      continue;
+    }
+    events = 0;
+    /* A hangup is reported as readable; process_input() sees the EOF. */
+    if (epoll_events[i].events & (EPOLLIN | EPOLLHUP))
+      events |= NETPOLL_READ;
+    if (epoll_events[i].events & EPOLLOUT)
+      events |= NETPOLL_WRITE;
+    if (epoll_events[i].events & (EPOLLPRI | EPOLLERR))
+      events |= NETPOLL_EXCEPT;
+    if (events)
+      ready_push(d, events);
+  }
+  return (ready_count);
+}
+#endif /* HAVE_SYS_EPOLL_H */
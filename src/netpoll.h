@@ -0,0 +1,39 @@
+/**
+* @file netpoll.h
+* Descriptor readiness backends (epoll and select) used by game_loop().
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _NETPOLL_H_
+#define _NETPOLL_H_
+
+/* Readiness bits stored in descriptor_data.io_events by netpoll_wait(). */
+#define NETPOLL_READ    (1 << 0)  /**< input (or EOF) waiting to be read */
+#define NETPOLL_WRITE   (1 << 1)  /**< socket can accept more output */
+#define NETPOLL_EXCEPT  (1 << 2)  /**< out-of-band data or socket error */
+
+/* Backend identifiers */
+#define NETPOLL_SELECT  0
+#define NETPOLL_EPOLL   1
+
+/* netpoll.c */
+void netpoll_init(socket_t mother, int force_select);
+void netpoll_shutdown(void);
+const char *netpoll_backend_name(void);
+int netpoll_add(struct descriptor_data *d);
+void netpoll_remove(struct descriptor_data *d);
+void netpoll_want_write(struct descriptor_data *d, int want);
+int netpoll_wait(struct timeval *timeout, int *mother_ready);
+
+/** Descriptors reported ready by the last netpoll_wait().  Entries are set
+ * to NULL by netpoll_remove() if the descriptor is closed mid-pulse. */
+extern struct descriptor_data **netpoll_ready;
+extern int netpoll_backend;
+
+#endif /* _NETPOLL_H_ */
@@ -13,6 +13,7 @@
 #include "comm.h"
 #include "interpreter.h"
 #include "handler.h"
+#include "graph.h"
 #include "db.h"
 #include "shop.h"
 #include "genshp.h"
@@ -23,6 +24,7 @@
 #include "improved-edit.h"
 #include "constants.h"
 #include "dg_scripts.h"
+#include "strpool.h"
 
 /* Local, filescope function prototypes */
 /* Utility function for buildwalk */
@@ -198,9 +200,9 @@ ACMD(do_dig)
     if (W_EXIT(IN_ROOM(ch), dir)) {
       /* free the old pointers, if any */
       if (W_EXIT(IN_ROOM(ch), dir)->general_description)
-        free(W_EXIT(IN_ROOM(ch), dir)->general_description);
+        release_string(W_EXIT(IN_ROOM(ch), dir)->general_description);
       if (W_EXIT(IN_ROOM(ch), dir)->keyword)
-        free(W_EXIT(IN_ROOM(ch), dir)->keyword);
+        release_string(W_EXIT(IN_ROOM(ch), dir)->keyword);
       free(W_EXIT(IN_ROOM(ch), dir));
       W_EXIT(IN_ROOM(ch), dir) = NULL;
       add_to_save_list(zone_table[world[IN_ROOM(ch)].zone].number, SL_WLD);
@@ -284,7 +286,9 @@ ACMD(do_dig)
     W_EXIT(rrnum, rev_dir[dir])->keyword = NULL;
     W_EXIT(rrnum, rev_dir[dir])->to_room = IN_ROOM(ch);
     add_to_save_list(zone_table[world[rrnum].zone].number, SL_WLD);
+    route_room_changed(rrnum);
   }
+  route_room_changed(IN_ROOM(ch));
 }
 
 /* BuildWalk - OasisOLC Extension by D. Tyler Barnes. */
@@ -355,6 +359,8 @@ int buildwalk(struct char_data *ch, int dir)
       EXIT(ch, dir)->to_room = rnum;
       CREATE(world[rnum].dir_option[rev_dir[dir]], struct room_direction_data, 1);
       world[rnum].dir_option[rev_dir[dir]]->to_room = IN_ROOM(ch);
+      route_room_changed(IN_ROOM(ch));
+      route_room_changed(rnum);
 
       /* Report room creation to user */
       send_to_char(ch, "%sRoom #%d created by BuildWalk.%s\r\n", yel, vnum, nrm);
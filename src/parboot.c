@@ -0,0 +1,242 @@
+/**************************************************************************
+*  File: parboot.c                                         Part of tbaMUD *
+*  Usage: Parsing the room, mobile and object files on several threads    *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* index_boot() already reads every area file once to count its records
+ * before the tables are allocated, so it knows the rnum each file's first
+ * record will get.  That makes the files independent: each one can be
+ * parsed straight into its own slice of world[], mob_proto[] or obj_proto[]
+ * while other threads parse the others.  index_boot() then closes any gaps
+ * between the slices, leaving the tables exactly as a serial boot would.
+ *
+ * Anything a file logs while it is parsed is kept with the file and written
+ * out in index order once every file is done, so the log reads the same no
+ * matter how the files were spread over the threads.  The parsers still
+ * exit() on a format error; when a worker does, the messages of that file
+ * and of the ones before it are written first, so the SYSERR and everything
+ * leading up to it still reach the log.
+ *
+ * Zones, triggers, shops and help are left to the main thread: they are
+ * small, and their loaders count records as they go. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "profiler.h"
+#include "parboot.h"
+
+/* zmalloc's bookkeeping is not thread safe. */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD) && !defined(MEMORY_DEBUG)
+#define PARALLEL_BOOT
+#endif
+
+int boot_threads = 1;
+
+#ifdef PARALLEL_BOOT
+/* The files being loaded.  pool_next is guarded by pool_lock, as are the
+ * log buffers of the jobs. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t pool_key;   /* job being parsed by this thread */
+static struct boot_job *pool_jobs = NULL;
+static int pool_num = 0, pool_next = 0, pool_mode = 0, pool_running = FALSE;
+
+/* Serializes the rare parser paths that touch shared state. */
+static pthread_mutex_t boot_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* local functions */
+static void *boot_worker(void *arg);
+static void load_boot_job(struct boot_job *job);
+static void replay_boot_log(struct boot_job *job);
+static void replay_on_exit(void);
+
+static void load_boot_job(struct boot_job *job)
+{
+  FILE *fl;
+  prof_time start = prof_now();
+  int rnum = job->first;
+
+  if (!(fl = fopen(job->filename, "r"))) {
+    log("SYSERR: %s: %s", job->filename, strerror(errno));
+    exit(1);
+  }
+  discrete_load(fl, pool_mode, job->filename, &rnum);
+  fclose(fl);
+
+  job->loaded = rnum - job->first;
+  job->usec = prof_now() - start;
+}
+
+static void *boot_worker(void *arg)
+{
+  struct boot_job *job;
+
+  for (;;) {
+    pthread_mutex_lock(&pool_lock);
+    job = pool_next < pool_num ? &pool_jobs[pool_next++] : NULL;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!job)
+      return (NULL);
+
+    pthread_setspecific(pool_key, job);
+    load_boot_job(job);
+    pthread_setspecific(pool_key, NULL);
+  }
+}
+
+static void replay_boot_log(struct boot_job *job)
+{
+  char *msg;
+
+  for (msg = job->log; msg && msg < job->log + job->log_len; msg += strlen(msg) + 1)
+    basic_mud_log("%s", msg);
+
+  if (job->log)
+    free(job->log);
+  job->log = NULL;
+  job->log_len = job->log_size = 0;
+}
+
+/* A parser called exit() in one of the workers.  The lock is never released:
+ * the other workers must not log while this runs, and the process is on its
+ * way out. */
+static void replay_on_exit(void)
+{
+  struct boot_job *job;
+  int i;
+
+  if (!pool_running || !(job = pthread_getspecific(pool_key)))
+    return;
+
+  pthread_mutex_lock(&pool_lock);
+  pthread_setspecific(pool_key, NULL);
+  for (i = 0; i <= job - pool_jobs; i++)
+    replay_boot_log(&pool_jobs[i]);
+}
+#endif /* PARALLEL_BOOT */
+
+/** Parse the files in jobs[] on boot_threads threads.  Each file's records
+ * are stored from jobs[i].first on, and jobs[i].loaded is set to how many
+ * there were.
+ * @param jobs The files listed in the index, in order.
+ * @param num_jobs Number of entries in jobs.
+ * @param mode DB_BOOT_WLD, DB_BOOT_MOB or DB_BOOT_OBJ.
+ * @retval int FALSE if the files were not loaded and the caller should load
+ * them itself. */
+int parallel_discrete_load(struct boot_job *jobs, int num_jobs, int mode)
+{
+#ifdef PARALLEL_BOOT
+  static int initialized = FALSE;
+  const char *what[] = {"world", "mob", "obj"};
+  unsigned long parse_time = 0;
+  pthread_t *threads;
+  prof_time start;
+  int num_threads, started, i, err;
+
+  if (boot_threads < 2 || num_jobs < 2)
+    return (FALSE);
+
+  if (!initialized) {
+    if ((err = pthread_key_create(&pool_key, NULL)) != 0) {
+      log("SYSERR: Cannot parse the area files in parallel: %s", strerror(err));
+      boot_threads = 1;
+      return (FALSE);
+    }
+    atexit(replay_on_exit);
+    initialized = TRUE;
+  }
+
+  start = prof_now();
+  num_threads = MIN(boot_threads, num_jobs);
+
+  pool_jobs = jobs;
+  pool_num = num_jobs;
+  pool_next = 0;
+  pool_mode = mode;
+  pool_running = TRUE;
+
+  /* The main thread takes jobs too. */
+  CREATE(threads, pthread_t, num_threads - 1);
+  for (started = 0; started < num_threads - 1; started++)
+    if ((err = pthread_create(&threads[started], NULL, boot_worker, NULL)) != 0) {
+      log("SYSERR: Cannot start boot thread: %s", strerror(err));
+      break;
+    }
+  boot_worker(NULL);
+
+  for (i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  pool_running = FALSE;
+
+  for (i = 0; i < num_jobs; i++) {
+    replay_boot_log(&jobs[i]);
+    parse_time += jobs[i].usec;
+  }
+
+  log("   Parsed %d %s files on %d threads in %lu ms (%lu ms of parsing).",
+      num_jobs, what[mode], started + 1, (prof_now() - start) / 1000, parse_time / 1000);
+  return (TRUE);
+#else
+  if (boot_threads > 1) {
+    log("SYSERR: Built without thread support; parsing the area files in one thread.");
+    boot_threads = 1;
+  }
+  return (FALSE);
+#endif
+}
+
+/** Called by basic_mud_vlog().  While a worker is parsing a file, what it
+ * logs is kept with the file, to be written out in index order.
+ * @retval int TRUE if the message was kept, FALSE if it should be logged. */
+int boot_log_capture(const char *format, va_list args)
+{
+#ifdef PARALLEL_BOOT
+  struct boot_job *job;
+  char msg[MAX_STRING_LENGTH];
+  size_t len;
+
+  if (!pool_running || !(job = pthread_getspecific(pool_key)))
+    return (FALSE);
+
+  vsnprintf(msg, sizeof(msg), format, args);
+  len = strlen(msg) + 1;
+
+  pthread_mutex_lock(&pool_lock);
+  if (job->log_len + len > job->log_size) {
+    job->log_size = MAX(job->log_size * 2, job->log_len + len);
+    RECREATE(job->log, char, job->log_size);
+  }
+  memcpy(job->log + job->log_len, msg, len);
+  job->log_len += len;
+  pthread_mutex_unlock(&pool_lock);
+
+  return (TRUE);
+#else
+  return (FALSE);
+#endif
+}
+
+/** Guard a parser path that changes shared state, such as the OLC save list
+ * when old world files are converted. */
+void lock_boot(void)
+{
+#ifdef PARALLEL_BOOT
+  pthread_mutex_lock(&boot_lock);
+#endif
+}
+
+void unlock_boot(void)
+{
+#ifdef PARALLEL_BOOT
+  pthread_mutex_unlock(&boot_lock);
+#endif
+}
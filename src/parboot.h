@@ -0,0 +1,38 @@
+/**
+* @file parboot.h
+* Parsing the room, mobile and object files on several threads at boot.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _PARBOOT_H_
+#define _PARBOOT_H_
+
+/** One area file for the parallel loader.  index_boot() fills in filename
+ * and first; the loader fills in the rest. */
+struct boot_job {
+  char *filename;    /**< path of the area file */
+  int first;         /**< rnum given to the file's first record */
+  int loaded;        /**< number of records parsed from the file */
+  unsigned long usec; /**< time spent parsing the file */
+  char *log;         /**< messages logged while parsing, each '\0'-terminated */
+  size_t log_len;    /**< bytes used in log */
+  size_t log_size;   /**< bytes allocated for log */
+};
+
+/* parboot.c */
+int parallel_discrete_load(struct boot_job *jobs, int num_jobs, int mode);
+int boot_log_capture(const char *format, va_list args);
+void lock_boot(void);
+void unlock_boot(void);
+
+/** Threads used to parse the area files (-t); 1 parses them in the main
+ * thread, as before. */
+extern int boot_threads;
+
+#endif /* _PARBOOT_H_ */
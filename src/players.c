@@ -46,6 +46,124 @@ static void load_HMVS(struct char_data *ch, const char *line, int mode);
 static void write_aliases_ascii(FILE *file, struct char_data *ch);
 static void read_aliases_ascii(FILE *file, struct char_data *ch, int count);
 
+/* Names loaded in bulk share one allocation; see set_player_index_arena(). */
+static char *ptable_arena = NULL;
+static size_t ptable_arena_len = 0;
+
+/* Open addressed hashes from lowercased name and from id to a position in
+ * player_table, which itself is never reordered (GET_PFILEPOS points in).
+ * Slots hold -1 when empty.  A slot whose entry has since been renamed or
+ * given a new id no longer matches and is skipped; both are rebuilt from
+ * scratch when entries move or the tables fill up. */
+static int *ptable_name_hash = NULL;
+static int *ptable_id_hash = NULL;
+static int ptable_hash_size = 0;   /* power of two */
+static int ptable_name_used = 0, ptable_id_used = 0;
+
+static bool ptable_name_in_arena(const char *name)
+{
+  return (ptable_arena && name >= ptable_arena && name < ptable_arena + ptable_arena_len);
+}
+
+static void free_ptable_name(int pos)
+{
+  if (PT_PNAME(pos) && !ptable_name_in_arena(PT_PNAME(pos)))
+    free(PT_PNAME(pos));
+  PT_PNAME(pos) = NULL;
+}
+
+/* Hands the block holding all the names of a freshly loaded index over to
+ * the index.  Names later replaced or removed are simply left in it. */
+void set_player_index_arena(char *arena, size_t len)
+{
+  if (ptable_arena)
+    free(ptable_arena);
+  ptable_arena = arena;
+  ptable_arena_len = len;
+}
+
+static unsigned int ptable_name_key(const char *name)
+{
+  unsigned int h = 2166136261u;
+
+  for (; *name; name++)
+    h = (h ^ (unsigned char) LOWER(*name)) * 16777619u;
+  return (h);
+}
+
+static unsigned int ptable_id_key(long id)
+{
+  return ((unsigned int) id * 2654435761u);
+}
+
+static void ptable_hash_put(int *hash, unsigned int key, int pos)
+{
+  unsigned int mask = ptable_hash_size - 1;
+
+  for (key &= mask; hash[key] != -1; key = (key + 1) & mask)
+    /* Nothing */;
+  hash[key] = pos;
+}
+
+/* Rebuilds both hashes for the whole table, after it is loaded, after
+ * entries are removed, or when an insert would fill them past half. */
+void index_player_table(void)
+{
+  int i, size, num = top_of_p_table + 1;
+
+  for (size = 64; size < num * 4; size <<= 1)
+    /* Nothing */;
+  if (size != ptable_hash_size || !ptable_name_hash) {
+    ptable_hash_size = size;
+    RECREATE(ptable_name_hash, int, ptable_hash_size);
+    RECREATE(ptable_id_hash, int, ptable_hash_size);
+  }
+  memset(ptable_name_hash, -1, ptable_hash_size * sizeof(int));
+  memset(ptable_id_hash, -1, ptable_hash_size * sizeof(int));
+
+  for (i = 0; i < num; i++) {
+    ptable_hash_put(ptable_name_hash, ptable_name_key(PT_PNAME(i)), i);
+    ptable_hash_put(ptable_id_hash, ptable_id_key(PT_IDNUM(i)), i);
+  }
+  ptable_name_used = ptable_id_used = num;
+}
+
+/* Indexes the name at pos, a new entry or one just renamed. */
+static void ptable_hash_add_name(int pos)
+{
+  if (!ptable_name_hash || (ptable_name_used + 1) * 2 > ptable_hash_size)
+    index_player_table();
+  else {
+    ptable_hash_put(ptable_name_hash, ptable_name_key(PT_PNAME(pos)), pos);
+    ptable_name_used++;
+  }
+}
+
+/* Gives the entry at pos its id number and indexes it. */
+void set_player_index_id(int pos, long id)
+{
+  if (pos < 0 || pos > top_of_p_table)
+    return;
+
+  PT_IDNUM(pos) = id;
+  if (!ptable_id_hash || (ptable_id_used + 1) * 2 > ptable_hash_size)
+    index_player_table();
+  else {
+    ptable_hash_put(ptable_id_hash, ptable_id_key(id), pos);
+    ptable_id_used++;
+  }
+}
+
+static void free_ptable_hash(void)
+{
+  if (ptable_name_hash)
+    free(ptable_name_hash);
+  if (ptable_id_hash)
+    free(ptable_id_hash);
+  ptable_name_hash = ptable_id_hash = NULL;
+  ptable_hash_size = ptable_name_used = ptable_id_used = 0;
+}
+
 /* New version to build player index for ASCII Player Files. Generate index
  * table for the player file. */
 void build_player_index()
@@ -86,6 +204,7 @@ void build_player_index()
 
   fclose(plr_index);
   top_of_p_file = top_of_p_table = i - 1;
+  index_player_table();
 }
 
 /* Create a new entry in the in-memory index table for the player file. If the
@@ -94,6 +213,7 @@ void build_player_index()
 int create_entry(char *name)
 {
   int i, pos;
+  bool new_name = TRUE;
 
   if (top_of_p_table == -1) {	/* no table */
     pos = top_of_p_table = 0;
@@ -103,13 +223,19 @@ int create_entry(char *name)
 
     RECREATE(player_table, struct player_index_element, i);
     pos = top_of_p_table;
-  }
+    PT_PNAME(pos) = NULL;
+    PT_IDNUM(pos) = 0;
+  } else
+    new_name = FALSE;
 
+  free_ptable_name(pos);
   CREATE(player_table[pos].name, char, strlen(name) + 1);
 
   /* copy lowercase equivalent of name to table field */
   for (i = 0; (player_table[pos].name[i] = LOWER(name[i])); i++)
     /* Nothing */;
+  if (new_name)
+    ptable_hash_add_name(pos);
 
   /* clear the bitflag in case we have garbage data */
   player_table[pos].flags = 0;
@@ -128,7 +254,7 @@ void remove_player_from_index(int pos)
     return;
 
   /* We only need to free the name string */
-  free(PT_PNAME(pos));
+  free_ptable_name(pos);
 
   /* Move every other item in the list down the index */
   for (i = pos+1; i <= top_of_p_table; i++) {
@@ -150,6 +276,48 @@ void remove_player_from_index(int pos)
     free(player_table);
     player_table = NULL;
   }
+  index_player_table();
+}
+
+/* Renames entry pos in place, keeping the name order intact. */
+void rename_player_in_index(int pos, const char *name)
+{
+  int i;
+
+  if (pos < 0 || pos > top_of_p_table)
+    return;
+
+  free_ptable_name(pos);
+  CREATE(PT_PNAME(pos), char, strlen(name) + 1);
+  for (i = 0; (PT_PNAME(pos)[i] = LOWER(name[i])); i++)
+    /* Nothing */;
+  ptable_hash_add_name(pos);
+}
+
+/* Drops every entry whose name was blanked by a purge in one pass, then
+ * reindexes.  Surviving entries keep their relative order. */
+void compact_player_index(void)
+{
+  int i, j;
+
+  for (i = j = 0; i <= top_of_p_table; i++) {
+    if (!*PT_PNAME(i)) {
+      free_ptable_name(i);
+      continue;
+    }
+    if (i != j)
+      player_table[j] = player_table[i];
+    j++;
+  }
+  top_of_p_table = j - 1;
+
+  if (top_of_p_table >= 0)
+    RECREATE(player_table, struct player_index_element, (top_of_p_table+1));
+  else {
+    free(player_table);
+    player_table = NULL;
+  }
+  index_player_table();
 }
 
 /* This function necessary to save a seperate ASCII player index */
@@ -185,43 +353,54 @@ void free_player_index(void)
     return;
 
   for (tp = 0; tp <= top_of_p_table; tp++)
-    if (player_table[tp].name)
-      free(player_table[tp].name);
+    free_ptable_name(tp);
 
   free(player_table);
   player_table = NULL;
   top_of_p_table = 0;
+
+  set_player_index_arena(NULL, 0);
+  free_ptable_hash();
 }
 
 long get_ptable_by_name(const char *name)
 {
-  int i;
+  unsigned int key, mask;
+  int pos;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (i);
+  if (!ptable_name_hash)
+    return (-1);
+
+  mask = ptable_hash_size - 1;
+  for (key = ptable_name_key(name) & mask; (pos = ptable_name_hash[key]) != -1; key = (key + 1) & mask)
+    if (!str_cmp(PT_PNAME(pos), name))
+      return (pos);
 
   return (-1);
 }
 
 long get_id_by_name(const char *name)
 {
-  int i;
+  long pos;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (player_table[i].id);
+  if ((pos = get_ptable_by_name(name)) < 0)
+    return (-1);
 
-  return (-1);
+  return (player_table[pos].id);
 }
 
 char *get_name_by_id(long id)
 {
-  int i;
+  unsigned int key, mask;
+  int pos;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (player_table[i].id == id)
-      return (player_table[i].name);
+  if (!ptable_id_hash)
+    return (NULL);
+
+  mask = ptable_hash_size - 1;
+  for (key = ptable_id_key(id) & mask; (pos = ptable_id_hash[key]) != -1; key = (key + 1) & mask)
+    if (PT_IDNUM(pos) == id)
+      return (PT_PNAME(pos));
 
   return (NULL);
 }
@@ -511,7 +690,7 @@ int load_char(const char *name, struct char_data *ch)
           if ((t_rnum = real_trigger(atoi(line))) != NOTHING) {
             t = read_trigger(t_rnum);
           if (!SCRIPT(ch))
-            CREATE(SCRIPT(ch), struct script_data, 1);
+            SCRIPT(ch) = create_script(ch, MOB_TRIGGER);
           add_trigger(SCRIPT(ch), t, -1);
           }
          }
@@ -915,38 +1094,47 @@ void remove_player(int pfilepos)
   save_player_index();
 }
 
+/* Should the player at pos be purged: either flagged for deletion or idle
+ * past the pclean criteria for their level, and not protected. */
+int pfile_needs_cleaning(int pos, time_t now)
+{
+  int ci;
+
+  /* We only want to go further if the player isn't protected from deletion
+   * and hasn't already been deleted. */
+  if (IS_SET(player_table[pos].flags, PINDEX_NODELETE) || !*player_table[pos].name)
+    return FALSE;
+
+  /* If the player is already flagged for deletion, then go ahead and get
+   * rid of him. */
+  if (IS_SET(player_table[pos].flags, PINDEX_DELETED))
+    return TRUE;
+
+  /* Check to see if the player has overstayed his welcome based on level. */
+  for (ci = 0; pclean_criteria[ci].level > -1; ci++)
+    if (player_table[pos].level <= pclean_criteria[ci].level &&
+        ((now - player_table[pos].last) > (pclean_criteria[ci].days * SECS_PER_REAL_DAY)))
+      return TRUE;
+
+  /* If we got this far and the players hasn't been kicked out, then he
+   * can stay a little while longer. */
+  return FALSE;
+}
+
 void clean_pfiles(void)
 {
-  int i, ci;
-
-  for (i = 0; i <= top_of_p_table; i++) {
-    /* We only want to go further if the player isn't protected from deletion
-     * and hasn't already been deleted. */
-    if (!IS_SET(player_table[i].flags, PINDEX_NODELETE) &&
-        *player_table[i].name) {
-      /* If the player is already flagged for deletion, then go ahead and get
-       * rid of him. */
-      if (IS_SET(player_table[i].flags, PINDEX_DELETED)) {
-	//remove_player(i);
-        remove_player_mysql(player_table[i].id);
-      } else {
-        /* Check to see if the player has overstayed his welcome based on level. */
-	for (ci = 0; pclean_criteria[ci].level > -1; ci++) {
-	  if (player_table[i].level <= pclean_criteria[ci].level &&
-	      ((time(0) - player_table[i].last) >
-	       (pclean_criteria[ci].days * SECS_PER_REAL_DAY))) {
-//	    remove_player(i);
-            remove_player_mysql(player_table[i].id);
-	    break;
-	  }
-	}
-        /* If we got this far and the players hasn't been kicked out, then he
-	 * can stay a little while longer. */
-      }
-    }
+  time_t now = time(0);
+  int i;
+
+  if (USING_MYSQL_DATABASE_FOR_PLAYERFILE == TRUE) {
+    clean_pfiles_mysql();
+    return;
   }
-  /* After everything is done, we should rebuild player_index and remove the
-   * entries of the players that were just deleted. */
+
+  /* Walk down so removing an entry doesn't skip the one after it. */
+  for (i = top_of_p_table; i >= 0; i--)
+    if (pfile_needs_cleaning(i, now))
+      remove_player(i);
 }
 
 /* load_affects function now handles both 32-bit and
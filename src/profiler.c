@@ -0,0 +1,262 @@
+/**************************************************************************
+*  File: profiler.c                                        Part of tbaMUD *
+*  Usage: Timing of game_loop() phases and heartbeat() stages.            *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* Every pass through game_loop() is expected to fit in one pulse (OPT_USEC).
+ * When it doesn't, all we used to hear about was a "Missed N seconds worth
+ * of pulses" line well after the fact.  Each phase of game_loop() and each
+ * stage of heartbeat() is timed here with a monotonic clock; the last
+ * PROF_SAMPLES times of every stage are kept for the 'profile' command, and
+ * a pass that runs over budget is logged with the stage that ate the time. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "interpreter.h"
+#include "modify.h"
+#include "profiler.h"
+
+struct prof_stat {
+  prof_time samples[PROF_SAMPLES]; /* most recent durations, usec */
+  int next;                        /* slot the next sample goes in */
+  long calls;                      /* since the last reset */
+  prof_time max;                   /* since the last reset */
+  prof_time this_pulse;            /* total during the current pulse */
+};
+
+/* Names shown by 'profile' and in slow pulse reports, and which stage each
+ * one is part of (-1 for the phases of game_loop() itself). */
+static const struct {
+  const char *name;
+  int parent;
+} prof_stages[NUM_PROF_STAGES] = {
+  { "input",                 -1 },
+  { "commands",              -1 },
+  { "output",                -1 },
+  { "prompts",               PROF_OUTPUT },
+  { "heartbeat",             -1 },
+  { "event_process",         PROF_HEARTBEAT },
+  { "script_trigger_check",  PROF_HEARTBEAT },
+  { "msdp_update",           PROF_HEARTBEAT },
+  { "zone_update",           PROF_HEARTBEAT },
+  { "run_zone_resets",       PROF_HEARTBEAT },
+  { "check_idle_passwords",  PROF_HEARTBEAT },
+  { "mobile_activity",       PROF_HEARTBEAT },
+  { "perform_violence",      PROF_HEARTBEAT },
+  { "weather_and_time",      PROF_HEARTBEAT },
+  { "check_time_triggers",   PROF_HEARTBEAT },
+  { "affect_update",         PROF_HEARTBEAT },
+  { "point_update",          PROF_HEARTBEAT },
+  { "check_timed_quests",    PROF_HEARTBEAT },
+  { "autosave",              PROF_HEARTBEAT },
+  { "record_usage",          PROF_HEARTBEAT },
+  { "save_mud_time",         PROF_HEARTBEAT },
+  { "extract_pending_chars", PROF_HEARTBEAT },
+  { "whole pulse",           -1 }
+};
+
+/* static local global variable declarations (current file scope only) */
+static struct prof_stat prof_stats[NUM_PROF_STAGES];
+static prof_time pulse_start;
+static prof_time last_report;       /* when the last slow pulse was logged */
+static int have_reported = FALSE;
+static long slow_pulses = 0;        /* since the last reset */
+static long unreported = 0;         /* slow pulses not logged since then */
+static char last_slow[MAX_INPUT_LENGTH] = "\0";
+
+/* static local function prototypes (current file scope only) */
+static int prof_worst_child(int parent);
+static void report_slow_pulse(prof_time total);
+static int compare_prof_time(const void *a, const void *b);
+static void prof_percentiles(struct prof_stat *s, prof_time *p50, prof_time *p99);
+
+prof_time prof_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (prof_time) ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#endif
+  {
+    struct timeval tv;
+
+    gettimeofday(&tv, (struct timezone *) 0);
+    return (prof_time) tv.tv_sec * 1000000UL + tv.tv_usec;
+  }
+}
+
+/** Record that stage ran from start until now. */
+void prof_stop(int stage, prof_time start)
+{
+  struct prof_stat *s = &prof_stats[stage];
+  prof_time elapsed = prof_now() - start;
+
+  s->samples[s->next] = elapsed;
+  s->next = (s->next + 1) % PROF_SAMPLES;
+  s->calls++;
+  if (elapsed > s->max)
+    s->max = elapsed;
+  s->this_pulse += elapsed;
+}
+
+/** Called when game_loop() wakes up for a new pulse. */
+void prof_pulse_begin(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_PROF_STAGES; i++)
+    prof_stats[i].this_pulse = 0;
+  pulse_start = prof_now();
+}
+
+/** Called when game_loop() has finished a pulse, before it sleeps. */
+void prof_pulse_end(void)
+{
+  prof_stop(PROF_PULSE, pulse_start);
+
+  if (prof_stats[PROF_PULSE].this_pulse > PROF_SLOW_PULSE)
+    report_slow_pulse(prof_stats[PROF_PULSE].this_pulse);
+}
+
+void prof_reset(void)
+{
+  memset(prof_stats, 0, sizeof(prof_stats));
+  slow_pulses = 0;
+  unreported = 0;
+  *last_slow = '\0';
+}
+
+/* The stage under parent (-1 for the top level) that took the most time
+ * this pulse, or NOTHING if none of them ran. */
+static int prof_worst_child(int parent)
+{
+  int i, worst = NOTHING;
+
+  for (i = 0; i < NUM_PROF_STAGES; i++) {
+    if (i == PROF_PULSE || prof_stages[i].parent != parent || !prof_stats[i].this_pulse)
+      continue;
+    if (worst == NOTHING || prof_stats[i].this_pulse > prof_stats[worst].this_pulse)
+      worst = i;
+  }
+  return worst;
+}
+
+static void report_slow_pulse(prof_time total)
+{
+  char buf[MAX_STRING_LENGTH];
+  size_t len = 0;
+  int i, worst, child;
+  prof_time now = prof_now();
+
+  slow_pulses++;
+
+  /* Name the slowest stage, and the slowest part of it if it has parts. */
+  if ((worst = prof_worst_child(-1)) == NOTHING)
+    snprintf(last_slow, sizeof(last_slow), "%.1f ms, no stage stands out", total / 1000.0);
+  else if ((child = prof_worst_child(worst)) == NOTHING)
+    snprintf(last_slow, sizeof(last_slow), "%.1f ms, mostly %s (%.1f ms)", total / 1000.0,
+      prof_stages[worst].name, prof_stats[worst].this_pulse / 1000.0);
+  else
+    snprintf(last_slow, sizeof(last_slow), "%.1f ms, mostly %s/%s (%.1f ms)", total / 1000.0,
+      prof_stages[worst].name, prof_stages[child].name, prof_stats[child].this_pulse / 1000.0);
+
+  if (have_reported && now - last_report < PROF_REPORT_SECS * 1000000UL) {
+    unreported++;
+    return;
+  }
+  have_reported = TRUE;
+  last_report = now;
+
+  log("SYSERR: Slow pulse: %s; budget %d ms.", last_slow, PROF_SLOW_PULSE / 1000);
+  if (unreported) {
+    log("SYSERR: (%ld more slow pulses in the last %d seconds were not logged)", unreported, PROF_REPORT_SECS);
+    unreported = 0;
+  }
+
+  /* and everything that took a measurable amount of time */
+  for (i = 0; i < NUM_PROF_STAGES; i++) {
+    if (i == PROF_PULSE || prof_stats[i].this_pulse < 100)
+      continue;
+    len += snprintf(buf + len, sizeof(buf) - len, " %s %.1f", prof_stages[i].name, prof_stats[i].this_pulse / 1000.0);
+    if (len >= sizeof(buf))
+      break;
+  }
+  if (len)
+    log("SYSERR: Slow pulse stages (ms):%s", buf);
+}
+
+static int compare_prof_time(const void *a, const void *b)
+{
+  prof_time x = *(const prof_time *) a, y = *(const prof_time *) b;
+
+  return (x > y) - (x < y);
+}
+
+static void prof_percentiles(struct prof_stat *s, prof_time *p50, prof_time *p99)
+{
+  prof_time sorted[PROF_SAMPLES];
+  int n = s->calls < PROF_SAMPLES ? (int) s->calls : PROF_SAMPLES;
+
+  *p50 = *p99 = 0;
+  if (n < 1)
+    return;
+
+  /* until the ring fills, the samples are the first n slots */
+  memcpy(sorted, s->samples, n * sizeof(prof_time));
+  qsort(sorted, n, sizeof(prof_time), compare_prof_time);
+  *p50 = sorted[(n - 1) * 50 / 100];
+  *p99 = sorted[(n - 1) * 99 / 100];
+}
+
+ACMD(do_profile)
+{
+  char arg[MAX_INPUT_LENGTH], buf[MAX_STRING_LENGTH];
+  size_t len;
+  int i, nlen;
+  prof_time p50, p99;
+
+  one_argument(argument, arg);
+
+  if (*arg && is_abbrev(arg, "reset")) {
+    prof_reset();
+    send_to_char(ch, "Pulse timings cleared.\r\n");
+    return;
+  } else if (*arg) {
+    send_to_char(ch, "Usage: profile [reset]\r\n");
+    return;
+  }
+
+  len = snprintf(buf, sizeof(buf),
+    "Stage                        Calls   p50 ms   p99 ms   max ms\r\n"
+    "---------------------------------------------------------------\r\n");
+
+  for (i = 0; i < NUM_PROF_STAGES; i++) {
+    if (!prof_stats[i].calls)
+      continue;
+    prof_percentiles(&prof_stats[i], &p50, &p99);
+    nlen = snprintf(buf + len, sizeof(buf) - len, "%s%-*s %8ld %8.2f %8.2f %8.2f\r\n",
+      prof_stages[i].parent == -1 ? "" : "  ", prof_stages[i].parent == -1 ? 25 : 23,
+      prof_stages[i].name, prof_stats[i].calls, p50 / 1000.0, p99 / 1000.0, prof_stats[i].max / 1000.0);
+    if (len + nlen >= sizeof(buf))
+      break;
+    len += nlen;
+  }
+
+  nlen = snprintf(buf + len, sizeof(buf) - len,
+    "\r\nPercentiles cover the last %d calls of each stage.\r\n"
+    "Pulses over %d ms: %ld%s%s\r\n", PROF_SAMPLES, PROF_SLOW_PULSE / 1000, slow_pulses,
+    *last_slow ? ", last one " : "", last_slow);
+  if (len + nlen < sizeof(buf))
+    len += nlen;
+
+  page_string(ch->desc, buf, TRUE);
+}
@@ -0,0 +1,69 @@
+/**
+* @file profiler.h
+* Per-pulse timing of game_loop() phases and heartbeat() stages.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+/* Timed stages.  Keep in sync with prof_stages[] in profiler.c. */
+enum prof_stage {
+  PROF_INPUT,           /**< poll, accept and read input */
+  PROF_COMMANDS,        /**< run queued commands */
+  PROF_OUTPUT,          /**< flush output, prompts and closes */
+  PROF_PROMPT,          /**< ... of which building and sending prompts */
+  PROF_HEARTBEAT,       /**< all of heartbeat() */
+  PROF_EVENTS,
+  PROF_SCRIPTS,
+  PROF_MSDP,
+  PROF_ZONES,
+  PROF_ZONE_RESETS,
+  PROF_IDLE_PASSWORDS,
+  PROF_MOBILES,
+  PROF_VIOLENCE,
+  PROF_WEATHER,
+  PROF_TIME_TRIGGERS,
+  PROF_AFFECTS,
+  PROF_POINTS,
+  PROF_TIMED_QUESTS,
+  PROF_AUTOSAVE,
+  PROF_USAGE,
+  PROF_TIMESAVE,
+  PROF_EXTRACT,
+  PROF_PULSE,           /**< one whole pass of game_loop(), minus the sleep */
+  NUM_PROF_STAGES
+};
+
+/** Samples kept per stage for the percentiles shown by 'profile'. */
+#define PROF_SAMPLES     256
+/** A pass through game_loop() slower than this (usec) is logged. */
+#define PROF_SLOW_PULSE  OPT_USEC
+/** At most one slow pulse report per this many seconds. */
+#define PROF_REPORT_SECS 10
+
+/** Microseconds from a monotonic clock; only differences are meaningful. */
+typedef unsigned long prof_time;
+
+/** Time a statement as the given stage. */
+#define PROFILE(stage, stmt) do {        \
+    prof_time prof_start_ = prof_now();  \
+    stmt;                                \
+    prof_stop((stage), prof_start_);     \
+  } while (0)
+
+/* profiler.c */
+prof_time prof_now(void);
+void prof_stop(int stage, prof_time start);
+void prof_pulse_begin(void);
+void prof_pulse_end(void);
+void prof_reset(void);
+ACMD(do_profile);
+
+#endif /* _PROFILER_H_ */
@@ -40,7 +40,7 @@ static void Write( descriptor_t *apDescriptor, const char *apData )
 {
    if ( apDescriptor != NULL)
    {
-      if ( apDescriptor->pProtocol->WriteOOB > 0 || *(apDescriptor->output) == '\0' )
+      if ( apDescriptor->pProtocol->WriteOOB > 0 || apDescriptor->out_head == NULL )
       {
          apDescriptor->pProtocol->WriteOOB = 2;
       }
@@ -59,26 +59,409 @@ static void InfoMessage( descriptor_t *apDescriptor, const char *apData )
    Write( apDescriptor, apData );
 }
 
+/******************************************************************************
+ MCCP (Mud Client Compression Protocol) support.
+ ******************************************************************************/
+
+/* Running totals, reported by record_usage() in comm.c. */
+mccp_stats_t MCCPStats = { 0, 0, 0, 0 };
+
+#ifdef USING_MCCP
+#include <zlib.h>
+
+#define MCCP_PENDING_SIZE              MAX_SOCK_BUF
+
+/* Each descriptor gets one of these the first time it compresses anything. 
+ * Out is the MCCP2 stream (mud to client), In the MCCP3 stream (client to 
+ * mud).  Pending holds bytes which must reach the socket before anything else 
+ * does - the start sequence, compressed output the kernel wouldn't accept yet, 
+ * and the end of a finished stream.  Input holds what the client sent that 
+ * there was no room to inflate yet; it is used before the socket is read again.
+ */
+struct mccp_t
+{
+   z_stream       Out;
+   bool_t         bOut;          /* Out is initialised */
+   z_stream       In;
+   bool_t         bIn;           /* In is initialised */
+   unsigned char *pPending;      /* Bytes waiting for the socket */
+   size_t         PendingSize;   /* Allocated size of pPending */
+   size_t         PendingStart;  /* First unsent byte */
+   size_t         PendingEnd;    /* One past the last unsent byte */
+   unsigned char *pInput;        /* Input waiting to be inflated */
+   size_t         InputSize;     /* Allocated size of pInput */
+   size_t         InputLen;      /* Bytes waiting in pInput */
+};
+
+static mccp_t *GetMCCP( descriptor_t *apDescriptor )
+{
+   protocol_t *pProtocol = apDescriptor->pProtocol;
+
+   if ( pProtocol->pMCCP == NULL )
+   {
+      mccp_t *pMCCP;
+
+      CREATE(pMCCP, mccp_t, 1);
+      pMCCP->PendingSize = MCCP_PENDING_SIZE;
+      CREATE(pMCCP->pPending, unsigned char, pMCCP->PendingSize);
+      pProtocol->pMCCP = pMCCP;
+   }
+
+   return pProtocol->pMCCP;
+}
+
+static void PendingAppend( mccp_t *apMCCP, const char *apData, size_t aSize )
+{
+   while ( apMCCP->PendingEnd + aSize > apMCCP->PendingSize )
+   {
+      apMCCP->PendingSize *= 2;
+      RECREATE(apMCCP->pPending, unsigned char, apMCCP->PendingSize);
+   }
+   memcpy( apMCCP->pPending + apMCCP->PendingEnd, apData, aSize );
+   apMCCP->PendingEnd += aSize;
+}
+
+/* Keeps aSize bytes of client input until there is room for them.  They go 
+ * after anything already kept, or in front of it if abFirst is set.
+ */
+static void InputKeep( mccp_t *apMCCP, const char *apData, size_t aSize, bool_t abFirst )
+{
+   if ( apMCCP->InputLen + aSize > apMCCP->InputSize )
+   {
+      apMCCP->InputSize = MAX( apMCCP->InputSize * 2, apMCCP->InputLen + aSize );
+      RECREATE(apMCCP->pInput, unsigned char, apMCCP->InputSize);
+   }
+   if ( abFirst )
+   {
+      memmove( apMCCP->pInput + aSize, apMCCP->pInput, apMCCP->InputLen );
+      memcpy( apMCCP->pInput, apData, aSize );
+   }
+   else
+      memcpy( apMCCP->pInput + apMCCP->InputLen, apData, aSize );
+   apMCCP->InputLen += aSize;
+}
+
+/* Runs aSize bytes through the deflate stream, appending the result to the 
+ * pending buffer.  aFlush is Z_SYNC_FLUSH after each write, or Z_FINISH to 
+ * end the stream.
+ */
+static bool_t Compress( mccp_t *apMCCP, const char *apData, size_t aSize, int aFlush )
+{
+   z_stream *pStream = &apMCCP->Out;
+   size_t Before = apMCCP->PendingEnd;
+   int Result;
+
+   pStream->next_in = (Bytef *)apData;
+   pStream->avail_in = aSize;
+
+   do
+   {
+      if ( apMCCP->PendingEnd == apMCCP->PendingSize )
+      {
+         apMCCP->PendingSize *= 2;
+         RECREATE(apMCCP->pPending, unsigned char, apMCCP->PendingSize);
+      }
+      pStream->next_out = apMCCP->pPending + apMCCP->PendingEnd;
+      pStream->avail_out = apMCCP->PendingSize - apMCCP->PendingEnd;
+
+      Result = deflate( pStream, aFlush );
+      apMCCP->PendingEnd = apMCCP->PendingSize - pStream->avail_out;
+
+      if ( Result != Z_OK && Result != Z_STREAM_END && Result != Z_BUF_ERROR )
+      {
+         log( "SYSERR: MCCP: deflate() failed (%d).", Result );
+         return false;
+      }
+   } while ( pStream->avail_out == 0 );
+
+   MCCPStats.RawOut += aSize;
+   MCCPStats.CompressedOut += apMCCP->PendingEnd - Before;
+
+   return true;
+}
+
+/* Inflates MCCP3 input into apOut, which has room for aMax bytes plus a 
+ * terminating NUL.  Input kept from an earlier call goes first.  Whatever 
+ * doesn't fit is kept for the next call, and ProtocolInputPending() tells 
+ * the mud to come back for it.  If the client ends its stream, whatever 
+ * follows is plain text and is copied across unchanged.  Returns the number 
+ * of bytes placed in apOut, or -1 if the connection should be closed.
+ */
+static int Decompress( descriptor_t *apDescriptor, const char *apData, int aSize, char *apOut, int aMax )
+{
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+   z_stream *pStream = &pMCCP->In;
+   const unsigned char *pIn = (const unsigned char *)apData;
+   size_t Left = aSize;
+   int Result, Size = 0, Copy;
+
+   if ( aMax < 0 )
+      aMax = 0;
+
+   /* Earlier input first; the new data queues up behind it. */
+   if ( pMCCP->InputLen > 0 )
+   {
+      InputKeep( pMCCP, apData, aSize, false );
+      pIn = pMCCP->pInput;
+      Left = pMCCP->InputLen;
+   }
+
+   if ( pMCCP->bIn && Left > 0 )
+   {
+      pStream->next_in = (Bytef *)pIn;
+      pStream->avail_in = Left;
+      pStream->next_out = (Bytef *)apOut;
+      pStream->avail_out = aMax;
+
+      Result = inflate( pStream, Z_SYNC_FLUSH );
+      Size = aMax - pStream->avail_out;
+
+      MCCPStats.CompressedIn += Left - pStream->avail_in;
+      MCCPStats.RawIn += Size;
+
+      pIn = pStream->next_in;
+      Left = pStream->avail_in;
+
+      if ( Result == Z_STREAM_END )
+      {
+         inflateEnd( pStream );
+         pMCCP->bIn = false;
+      }
+      else if ( Result != Z_OK && Result != Z_BUF_ERROR )
+      {
+         log( "SYSERR: MCCP3: inflate() failed (%d), closing connection.", Result );
+         return (-1);
+      }
+   }
+
+   /* After the end of the stream the client is back to plain text. */
+   if ( !pMCCP->bIn && Left > 0 )
+   {
+      Copy = MIN( (int)Left, aMax - Size );
+      memcpy( apOut + Size, pIn, Copy );
+      Size += Copy;
+      pIn += Copy;
+      Left -= Copy;
+   }
+
+   /* Keep the rest, at the front of pInput. */
+   if ( pMCCP->InputLen > 0 )
+   {
+      memmove( pMCCP->pInput, pIn, Left );
+      pMCCP->InputLen = Left;
+   }
+   else if ( Left > 0 )
+      InputKeep( pMCCP, (const char *)pIn, Left, false );
+
+   apOut[Size] = '\0';
+   return Size;
+}
+
+static bool_t DecompressStart( descriptor_t *apDescriptor )
+{
+   mccp_t *pMCCP = GetMCCP(apDescriptor);
+
+   if ( pMCCP->bIn )
+      return true;
+
+   memset( &pMCCP->In, 0, sizeof(pMCCP->In) );
+   if ( inflateInit(&pMCCP->In) != Z_OK )
+   {
+      log( "SYSERR: MCCP3: inflateInit() failed." );
+      return false;
+   }
+   pMCCP->bIn = true;
+
+   return true;
+}
+
+static void DecompressEnd( descriptor_t *apDescriptor )
+{
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+   if ( pMCCP != NULL && pMCCP->bIn )
+   {
+      inflateEnd( &pMCCP->In );
+      pMCCP->bIn = false;
+   }
+}
+#endif /* USING_MCCP */
+
 static void CompressStart( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
+#ifdef USING_MCCP
+   const char StartMCCP[] = { (char)IAC, (char)SB, TELOPT_MCCP, (char)IAC, (char)SE };
+   mccp_t *pMCCP = GetMCCP(apDescriptor);
+
+   if ( pMCCP->bOut )
+      return;
+
+   memset( &pMCCP->Out, 0, sizeof(pMCCP->Out) );
+   if ( deflateInit(&pMCCP->Out, Z_DEFAULT_COMPRESSION) != Z_OK )
+   {
+      log( "SYSERR: MCCP: deflateInit() failed, not compressing." );
+      apDescriptor->pProtocol->bMCCP = false;
+      return;
+   }
+
+   /* The start sequence goes out uncompressed, and everything after it - 
+    * including whatever is still sitting in the output buffer - compressed.
     */
-   ReportBug( "CompressStart() in protocol.c is being called, but it doesn't do anything!\n" );
+   PendingAppend( pMCCP, StartMCCP, sizeof(StartMCCP) );
+   pMCCP->bOut = true;
+   ProtocolFlush( apDescriptor );
+#else
+   /* Without zlib we never offer MCCP, so ignore clients that ask anyway. */
+   apDescriptor->pProtocol->bMCCP = false;
+#endif /* USING_MCCP */
 }
 
 static void CompressEnd( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
-    */
-   ReportBug( "CompressEnd() in protocol.c is being called, but it doesn't do anything!\n" );
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+   if ( pMCCP == NULL || !pMCCP->bOut )
+      return;
+
+   /* Finish the stream so the client knows the rest is uncompressed. */
+   Compress( pMCCP, "", 0, Z_FINISH );
+   deflateEnd( &pMCCP->Out );
+   pMCCP->bOut = false;
+   ProtocolFlush( apDescriptor );
+#endif /* USING_MCCP */
+}
+
+int ProtocolWrite( descriptor_t *apDescriptor, const char *apData )
+{
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+   if ( pMCCP != NULL )
+   {
+      size_t Length = strlen(apData);
+      int Result;
+
+      /* Older data has to go first - if it can't, don't take any more. */
+      if ( (Result = ProtocolFlush(apDescriptor)) <= 0 )
+         return Result;
+
+      if ( pMCCP->bOut )
+      {
+         if ( !Compress(pMCCP, apData, Length, Z_SYNC_FLUSH) )
+            return (-1);
+         if ( ProtocolFlush(apDescriptor) < 0 )
+            return (-1);
+         return Length;
+      }
+   }
+#endif /* USING_MCCP */
+
+   return write_to_descriptor( apDescriptor->descriptor, apData );
+}
+
+int ProtocolWritePieces( descriptor_t *apDescriptor, const struct out_piece *apPieces, int aCount )
+{
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+   if ( pMCCP != NULL )
+   {
+      size_t Length = 0;
+      int Result, i;
+
+      /* Older data has to go first - if it can't, don't take any more. */
+      if ( (Result = ProtocolFlush(apDescriptor)) <= 0 )
+         return Result;
+
+      if ( pMCCP->bOut )
+      {
+         /* Only the last piece flushes, so they compress as one block. */
+         for ( i = 0; i < aCount; ++i )
+         {
+            if ( !Compress(pMCCP, apPieces[i].text, apPieces[i].len, 
+                  i == aCount - 1 ? Z_SYNC_FLUSH : Z_NO_FLUSH) )
+               return (-1);
+            Length += apPieces[i].len;
+         }
+         if ( ProtocolFlush(apDescriptor) < 0 )
+            return (-1);
+         return Length;
+      }
+   }
+#endif /* USING_MCCP */
+
+   return write_pieces_to_descriptor( apDescriptor->descriptor, apPieces, aCount );
+}
+
+int ProtocolFlush( descriptor_t *apDescriptor )
+{
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+   int Written;
+
+   if ( pMCCP == NULL || pMCCP->PendingStart == pMCCP->PendingEnd )
+      return 1;
+
+   Written = write_bytes_to_descriptor( apDescriptor->descriptor, 
+      (const char *)pMCCP->pPending + pMCCP->PendingStart, 
+      pMCCP->PendingEnd - pMCCP->PendingStart );
+
+   if ( Written < 0 )
+      return (-1);
+
+   pMCCP->PendingStart += Written;
+   if ( pMCCP->PendingStart < pMCCP->PendingEnd )
+      return 0;
+
+   pMCCP->PendingStart = pMCCP->PendingEnd = 0;
+#endif /* USING_MCCP */
+   return 1;
+}
+
+bool_t ProtocolInputPending( descriptor_t *apDescriptor )
+{
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol ? apDescriptor->pProtocol->pMCCP : NULL;
+
+   if ( pMCCP != NULL && pMCCP->InputLen > 0 )
+      return true;
+#endif /* USING_MCCP */
+   return false;
+}
+
+bool_t ProtocolDrain( descriptor_t *apDescriptor, int aSeconds )
+{
+   time_t Until = time(0) + aSeconds;
+   int Result;
+
+   while ( (Result = ProtocolFlush(apDescriptor)) == 0 && time(0) < Until )
+   {
+      struct timeval Wait = { 0, 100000 };
+      fd_set Writable;
+
+      FD_ZERO( &Writable );
+      if ( apDescriptor->descriptor < FD_SETSIZE )
+      {
+         FD_SET( apDescriptor->descriptor, &Writable );
+         select( apDescriptor->descriptor + 1, NULL, &Writable, NULL, &Wait );
+      }
+      else /* Just wait a little */
+         select( 0, NULL, NULL, NULL, &Wait );
+   }
+
+   return Result > 0;
+}
+
+bool_t ProtocolPending( descriptor_t *apDescriptor )
+{
+#ifdef USING_MCCP
+   mccp_t *pMCCP = apDescriptor->pProtocol->pMCCP;
+
+   if ( pMCCP != NULL && pMCCP->PendingStart != pMCCP->PendingEnd )
+      return true;
+#endif /* USING_MCCP */
+   return false;
 }
 
 /******************************************************************************
@@ -302,6 +685,8 @@ protocol_t *ProtocolCreate( void )
    pProtocol->bMSP = false;
    pProtocol->bMXP = false;
    pProtocol->bMCCP = false;
+   pProtocol->bMCCP3 = false;
+   pProtocol->pMCCP = NULL;
    pProtocol->b256Support = eUNKNOWN;
    pProtocol->ScreenWidth = 0;
    pProtocol->ScreenHeight = 0;
@@ -350,6 +735,19 @@ void ProtocolDestroy( protocol_t *apProtocol )
    if (apProtocol->pLastTTYPE) /* Isn't saved over copyover so may still be NULL */
      free(apProtocol->pLastTTYPE);
    free(apProtocol->pMXPVersion);
+#ifdef USING_MCCP
+   if (apProtocol->pMCCP)
+   {
+      if (apProtocol->pMCCP->bOut)
+         deflateEnd(&apProtocol->pMCCP->Out);
+      if (apProtocol->pMCCP->bIn)
+         inflateEnd(&apProtocol->pMCCP->In);
+      free(apProtocol->pMCCP->pPending);
+      if (apProtocol->pMCCP->pInput)
+         free(apProtocol->pMCCP->pInput);
+      free(apProtocol->pMCCP);
+   }
+#endif /* USING_MCCP */
    free(apProtocol);
 }
 
@@ -363,6 +761,24 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
 
    protocol_t *pProtocol = apDescriptor ? apDescriptor->pProtocol : NULL;
 
+#ifdef USING_MCCP
+   static char InflateBuf[MAX_PROTOCOL_BUFFER+1];
+
+   /* With MCCP3 running, everything the client sends is compressed.  Never 
+    * inflate more than the caller's input buffer has room for; the rest is 
+    * kept for next time.
+    */
+   if ( pProtocol->pMCCP != NULL && 
+      ( pProtocol->pMCCP->bIn || pProtocol->pMCCP->InputLen > 0 ) )
+   {
+      aSize = Decompress( apDescriptor, apData, aSize, InflateBuf, 
+         MAX_PROTOCOL_BUFFER - 1 - strlen(apOut) );
+      if ( aSize < 0 )
+         return (-1);
+      apData = InflateBuf;
+   }
+#endif /* USING_MCCP */
+
    for ( Index = 0; Index < aSize; ++Index )
    {
       /* If we'd overflow the buffer, we just ignore the input */
@@ -391,6 +807,28 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
             IacBuf[IacIndex] = '\0';
             if ( IacIndex >= 2 )
                PerformSubnegotiation( apDescriptor, IacBuf[0], &IacBuf[1], IacIndex-1 );
+#ifdef USING_MCCP
+            else if ( IacIndex == 1 && IacBuf[0] == (char)TELOPT_MCCP3 && 
+               pProtocol->bMCCP3 && 
+               ( pProtocol->pMCCP == NULL || !pProtocol->pMCCP->bIn ) && 
+               DecompressStart(apDescriptor) )
+            {
+               /* The client starts compressing straight after IAC SE, so 
+                * the rest of this buffer has to be inflated before parsing. 
+                * It is copied out first, as apData may be InflateBuf itself, 
+                * and goes in front of anything Decompress() kept, as that 
+                * came later.  A start sequence while the stream is already 
+                * running is ignored.
+                */
+               ssize_t Rest;
+
+               CmdBuf[CmdIndex] = '\0';
+               strcat( apOut, CmdBuf );
+               InputKeep( pProtocol->pMCCP, &apData[Index+1], aSize-Index-1, true );
+               Rest = ProtocolInput( apDescriptor, apData, 0, apOut );
+               return Rest < 0 ? -1 : CmdIndex + Rest;
+            }
+#endif /* USING_MCCP */
             IacIndex = 0;
          }
          else
@@ -859,6 +1297,43 @@ const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int
    return Result;
 }
 
+void ProtocolOutputStyle( descriptor_t *apDescriptor, output_style_t *apStyle )
+{
+   protocol_t *pProtocol = apDescriptor ? apDescriptor->pProtocol : NULL;
+
+   memset( apStyle, 0, sizeof(*apStyle) );
+   if ( pProtocol == NULL )
+      return;
+
+   /* These mirror the tests in ProtocolOutput() and ColourRGB() */
+   apStyle->bColour = pProtocol->pVariables[eMSDP_ANSI_COLORS]->ValueInt &&
+      !(apDescriptor->character && !clr(apDescriptor->character, C_CMP));
+   apStyle->b256Colour = pProtocol->pVariables[eMSDP_XTERM_256_COLORS]->ValueInt != 0;
+   apStyle->bUTF8 = pProtocol->pVariables[eMSDP_UTF_8]->ValueInt != 0;
+   apStyle->bMXP = pProtocol->pVariables[eMSDP_MXP]->ValueInt != 0;
+   apStyle->bBlockMXP = pProtocol->bBlockMXP;
+   apStyle->bSound = pProtocol->bMSP || pProtocol->pVariables[eMSDP_SOUND]->ValueInt;
+   apStyle->pMXPVersion = pProtocol->pMXPVersion;
+}
+
+bool_t ProtocolSameStyle( const output_style_t *apOne, const output_style_t *apTwo )
+{
+   if ( apOne->bColour != apTwo->bColour || apOne->bUTF8 != apTwo->bUTF8 || 
+      apOne->bMXP != apTwo->bMXP || apOne->bBlockMXP != apTwo->bBlockMXP || 
+      apOne->bSound != apTwo->bSound )
+      return false;
+
+   /* The colour depth only matters if there's colour at all */
+   if ( apOne->bColour && apOne->b256Colour != apTwo->b256Colour )
+      return false;
+
+   if ( apOne->pMXPVersion == apTwo->pMXPVersion )
+      return true;
+   if ( apOne->pMXPVersion == NULL || apTwo->pMXPVersion == NULL )
+      return false;
+   return !strcmp( apOne->pMXPVersion, apTwo->pMXPVersion );
+}
+
 /* Some clients (such as GMud) don't properly handle negotiation, and simply 
  * display every printable character to the screen.  However TTYPE isn't a 
  * printable character, so we negotiate for it first, and only negotiate for 
@@ -906,6 +1381,19 @@ const char *CopyoverGet( descriptor_t *apDescriptor )
          *pBuffer++ = 'c';
          CompressEnd(apDescriptor);
       }
+#ifdef USING_MCCP
+      if ( pProtocol->bMCCP3 )
+      {
+         /* An inflate stream can't be handed over, so ask the client to stop 
+          * compressing; MCCP3 is simply not offered again after the copyover.
+          */
+         const char WontMCCP3[] = { (char)IAC, (char)WONT, TELOPT_MCCP3, '\0' };
+
+         ProtocolWrite( apDescriptor, WontMCCP3 );
+         pProtocol->bMCCP3 = false;
+         DecompressEnd(apDescriptor);
+      }
+#endif // USING_MCCP
       if ( pProtocol->pVariables[eMSDP_XTERM_256_COLORS]->ValueInt )
          *pBuffer++ = 'C';
       if ( pProtocol->bCHARSET )
@@ -1498,6 +1986,7 @@ static void Negotiate( descriptor_t *apDescriptor )
 
 #ifdef USING_MCCP
       const char WillMCCP       [] = { (char)IAC, (char)WILL, TELOPT_MCCP,      '\0' };
+      const char WillMCCP3      [] = { (char)IAC, (char)WILL, TELOPT_MCCP3,     '\0' };
 #endif // USING_MCCP
 
       /* Request the client type if TTYPE is supported. */
@@ -1524,6 +2013,7 @@ static void Negotiate( descriptor_t *apDescriptor )
 
 #ifdef USING_MCCP
       Write(apDescriptor, WillMCCP);
+      Write(apDescriptor, WillMCCP3);
 #endif // USING_MCCP
    }
 }
@@ -1610,6 +2100,20 @@ static void PerformHandshake( descriptor_t *apDescriptor, char aCmd, char aProto
          }
          break;
 
+#ifdef USING_MCCP
+      case (char)TELOPT_MCCP3:
+         /* The client starts compressing when it sends IAC SB MCCP3 IAC SE, 
+          * which ProtocolInput() deals with. */
+         if ( aCmd == (char)DO )
+            pProtocol->bMCCP3 = true;
+         else if ( aCmd == (char)DONT )
+         {
+            pProtocol->bMCCP3 = false;
+            DecompressEnd( apDescriptor );
+         }
+         break;
+#endif // USING_MCCP
+
       case (char)TELOPT_MSP:
          if ( aCmd == (char)DO )
             pProtocol->bMSP = true;
@@ -12,14 +12,15 @@
 #define MUD_NAME "tbaMUD"
 
 typedef struct descriptor_data descriptor_t;
+struct out_piece;
 
 /******************************************************************************
- If your mud supports MCCP (compression), uncomment the next line.
+ MCCP (compression) is enabled automatically when configure finds zlib.
  ******************************************************************************/
 
-/*
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
 #define USING_MCCP
-*/
+#endif
 
 /******************************************************************************
  If your offer a Mudlet GUI for autoinstallation, put the path/filename here.
@@ -48,6 +49,7 @@ typedef struct descriptor_data descriptor_t;
 #define TELOPT_MSDP                    69
 #define TELOPT_MSSP                    70
 #define TELOPT_MCCP                    86 /* This is MCCP version 2 */
+#define TELOPT_MCCP3                   87 /* MCCP version 3 (client to server) */
 #define TELOPT_MSP                     90
 #define TELOPT_MXP                     91
 #define TELOPT_ATCP                    200
@@ -194,6 +196,16 @@ typedef struct
    const char  *(*pFunction)(void); /* Optional function to return the value */
 } MSSP_t;
 
+typedef struct mccp_t mccp_t;  /* Compression state, private to protocol.c */
+
+typedef struct
+{
+   unsigned long RawOut;       /* Bytes handed to the output compressor */
+   unsigned long CompressedOut;/* Bytes the output compressor produced */
+   unsigned long CompressedIn; /* Compressed bytes received from clients */
+   unsigned long RawIn;        /* Bytes those inflated to */
+} mccp_stats_t;
+
 typedef struct
 {
    int       WriteOOB;         /* Used internally to indicate OOB data */
@@ -208,6 +220,8 @@ typedef struct
    bool_t    bMSP;             /* The client supports MSP */
    bool_t    bMXP;             /* The client supports MXP */
    bool_t    bMCCP;            /* The client supports MCCP */
+   bool_t    bMCCP3;           /* The client supports MCCP3 */
+   mccp_t   *pMCCP;            /* Compression streams, NULL until needed */
    support_t b256Support;      /* The client supports XTerm 256 colors */
    int       ScreenWidth;      /* The client's screen width */
    int       ScreenHeight;     /* The client's screen height */
@@ -216,6 +230,17 @@ typedef struct
    MSDP_t  **pVariables;       /* The MSDP variables */
 } protocol_t;
 
+typedef struct
+{
+   bool_t    bColour;          /* Colour codes become ANSI sequences */
+   bool_t    b256Colour;       /* ... using XTerm 256 colours */
+   bool_t    bUTF8;            /* Unicode substitutes become UTF-8 */
+   bool_t    bMXP;             /* MXP tags are sent rather than stripped */
+   bool_t    bBlockMXP;        /* The last MXP version check failed */
+   bool_t    bSound;           /* Old-style MSP triggers are defused */
+   const char *pMXPVersion;    /* The version of MXP supported */
+} output_style_t;
+
 /******************************************************************************
  Protocol functions.
  ******************************************************************************/
@@ -258,6 +283,57 @@ extern const char * RGBthree;
  
 ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char *apOut );
 
+/* Function: ProtocolWrite
+ *
+ * Sends a string straight to the user's socket, compressing it first if MCCP 
+ * is active.  Use this instead of write_to_descriptor() once the descriptor 
+ * exists.  Compressed output is flushed at the end of every call, so each 
+ * write (and therefore each prompt) reaches the client immediately.  Returns 
+ * the number of bytes of apData consumed, 0 if the socket is still backed up 
+ * from an earlier write, or -1 if the connection should be closed.
+ */
+int ProtocolWrite( descriptor_t *apDescriptor, const char *apData );
+
+/* Function: ProtocolWritePieces
+ *
+ * As ProtocolWrite(), but sends aCount pieces of text in order as one write 
+ * (with writev() where the system has it), without joining them first. 
+ * Returns the number of bytes consumed across all the pieces.
+ */
+int ProtocolWritePieces( descriptor_t *apDescriptor, const struct out_piece *apPieces, int aCount );
+
+/* Function: ProtocolFlush
+ *
+ * Tries to send any compressed data the socket wouldn't accept earlier. 
+ * Returns 1 if nothing is left, 0 if some is still waiting, or -1 on error.
+ */
+int ProtocolFlush( descriptor_t *apDescriptor );
+
+/* Function: ProtocolPending
+ *
+ * Returns true if ProtocolFlush() still has data waiting for the socket.
+ */
+bool_t ProtocolPending( descriptor_t *apDescriptor );
+
+/* Function: ProtocolDrain
+ *
+ * Calls ProtocolFlush() until nothing is left, waiting up to aSeconds for 
+ * the socket to take it.  Use it before writing to the socket directly or 
+ * handing it over, as copyover does.  Returns true if everything was sent.
+ */
+bool_t ProtocolDrain( descriptor_t *apDescriptor, int aSeconds );
+
+/* Function: ProtocolInputPending
+ *
+ * Returns true if the client sent more MCCP3 input than the last call to 
+ * ProtocolInput() had room to inflate.  Until it returns false, call 
+ * ProtocolInput() with no new data instead of reading the socket.
+ */
+bool_t ProtocolInputPending( descriptor_t *apDescriptor );
+
+/* Running totals for every MCCP stream, reported by record_usage(). */
+extern mccp_stats_t MCCPStats;
+
 /* Function: ProtocolOutput
  *
  * This function takes a string, applies colour codes to it, and returns the 
@@ -319,6 +395,22 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
  */
 const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int *apLength );
 
+/* Function: ProtocolOutputStyle
+ *
+ * Fills in everything about the descriptor that ProtocolOutput() looks at.  
+ * Two descriptors with the same style (see ProtocolSameStyle) get identical 
+ * results from ProtocolOutput() for any string, and are left in the same 
+ * state afterwards, so text sent to many users need only be processed once 
+ * per style.
+ */
+void ProtocolOutputStyle( descriptor_t *apDescriptor, output_style_t *apStyle );
+
+/* Function: ProtocolSameStyle
+ *
+ * Returns true if the two styles would produce the same output.
+ */
+bool_t ProtocolSameStyle( const output_style_t *apOne, const output_style_t *apTwo );
+
 /******************************************************************************
  Copyover save/load functions.
  ******************************************************************************/
@@ -0,0 +1,331 @@
+/**************************************************************************
+*  File: strpool.c                                         Part of tbaMUD *
+*  Usage: Shared, reference counted copies of room and prototype text     *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* The same text turns up in many rooms and prototypes: corridor and forest
+ * rooms that share a name and description, exits whose keyword is "door",
+ * stock mobiles and objects copied from zone to zone.  The loaders and the
+ * OLC savers store one copy of each such string here and hand out pointers
+ * to it, counting how many they gave out.
+ *
+ * A pooled string must never be changed in place or passed to free().  The
+ * code that frees room and prototype text calls release_string() instead,
+ * which drops one reference and frees the string with the last one.  Given
+ * a string that is not in the pool, it simply calls free(), so it is safe on
+ * text that may or may not have been shared.  OLC works on private copies
+ * (the editors change their buffers in place), and instances keep pointing
+ * at their prototype's text, as before.
+ *
+ * Until boot_world() seals the pool, strings are packed one after another
+ * into large blocks instead of being malloc()ed one by one, which saves the
+ * allocator's per-block overhead on some fifty thousand strings.  A boot
+ * string whose last reference goes away leaves a hole in its block; text
+ * pooled after boot is malloc()ed, so OLC edits do not pile up holes. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "strpool.h"
+#include <stddef.h> /* for offsetof */
+
+/* One pooled string.  text[] is what callers are given. */
+struct pool_string {
+  struct pool_string *next;   /* next in the hash chain */
+  unsigned int hash;
+  unsigned int refs : 31;
+  unsigned int in_block : 1;  /* carved from a boot block, not malloc()ed */
+  char text[1];
+};
+
+/* A block of boot strings, packed after the header. */
+struct pool_block {
+  struct pool_block *next;
+};
+
+#define POOL_HEADER       (offsetof(struct pool_string, text))
+#define POOL_ALIGN(n)     (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define POOL_MIN_BUCKETS  4096
+#define POOL_LOAD         2            /* strings per bucket before growing */
+#define POOL_BLOCK_SIZE   (256 * 1024)
+#define POOL_BLOCK_MAX    (POOL_BLOCK_SIZE / 8) /* longer strings are malloc()ed */
+
+/* Roughly what malloc(n) takes from the heap: a size word, rounded up to 16
+ * bytes, 32 at least.  Used to tell what the pool saves. */
+#define MALLOC_COST(n)    ((n) + sizeof(size_t) <= 32 ? 32 : ((n) + sizeof(size_t) + 15) & ~(size_t)15)
+
+/* Totals for 'show strings', kept as strings come and go. */
+static struct {
+  long strings;          /* distinct strings in the pool */
+  long refs;             /* references held on them */
+  size_t bytes;          /* text stored, one copy of each */
+  size_t unshared_bytes; /* text the references would take as copies */
+  size_t unshared_heap;  /* heap those copies would take */
+  size_t heap;           /* heap the pool takes: blocks, entries, buckets */
+  size_t block_bytes;    /* boot blocks allocated */
+  size_t block_free;     /* unused and released space in the blocks */
+} string_pool;
+
+static struct pool_string **pool_table = NULL;
+static unsigned int pool_buckets = 0;   /* always a power of two */
+static struct pool_block *pool_blocks = NULL;
+static char *block_next = NULL, *block_end = NULL;
+static int pool_sealed = FALSE;
+
+/* local functions */
+static unsigned int pool_hash(const char *str, size_t *len);
+static void grow_string_pool(void);
+static struct pool_string *new_pool_string(size_t len);
+static struct pool_string *find_pool_entry(const char *str, struct pool_string ***prev);
+
+static unsigned int pool_hash(const char *str, size_t *len)
+{
+  const unsigned char *p;
+  unsigned int hash = 2166136261U;
+
+  for (p = (const unsigned char *)str; *p; p++)
+    hash = (hash ^ *p) * 16777619U;
+
+  *len = (const char *)p - str;
+  return (hash);
+}
+
+static void grow_string_pool(void)
+{
+  struct pool_string **table, *ps, *next;
+  unsigned int buckets = pool_buckets ? pool_buckets * 2 : POOL_MIN_BUCKETS, i;
+
+  CREATE(table, struct pool_string *, buckets);
+  for (i = 0; i < pool_buckets; i++)
+    for (ps = pool_table[i]; ps; ps = next) {
+      next = ps->next;
+      ps->next = table[ps->hash & (buckets - 1)];
+      table[ps->hash & (buckets - 1)] = ps;
+    }
+
+  if (pool_table)
+    free(pool_table);
+  string_pool.heap += (buckets - pool_buckets) * sizeof(struct pool_string *);
+  pool_table = table;
+  pool_buckets = buckets;
+}
+
+/* Room for an entry with len bytes of text, from the current block while
+ * booting, or from malloc(). */
+static struct pool_string *new_pool_string(size_t len)
+{
+  struct pool_block *block;
+  struct pool_string *ps;
+  size_t size = POOL_ALIGN(POOL_HEADER + len + 1);
+
+  if (!pool_sealed && size <= POOL_BLOCK_MAX) {
+    if ((size_t) (block_end - block_next) < size) {
+      string_pool.block_free += block_end - block_next;
+      if (!(block = (struct pool_block *)malloc(POOL_BLOCK_SIZE))) {
+        perror("SYSERR: malloc failure");
+        abort();
+      }
+      block->next = pool_blocks;
+      pool_blocks = block;
+      block_next = (char *)block + POOL_ALIGN(sizeof(struct pool_block));
+      block_end = (char *)block + POOL_BLOCK_SIZE;
+      string_pool.block_bytes += POOL_BLOCK_SIZE;
+      string_pool.heap += MALLOC_COST(POOL_BLOCK_SIZE);
+    }
+    ps = (struct pool_string *)block_next;
+    block_next += size;
+    ps->in_block = 1;
+  } else {
+    if (!(ps = (struct pool_string *)malloc(size))) {
+      perror("SYSERR: malloc failure");
+      abort();
+    }
+    ps->in_block = 0;
+    string_pool.heap += MALLOC_COST(size);
+  }
+
+  return (ps);
+}
+
+/* The entry whose text is str itself, not just the same words. */
+static struct pool_string *find_pool_entry(const char *str, struct pool_string ***prev)
+{
+  struct pool_string *ps, **p;
+  unsigned int hash;
+  size_t len;
+
+  if (!pool_buckets)
+    return (NULL);
+
+  hash = pool_hash(str, &len);
+  for (p = &pool_table[hash & (pool_buckets - 1)]; (ps = *p); p = &ps->next)
+    if (ps->text == str) {
+      if (prev)
+        *prev = p;
+      return (ps);
+    }
+
+  return (NULL);
+}
+
+/** Get a shared copy of a string, adding a reference to it.  The result
+ * must be given back with release_string(), and never changed.
+ * @param str The text to share; may itself be a pooled string.
+ * @retval char * The pooled copy, or NULL if str is NULL. */
+char *intern_string(const char *str)
+{
+  struct pool_string *ps;
+  unsigned int hash;
+  size_t len;
+
+  if (!str)
+    return (NULL);
+
+  hash = pool_hash(str, &len);
+
+  if (pool_buckets)
+    for (ps = pool_table[hash & (pool_buckets - 1)]; ps; ps = ps->next)
+      if (ps->hash == hash && (ps->text == str || !strcmp(ps->text, str))) {
+        ps->refs++;
+        string_pool.refs++;
+        string_pool.unshared_bytes += len + 1;
+        string_pool.unshared_heap += MALLOC_COST(len + 1);
+        return (ps->text);
+      }
+
+  if (string_pool.strings >= (long) pool_buckets * POOL_LOAD)
+    grow_string_pool();
+
+  ps = new_pool_string(len);
+  memcpy(ps->text, str, len + 1);
+  ps->hash = hash;
+  ps->refs = 1;
+  ps->next = pool_table[hash & (pool_buckets - 1)];
+  pool_table[hash & (pool_buckets - 1)] = ps;
+
+  string_pool.strings++;
+  string_pool.refs++;
+  string_pool.bytes += len + 1;
+  string_pool.unshared_bytes += len + 1;
+  string_pool.unshared_heap += MALLOC_COST(len + 1);
+  return (ps->text);
+}
+
+/** Swap a malloc()ed string for its shared copy.  The string passed in is
+ * freed, unless it was pooled already, in which case it is returned as is.
+ * @param str A string the caller owns, or NULL. */
+char *share_string(char *str)
+{
+  char *shared;
+
+  if (!str || find_pool_entry(str, NULL))
+    return (str);
+
+  shared = intern_string(str);
+  free(str);
+  return (shared);
+}
+
+/** Give back a reference taken by intern_string() or share_string().  A
+ * string that is not in the pool is simply freed. */
+void release_string(char *str)
+{
+  struct pool_string *ps, **prev;
+  size_t len, size;
+
+  if (!str)
+    return;
+
+  if (!(ps = find_pool_entry(str, &prev))) {
+    free(str);
+    return;
+  }
+
+  len = strlen(str);
+  string_pool.refs--;
+  string_pool.unshared_bytes -= len + 1;
+  string_pool.unshared_heap -= MALLOC_COST(len + 1);
+  if (--ps->refs)
+    return;
+
+  *prev = ps->next;
+  size = POOL_ALIGN(POOL_HEADER + len + 1);
+  string_pool.strings--;
+  string_pool.bytes -= len + 1;
+  if (ps->in_block)
+    string_pool.block_free += size;
+  else {
+    string_pool.heap -= MALLOC_COST(size);
+    free(ps);
+  }
+}
+
+/** Share the keywords and descriptions of a list of extra descriptions. */
+void share_ex_descriptions(struct extra_descr_data *list)
+{
+  for (; list; list = list->next) {
+    list->keyword = share_string(list->keyword);
+    list->description = share_string(list->description);
+  }
+}
+
+/** Called once the world is loaded: strings pooled from now on are
+ * malloc()ed, so they can be freed again. */
+void seal_string_pool(void)
+{
+  string_pool.block_free += block_end - block_next;
+  block_next = block_end = NULL;
+  pool_sealed = TRUE;
+}
+
+/** Free whatever is still in the pool, at shutdown. */
+void free_string_pool(void)
+{
+  struct pool_string *ps, *next;
+  struct pool_block *block;
+  unsigned int i;
+
+  for (i = 0; i < pool_buckets; i++)
+    for (ps = pool_table[i]; ps; ps = next) {
+      next = ps->next;
+      if (!ps->in_block)
+        free(ps);
+    }
+
+  while ((block = pool_blocks)) {
+    pool_blocks = block->next;
+    free(block);
+  }
+
+  if (pool_table)
+    free(pool_table);
+  pool_table = NULL;
+  pool_buckets = 0;
+  block_next = block_end = NULL;
+  memset(&string_pool, 0, sizeof(string_pool));
+}
+
+/* show strings: what sharing the text has saved */
+void show_string_pool(struct char_data *ch)
+{
+  long saved = (long) string_pool.unshared_heap - (long) string_pool.heap;
+
+  send_to_char(ch, "Pooled strings    : %ld distinct, %ld references (%.2f per string)\r\n",
+    string_pool.strings, string_pool.refs,
+    string_pool.strings ? (double) string_pool.refs / string_pool.strings : 0.0);
+  send_to_char(ch, "Text              : %lu bytes stored, %lu bytes as separate copies\r\n",
+    (unsigned long) string_pool.bytes, (unsigned long) string_pool.unshared_bytes);
+  send_to_char(ch, "Boot blocks       : %lu bytes, %lu unused or released\r\n",
+    (unsigned long) string_pool.block_bytes, (unsigned long) string_pool.block_free);
+  send_to_char(ch, "Heap used         : %lu bytes, against about %lu for separate copies\r\n",
+    (unsigned long) string_pool.heap, (unsigned long) string_pool.unshared_heap);
+  send_to_char(ch, "Saved             : about %ld bytes (%.1f%%)\r\n", saved,
+    string_pool.unshared_heap ? 100.0 * saved / string_pool.unshared_heap : 0.0);
+}
@@ -0,0 +1,25 @@
+/**
+* @file strpool.h
+* Shared, reference counted copies of the text of rooms and prototypes.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _STRPOOL_H_
+#define _STRPOOL_H_
+
+/* strpool.c */
+char *intern_string(const char *str);
+char *share_string(char *str);
+void release_string(char *str);
+void share_ex_descriptions(struct extra_descr_data *list);
+void seal_string_pool(void);
+void free_string_pool(void);
+void show_string_pool(struct char_data *ch);
+
+#endif /* _STRPOOL_H_ */
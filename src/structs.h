@@ -227,6 +227,11 @@
 
 #define NUM_MOB_FLAGS      19
 
+/* Which AI list an NPC is on: char_data.ai_state (see mobact.c) */
+#define MOB_AI_OFF      0   /**< Not in a room, so on neither */
+#define MOB_AI_AWAKE    1   /**< Run by mobile_activity() */
+#define MOB_AI_PARKED   2   /**< Idle in its empty zone's parked_mobs */
+
 /* Preference flags: used by char_data.player_specials.pref */
 #define PRF_BRIEF         0   /**< Room descs won't normally be shown */
 #define PRF_COMPACT       1   /**< No extra CRLF pair before prompts */
@@ -569,6 +574,8 @@
 #define PULSE_MOBILE    (10 RL_SEC)
 /** Controls the time between turns of combat. */
 #define PULSE_VIOLENCE  ( 2 RL_SEC)
+/** How often point_update() brings another slice of the world up to date. */
+#define PULSE_POINTS    ( 1 RL_SEC)
 /** Controls when characters and houses (if implemented) will be autosaved.
  * @see CONFIG_AUTO_SAVE
  */
@@ -589,6 +596,9 @@
 #define MAX_PROMPT_LENGTH  96          /**< Max length of prompt        */
 #define GARBAGE_SPACE      32          /**< Space for **OVERFLOW** etc  */
 #define SMALL_BUFSIZE      1024        /**< Static output buffer size   */
+#define OUT_SLAB_SIZE      4096        /**< Usual size of an output slab */
+#define OUT_PIECES_MAX     64          /**< Most pieces in one write     */
+#define OUT_SHARE_MIN      256         /**< Shorter shared text is copied */
 /** Max amount of output that can be buffered */
 #define LARGE_BUFSIZE      (MAX_SOCK_BUF - GARBAGE_SPACE - MAX_PROMPT_LENGTH)
 
@@ -724,6 +734,8 @@ struct obj_data
 
   struct obj_data *next_content;  /**< For 'contains' lists   */
   struct obj_data *next;          /**< For the object list */
+  struct obj_data *next_timed;    /**< For the list of timed objects */
+  struct obj_data *prev_timed;    /**< For the list of timed objects */
   struct char_data *sitting_here; /**< For furniture, who is sitting in it */
   
   struct list_data *events;      /**< Used for object events */
@@ -952,6 +964,7 @@ struct player_special_data
   int last_olc_mode;     /**< ? Currently Unused ? */
   char *host;            /**< Resolved hostname, or ip, for player. */
   int buildwalk_sector;  /**< Default sector type for buildwalk */
+  struct mysql_player_state *db_state; /**< Values last written to the database */
 };
 
 /** Special data used by NPCs, not PCs */
@@ -998,6 +1011,8 @@ struct char_data
   mob_rnum nr;  /**< NPC real instance number */
   room_rnum in_room;     /**< Current location (real room number) */
   room_rnum was_in_room; /**< Previous location for linkdead people  */
+  zone_rnum presence_zone; /**< Zone this char keeps from is_empty(), or NOWHERE */
+  byte ai_state;         /**< NPC: MOB_AI_OFF, MOB_AI_AWAKE or MOB_AI_PARKED */
   int wait;              /**< wait for how many loops before taking action. */
 
   struct char_player_data player;       /**< General PC/NPC data */
@@ -1022,6 +1037,8 @@ struct char_data
   struct char_data *next_in_room;  /**< Next PC in the room */
   struct char_data *next;          /**< Next char_data in the room */
   struct char_data *next_fighting; /**< Next in line to fight */
+  struct char_data *next_in_ai;    /**< Next NPC in the same AI list */
+  struct char_data *prev_in_ai;    /**< Previous NPC in the same AI list */
 
   struct follow_type *followers; /**< List of characters following */
   struct char_data *master;      /**< List of character being followed */
@@ -1050,6 +1067,33 @@ struct txt_q
   struct txt_block *tail; /**< ? */
 };
 
+/** A block of output text.  Descriptors queue pieces of it instead of copies,
+ * so one slab can be waiting in many output queues at once. */
+struct out_slab
+{
+  int refs;               /**< chunks, and the writer, holding it */
+  size_t size;            /**< bytes allocated for text */
+  size_t used;            /**< bytes of text filled in */
+  char *text;             /**< not NUL terminated */
+  struct out_slab *next;  /**< in the pool of free slabs */
+};
+
+/** One piece of a descriptor's output queue. */
+struct out_chunk
+{
+  struct out_slab *slab;  /**< where the text is */
+  size_t start;           /**< offset of the first unsent byte */
+  size_t len;             /**< unsent bytes */
+  struct out_chunk *next; /**< next in the queue or the free list */
+};
+
+/** Text to be written, and how long it is. */
+struct out_piece
+{
+  const char *text;
+  size_t len;
+};
+
 /** Master structure players. Holds the real players connection to the mud.
  * An analogy is the char_data is the body of the character, the descriptor_data
  * is the soul. */
@@ -1073,13 +1117,12 @@ struct descriptor_data
   int has_prompt;           /**< is the user at a prompt?             */
   char inbuf[MAX_RAW_INPUT_LENGTH];  /**< buffer for raw input		*/
   char last_input[MAX_INPUT_LENGTH]; /**< the last input			*/
-  char small_outbuf[SMALL_BUFSIZE];  /**< standard output buffer		*/
-  char *output;             /**< ptr to the current output buffer	*/
   char **history;           /**< History of commands, for ! mostly.	*/
   int history_pos;          /**< Circular array position.		*/
-  int bufptr;               /**< ptr to end of current output		*/
-  int bufspace;             /**< space left in the output buffer	*/
-  struct txt_block *large_outbuf; /**< ptr to large buffer, if we need it */
+  int bufptr;               /**< bytes of output queued			*/
+  int bufspace;             /**< room left before overflow, 0 if full	*/
+  struct out_chunk *out_head; /**< queued output, oldest first		*/
+  struct out_chunk *out_tail; /**< last queued chunk			*/
   struct txt_q input;       /**< q of unprocessed input		*/
   struct char_data *character; /**< linked to char			*/
   struct char_data *original;  /**< original char if switched		*/
@@ -1088,6 +1131,9 @@ struct descriptor_data
   struct descriptor_data *next;     /**< link to next descriptor		*/
   struct oasis_olc_data *olc;       /**< OLC info */
   protocol_t *pProtocol;    /**< Kavir plugin */
+  int io_events;            /**< NETPOLL_xxx readiness for this pulse */
+  int io_slot;              /**< index in netpoll_ready, or -1 */
+  int io_want_write;        /**< write interest armed (output is backed up) */
   
   struct list_data * events;
 };
@@ -1231,6 +1277,7 @@ struct index_data
 
   char *farg; /**< String argument for special function. */
   struct trig_data *proto; /**< Points to the trigger prototype. */
+  struct keyword_list *keywords; /**< Prototype name split into keywords. */
 };
 
 /** Master linked list for the mob/object prototype trigger lists. */
@@ -1295,6 +1342,7 @@ struct game_data
   int map_size;           /**< Default size for map command         */
   int minimap_size;       /**< Default size for mini-map (automap)  */
   int script_players;     /**< Is attaching scripts to players allowed? */
+  int unattended_ai_rate; /**< Mobs in empty zones act 1 pulse in N, 0 never */
 
   char *OK;       /**< When player receives 'Okay.' text.    */
   char *HUH;      /**< 'Huh!?!'                              */ 
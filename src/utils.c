@@ -22,6 +22,7 @@
 #include "handler.h"
 #include "interpreter.h"
 #include "class.h"
+#include "parboot.h"
 
 
 /** Aportable random number function.
@@ -202,6 +203,11 @@ void basic_mud_vlog(const char *format, va_list args)
   if (format == NULL)
     format = "SYSERR: log() received a NULL format.";
 
+  /* Held back while the area files are parsed in parallel, or written by
+   * the player save worker. */
+  if (boot_log_capture(format, args) || mysql_save_log_capture(format, args))
+    return;
+
   for (i=0;i<21;i++) timestr[i]=0;
   strftime(timestr, sizeof(timestr), "%b %d %H:%M:%S %Y", localtime(&ct));
 
@@ -128,7 +128,11 @@ void	set_title(struct char_data *ch, char *title);
 void	gain_exp(struct char_data *ch, int gain);
 void	gain_exp_regardless(struct char_data *ch, int gain);
 void	gain_condition(struct char_data *ch, int condition, int value);
+void	begin_point_update(void);
 void	point_update(void);
+void	timed_obj_check(struct obj_data *obj);
+void	timed_obj_remove(struct obj_data *obj);
+void	point_char_removed(struct char_data *ch);
 void	update_pos(struct char_data *victim);
 void run_autowiz(void);
 int increase_gold(struct char_data *ch, int amt);
@@ -460,6 +464,8 @@ do                                                              \
 #define IN_ROOM(ch)	((ch)->in_room)
 /** What room was PC/NPC previously in? */
 #define GET_WAS_IN(ch)	((ch)->was_in_room)
+/** Which zone is PC/NPC counted as present in? (see update_zone_presence) */
+#define GET_PRESENCE_ZONE(ch)	((ch)->presence_zone)
 /** How old is PC/NPC, at last recorded time? */
 #define GET_AGE(ch)     (age(ch)->year)
 
@@ -976,6 +982,9 @@ do                                                              \
 /* DG Script Options */
 #define CONFIG_SCRIPT_PLAYERS  config_info.play.script_players
 
+/** How often mobs in zones without players act (see mobile_activity). */
+#define CONFIG_UNATTENDED_AI   config_info.play.unattended_ai_rate
+
 /* Crash Saves */
 /** Get free rent setting. */
 #define CONFIG_FREE_RENT        config_info.csd.free_rent
@@ -0,0 +1,819 @@
+/**************************************************************************
+*  File: worldsnap.c                                       Part of tbaMUD *
+*  Usage: Binary snapshot of the parsed rooms, mobs, objs, zones and trigs*
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* Parsing the area files is most of a cold boot: every line goes through
+ * get_line(), fread_string() and asciiflag_conv().  This file saves the
+ * tables boot_world() ends up with -- rooms, mob and object prototypes,
+ * zones and triggers, already renumbered -- as one binary file, and loads
+ * them back instead of parsing when nothing has changed.
+ *
+ * The file holds raw images of the structs.  Pointer fields are replaced
+ * before writing: strings by their offset (plus one) into a string table at
+ * the end of the file, lists by their length, with the list entries stored
+ * in order in their own section.  Everything else a pointer could hold at
+ * boot is zeroed.  The structs are only valid for the binary that wrote
+ * them, so the header records the version, build time and struct sizes.
+ *
+ * The header also records a fingerprint of the area files: the name, size
+ * and modification time of every index and every file listed in one.  Any
+ * OLC save or hand edit changes it, and boot falls back to the parsers.
+ *
+ * Strings are copied out of the table rather than pointed into it, since
+ * OLC and free_char()/free_obj() free prototype strings one at a time. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "profiler.h"
+#include "worldsnap.h"
+#include "strpool.h"
+
+#define SNAP_MAGIC "TBAWSNAP"
+
+/* Sections of the file, in file order. */
+enum {
+  SNAP_ROOMS,      /* struct room_data */
+  SNAP_EXITS,      /* struct room_direction_data, per room in dir order */
+  SNAP_EXDESCS,    /* struct extra_descr_data, rooms' then objects' */
+  SNAP_PROTOS,     /* int trigger vnums of proto_script lists */
+  SNAP_MOBS,       /* struct char_data */
+  SNAP_MOB_VNUMS,  /* mob_vnum, one per mob */
+  SNAP_OBJS,       /* struct obj_data */
+  SNAP_OBJ_VNUMS,  /* obj_vnum, one per object */
+  SNAP_ZONES,      /* struct zone_data */
+  SNAP_CMDS,       /* struct reset_com, every zone's up to and including 'S' */
+  SNAP_TRIGS,      /* struct trig_data */
+  SNAP_TRIG_VNUMS, /* trig_vnum, one per trigger */
+  SNAP_LINES,      /* size_t string reference per trigger command line */
+  SNAP_STRINGS,    /* the string table */
+  NUM_SNAP_SECTIONS
+};
+
+static const size_t snap_elem_size[NUM_SNAP_SECTIONS] = {
+  sizeof(struct room_data), sizeof(struct room_direction_data),
+  sizeof(struct extra_descr_data), sizeof(int),
+  sizeof(struct char_data), sizeof(mob_vnum),
+  sizeof(struct obj_data), sizeof(obj_vnum),
+  sizeof(struct zone_data), sizeof(struct reset_com),
+  sizeof(struct trig_data), sizeof(trig_vnum),
+  sizeof(size_t), 1
+};
+
+struct snap_header {
+  char magic[8];
+  int version;
+  char build[24];                   /* __DATE__ " " __TIME__ of this file */
+  unsigned long long fingerprint;   /* of the area files it was made from */
+  unsigned long long checksum;      /* of everything after the header */
+  size_t file_size;
+  size_t elem_size[NUM_SNAP_SECTIONS];
+  size_t count[NUM_SNAP_SECTIONS];
+  size_t offset[NUM_SNAP_SECTIONS];
+};
+
+/* Offsets and section sizes are kept to multiples of this. */
+#define SNAP_ALIGN 8
+#define SNAP_ROUND(n) (((n) + SNAP_ALIGN - 1) & ~((size_t) SNAP_ALIGN - 1))
+
+/* A length or string reference stored in a pointer field, and back. */
+#define SNAP_NUM(n)   ((void *) (size_t) (n))
+#define SNAP_VAL(p)   ((size_t) (p))
+
+/* Growable section being written. */
+struct snap_buf {
+  char *data;
+  size_t len, size;
+};
+
+/* static local global variable declarations (current file scope only) */
+static unsigned long long area_fingerprint;
+static int have_fingerprint = FALSE;
+static int snapshot_seen = FALSE;  /* the last load found a snapshot file */
+
+static struct snap_buf snap_out[NUM_SNAP_SECTIONS];
+static size_t *snap_strhash = NULL;  /* string table offsets + 1, or 0 */
+static size_t snap_strhash_size = 0, snap_strhash_used = 0;
+
+static const char *snap_in;          /* file being loaded */
+static const struct snap_header *snap_hdr;
+static size_t snap_next[NUM_SNAP_SECTIONS];
+static int snap_damaged;
+
+/* static local function prototypes (current file scope only) */
+static unsigned long long snap_hash(unsigned long long h, const void *data, size_t len);
+static int fingerprint_index(unsigned long long *h, const char *prefix);
+static void snap_put(int sect, const void *data, size_t len);
+static size_t snap_ref(const char *str);
+static size_t put_exdescs(struct extra_descr_data *ex);
+static size_t put_protos(struct trig_proto_list *proto);
+static void put_room(struct room_data *room);
+static void put_mob(mob_rnum nr);
+static void put_obj(obj_rnum nr);
+static void put_zone(struct zone_data *zone);
+static void put_trig(struct index_data *index);
+static void free_snap_out(void);
+static int check_counts(void);
+static const void *snap_take(int sect, size_t num);
+static const char *snap_text(const char *ref);
+static char *snap_str(const char *ref);
+static char *snap_shared(const char *ref);
+static struct extra_descr_data *take_exdescs(size_t num);
+static struct trig_proto_list *take_protos(size_t num);
+static void take_world(void);
+
+/* FNV-1a, a word at a time where it can.  Used both for the fingerprint and
+ * the checksum, neither of which has to resist anything but accidents. */
+static unsigned long long snap_hash(unsigned long long h, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  unsigned long long w;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    h = (h ^ w) * 1099511628211ULL;
+    h ^= h >> 29;
+  }
+  for (; len; p++, len--)
+    h = (h ^ *p) * 1099511628211ULL;
+  return (h);
+}
+
+/* Adds an index file and every file it lists to the fingerprint. */
+static int fingerprint_index(unsigned long long *h, const char *prefix)
+{
+  char name[256], path[PATH_MAX];
+  struct stat st;
+  long long stamp[2];
+  FILE *fl;
+  int listed;
+
+  snprintf(path, sizeof(path), "%s%s", prefix, mini_mud ? MINDEX_FILE : INDEX_FILE);
+  if (!(fl = fopen(path, "r")))
+    return (FALSE);
+
+  for (listed = FALSE; ; listed = TRUE) {
+    *h = snap_hash(*h, path, strlen(path) + 1);
+    if (stat(path, &st) < 0)
+      stamp[0] = stamp[1] = -1;
+    else {
+      stamp[0] = st.st_size;
+      stamp[1] = st.st_mtime;
+    }
+    *h = snap_hash(*h, stamp, sizeof(stamp));
+
+    if (fscanf(fl, "%255s\n", name) != 1 || *name == '$')
+      break;
+    snprintf(path, sizeof(path), "%s%s", prefix, name);
+  }
+  fclose(fl);
+  return (listed);
+}
+
+/* Stats the area files that boot_world() is about to read.  Call before
+ * loading or parsing them, so a file changed mid-boot makes the snapshot
+ * stale rather than wrong. */
+void world_snapshot_fingerprint(void)
+{
+  const char *prefixes[] = { ZON_PREFIX, TRG_PREFIX, WLD_PREFIX, MOB_PREFIX, OBJ_PREFIX };
+  unsigned long long h = 14695981039346656037ULL;
+  int i, opts[3] = { WORLDSNAP_VERSION, mini_mud, CONFIG_DIAGONAL_DIRS };
+
+  have_fingerprint = FALSE;
+  h = snap_hash(h, opts, sizeof(opts));
+  for (i = 0; i < (int) (sizeof(prefixes) / sizeof(*prefixes)); i++)
+    if (!fingerprint_index(&h, prefixes[i]))
+      return;
+  area_fingerprint = h;
+  have_fingerprint = TRUE;
+}
+
+static void snap_put(int sect, const void *data, size_t len)
+{
+  struct snap_buf *b = &snap_out[sect];
+
+  if (b->len + len > b->size) {
+    b->size = MAX(b->size * 2, MAX(b->len + len, 4096));
+    RECREATE(b->data, char, b->size);
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+/* The string table reference for str, adding it if it is not there yet.
+ * Identical strings share one copy in the file. */
+static size_t snap_ref(const char *str)
+{
+  struct snap_buf *b = &snap_out[SNAP_STRINGS];
+  size_t i, ref, len;
+
+  if (!str)
+    return (0);
+
+  if (snap_strhash_used * 2 >= snap_strhash_size) {
+    size_t *old = snap_strhash, old_size = snap_strhash_size;
+
+    snap_strhash_size = MAX(old_size * 2, 4096);
+    CREATE(snap_strhash, size_t, snap_strhash_size);
+    for (i = 0; i < old_size; i++)
+      if (old[i]) {
+        const char *s = b->data + old[i] - 1;
+        size_t j = snap_hash(0, s, strlen(s)) & (snap_strhash_size - 1);
+
+        while (snap_strhash[j])
+          j = (j + 1) & (snap_strhash_size - 1);
+        snap_strhash[j] = old[i];
+      }
+    if (old)
+      free(old);
+  }
+
+  len = strlen(str);
+  for (i = snap_hash(0, str, len) & (snap_strhash_size - 1); (ref = snap_strhash[i]); i = (i + 1) & (snap_strhash_size - 1))
+    if (!strcmp(b->data + ref - 1, str))
+      return (ref);
+
+  ref = b->len + 1;
+  snap_put(SNAP_STRINGS, str, len + 1);
+  snap_strhash[i] = ref;
+  snap_strhash_used++;
+  return (ref);
+}
+
+static size_t put_exdescs(struct extra_descr_data *ex)
+{
+  struct extra_descr_data e;
+  size_t num = 0;
+
+  for (; ex; ex = ex->next, num++) {
+    e = *ex;
+    e.keyword = SNAP_NUM(snap_ref(ex->keyword));
+    e.description = SNAP_NUM(snap_ref(ex->description));
+    e.next = NULL;
+    snap_put(SNAP_EXDESCS, &e, sizeof(e));
+  }
+  return (num);
+}
+
+static size_t put_protos(struct trig_proto_list *proto)
+{
+  size_t num = 0;
+
+  for (; proto; proto = proto->next, num++)
+    snap_put(SNAP_PROTOS, &proto->vnum, sizeof(int));
+  return (num);
+}
+
+static void put_room(struct room_data *room)
+{
+  struct room_data r = *room;
+  struct room_direction_data e;
+  int dir;
+
+  r.name = SNAP_NUM(snap_ref(room->name));
+  r.description = SNAP_NUM(snap_ref(room->description));
+  r.ex_description = SNAP_NUM(put_exdescs(room->ex_description));
+  for (dir = 0; dir < NUM_OF_DIRS; dir++) {
+    if (!room->dir_option[dir])
+      continue;
+    e = *room->dir_option[dir];
+    e.general_description = SNAP_NUM(snap_ref(e.general_description));
+    e.keyword = SNAP_NUM(snap_ref(e.keyword));
+    snap_put(SNAP_EXITS, &e, sizeof(e));
+    r.dir_option[dir] = SNAP_NUM(1);
+  }
+  r.proto_script = SNAP_NUM(put_protos(room->proto_script));
+
+  /* The live script is rebuilt from proto_script at load. */
+  r.func = NULL;
+  r.script = NULL;
+  r.contents = NULL;
+  r.people = NULL;
+  r.events = NULL;
+  snap_put(SNAP_ROOMS, &r, sizeof(r));
+}
+
+static void put_mob(mob_rnum nr)
+{
+  struct char_data m = mob_proto[nr];
+  int i;
+
+  m.player.name = SNAP_NUM(snap_ref(m.player.name));
+  m.player.short_descr = SNAP_NUM(snap_ref(m.player.short_descr));
+  m.player.long_descr = SNAP_NUM(snap_ref(m.player.long_descr));
+  m.player.description = SNAP_NUM(snap_ref(m.player.description));
+  m.player.title = SNAP_NUM(snap_ref(m.player.title));
+  m.proto_script = SNAP_NUM(put_protos(mob_proto[nr].proto_script));
+
+  m.player_specials = NULL;  /* &dummy_mob */
+  m.affected = NULL;
+  for (i = 0; i < NUM_WEARS; i++)
+    m.equipment[i] = NULL;
+  m.carrying = NULL;
+  m.desc = NULL;
+  m.script = NULL;
+  m.memory = NULL;
+  m.next_in_room = m.next = m.next_fighting = NULL;
+  m.next_in_ai = m.prev_in_ai = NULL;
+  m.followers = NULL;
+  m.master = NULL;
+  m.group = NULL;
+  m.events = NULL;
+  m.cooldown = NULL;
+  m.char_specials.fighting = m.char_specials.hunting = NULL;
+  m.char_specials.furniture = NULL;
+  m.char_specials.next_in_furniture = NULL;
+  m.mob_specials.memory = NULL;
+
+  snap_put(SNAP_MOBS, &m, sizeof(m));
+  snap_put(SNAP_MOB_VNUMS, &mob_index[nr].vnum, sizeof(mob_vnum));
+}
+
+static void put_obj(obj_rnum nr)
+{
+  struct obj_data o = obj_proto[nr];
+
+  o.name = SNAP_NUM(snap_ref(o.name));
+  o.description = SNAP_NUM(snap_ref(o.description));
+  o.short_description = SNAP_NUM(snap_ref(o.short_description));
+  o.action_description = SNAP_NUM(snap_ref(o.action_description));
+  o.ex_description = SNAP_NUM(put_exdescs(obj_proto[nr].ex_description));
+  o.proto_script = SNAP_NUM(put_protos(obj_proto[nr].proto_script));
+
+  o.carried_by = o.worn_by = NULL;
+  o.in_obj = o.contains = NULL;
+  o.script = NULL;
+  o.next_content = o.next = NULL;
+  o.next_timed = o.prev_timed = NULL;
+  o.sitting_here = NULL;
+  o.events = NULL;
+
+  snap_put(SNAP_OBJS, &o, sizeof(o));
+  snap_put(SNAP_OBJ_VNUMS, &obj_index[nr].vnum, sizeof(obj_vnum));
+}
+
+static void put_zone(struct zone_data *zone)
+{
+  struct zone_data z = *zone;
+  struct reset_com c;
+  size_t num;
+
+  z.name = SNAP_NUM(snap_ref(zone->name));
+  z.builders = SNAP_NUM(snap_ref(zone->builders));
+  for (num = 0; ; num++) {
+    c = zone->cmd[num];
+    c.sarg1 = SNAP_NUM(snap_ref(c.sarg1));
+    c.sarg2 = SNAP_NUM(snap_ref(c.sarg2));
+    snap_put(SNAP_CMDS, &c, sizeof(c));
+    if (c.command == 'S')
+      break;
+  }
+  z.cmd = SNAP_NUM(num + 1);
+  z.parked_mobs = NULL;
+  z.program = NULL;
+  snap_put(SNAP_ZONES, &z, sizeof(z));
+}
+
+static void put_trig(struct index_data *index)
+{
+  struct trig_data t = *index->proto;
+  struct cmdlist_element *cmd;
+  trig_vnum vnum = index->vnum;
+  size_t num, ref;
+
+  t.name = SNAP_NUM(snap_ref(t.name));
+  t.arglist = SNAP_NUM(snap_ref(t.arglist));
+  for (num = 0, cmd = index->proto->cmdlist; cmd; cmd = cmd->next, num++) {
+    ref = snap_ref(cmd->cmd);
+    snap_put(SNAP_LINES, &ref, sizeof(ref));
+  }
+  t.cmdlist = SNAP_NUM(num);
+  t.curr_state = NULL;
+  t.wait_event = NULL;
+  t.var_list = NULL;
+  t.next = t.next_in_world = NULL;
+
+  snap_put(SNAP_TRIGS, &t, sizeof(t));
+  snap_put(SNAP_TRIG_VNUMS, &vnum, sizeof(vnum));
+}
+
+static void free_snap_out(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++) {
+    if (snap_out[i].data)
+      free(snap_out[i].data);
+    snap_out[i].data = NULL;
+    snap_out[i].len = snap_out[i].size = 0;
+  }
+  if (snap_strhash)
+    free(snap_strhash);
+  snap_strhash = NULL;
+  snap_strhash_size = snap_strhash_used = 0;
+}
+
+/* Writes the world as boot_world() has just parsed it.  Without force, only
+ * replaces a snapshot that load_world_snapshot() found stale, so a MUD that
+ * never built one with -w never gets one. */
+int save_world_snapshot(int force)
+{
+  static const char zeros[SNAP_ALIGN];
+  struct snap_header hdr;
+  char tmpname[PATH_MAX];
+  prof_time start = prof_now();
+  FILE *fl;
+  size_t pos, strings;
+  int i, ok;
+
+  if (!force && !snapshot_seen)
+    return (FALSE);
+  if (!have_fingerprint) {
+    log("SYSERR: Not writing world snapshot: could not read the world index files.");
+    return (FALSE);
+  }
+
+  for (i = 0; i <= top_of_zone_table; i++)
+    put_zone(&zone_table[i]);
+  for (i = 0; i < top_of_trigt; i++)
+    put_trig(trig_index[i]);
+  for (i = 0; i <= top_of_world; i++)
+    put_room(&world[i]);
+  for (i = 0; i <= top_of_mobt; i++)
+    put_mob(i);
+  for (i = 0; i <= top_of_objt; i++)
+    put_obj(i);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+  hdr.version = WORLDSNAP_VERSION;
+  strlcpy(hdr.build, __DATE__ " " __TIME__, sizeof(hdr.build));
+  hdr.fingerprint = area_fingerprint;
+  hdr.checksum = 14695981039346656037ULL;
+
+  pos = SNAP_ROUND(sizeof(hdr));
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++) {
+    hdr.elem_size[i] = snap_elem_size[i];
+    hdr.count[i] = snap_out[i].len / snap_elem_size[i];
+    /* Pad each section so the checksum sees the same bytes as the reader. */
+    if (snap_out[i].len % SNAP_ALIGN)
+      snap_put(i, zeros, SNAP_ALIGN - snap_out[i].len % SNAP_ALIGN);
+    hdr.offset[i] = pos;
+    hdr.checksum = snap_hash(hdr.checksum, snap_out[i].data, snap_out[i].len);
+    pos += snap_out[i].len;
+  }
+  hdr.file_size = pos;
+
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", SNAPSHOT_FILE);
+  if (!(fl = fopen(tmpname, "wb"))) {
+    log("SYSERR: Writing world snapshot %s: %s", tmpname, strerror(errno));
+    free_snap_out();
+    return (FALSE);
+  }
+  ok = fwrite(&hdr, sizeof(hdr), 1, fl) == 1;
+  if (SNAP_ROUND(sizeof(hdr)) > sizeof(hdr))
+    ok = ok && fwrite(zeros, SNAP_ROUND(sizeof(hdr)) - sizeof(hdr), 1, fl) == 1;
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++)
+    if (snap_out[i].len)
+      ok = ok && fwrite(snap_out[i].data, snap_out[i].len, 1, fl) == 1;
+  if (fclose(fl) != 0)
+    ok = FALSE;
+  strings = snap_strhash_used;
+  free_snap_out();
+
+  if (!ok || rename(tmpname, SNAPSHOT_FILE) < 0) {
+    log("SYSERR: Writing world snapshot %s: %s", SNAPSHOT_FILE, strerror(errno));
+    remove(tmpname);
+    return (FALSE);
+  }
+  snapshot_seen = TRUE;
+  log("World snapshot written: %lu bytes, %lu distinct strings, in %.1f ms.",
+      (unsigned long) hdr.file_size, (unsigned long) strings, (prof_now() - start) / 1000.0);
+  return (TRUE);
+}
+
+/* Every list length stored in the images must add up to its section. */
+static int check_counts(void)
+{
+  const struct room_data *r;
+  const struct char_data *m;
+  const struct obj_data *o;
+  const struct zone_data *z;
+  const struct trig_data *t;
+  size_t want[NUM_SNAP_SECTIONS], i;
+  int dir, sect;
+
+  memset(want, 0, sizeof(want));
+  for (i = 0; i < snap_hdr->count[SNAP_ROOMS]; i++) {
+    r = (const struct room_data *) (snap_in + snap_hdr->offset[SNAP_ROOMS]) + i;
+    want[SNAP_EXDESCS] += SNAP_VAL(r->ex_description);
+    want[SNAP_PROTOS] += SNAP_VAL(r->proto_script);
+    for (dir = 0; dir < NUM_OF_DIRS; dir++)
+      want[SNAP_EXITS] += SNAP_VAL(r->dir_option[dir]);
+  }
+  for (i = 0; i < snap_hdr->count[SNAP_MOBS]; i++) {
+    m = (const struct char_data *) (snap_in + snap_hdr->offset[SNAP_MOBS]) + i;
+    want[SNAP_PROTOS] += SNAP_VAL(m->proto_script);
+  }
+  for (i = 0; i < snap_hdr->count[SNAP_OBJS]; i++) {
+    o = (const struct obj_data *) (snap_in + snap_hdr->offset[SNAP_OBJS]) + i;
+    want[SNAP_EXDESCS] += SNAP_VAL(o->ex_description);
+    want[SNAP_PROTOS] += SNAP_VAL(o->proto_script);
+  }
+  for (i = 0; i < snap_hdr->count[SNAP_ZONES]; i++) {
+    z = (const struct zone_data *) (snap_in + snap_hdr->offset[SNAP_ZONES]) + i;
+    if (!SNAP_VAL(z->cmd))
+      return (FALSE);
+    want[SNAP_CMDS] += SNAP_VAL(z->cmd);
+  }
+  for (i = 0; i < snap_hdr->count[SNAP_TRIGS]; i++) {
+    t = (const struct trig_data *) (snap_in + snap_hdr->offset[SNAP_TRIGS]) + i;
+    want[SNAP_LINES] += SNAP_VAL(t->cmdlist);
+  }
+  want[SNAP_MOB_VNUMS] = snap_hdr->count[SNAP_MOBS];
+  want[SNAP_OBJ_VNUMS] = snap_hdr->count[SNAP_OBJS];
+  want[SNAP_TRIG_VNUMS] = snap_hdr->count[SNAP_TRIGS];
+
+  for (sect = 0; sect < NUM_SNAP_SECTIONS; sect++)
+    if (want[sect] && want[sect] != snap_hdr->count[sect])
+      return (FALSE);
+  return (!snap_hdr->count[SNAP_STRINGS] ||
+          snap_in[snap_hdr->offset[SNAP_STRINGS] + snap_hdr->count[SNAP_STRINGS] - 1] == '\0');
+}
+
+/* The next num entries of a section.  check_counts() has made sure they
+ * exist. */
+static const void *snap_take(int sect, size_t num)
+{
+  const char *p = snap_in + snap_hdr->offset[sect] + snap_next[sect] * snap_hdr->elem_size[sect];
+
+  snap_next[sect] += num;
+  return (p);
+}
+
+/* The string an image field refers to, in the mapped file. */
+static const char *snap_text(const char *ref)
+{
+  size_t off = SNAP_VAL(ref);
+
+  if (!off)
+    return (NULL);
+  if (off > snap_hdr->count[SNAP_STRINGS]) {
+    snap_damaged = TRUE;
+    return ("");
+  }
+  return (snap_in + snap_hdr->offset[SNAP_STRINGS] + off - 1);
+}
+
+/* A fresh copy of the string an image field refers to. */
+static char *snap_str(const char *ref)
+{
+  const char *text = snap_text(ref);
+
+  return (text ? strdup(text) : NULL);
+}
+
+/* The pooled copy, for room and prototype text, as the parsers store it. */
+static char *snap_shared(const char *ref)
+{
+  return (intern_string(snap_text(ref)));
+}
+
+static struct extra_descr_data *take_exdescs(size_t num)
+{
+  struct extra_descr_data *head = NULL, **tail = &head, *ex;
+
+  while (num--) {
+    CREATE(ex, struct extra_descr_data, 1);
+    memcpy(ex, snap_take(SNAP_EXDESCS, 1), sizeof(*ex));
+    ex->keyword = snap_shared(ex->keyword);
+    ex->description = snap_shared(ex->description);
+    ex->next = NULL;
+    *tail = ex;
+    tail = &ex->next;
+  }
+  return (head);
+}
+
+static struct trig_proto_list *take_protos(size_t num)
+{
+  struct trig_proto_list *head = NULL, **tail = &head, *proto;
+
+  while (num--) {
+    CREATE(proto, struct trig_proto_list, 1);
+    memcpy(&proto->vnum, snap_take(SNAP_PROTOS, 1), sizeof(int));
+    *tail = proto;
+    tail = &proto->next;
+  }
+  return (head);
+}
+
+/* Builds the five tables from the checked file, in boot_world() order. */
+static void take_world(void)
+{
+  struct cmdlist_element **cmd;
+  struct index_data *index;
+  struct trig_data *trig;
+  size_t i, j, num, ref;
+  int dir;
+
+  num = snap_hdr->count[SNAP_ZONES];
+  CREATE(zone_table, struct zone_data, num);
+  for (i = 0; i < num; i++) {
+    struct zone_data *z = &zone_table[i];
+
+    memcpy(z, snap_take(SNAP_ZONES, 1), sizeof(*z));
+    z->name = snap_str(z->name);
+    z->builders = snap_str(z->builders);
+    j = SNAP_VAL(z->cmd);
+    CREATE(z->cmd, struct reset_com, j);
+    memcpy(z->cmd, snap_take(SNAP_CMDS, j), j * sizeof(struct reset_com));
+    while (j--) {
+      z->cmd[j].sarg1 = snap_str(z->cmd[j].sarg1);
+      z->cmd[j].sarg2 = snap_str(z->cmd[j].sarg2);
+    }
+  }
+  top_of_zone_table = num - 1;
+
+  num = snap_hdr->count[SNAP_TRIGS];
+  CREATE(trig_index, struct index_data *, num);
+  for (i = 0; i < num; i++) {
+    CREATE(index, struct index_data, 1);
+    CREATE(trig, struct trig_data, 1);
+    memcpy(trig, snap_take(SNAP_TRIGS, 1), sizeof(*trig));
+    memcpy(&index->vnum, snap_take(SNAP_TRIG_VNUMS, 1), sizeof(trig_vnum));
+    index->proto = trig;
+    trig->name = snap_str(trig->name);
+    trig->arglist = snap_str(trig->arglist);
+    j = SNAP_VAL(trig->cmdlist);
+    for (cmd = &trig->cmdlist; j--; cmd = &(*cmd)->next) {
+      CREATE(*cmd, struct cmdlist_element, 1);
+      memcpy(&ref, snap_take(SNAP_LINES, 1), sizeof(ref));
+      (*cmd)->cmd = snap_str(SNAP_NUM(ref));
+    }
+    *cmd = NULL;
+    trig_index[i] = index;
+  }
+  top_of_trigt = num;
+  index_vnums(DB_BOOT_TRG);
+
+  num = snap_hdr->count[SNAP_ROOMS];
+  CREATE(world, struct room_data, num);
+  for (i = 0; i < num; i++) {
+    struct room_data *r = &world[i];
+
+    memcpy(r, snap_take(SNAP_ROOMS, 1), sizeof(*r));
+    r->name = snap_shared(r->name);
+    r->description = snap_shared(r->description);
+    r->ex_description = take_exdescs(SNAP_VAL(r->ex_description));
+    for (dir = 0; dir < NUM_OF_DIRS; dir++) {
+      if (!r->dir_option[dir])
+        continue;
+      CREATE(r->dir_option[dir], struct room_direction_data, 1);
+      memcpy(r->dir_option[dir], snap_take(SNAP_EXITS, 1), sizeof(struct room_direction_data));
+      r->dir_option[dir]->general_description = snap_shared(r->dir_option[dir]->general_description);
+      r->dir_option[dir]->keyword = snap_shared(r->dir_option[dir]->keyword);
+    }
+    r->proto_script = take_protos(SNAP_VAL(r->proto_script));
+  }
+  top_of_world = num - 1;
+  index_vnums(DB_BOOT_WLD);
+  /* As dg_read_trigger() does while parsing. */
+  for (i = 0; i < num; i++)
+    if (world[i].proto_script)
+      assign_triggers(&world[i], WLD_TRIGGER);
+
+  num = snap_hdr->count[SNAP_MOBS];
+  CREATE(mob_proto, struct char_data, num);
+  CREATE(mob_index, struct index_data, num);
+  for (i = 0; i < num; i++) {
+    struct char_data *m = &mob_proto[i];
+
+    memcpy(m, snap_take(SNAP_MOBS, 1), sizeof(*m));
+    memcpy(&mob_index[i].vnum, snap_take(SNAP_MOB_VNUMS, 1), sizeof(mob_vnum));
+    m->player.name = snap_shared(m->player.name);
+    m->player.short_descr = snap_shared(m->player.short_descr);
+    m->player.long_descr = snap_shared(m->player.long_descr);
+    m->player.description = snap_shared(m->player.description);
+    m->player.title = snap_str(m->player.title);
+    m->player_specials = &dummy_mob;
+    m->proto_script = take_protos(SNAP_VAL(m->proto_script));
+  }
+  top_of_mobt = num - 1;
+  index_vnums(DB_BOOT_MOB);
+
+  num = snap_hdr->count[SNAP_OBJS];
+  CREATE(obj_proto, struct obj_data, num);
+  CREATE(obj_index, struct index_data, num);
+  for (i = 0; i < num; i++) {
+    struct obj_data *o = &obj_proto[i];
+
+    memcpy(o, snap_take(SNAP_OBJS, 1), sizeof(*o));
+    memcpy(&obj_index[i].vnum, snap_take(SNAP_OBJ_VNUMS, 1), sizeof(obj_vnum));
+    o->name = snap_shared(o->name);
+    o->description = snap_shared(o->description);
+    o->short_description = snap_shared(o->short_description);
+    o->action_description = snap_shared(o->action_description);
+    o->ex_description = take_exdescs(SNAP_VAL(o->ex_description));
+    o->proto_script = take_protos(SNAP_VAL(o->proto_script));
+  }
+  top_of_objt = num - 1;
+  index_vnums(DB_BOOT_OBJ);
+  index_vnums(DB_BOOT_ZON);
+}
+
+/* Loads zones, triggers, rooms, mobs and objects from the snapshot if it
+ * matches the area files, in place of index_boot() and the renumbering.
+ * Returns FALSE, having loaded nothing, if the caller should parse instead. */
+int load_world_snapshot(void)
+{
+  struct snap_header hdr;
+  const char *why = NULL;
+  char *data;
+  struct stat st;
+  size_t size;
+  int fd, i;
+
+  snapshot_seen = FALSE;
+  if ((fd = open(SNAPSHOT_FILE, O_RDONLY)) < 0) {
+    if (errno != ENOENT)
+      log("SYSERR: Opening world snapshot %s: %s", SNAPSHOT_FILE, strerror(errno));
+    return (FALSE);
+  }
+  snapshot_seen = TRUE;
+
+  if (fstat(fd, &st) < 0 || (size = st.st_size) < sizeof(hdr)) {
+    log("World snapshot %s is truncated, parsing the area files.", SNAPSHOT_FILE);
+    close(fd);
+    return (FALSE);
+  }
+#ifdef HAVE_SYS_MMAN_H
+  if ((data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+    log("SYSERR: Mapping world snapshot %s: %s", SNAPSHOT_FILE, strerror(errno));
+    close(fd);
+    return (FALSE);
+  }
+#else
+  CREATE(data, char, size);
+  if (read(fd, data, size) != (ssize_t) size) {
+    log("SYSERR: Reading world snapshot %s: %s", SNAPSHOT_FILE, strerror(errno));
+    free(data);
+    close(fd);
+    return (FALSE);
+  }
+#endif
+  close(fd);
+
+  memcpy(&hdr, data, sizeof(hdr));
+  snap_in = data;
+  snap_hdr = &hdr;
+
+  if (memcmp(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic)) || hdr.version != WORLDSNAP_VERSION ||
+      strncmp(hdr.build, __DATE__ " " __TIME__, sizeof(hdr.build)) ||
+      memcmp(hdr.elem_size, snap_elem_size, sizeof(snap_elem_size)))
+    why = "was written by a different build";
+  else if (!have_fingerprint || hdr.fingerprint != area_fingerprint)
+    why = "is out of date";
+  else if (hdr.file_size != size)
+    why = "is truncated";
+  else {
+    for (i = 0; i < NUM_SNAP_SECTIONS && !why; i++)
+      if (hdr.offset[i] % SNAP_ALIGN || hdr.offset[i] > size ||
+          hdr.count[i] > (size - hdr.offset[i]) / hdr.elem_size[i])
+        why = "is damaged";
+    if (!why && (!hdr.count[SNAP_ROOMS] || !hdr.count[SNAP_ZONES] ||
+        snap_hash(14695981039346656037ULL, data + SNAP_ROUND(sizeof(hdr)), size - SNAP_ROUND(sizeof(hdr))) != hdr.checksum ||
+        !check_counts()))
+      why = "is damaged";
+  }
+
+  if (!why) {
+    memset(snap_next, 0, sizeof(snap_next));
+    snap_damaged = FALSE;
+    take_world();
+    if (snap_damaged)
+      log("SYSERR: World snapshot %s has bad string references; rebuild it with -w.", SNAPSHOT_FILE);
+    log("   %d zones, %d triggers, %d rooms, %d mobs, %d objs from %s.",
+        top_of_zone_table + 1, top_of_trigt, top_of_world + 1, top_of_mobt + 1, top_of_objt + 1,
+        SNAPSHOT_FILE);
+  } else
+    log("World snapshot %s %s, parsing the area files.", SNAPSHOT_FILE, why);
+
+#ifdef HAVE_SYS_MMAN_H
+  munmap(data, size);
+#else
+  free(data);
+#endif
+  snap_in = NULL;
+  snap_hdr = NULL;
+  return (why == NULL);
+}
@@ -0,0 +1,25 @@
+/**
+* @file worldsnap.h
+* Binary snapshot of the parsed world, used to skip the area file parsers
+* at boot.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _WORLDSNAP_H_
+#define _WORLDSNAP_H_
+
+/** Bump whenever the layout of the snapshot file changes. */
+#define WORLDSNAP_VERSION 1
+
+/* worldsnap.c */
+void world_snapshot_fingerprint(void);
+int load_world_snapshot(void);
+int save_world_snapshot(int force);
+
+#endif /* _WORLDSNAP_H_ */
@@ -17,6 +17,7 @@
 #include "genzon.h"
 #include "oasis.h"
 #include "dg_scripts.h"
+#include "zreset.h"
 
 /* Nasty internal macros to clean up the code. */
 #define MYCMD		(OLC_ZONE(d)->cmd[subcmd])
@@ -351,6 +352,7 @@ static void zedit_save_internally(struct descriptor_data *d)
     for (i=0; i<ZN_ARRAY_MAX; i++)
       zone_table[OLC_ZNUM(d)].zone_flags[(i)] = OLC_ZONE(d)->zone_flags[(i)];
   }
+  compile_zone_program(OLC_ZNUM(d));
   add_to_save_list(zone_table[OLC_ZNUM(d)].number, SL_ZON);
 }
 
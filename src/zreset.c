@@ -0,0 +1,696 @@
+/**************************************************************************
+*  File: zreset.c                                          Part of tbaMUD *
+*  Usage: Compiling zone command tables and running them to reset zones   *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+/* reset_zone() used to walk the zone's cmd table and work out, command by
+ * command, whether the if-flag chain it belongs to was still alive.  Each
+ * table is now compiled into a reset program once, and the program is what
+ * runs.  Compiling does the work that comes out the same every time:
+ *
+ *   - Every step knows where its if-flag chain ends, so a step that fails
+ *     jumps straight past the steps that depend on it.
+ *   - Commands that can never run are left out: disabled ('*') commands and
+ *     the rest of their chains, and if-flag commands at the very start.
+ *   - The rooms whose reset triggers fire are found by rnum once, instead of
+ *     looking up every vnum from bot to top on every reset.
+ *
+ * A program is compiled again when it might no longer match its table: when
+ * zedit saves the zone, when commands are added to or removed from any
+ * table, when OLC renumbers the rooms, mobiles, objects or triggers the
+ * arguments refer to (all of which call zone_programs_changed()), and when a
+ * reset disables one of its commands.
+ *
+ * 'P' still finds its container with get_obj_num(), the newest object of
+ * that kind anywhere.  Which object that is cannot be settled when the zone
+ * is compiled: load triggers can create and purge objects in the middle of
+ * a reset.  When the container was loaded earlier in the same reset it is
+ * near the head of object_list anyway.
+ *
+ * zone_update() only queues the zones that are due.  run_zone_resets() works
+ * through the queue every pulse for ZONE_RESET_BUDGET microseconds, zones
+ * with players waiting in them first.  A reset that runs over is paused at
+ * the start of a chain, never inside one, and carried on next pulse; while
+ * it waits, the mobile and object the chain steps refer to are held by
+ * script id, as they may be extracted in the meantime.  A zone that only
+ * resets while empty is checked again each time its reset carries on; if a
+ * player has come in, the reset is given up and the zone queued again.
+ * reset_zone(), for boot, zreset and OLC, still runs a whole program at
+ * once. */
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "comm.h"
+#include "handler.h"
+#include "graph.h"
+#include "screen.h"
+#include "dg_scripts.h"
+#include "profiler.h"
+#include "zreset.h"
+
+/* A reset in progress.  run_zone_resets() keeps one going across pulses;
+ * reset_zone() runs one from start to end. */
+struct zone_run {
+  zone_vnum zone;       /* by vnum, as OLC can renumber the zone table */
+  int pc;               /* the next step to run */
+  int last_cmd;
+  struct char_data *mob, *tmob;
+  struct obj_data *tobj;
+  long mob_id, tmob_id, tobj_id; /* the same, by script id, while paused */
+  bool lost_mob;        /* mob was extracted while the reset was paused */
+  unsigned long usec;   /* time spent on the reset so far */
+  int pulses;           /* pulses it has run in */
+};
+
+/* Bumped whenever a program may no longer match its zone's cmd table. */
+static int zone_program_generation = 0;
+
+/* The staggered reset under way, if zone_run_active. */
+static struct zone_run active_run;
+static bool zone_run_active = FALSE;
+
+/** What run_zone_resets() has done since record_usage() last cleared it. */
+struct zone_reset_stats zone_reset_stats;
+
+/* local functions */
+static struct zone_program *zone_program(zone_rnum zone);
+static void record_reset_time(zone_rnum zone, unsigned long usec);
+static bool run_zone_program(zone_rnum zone, struct zone_program *prog,
+                             struct zone_run *run, prof_time deadline);
+static void restart_zone_run(struct zone_run *run);
+static void pause_zone_run(struct zone_run *run);
+static void resume_zone_run(struct zone_run *run);
+static zone_rnum next_queued_zone(void);
+static void requeue_zone(zone_rnum zone);
+static void announce_zone_reset(zone_rnum zone);
+
+/** Compile a zone's command table, replacing its old program.  Called from
+ * boot and zedit; reset_zone() calls it for a program that is out of date. */
+void compile_zone_program(zone_rnum zone)
+{
+  struct reset_com *cmd = zone_table[zone].cmd;
+  struct zone_program *prog;
+  struct zone_op *op;
+  room_vnum rvnum;
+  room_rnum rnum;
+  int cmd_no, num_cmds, i, next_chain;
+  bool dead = TRUE;   /* the chain being compiled can never run */
+
+  for (num_cmds = 0; cmd[num_cmds].command != 'S'; num_cmds++)
+    ;
+
+  free_zone_program(zone);
+  prog = (struct zone_program *)calloc(1, sizeof(struct zone_program) +
+           MAX(num_cmds - 1, 0) * sizeof(struct zone_op));
+  if (!prog) {
+    perror("SYSERR: malloc failure");
+    abort();
+  }
+  prog->generation = zone_program_generation;
+  prog->num_cmds = num_cmds;
+
+  for (cmd_no = 0; cmd_no < num_cmds; cmd_no++) {
+    /* A command without the if-flag starts a chain; one with it runs only
+     * while the chain is going well.  Before the first plain command,
+     * last_cmd is 0, and '*' always leaves it 0. */
+    if (!cmd[cmd_no].if_flag)
+      dead = FALSE;
+    if (dead)
+      continue;
+    if (cmd[cmd_no].command == '*') {
+      dead = TRUE;
+      continue;
+    }
+
+    op = &prog->ops[prog->num_ops++];
+    op->command = cmd[cmd_no].command;
+    op->if_flag = cmd[cmd_no].if_flag;
+    op->cmd_no = cmd_no;
+    op->arg1 = cmd[cmd_no].arg1;
+    op->arg2 = cmd[cmd_no].arg2;
+    op->arg3 = cmd[cmd_no].arg3;
+  }
+
+  /* A step that fails goes on with the start of the next chain. */
+  for (next_chain = prog->num_ops, i = prog->num_ops - 1; i >= 0; i--) {
+    prog->ops[i].skip = next_chain;
+    if (!prog->ops[i].if_flag)
+      next_chain = i;
+  }
+
+  /* The world is sorted by vnum, so the zone's rooms are one run of rnums. */
+  prog->first_room = prog->last_room = NOWHERE;
+  for (rvnum = zone_table[zone].bot; rvnum <= zone_table[zone].top; rvnum++)
+    if ((rnum = real_room(rvnum)) != NOWHERE) {
+      if (prog->first_room == NOWHERE)
+        prog->first_room = rnum;
+      prog->last_room = rnum;
+    }
+
+  zone_table[zone].program = prog;
+
+  /* A paused reset of the zone cannot go on in a program it was not in. */
+  if (zone_run_active && active_run.zone == zone_table[zone].number)
+    restart_zone_run(&active_run);
+}
+
+/** Compile every zone, once the world is loaded. */
+void compile_zone_programs(void)
+{
+  prof_time start = prof_now();
+  zone_rnum zone;
+  int cmds = 0, ops = 0;
+
+  for (zone = 0; zone <= top_of_zone_table; zone++) {
+    compile_zone_program(zone);
+    cmds += zone_table[zone].program->num_cmds;
+    ops += zone_table[zone].program->num_ops;
+  }
+
+  log("   %d zone commands compiled to %d reset steps in %.1f ms.", cmds, ops,
+      (prof_now() - start) / 1000.0);
+}
+
+void free_zone_program(zone_rnum zone)
+{
+  if (zone_table[zone].program)
+    free(zone_table[zone].program);
+  zone_table[zone].program = NULL;
+}
+
+/** Some zone's cmd table, or the rnums in it, may have changed: compile
+ * every program again before it next runs. */
+void zone_programs_changed(void)
+{
+  zone_program_generation++;
+}
+
+static struct zone_program *zone_program(zone_rnum zone)
+{
+  struct zone_program *prog = zone_table[zone].program;
+
+  if (!prog || prog->stale || prog->generation != zone_program_generation)
+    compile_zone_program(zone);
+
+  return (zone_table[zone].program);
+}
+
+static void record_reset_time(zone_rnum zone, unsigned long usec)
+{
+  struct zone_data *z = &zone_table[zone];
+
+  z->reset_count++;
+  z->reset_usec += usec;
+  z->last_reset_usec = usec;
+  if (usec > z->max_reset_usec)
+    z->max_reset_usec = usec;
+}
+
+#define ZCMD zone_table[zone].cmd[op->cmd_no]
+
+#define ZONE_ERROR(message) \
+	{ log_zone_error(zone, op->cmd_no, message); last_cmd = 0; }
+
+/* Disable the command in the zone table; the program is compiled again
+ * without it before the next reset. */
+#define DISABLE_CMD() \
+	{ ZCMD.command = '*'; prog->stale = TRUE; }
+
+/* Run a zone's program from run->pc on.  With a deadline, stop at the first
+ * chain that starts after it, having run one chain at least.  Returns TRUE
+ * once the whole program has run and the reset triggers have fired. */
+static bool run_zone_program(zone_rnum zone, struct zone_program *prog,
+                             struct zone_run *run, prof_time deadline)
+{
+  struct zone_op *op;
+  int pc = run->pc, last_cmd = run->last_cmd;
+  struct char_data *mob = run->mob;
+  struct obj_data *obj, *obj_to;
+  room_rnum rrnum;
+  struct char_data *tmob = run->tmob; /* for trigger assignment */
+  struct obj_data *tobj = run->tobj;  /* for trigger assignment */
+  bool started = FALSE;
+
+  /* Steps that depend on a failed one are jumped over.  'T' and 'V' can
+   * leave last_cmd as it was, failed or not. */
+  for (; pc < prog->num_ops; pc = last_cmd ? pc + 1 : op->skip) {
+    op = &prog->ops[pc];
+
+    /* Pause only where a chain starts, so that no chain is ever split. */
+    if (!op->if_flag) {
+      if (deadline && started && prof_now() >= deadline)
+        break;
+      started = TRUE;
+    }
+
+    /* This is the list of actual zone commands. If any new zone commands are
+     * added to the game, be certain to update the list of commands in load_zone
+     * () so that the counting will still be correct. - ae. */
+    switch (op->command) {
+    case 'M':			/* read a mobile */
+      if (mob_index[op->arg1].number < op->arg2) {
+	mob = read_mobile(op->arg1, REAL);
+	run->lost_mob = FALSE;
+	char_to_room(mob, op->arg3);
+        load_mtrigger(mob);
+        tmob = mob;
+	last_cmd = 1;
+      } else
+	last_cmd = 0;
+      tobj = NULL;
+      break;
+
+    case 'O':			/* read an object */
+      if (obj_index[op->arg1].number < op->arg2) {
+	if (op->arg3 != NOWHERE) {
+	  obj = read_object(op->arg1, REAL);
+	  obj_to_room(obj, op->arg3);
+	  last_cmd = 1;
+          load_otrigger(obj);
+          tobj = obj;
+	} else {
+	  obj = read_object(op->arg1, REAL);
+	  IN_ROOM(obj) = NOWHERE;
+	  last_cmd = 1;
+          tobj = obj;
+	}
+      } else
+	last_cmd = 0;
+      tmob = NULL;
+      break;
+
+    case 'P':			/* object to object */
+      if (obj_index[op->arg1].number < op->arg2) {
+	obj = read_object(op->arg1, REAL);
+	if (!(obj_to = get_obj_num(op->arg3))) {
+	  ZONE_ERROR("target obj not found, command disabled");
+	  DISABLE_CMD();
+	  break;
+	}
+	obj_to_obj(obj, obj_to);
+	last_cmd = 1;
+        load_otrigger(obj);
+        tobj = obj;
+      } else
+	last_cmd = 0;
+      tmob = NULL;
+      break;
+
+    case 'G':			/* obj_to_char */
+      if (!mob && run->lost_mob) {
+        /* Its mobile was extracted while the reset was paused. */
+        last_cmd = 0;
+        break;
+      }
+      if (!mob) {
+	char error[MAX_INPUT_LENGTH];
+	snprintf(error, sizeof(error), "attempt to give obj #%d to non-existant mob, command disabled", obj_index[op->arg1].vnum);
+	ZONE_ERROR(error);
+	DISABLE_CMD();
+	break;
+      }
+      if (obj_index[op->arg1].number < op->arg2) {
+	obj = read_object(op->arg1, REAL);
+	obj_to_char(obj, mob);
+	last_cmd = 1;
+        load_otrigger(obj);
+        tobj = obj;
+      } else
+	last_cmd = 0;
+      tmob = NULL;
+      break;
+
+    case 'E':			/* object to equipment list */
+      if (!mob && run->lost_mob) {
+        /* Its mobile was extracted while the reset was paused. */
+        last_cmd = 0;
+        break;
+      }
+      if (!mob) {
+	char error[MAX_INPUT_LENGTH];
+	snprintf(error, sizeof(error), "trying to equip non-existant mob with obj #%d, command disabled", obj_index[op->arg1].vnum);
+	ZONE_ERROR(error);
+	DISABLE_CMD();
+	break;
+      }
+      if (obj_index[op->arg1].number < op->arg2) {
+	if (op->arg3 < 0 || op->arg3 >= NUM_WEARS) {
+          char error[MAX_INPUT_LENGTH];
+	  snprintf(error, sizeof(error), "invalid equipment pos number (mob %s, obj %d, pos %d)", GET_NAME(mob), obj_index[op->arg2].vnum, op->arg3);
+	  ZONE_ERROR(error);
+	} else {
+	  obj = read_object(op->arg1, REAL);
+          IN_ROOM(obj) = IN_ROOM(mob);
+          load_otrigger(obj);
+          if (wear_otrigger(obj, mob, op->arg3)) {
+            IN_ROOM(obj) = NOWHERE;
+            equip_char(mob, obj, op->arg3);
+          } else
+            obj_to_char(obj, mob);
+          tobj = obj;
+	  last_cmd = 1;
+	}
+      } else
+	last_cmd = 0;
+      tmob = NULL;
+      break;
+
+    case 'R': /* rem obj from room */
+      if ((obj = get_obj_in_list_num(op->arg2, world[op->arg1].contents)) != NULL)
+        extract_obj(obj);
+      last_cmd = 1;
+      tmob = NULL;
+      tobj = NULL;
+      break;
+
+
+    case 'D':			/* set state of door */
+      if (op->arg2 < 0 || op->arg2 >= DIR_COUNT ||
+	  (world[op->arg1].dir_option[op->arg2] == NULL)) {
+        char error[MAX_INPUT_LENGTH];
+        snprintf(error, sizeof(error), "door does not exist in room %d - dir %d, command disabled",  world[op->arg1].number, op->arg2);
+	ZONE_ERROR(error);
+	DISABLE_CMD();
+      } else
+	switch (op->arg3) {
+	case 0:
+	  REMOVE_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		     EX_LOCKED);
+	  REMOVE_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		     EX_CLOSED);
+	  break;
+	case 1:
+	  SET_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		  EX_CLOSED);
+	  REMOVE_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		     EX_LOCKED);
+	  break;
+	case 2:
+	  SET_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		  EX_LOCKED);
+	  SET_BIT(world[op->arg1].dir_option[op->arg2]->exit_info,
+		  EX_CLOSED);
+	  break;
+	}
+      route_door_changed(op->arg1);
+      last_cmd = 1;
+      tmob = NULL;
+      tobj = NULL;
+      break;
+
+    case 'T': /* trigger command */
+      if (op->arg1==MOB_TRIGGER && tmob) {
+        if (!SCRIPT(tmob))
+          SCRIPT(tmob) = create_script(tmob, MOB_TRIGGER);
+        add_trigger(SCRIPT(tmob), read_trigger(op->arg2), -1);
+        last_cmd = 1;
+      } else if (op->arg1==OBJ_TRIGGER && tobj) {
+        if (!SCRIPT(tobj))
+          SCRIPT(tobj) = create_script(tobj, OBJ_TRIGGER);
+        add_trigger(SCRIPT(tobj), read_trigger(op->arg2), -1);
+        last_cmd = 1;
+      } else if (op->arg1==WLD_TRIGGER) {
+        if (op->arg3 == NOWHERE || op->arg3>top_of_world) {
+          ZONE_ERROR("Invalid room number in trigger assignment");
+        }
+        if (!world[op->arg3].script)
+          world[op->arg3].script = create_script(&world[op->arg3], WLD_TRIGGER);
+        add_trigger(world[op->arg3].script, read_trigger(op->arg2), -1);
+        last_cmd = 1;
+      }
+
+      break;
+
+    case 'V':
+      if (op->arg1==MOB_TRIGGER && tmob) {
+        if (!SCRIPT(tmob)) {
+          ZONE_ERROR("Attempt to give variable to scriptless mobile");
+        } else
+          add_var(&(SCRIPT(tmob)->global_vars), ZCMD.sarg1, ZCMD.sarg2,
+                  op->arg3);
+        last_cmd = 1;
+      } else if (op->arg1==OBJ_TRIGGER && tobj) {
+        if (!SCRIPT(tobj)) {
+          ZONE_ERROR("Attempt to give variable to scriptless object");
+        } else
+          add_var(&(SCRIPT(tobj)->global_vars), ZCMD.sarg1, ZCMD.sarg2,
+                  op->arg3);
+        last_cmd = 1;
+      } else if (op->arg1==WLD_TRIGGER) {
+        if (op->arg3 == NOWHERE || op->arg3>top_of_world) {
+          ZONE_ERROR("Invalid room number in variable assignment");
+        } else {
+          if (!(world[op->arg3].script)) {
+            ZONE_ERROR("Attempt to give variable to scriptless object");
+          } else
+            add_var(&(world[op->arg3].script->global_vars),
+                    ZCMD.sarg1, ZCMD.sarg2, op->arg2);
+          last_cmd = 1;
+        }
+      }
+      break;
+
+    default:
+      ZONE_ERROR("unknown cmd in reset table; cmd disabled");
+      DISABLE_CMD();
+      break;
+    }
+  }
+
+  run->pc = pc;
+  run->last_cmd = last_cmd;
+  run->mob = mob;
+  run->tmob = tmob;
+  run->tobj = tobj;
+  if (pc < prog->num_ops)
+    return (FALSE);
+
+  zone_table[zone].age = 0;
+
+  /* handle reset_wtrigger's */
+  if (prog->first_room != NOWHERE)
+    for (rrnum = prog->first_room; rrnum <= prog->last_room; rrnum++)
+      reset_wtrigger(&world[rrnum]);
+
+  return (TRUE);
+}
+
+/* Start a run over, from the first step of its zone's program. */
+static void restart_zone_run(struct zone_run *run)
+{
+  run->pc = run->last_cmd = 0;
+  run->mob = run->tmob = NULL;
+  run->tobj = NULL;
+  run->mob_id = run->tmob_id = run->tobj_id = 0;
+  run->lost_mob = FALSE;
+}
+
+/* Between pulses the mobiles and objects a paused run points at can be
+ * extracted, so it holds on to their script ids instead. */
+static void pause_zone_run(struct zone_run *run)
+{
+  run->mob_id = run->mob ? char_script_id(run->mob) : 0;
+  run->tmob_id = run->tmob ? char_script_id(run->tmob) : 0;
+  run->tobj_id = run->tobj ? obj_script_id(run->tobj) : 0;
+  run->mob = run->tmob = NULL;
+  run->tobj = NULL;
+}
+
+static void resume_zone_run(struct zone_run *run)
+{
+  run->mob = run->mob_id ? find_char(run->mob_id) : NULL;
+  run->tmob = run->tmob_id ? find_char(run->tmob_id) : NULL;
+  run->tobj = run->tobj_id ? find_obj(run->tobj_id) : NULL;
+  if (run->mob_id && !run->mob)
+    run->lost_mob = TRUE;
+}
+
+/* execute the reset program of a given zone, all of it at once */
+void reset_zone(zone_rnum zone)
+{
+  struct zone_run run;
+  prof_time start = prof_now();
+
+  /* A staggered reset of the zone still under way is overtaken by this one. */
+  if (zone_run_active && active_run.zone == zone_table[zone].number)
+    zone_run_active = FALSE;
+
+  memset(&run, 0, sizeof(run));
+  run.zone = zone_table[zone].number;
+  run_zone_program(zone, zone_program(zone), &run, 0);
+
+  record_reset_time(zone, prof_now() - start);
+}
+
+/* Take the zone to reset next off the queue: the first one players are
+ * waiting in, or failing that the first one that may be reset now. */
+static zone_rnum next_queued_zone(void)
+{
+  struct reset_q_element *q, *prev, *pick = NULL, *pick_prev = NULL;
+  zone_rnum zone;
+
+  for (prev = NULL, q = reset_q.head; q; prev = q, q = q->next) {
+    zone = q->zone_to_reset;
+    if (zone_table[zone].reset_mode != 2 && !is_empty(zone))
+      continue;
+    if (!pick || zone_table[zone].num_present > 0) {
+      pick = q;
+      pick_prev = prev;
+    }
+    if (zone_table[zone].num_present > 0)
+      break;
+  }
+
+  if (!pick)
+    return (NOWHERE);
+
+  if (!pick_prev)
+    reset_q.head = pick->next;
+  else
+    pick_prev->next = pick->next;
+  if (!pick->next)
+    reset_q.tail = pick_prev;
+
+  zone = pick->zone_to_reset;
+  free(pick);
+  return (zone);
+}
+
+/* Put a zone back at the end of the queue, as zone_update() queues it. */
+static void requeue_zone(zone_rnum zone)
+{
+  struct reset_q_element *q;
+
+  CREATE(q, struct reset_q_element, 1);
+  q->zone_to_reset = zone;
+  q->next = NULL;
+
+  if (!reset_q.head)
+    reset_q.head = reset_q.tail = q;
+  else {
+    reset_q.tail->next = q;
+    reset_q.tail = q;
+  }
+}
+
+static void announce_zone_reset(zone_rnum zone)
+{
+  struct descriptor_data *pt;
+
+  mudlog(CMP, LVL_IMPL+1, FALSE, "Auto zone reset: %s (Zone %d)",
+      zone_table[zone].name, zone_table[zone].number);
+  for (pt = descriptor_list; pt; pt = pt->next)
+    if (IS_PLAYING(pt) && pt->character && PRF_FLAGGED(pt->character, PRF_ZONERESETS))
+      send_to_char(pt->character, "%s[Auto zone reset: %s (Zone %d)]%s",
+        CCGRN(pt->character, C_NRM), zone_table[zone].name,
+        zone_table[zone].number, CCNRM(pt->character, C_NRM));
+}
+
+/** Called every pulse: carry on with the zone resets queued by
+ * zone_update(), for ZONE_RESET_BUDGET microseconds at most.  A reset that
+ * does not fit is paused between two chains and picked up next pulse. */
+void run_zone_resets(void)
+{
+  struct zone_program *prog;
+  prof_time start, deadline, slice;
+  unsigned long usec;
+  zone_rnum zone;
+  bool done;
+
+  if (!zone_run_active && !reset_q.head)
+    return;
+
+  start = prof_now();
+  deadline = start + ZONE_RESET_BUDGET;
+
+  do {
+    if (!zone_run_active) {
+      if ((zone = next_queued_zone()) == NOWHERE)
+        break;
+      memset(&active_run, 0, sizeof(active_run));
+      active_run.zone = zone_table[zone].number;
+      zone_run_active = TRUE;
+      prog = zone_program(zone);
+    } else {
+      if ((zone = real_zone(active_run.zone)) == NOWHERE) {
+        zone_run_active = FALSE;
+        continue;
+      }
+      /* A zone that resets only while empty may have had a player walk in
+       * while it was paused.  Give the reset up and wait for the zone to
+       * empty again; it will start over from the beginning. */
+      if (zone_table[zone].reset_mode != 2 && !is_empty(zone)) {
+        zone_run_active = FALSE;
+        requeue_zone(zone);
+        zone_reset_stats.requeued++;
+        continue;
+      }
+      resume_zone_run(&active_run);
+      /* The table may have been changed by OLC while the reset was paused.
+       * A program only made stale by this very reset is left alone. */
+      prog = zone_table[zone].program;
+      if (!prog || prog->generation != zone_program_generation) {
+        compile_zone_program(zone);
+        prog = zone_table[zone].program;
+      }
+    }
+
+    slice = prof_now();
+    done = run_zone_program(zone, prog, &active_run, deadline);
+    active_run.usec += prof_now() - slice;
+    active_run.pulses++;
+
+    if (!done) {
+      pause_zone_run(&active_run);
+      break;
+    }
+
+    zone_run_active = FALSE;
+    record_reset_time(zone, active_run.usec);
+    zone_reset_stats.zones++;
+    if (active_run.pulses > 1)
+      zone_reset_stats.split++;
+    announce_zone_reset(zone);
+  } while (prof_now() < deadline);
+
+  usec = prof_now() - start;
+  zone_reset_stats.pulses++;
+  zone_reset_stats.usec += usec;
+  if (usec > zone_reset_stats.max_usec)
+    zone_reset_stats.max_usec = usec;
+}
+
+/** zreset * <rounds>: reset every zone the given number of times and report
+ * how long it took. */
+void benchmark_zone_resets(struct char_data *ch, int rounds)
+{
+  prof_time start = prof_now();
+  unsigned long usec, slowest_usec = 0;
+  zone_rnum zone, slowest = NOWHERE;
+  int round;
+
+  for (round = 0; round < rounds; round++)
+    for (zone = 0; zone <= top_of_zone_table; zone++) {
+      reset_zone(zone);
+      if (zone_table[zone].last_reset_usec > slowest_usec) {
+        slowest_usec = zone_table[zone].last_reset_usec;
+        slowest = zone;
+      }
+    }
+  usec = prof_now() - start;
+
+  send_to_char(ch, "Reset %d zones %d time%s in %.1f ms: %.1f ms a pass, %.3f ms a zone.\r\n",
+    top_of_zone_table + 1, rounds, rounds == 1 ? "" : "s", usec / 1000.0,
+    usec / 1000.0 / rounds, usec / 1000.0 / rounds / (top_of_zone_table + 1));
+  if (slowest != NOWHERE)
+    send_to_char(ch, "Slowest reset: zone #%d (%s), %.2f ms.\r\n",
+      zone_table[slowest].number, zone_table[slowest].name, slowest_usec / 1000.0);
+}
@@ -0,0 +1,61 @@
+/**
+* @file zreset.h
+* Zone command tables compiled into reset programs, and the code that runs
+* them.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+* Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University
+* CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.
+*
+*/
+#ifndef _ZRESET_H_
+#define _ZRESET_H_
+
+/** One step of a reset program: a zone command that can run. */
+struct zone_op {
+  char command;      /**< the zone command letter, 'M', 'O', ... */
+  bool if_flag;      /**< runs only if the step before it succeeded */
+  int cmd_no;        /**< the command in the zone's cmd table */
+  int skip;          /**< step to go on with when this one fails */
+  int arg1, arg2, arg3; /**< the command's arguments, as rnums */
+};
+
+/** A zone's command table, compiled by compile_zone_program(). */
+struct zone_program {
+  int generation;    /**< zone_program_generation it was compiled against */
+  bool stale;        /**< a command was disabled since; compile it again */
+  int num_cmds;      /**< commands in the table, the closing 'S' not counted */
+  int num_ops;       /**< steps kept, the ones that can never run dropped */
+  room_rnum first_room; /**< rooms of the zone, for reset triggers; */
+  room_rnum last_room;  /**< first_room is NOWHERE if it has none */
+  struct zone_op ops[1]; /**< num_ops steps */
+};
+
+/** At most this many microseconds a pulse go to the zone resets queued by
+ * zone_update().  A large reset is carried on over several pulses. */
+#define ZONE_RESET_BUDGET 2000
+
+/** Zone reset cost, logged and cleared by record_usage(). */
+struct zone_reset_stats {
+  int zones;              /**< queued zones reset */
+  int split;              /**< ... of which over more than one pulse */
+  int requeued;           /**< paused resets given up as players came in */
+  int pulses;             /**< pulses that spent time on resets */
+  unsigned long usec;     /**< time those pulses spent */
+  unsigned long max_usec; /**< most spent in one pulse */
+};
+
+extern struct zone_reset_stats zone_reset_stats;
+
+/* zreset.c */
+void compile_zone_program(zone_rnum zone);
+void compile_zone_programs(void);
+void free_zone_program(zone_rnum zone);
+void zone_programs_changed(void);
+void run_zone_resets(void);
+void benchmark_zone_resets(struct char_data *ch, int rounds);
+
+#endif /* _ZRESET_H_ */